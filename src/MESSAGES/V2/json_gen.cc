@@ -0,0 +1,449 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+
+/*! \file    json_gen.cc
+ *  \brief   generator of reflection-free JSON encoders for protocol messages
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+/*
+ * This host tool walks the descriptors of the compiled-in protocol messages
+ * and emits, for every message type given on the command line, a function
+ *
+ *   void write(std::string& out, const T& m);
+ *
+ * which appends m to out exactly as google::protobuf::util::MessageToJsonString()
+ * with the default options writes it (field order, lowerCamelCase names,
+ * quoted 64-bit integers, enums by name, string escaping), using the
+ * generated accessors instead of the protobuf reflection API. Message types
+ * reachable from T get a static encoder in the same file. Field types that
+ * do not appear in the statistics and configuration messages (floating
+ * point, bytes, maps, groups) are rejected at generation time. Strings which
+ * are not valid UTF-8, which the JSON printer does not keep verbatim, make
+ * write() fall back to the reflection API for the whole message.
+ *
+ * usage: flpt_json_gen <output dir> <full message name>...
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/descriptor.h>
+
+#include "flexran.pb.h"
+
+namespace gpb = google::protobuf;
+
+static std::string cpp_namespace(const std::string& package)
+{
+  std::string ns = "::";
+  for (char c : package)
+    ns += c == '.' ? std::string("::") : std::string(1, c);
+  return ns;
+}
+
+static std::string cpp_class_name(const gpb::Descriptor *d)
+{
+  std::string name = d->name();
+  for (const gpb::Descriptor *c = d->containing_type(); c; c = c->containing_type())
+    name = c->name() + "_" + name;
+  return cpp_namespace(d->file()->package()) + "::" + name;
+}
+
+static std::string cpp_enum_name(const gpb::EnumDescriptor *e)
+{
+  std::string name = e->name();
+  for (const gpb::Descriptor *c = e->containing_type(); c; c = c->containing_type())
+    name = c->name() + "_" + name;
+  return cpp_namespace(e->file()->package()) + "::" + name;
+}
+
+static std::string pb_header(const gpb::FileDescriptor *f)
+{
+  const std::string& n = f->name();
+  return n.substr(0, n.rfind(".proto")) + ".pb.h";
+}
+
+/* name of the accessors of f: protoc appends an underscore to C++ keywords */
+static std::string cpp_field_name(const gpb::FieldDescriptor *f)
+{
+  static const char *keywords[] = {
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor",
+    "bool", "break", "case", "catch", "char", "class", "compl", "const",
+    "constexpr", "const_cast", "continue", "decltype", "default", "delete",
+    "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+    "extern", "false", "float", "for", "friend", "goto", "if", "inline",
+    "int", "long", "mutable", "namespace", "new", "noexcept", "not",
+    "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected",
+    "public", "register", "reinterpret_cast", "return", "short", "signed",
+    "sizeof", "static", "static_assert", "static_cast", "struct", "switch",
+    "template", "this", "thread_local", "throw", "true", "try", "typedef",
+    "typeid", "typename", "union", "unsigned", "using", "virtual", "void",
+    "volatile", "wchar_t", "while", "xor", "xor_eq"
+  };
+  const std::string name = f->lowercase_name();
+  for (const char *k : keywords)
+    if (name == k)
+      return name + "_";
+  return name;
+}
+
+/* name of the static encoder of d in the generated file */
+static std::string writer_name(const gpb::Descriptor *d)
+{
+  std::string name = "write_";
+  for (char c : d->full_name())
+    name += c == '.' ? '_' : c;
+  return name;
+}
+
+static const char *banner =
+    "// Generated by flpt_json_gen. DO NOT EDIT!\n";
+
+static const char *reflection_decl =
+    "    /// reference implementation through the reflection API, for any message\n"
+    "    void write_reflection(std::string& out, const google::protobuf::Message& m);\n";
+
+/* helpers of the generated encoders. Strings are escaped like the protobuf
+ * JSON printer does, see google/protobuf/util/internal/json_escaping.cc */
+static const char *helpers =
+    "\n"
+    "namespace {\n"
+    "\n"
+    "const char hex_digits[] = \"0123456789abcdef\";\n"
+    "\n"
+    "inline void key(std::string& out, bool& first, const char *k)\n"
+    "{\n"
+    "  if (!first) out += ',';\n"
+    "  first = false;\n"
+    "  out += k;\n"
+    "}\n"
+    "\n"
+    "void write_uint(std::string& out, uint64_t v)\n"
+    "{\n"
+    "  char d[20];\n"
+    "  char *p = d + sizeof(d);\n"
+    "  do {\n"
+    "    *--p = '0' + v % 10;\n"
+    "    v /= 10;\n"
+    "  } while (v > 0);\n"
+    "  out.append(p, d + sizeof(d) - p);\n"
+    "}\n"
+    "\n"
+    "void write_int(std::string& out, int64_t v)\n"
+    "{\n"
+    "  if (v < 0) {\n"
+    "    out += '-';\n"
+    "    write_uint(out, ~static_cast<uint64_t>(v) + 1);\n"
+    "  } else {\n"
+    "    write_uint(out, v);\n"
+    "  }\n"
+    "}\n"
+    "\n"
+    "void write_enum(std::string& out, const std::string& name, int v)\n"
+    "{\n"
+    "  if (name.empty()) {\n"
+    "    write_int(out, v);\n"
+    "    return;\n"
+    "  }\n"
+    "  out += '\"';\n"
+    "  out += name;\n"
+    "  out += '\"';\n"
+    "}\n"
+    "\n"
+    "void write_unit(std::string& out, uint32_t u)\n"
+    "{\n"
+    "  const char e[6] = { '\\\\', 'u', hex_digits[(u >> 12) & 0xf],\n"
+    "      hex_digits[(u >> 8) & 0xf], hex_digits[(u >> 4) & 0xf], hex_digits[u & 0xf] };\n"
+    "  out.append(e, sizeof(e));\n"
+    "}\n"
+    "\n"
+    "/* code points that the JSON printer escapes besides \\\" and \\\\ */\n"
+    "bool needs_escape(uint32_t cp)\n"
+    "{\n"
+    "  return cp < 0x20 || cp == '<' || cp == '>' || (cp >= 0x7f && cp <= 0x9f)\n"
+    "      || cp == 0xad || (cp >= 0x600 && cp <= 0x603) || cp == 0x6dd\n"
+    "      || cp == 0x70f || (cp >= 0x17b4 && cp <= 0x17b5)\n"
+    "      || (cp >= 0x200b && cp <= 0x200f) || (cp >= 0x2028 && cp <= 0x202e)\n"
+    "      || (cp >= 0x2060 && cp <= 0x2064) || (cp >= 0x206a && cp <= 0x206f)\n"
+    "      || cp == 0xfeff || (cp >= 0xfff9 && cp <= 0xfffb)\n"
+    "      || (cp >= 0x1d173 && cp <= 0x1d17a) || cp == 0xe0001\n"
+    "      || (cp >= 0xe0020 && cp <= 0xe007f);\n"
+    "}\n"
+    "\n"
+    "/* returns false if s is not valid UTF-8 */\n"
+    "bool write_string(std::string& out, const std::string& s)\n"
+    "{\n"
+    "  out += '\"';\n"
+    "  const unsigned char *p = reinterpret_cast<const unsigned char *>(s.data());\n"
+    "  const unsigned char *end = p + s.size();\n"
+    "  while (p < end) {\n"
+    "    const unsigned char *run = p;\n"
+    "    while (p < end && *p >= 0x20 && *p < 0x7f && *p != '\"' && *p != '\\\\'\n"
+    "        && *p != '<' && *p != '>')\n"
+    "      ++p;\n"
+    "    out.append(reinterpret_cast<const char *>(run), p - run);\n"
+    "    if (p == end) break;\n"
+    "\n"
+    "    uint32_t cp;\n"
+    "    int len;\n"
+    "    if (*p < 0x80)      { cp = *p;        len = 1; }\n"
+    "    else if (*p < 0xc2) { return false; }\n"
+    "    else if (*p < 0xe0) { cp = *p & 0x1f; len = 2; }\n"
+    "    else if (*p < 0xf0) { cp = *p & 0x0f; len = 3; }\n"
+    "    else if (*p < 0xf5) { cp = *p & 0x07; len = 4; }\n"
+    "    else                { return false; }\n"
+    "    if (end - p < len) return false;\n"
+    "    for (int i = 1; i < len; ++i) {\n"
+    "      if ((p[i] & 0xc0) != 0x80) return false;\n"
+    "      cp = cp << 6 | (p[i] & 0x3f);\n"
+    "    }\n"
+    "    if ((len == 3 && cp < 0x800) || (len == 4 && (cp < 0x10000 || cp > 0x10ffff))\n"
+    "        || (cp >= 0xd800 && cp <= 0xdfff))\n"
+    "      return false;\n"
+    "\n"
+    "    switch (cp) {\n"
+    "      case '\"':  out += \"\\\\\\\"\"; break;\n"
+    "      case '\\\\': out += \"\\\\\\\\\"; break;\n"
+    "      case '\\b': out += \"\\\\b\"; break;\n"
+    "      case '\\t': out += \"\\\\t\"; break;\n"
+    "      case '\\n': out += \"\\\\n\"; break;\n"
+    "      case '\\f': out += \"\\\\f\"; break;\n"
+    "      case '\\r': out += \"\\\\r\"; break;\n"
+    "      default:\n"
+    "        if (!needs_escape(cp)) {\n"
+    "          out.append(reinterpret_cast<const char *>(p), len);\n"
+    "        } else if (cp < 0x10000) {\n"
+    "          write_unit(out, cp);\n"
+    "        } else {\n"
+    "          write_unit(out, 0xd800 + ((cp - 0x10000) >> 10));\n"
+    "          write_unit(out, 0xdc00 + ((cp - 0x10000) & 0x3ff));\n"
+    "        }\n"
+    "        break;\n"
+    "    }\n"
+    "    p += len;\n"
+    "  }\n"
+    "  out += '\"';\n"
+    "  return true;\n"
+    "}\n"
+    "\n"
+    "}\n";
+
+static const char *reflection_impl =
+    "void protocol::json::write_reflection(std::string& out,\n"
+    "    const google::protobuf::Message& m)\n"
+    "{\n"
+    "  std::string s;\n"
+    "  google::protobuf::util::MessageToJsonString(m, &s,\n"
+    "      google::protobuf::util::JsonPrintOptions());\n"
+    "  out += s;\n"
+    "}\n";
+
+/* collects d and all message types reachable from it, in order of discovery */
+static bool collect(const gpb::Descriptor *d, std::vector<const gpb::Descriptor *>& all)
+{
+  if (std::find(all.begin(), all.end(), d) != all.end())
+    return true;
+  all.push_back(d);
+  for (int i = 0; i < d->field_count(); ++i) {
+    const gpb::FieldDescriptor *f = d->field(i);
+    if (f->is_map() || f->type() == gpb::FieldDescriptor::TYPE_GROUP
+        || f->cpp_type() == gpb::FieldDescriptor::CPPTYPE_FLOAT
+        || f->cpp_type() == gpb::FieldDescriptor::CPPTYPE_DOUBLE
+        || f->type() == gpb::FieldDescriptor::TYPE_BYTES) {
+      std::cerr << "unsupported type " << f->type_name() << " of field "
+                << f->full_name() << "\n";
+      return false;
+    }
+    if (f->cpp_type() == gpb::FieldDescriptor::CPPTYPE_MESSAGE
+        && !collect(f->message_type(), all))
+      return false;
+  }
+  return true;
+}
+
+/* returns the statement appending value v of field f */
+static std::string write_value(const gpb::FieldDescriptor *f, const std::string& v)
+{
+  switch (f->cpp_type()) {
+    case gpb::FieldDescriptor::CPPTYPE_INT32:
+      return "write_int(out, " + v + ");";
+    case gpb::FieldDescriptor::CPPTYPE_UINT32:
+      return "write_uint(out, " + v + ");";
+    case gpb::FieldDescriptor::CPPTYPE_INT64:
+      return "out += '\"'; write_int(out, " + v + "); out += '\"';";
+    case gpb::FieldDescriptor::CPPTYPE_UINT64:
+      return "out += '\"'; write_uint(out, " + v + "); out += '\"';";
+    case gpb::FieldDescriptor::CPPTYPE_BOOL:
+      return "out += " + v + " ? \"true\" : \"false\";";
+    case gpb::FieldDescriptor::CPPTYPE_ENUM:
+      return "write_enum(out, " + cpp_enum_name(f->enum_type()) + "_Name("
+          + v + "), " + v + ");";
+    case gpb::FieldDescriptor::CPPTYPE_STRING:
+      return "if (!write_string(out, " + v + ")) return false;";
+    case gpb::FieldDescriptor::CPPTYPE_MESSAGE:
+      return "if (!" + writer_name(f->message_type()) + "(out, " + v + ")) return false;";
+    default:
+      return "";
+  }
+}
+
+static void write_encoder(std::ostream& cc, const gpb::Descriptor *d)
+{
+  cc << "\nbool " << writer_name(d) << "(std::string& out,\n"
+     << "    const " << cpp_class_name(d) << "& m)\n"
+     << "{\n";
+
+  /* the JSON printer writes fields in the order of their numbers */
+  std::vector<const gpb::FieldDescriptor *> fields;
+  for (int i = 0; i < d->field_count(); ++i)
+    fields.push_back(d->field(i));
+  std::sort(fields.begin(), fields.end(),
+      [] (const gpb::FieldDescriptor *a, const gpb::FieldDescriptor *b)
+      { return a->number() < b->number(); });
+
+  if (fields.empty())
+    cc << "  (void) m;\n";
+  else
+    cc << "  bool first = true;\n";
+  cc << "  out += '{';\n";
+  for (const gpb::FieldDescriptor *f : fields) {
+    const std::string name = cpp_field_name(f);
+    const std::string k = "\"\\\"" + f->json_name() + "\\\":\"";
+    if (f->is_repeated()) {
+      cc << "  if (m." << name << "_size() > 0) {\n"
+         << "    key(out, first, " << k << ");\n"
+         << "    out += '[';\n"
+         << "    for (int i = 0; i < m." << name << "_size(); ++i) {\n"
+         << "      if (i > 0) out += ',';\n"
+         << "      " << write_value(f, "m." + name + "(i)") << "\n"
+         << "    }\n"
+         << "    out += ']';\n"
+         << "  }\n";
+    } else {
+      cc << "  if (m.has_" << name << "()) {\n"
+         << "    key(out, first, " << k << ");\n"
+         << "    " << write_value(f, "m." + name + "()") << "\n"
+         << "  }\n";
+    }
+  }
+  cc << "  out += '}';\n"
+     << "  return true;\n"
+     << "}\n";
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <output dir> <message>...\n";
+    return 1;
+  }
+  const std::string out_dir = argv[1];
+
+  /* reference a message of flexran.proto so that the linker pulls in all
+   * descriptors of the protocol */
+  protocol::flexran_message::descriptor();
+  const gpb::DescriptorPool *pool = gpb::DescriptorPool::generated_pool();
+
+  std::vector<const gpb::Descriptor *> msgs;
+  std::vector<const gpb::Descriptor *> all;
+  for (int i = 2; i < argc; ++i) {
+    const gpb::Descriptor *d = pool->FindMessageTypeByName(argv[i]);
+    if (!d) {
+      std::cerr << argv[0] << ": unknown message type " << argv[i] << "\n";
+      return 1;
+    }
+    msgs.push_back(d);
+    if (!collect(d, all)) {
+      std::cerr << argv[0] << ": cannot generate an encoder for " << argv[i] << "\n";
+      return 1;
+    }
+  }
+
+  std::ofstream h(out_dir + "/flexran_json.h");
+  std::ofstream cc(out_dir + "/flexran_json.cc");
+  if (!h || !cc) {
+    std::cerr << argv[0] << ": cannot open output files in " << out_dir << "\n";
+    return 1;
+  }
+
+  h << banner
+    << "#ifndef FLEXRAN_JSON_H_\n"
+    << "#define FLEXRAN_JSON_H_\n\n"
+    << "#include <string>\n\n"
+    << "#include <google/protobuf/message.h>\n";
+  std::vector<std::string> headers;
+  for (const gpb::Descriptor *d : msgs) {
+    const std::string hdr = pb_header(d->file());
+    if (std::find(headers.begin(), headers.end(), hdr) == headers.end())
+      headers.push_back(hdr);
+  }
+  for (const std::string& hdr : headers)
+    h << "#include \"" << hdr << "\"\n";
+  h << "\nnamespace protocol {\n\n"
+    << "  namespace json {\n\n"
+    << "    /// append m to out like google::protobuf::util::MessageToJsonString()\n"
+    << "    /// with the default options\n";
+  for (const gpb::Descriptor *d : msgs)
+    h << "    void write(std::string& out, const " << cpp_class_name(d) << "& m);\n";
+  h << "\n" << reflection_decl
+    << "\n  }\n\n"
+    << "}\n\n"
+    << "#endif /* FLEXRAN_JSON_H_ */\n";
+
+  cc << banner
+     << "#include <cstdint>\n\n"
+     << "#include <google/protobuf/util/json_util.h>\n\n"
+     << "#include \"flexran_json.h\"\n";
+  headers.clear();
+  for (const gpb::Descriptor *d : all) {
+    const std::string hdr = pb_header(d->file());
+    if (std::find(headers.begin(), headers.end(), hdr) == headers.end())
+      headers.push_back(hdr);
+  }
+  for (const std::string& hdr : headers)
+    cc << "#include \"" << hdr << "\"\n";
+  cc << helpers
+     << "\nnamespace {\n\n";
+  for (const gpb::Descriptor *d : all)
+    cc << "bool " << writer_name(d) << "(std::string& out, const "
+       << cpp_class_name(d) << "& m);\n";
+  for (const gpb::Descriptor *d : all)
+    write_encoder(cc, d);
+  cc << "\n}\n";
+
+  for (const gpb::Descriptor *d : msgs) {
+    cc << "\nvoid protocol::json::write(std::string& out,\n"
+       << "    const " << cpp_class_name(d) << "& m)\n"
+       << "{\n"
+       << "  const std::size_t start = out.size();\n"
+       << "  if (!" << writer_name(d) << "(out, m)) {\n"
+       << "    out.resize(start);\n"
+       << "    write_reflection(out, m);\n"
+       << "  }\n"
+       << "}\n";
+  }
+  cc << "\n" << reflection_impl;
+
+  return h && cc ? 0 : 1;
+}
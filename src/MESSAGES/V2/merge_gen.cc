@@ -0,0 +1,148 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    merge_gen.cc
+ *  \brief   generator of reflection-free merge helpers for protocol messages
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+/*
+ * This host tool walks the descriptors of the compiled-in protocol messages
+ * and emits, for every message type given on the command line, a function
+ *
+ *   void clear_repeated_if_present(T *dst, const T& src);
+ *
+ * which clears every repeated field of dst that has at least one element in
+ * src, using the generated accessors instead of the protobuf reflection API.
+ * Together with T::MergeFrom(), this replaces repeated fields that are present
+ * in an update instead of appending to them.
+ *
+ * usage: flpt_merge_gen <output dir> <full message name>...
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/descriptor.h>
+
+#include "flexran.pb.h"
+
+namespace gpb = google::protobuf;
+
+static std::string cpp_namespace(const std::string& package)
+{
+  std::string ns = "::";
+  for (char c : package)
+    ns += c == '.' ? std::string("::") : std::string(1, c);
+  return ns;
+}
+
+static std::string cpp_class_name(const gpb::Descriptor *d)
+{
+  std::string name = d->name();
+  for (const gpb::Descriptor *c = d->containing_type(); c; c = c->containing_type())
+    name = c->name() + "_" + name;
+  return cpp_namespace(d->file()->package()) + "::" + name;
+}
+
+static std::string pb_header(const gpb::FileDescriptor *f)
+{
+  const std::string& n = f->name();
+  return n.substr(0, n.rfind(".proto")) + ".pb.h";
+}
+
+static const char *banner =
+    "// Generated by flpt_merge_gen. DO NOT EDIT!\n";
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <output dir> <message>...\n";
+    return 1;
+  }
+  const std::string out_dir = argv[1];
+
+  /* reference a message of flexran.proto so that the linker pulls in all
+   * descriptors of the protocol */
+  protocol::flexran_message::descriptor();
+  const gpb::DescriptorPool *pool = gpb::DescriptorPool::generated_pool();
+
+  std::vector<const gpb::Descriptor *> msgs;
+  for (int i = 2; i < argc; ++i) {
+    const gpb::Descriptor *d = pool->FindMessageTypeByName(argv[i]);
+    if (!d) {
+      std::cerr << argv[0] << ": unknown message type " << argv[i] << "\n";
+      return 1;
+    }
+    msgs.push_back(d);
+  }
+
+  std::ofstream h(out_dir + "/flexran_merge.h");
+  std::ofstream cc(out_dir + "/flexran_merge.cc");
+  if (!h || !cc) {
+    std::cerr << argv[0] << ": cannot open output files in " << out_dir << "\n";
+    return 1;
+  }
+
+  h << banner
+    << "#ifndef FLEXRAN_MERGE_H_\n"
+    << "#define FLEXRAN_MERGE_H_\n\n";
+  std::vector<std::string> headers;
+  for (const gpb::Descriptor *d : msgs) {
+    const std::string hdr = pb_header(d->file());
+    if (std::find(headers.begin(), headers.end(), hdr) == headers.end())
+      headers.push_back(hdr);
+  }
+  for (const std::string& hdr : headers)
+    h << "#include \"" << hdr << "\"\n";
+  h << "\nnamespace protocol {\n\n"
+    << "  namespace merge {\n\n"
+    << "    /// clear all repeated fields in dst which are present in src\n";
+  for (const gpb::Descriptor *d : msgs)
+    h << "    void clear_repeated_if_present(" << cpp_class_name(d) << " *dst,\n"
+      << "        const " << cpp_class_name(d) << "& src);\n";
+  h << "\n  }\n\n"
+    << "}\n\n"
+    << "#endif /* FLEXRAN_MERGE_H_ */\n";
+
+  cc << banner
+     << "#include \"flexran_merge.h\"\n";
+  for (const gpb::Descriptor *d : msgs) {
+    cc << "\nvoid protocol::merge::clear_repeated_if_present(\n"
+       << "    " << cpp_class_name(d) << " *dst,\n"
+       << "    const " << cpp_class_name(d) << "& src)\n"
+       << "{\n";
+    int n = 0;
+    for (int i = 0; i < d->field_count(); ++i) {
+      const gpb::FieldDescriptor *f = d->field(i);
+      if (!f->is_repeated()) continue;
+      const std::string name = f->lowercase_name();
+      cc << "  if (src." << name << "_size() > 0) dst->clear_" << name << "();\n";
+      n++;
+    }
+    if (n == 0)
+      cc << "  (void) dst;\n  (void) src;\n";
+    cc << "}\n";
+  }
+
+  return h && cc ? 0 : 1;
+}
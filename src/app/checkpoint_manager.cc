@@ -0,0 +1,147 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    checkpoint_manager.cc
+ *  \brief   app periodically checkpointing the RIB for warm restarts
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <chrono>
+
+#include "rt_controller_common.h"
+#include "checkpoint_manager.h"
+#include "thread_placement.h"
+#include "flexran_log.h"
+
+flexran::app::management::checkpoint_manager::checkpoint_manager(
+    const flexran::rib::Rib& rib, const flexran::core::requests_manager& rm,
+    flexran::event::subscription& sub, std::shared_ptr<rib::checkpoint_file> file,
+    std::shared_ptr<const stats::stats_manager> stats, uint64_t period_ms)
+  : component(rib, rm, sub),
+    file_(file),
+    stats_(stats),
+    written_(false),
+    last_version_(0),
+    last_requests_version_(0),
+    pending_(nullptr),
+    failed_(false),
+    stop_(false),
+    period_(period_ms),
+    writer_(&flexran::app::management::checkpoint_manager::writer, this)
+{
+  /* copying the RIB might take longer than a tick, so run it as a job in
+   * parallel to other apps */
+  subscribe_job("checkpoint",
+      boost::bind(&flexran::app::management::checkpoint_manager::tick, this, _1),
+      event::footprint().reads("rib").reads("stats").writes("checkpoint"),
+      event_sub_.ms_to_ticks(period_ms));
+}
+
+flexran::app::management::checkpoint_manager::~checkpoint_manager()
+{
+  {
+    std::lock_guard<std::mutex> l(wake_m_);
+    stop_ = true;
+  }
+  wake_cv_.notify_one();
+  writer_.join();
+}
+
+void flexran::app::management::checkpoint_manager::tick(uint64_t ms)
+{
+  _unused(ms);
+  checkpoint();
+}
+
+bool flexran::app::management::checkpoint_manager::checkpoint(bool force)
+{
+  if (!force && written_ && !changed())
+    return false;
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  /* take the versions first: a change in between is seen next time */
+  const uint64_t version = rib_.get_version();
+  const uint64_t requests_version = stats_ ? stats_->get_requests_version() : 0;
+  std::unique_ptr<protocol::flex_rib_checkpoint> cp(new protocol::flex_rib_checkpoint);
+  cp->set_timestamp_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+  rib_.fill_checkpoint(*cp);
+  if (stats_) stats_->fill_checkpoint(*cp);
+  const int num_bs = cp->bs_size();
+
+  /* a checkpoint the writer did not get to yet is outdated */
+  delete pending_.exchange(cp.release());
+  wake_cv_.notify_one();
+  failed_ = false;
+  written_ = true;
+  last_version_ = version;
+  last_requests_version_ = requests_version;
+  const std::chrono::duration<float, std::micro> dur = std::chrono::steady_clock::now() - start;
+  LOG4CXX_DEBUG(flog::app, "checkpoint_manager: took checkpoint with " << num_bs
+      << " BS(s) in " << dur.count() << "us");
+  return true;
+}
+
+void flexran::app::management::checkpoint_manager::writer()
+{
+  flexran::core::name_thread("rtc-checkpoint");
+  for (;;) {
+    std::unique_ptr<protocol::flex_rib_checkpoint> cp(pending_.exchange(nullptr));
+    if (!cp) {
+      if (stop_)
+        return;
+      /* the job does not take the lock when notifying, so a notification
+       * might be missed; the timeout bounds the delay */
+      std::unique_lock<std::mutex> l(wake_m_);
+      wake_cv_.wait_for(l, period_, [this] { return stop_ || pending_ != nullptr; });
+      continue;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string error;
+    if (!file_->store(*cp, error)) {
+      LOG4CXX_ERROR(flog::app, "checkpoint_manager: " << error);
+      failed_ = true; // retry in the next period
+      continue;
+    }
+    const std::chrono::duration<float, std::micro> dur = std::chrono::steady_clock::now() - start;
+    LOG4CXX_DEBUG(flog::app, "checkpoint_manager: stored checkpoint "
+        << file_->get_sequence() << " with " << cp->bs_size() << " BS(s) in "
+        << dur.count() << "us");
+  }
+}
+
+bool flexran::app::management::checkpoint_manager::changed() const
+{
+  if (failed_)
+    return true;
+  if (stats_ && stats_->get_requests_version() != last_requests_version_)
+    return true;
+  if (rib_.get_version() == last_version_)
+    return false;
+  /* statistics are not part of a checkpoint, only look at the rest */
+  const rib::rib_changes c = rib_.get_changes_since(last_version_);
+  if (!c.complete || !c.removed_bs.empty())
+    return true;
+  for (const rib::bs_changes& b : c.bs) {
+    if (b.has_config_changes())
+      return true;
+  }
+  return false;
+}
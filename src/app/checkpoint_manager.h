@@ -0,0 +1,95 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    checkpoint_manager.h
+ *  \brief   app periodically checkpointing the RIB for warm restarts
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef CHECKPOINT_MANAGER_H_
+#define CHECKPOINT_MANAGER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "component.h"
+#include "rib_checkpoint.h"
+#include "stats_manager.h"
+
+namespace flexran {
+
+  namespace app {
+
+    namespace management {
+
+      /// Stores agents, configurations and stats requests of all BSs in a
+      /// checkpoint file every period_ms if any of them changed, so that a
+      /// restarted controller can reattach reconnecting BSs immediately (see
+      /// rib::Rib::preload()). The checkpoint is taken in a job, but stored
+      /// by a thread of its own: writing the mapped file can fault in pages
+      /// and remap it, which must not delay the task manager when it runs
+      /// the jobs itself.
+      class checkpoint_manager : public component {
+
+      public:
+
+        checkpoint_manager(const rib::Rib& rib, const core::requests_manager& rm,
+            event::subscription& sub, std::shared_ptr<rib::checkpoint_file> file,
+            std::shared_ptr<const stats::stats_manager> stats, uint64_t period_ms);
+        /// stores the last checkpoint taken, if not done yet
+        ~checkpoint_manager();
+        void tick(uint64_t ms);
+
+        /// takes a checkpoint if anything changed since the last one and
+        /// hands it to the writer thread
+        bool checkpoint(bool force = false);
+
+      private:
+        bool changed() const;
+        void writer();
+
+        std::shared_ptr<rib::checkpoint_file> file_;
+        std::shared_ptr<const stats::stats_manager> stats_;
+        bool written_;
+        uint64_t last_version_;
+        uint64_t last_requests_version_;
+
+        /* the newest checkpoint not stored yet. The job never waits for the
+         * writer, which picks it up when notified or at the latest after
+         * period_ */
+        std::atomic<protocol::flex_rib_checkpoint *> pending_;
+        std::atomic<bool> failed_;
+        std::atomic<bool> stop_;
+        const std::chrono::milliseconds period_;
+        std::mutex wake_m_;
+        std::condition_variable wake_cv_;
+        std::thread writer_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* CHECKPOINT_MANAGER_H_ */
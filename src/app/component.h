@@ -56,6 +56,42 @@ namespace flexran {
       virtual void run_app() { LOG4CXX_ERROR(flog::app, "run_app() not implemented"); }
 
     protected:
+      //! subscribes fn as a job of this app run every period ticks. Unlike
+      //  subscribe_task_tick(), the task manager might run it in parallel
+      //  to jobs of other apps if fp does not conflict with theirs; jobs of
+      //  the same app are never run concurrently
+      bs2::connection subscribe_job(const std::string& name,
+          std::function<void(uint64_t)> fn, const event::footprint& fp,
+          uint64_t period, uint64_t start = 0, uint64_t deadline_us = 0,
+          event::missed_tick_policy missed = event::missed_tick_policy::skip)
+      {
+        auto job = std::make_shared<event::task_job>();
+        job->name = name;
+        job->fn = std::move(fn);
+        job->owner = this;
+        job->fp = fp;
+        job->deadline_us = deadline_us;
+        job->app = event_sub_.get_accounting().get_app(name);
+        return event_sub_.subscribe_task_job(job, period, start, missed);
+      }
+
+      //! delivers the events matching filter asynchronously: they are
+      //  queued while the RIB updater runs and fn handles them in a job of
+      //  this app in the same tick, in order. Returns the inbox, e.g., to
+      //  check for dropped events
+      std::shared_ptr<event::event_inbox> subscribe_events(const std::string& name,
+          const event::event_filter& filter,
+          std::function<void(const event::bs_ue_event&)> fn,
+          const event::footprint& fp, std::size_t capacity = 4096)
+      {
+        auto inbox = std::make_shared<event::event_inbox>(capacity);
+        event_sub_.subscribe_inbox(filter, inbox, name);
+        subscribe_job(name,
+            [inbox, fn] (uint64_t) { inbox->drain(fn); },
+            fp, 1);
+        return inbox;
+      }
+
       const rib::Rib& rib_;
       const core::requests_manager& req_manager_;
       event::subscription& event_sub_;
@@ -27,6 +27,7 @@
 #include "flexran_log.h"
 #include "rt_controller_common.h"
 
+#include <algorithm>
 #include <chrono>
 #include <string>
 #include <thread>
@@ -56,26 +57,43 @@ flexran::app::log::elastic_search::~elastic_search()
 }
 
 
+void flexran::app::log::elastic_search::stats_update(const event::stats_update& u)
+{
+  std::vector<rib::rnti_t>& r = fresh_ues_[u.bs_id];
+  r.insert(r.end(), u.rntis.begin(), u.rntis.end());
+}
+
 void flexran::app::log::elastic_search::process_stats(uint64_t tick)
 {
   _unused(tick);
 
-  //Collect all UE stats from all BS and fill the bulk batch
+  /* nothing to do if no UE sent stats since the last time */
+  if (fresh_ues_.empty())
+    return;
+
+  //Collect the UE stats that are new since the last time and fill the bulk batch
   int ue_count = 0;
-  for (uint64_t bs_id : rib_.get_available_base_stations()) {
-    std::shared_ptr<rib::enb_rib_info> bs_config = rib_.get_bs(bs_id);
-    const auto& lueu = bs_config->get_ue_configs();
-    ue_count += lueu.ue_config().size();
-    for(auto& flex_ue_config : lueu.ue_config()) {
-      const flexran::rib::rnti_t rnti = flex_ue_config.rnti();
-      std::shared_ptr<rib::ue_mac_rib_info> ue_mac_info = bs_config->get_ue_mac_info(rnti);
-      const std::string json = rib_.format_statistics_to_json(
-          std::chrono::system_clock::now(),
-          "",
-          ue_mac_info->dump_stats_to_json_string());
-      batch_stats_data_ += bulk_create_index("mac_stats", json);
-    }
-  }
+  rib_.for_each_bs([this, &ue_count] (const rib::enb_rib_info& bs) {
+    auto it = fresh_ues_.find(bs.get_id());
+    if (it == fresh_ues_.end())
+      return;
+    std::vector<rib::rnti_t>& fresh = it->second;
+    std::sort(fresh.begin(), fresh.end());
+    bs.for_each_ue(
+        [this, &fresh, &ue_count] (const protocol::flex_ue_config& c,
+                                   const rib::ue_mac_rib_info& ue_mac_info) {
+          if (!std::binary_search(fresh.begin(), fresh.end(), c.rnti()))
+            return;
+          const std::string json = rib_.format_statistics_to_json(
+              std::chrono::system_clock::now(),
+              "",
+              ue_mac_info.dump_stats_to_json_string());
+          batch_stats_data_ += bulk_create_index("mac_stats", json);
+          ue_count++;
+        }
+    );
+  });
+  fresh_ues_.clear();
   batch_stats_current_no_ += ue_count;
 
   if (batch_stats_current_no_ >= batch_stats_max_no_) {
@@ -90,10 +108,8 @@ void flexran::app::log::elastic_search::ue_disconnect(uint64_t bs_id, flexran::r
   _unused(rnti);
 
   int ue_count = 0;
-  for (uint64_t bs_id : rib_.get_available_base_stations()) {
-    std::shared_ptr<rib::enb_rib_info> bs_config = rib_.get_bs(bs_id);
-    ue_count += bs_config->get_ue_configs().ue_config().size();
-  }
+  rib_.for_each_bs([&ue_count] (const rib::enb_rib_info& bs)
+      { ue_count += bs.get_ue_configs().ue_config().size(); });
   /* if it is the last UE (new ue_count 0), send the batch off */
   if (ue_count == 0) {
     trigger_send(batch_stats_data_);
@@ -264,9 +280,10 @@ bool flexran::app::log::elastic_search::set_freq_stats(int freq)
     if (tick_stats_.connected())
       tick_stats_.disconnect();
     if (freq_stats_ > 0)
-      tick_stats_ = event_sub_.subscribe_task_tick(
-          boost::bind(&flexran::app::log::elastic_search::process_config, this, _1),
-          freq_stats_, event_sub_.last_tick());
+      tick_stats_ = subscribe_job("elastic_stats",
+          boost::bind(&flexran::app::log::elastic_search::process_stats, this, _1),
+          event::footprint().reads("rib").writes("elastic"),
+          event_sub_.ms_to_ticks(freq_stats_), event_sub_.last_tick());
   }
   return true;
 }
@@ -280,9 +297,10 @@ bool flexran::app::log::elastic_search::set_freq_config(int freq)
     if (tick_config_.connected())
       tick_config_.disconnect();
     if (freq_config_ > 0)
-      tick_config_ = event_sub_.subscribe_task_tick(
+      tick_config_ = subscribe_job("elastic_config",
           boost::bind(&flexran::app::log::elastic_search::process_config, this, _1),
-          freq_config_, event_sub_.last_tick());
+          event::footprint().reads("rib").writes("elastic"),
+          event_sub_.ms_to_ticks(freq_config_), event_sub_.last_tick());
   }
   return true;
 }
@@ -304,10 +322,8 @@ bool flexran::app::log::elastic_search::set_batch_config_max_size(int size)
 void flexran::app::log::elastic_search::initialise_batch_stats()
 {
   int ue_count = 0;
-  for (uint64_t bs_id : rib_.get_available_base_stations()) {
-    std::shared_ptr<rib::enb_rib_info> bs_config = rib_.get_bs(bs_id);
-    ue_count += bs_config->get_ue_configs().ue_config().size();
-  }
+  rib_.for_each_bs([&ue_count] (const rib::enb_rib_info& bs)
+      { ue_count += bs.get_ue_configs().ue_config().size(); });
 
   batch_stats_current_no_ = 0;
   batch_stats_data_.clear();
@@ -319,7 +335,7 @@ void flexran::app::log::elastic_search::initialise_batch_stats()
 
 void flexran::app::log::elastic_search::initialise_batch_config()
 {
-  const int bs_count = rib_.get_available_base_stations().size();
+  const int bs_count = rib_.get_bs_ids().size();
 
   batch_config_current_no_ = 0;
   batch_config_data_.clear();
@@ -344,21 +360,33 @@ bool flexran::app::log::elastic_search::enable_logging()
   initialise_batch_config();
 
   if (freq_config_ > 0) {
-    tick_config_ = event_sub_.subscribe_task_tick(
+    tick_config_ = subscribe_job("elastic_config",
         boost::bind(&flexran::app::log::elastic_search::process_config, this, _1),
-        freq_config_, event_sub_.last_tick());
+        event::footprint().reads("rib").writes("elastic"),
+        event_sub_.ms_to_ticks(freq_config_), event_sub_.last_tick());
   }
   if (freq_stats_ > 0) {
-    tick_stats_ = event_sub_.subscribe_task_tick(
+    tick_stats_ = subscribe_job("elastic_stats",
         boost::bind(&flexran::app::log::elastic_search::process_stats, this, _1),
-        freq_stats_, event_sub_.last_tick());
+        event::footprint().reads("rib").writes("elastic"),
+        event_sub_.ms_to_ticks(freq_stats_), event_sub_.last_tick());
+    /* only log the stats of UEs that sent new ones. The event signals are
+     * changed by the task manager between ticks */
+    stats_update_ = event_sub_.defer([this] {
+        fresh_ues_.clear();
+        return event_sub_.subscribe_stats_update(
+            boost::bind(&flexran::app::log::elastic_search::stats_update, this, _1));
+      }).get();
     /* UE disconnect: send batch if last UE disconnected */
-    ue_disconnect_ = event_sub_.subscribe_ue_disconnect(
-        boost::bind(&flexran::app::log::elastic_search::ue_disconnect, this, _1, _2));
+    ue_disconnect_ = event_sub_.defer([this] {
+        return event_sub_.subscribe_ue_disconnect(
+            boost::bind(&flexran::app::log::elastic_search::ue_disconnect, this, _1, _2));
+      }).get();
   }
-  tick_curl_ = event_sub_.subscribe_task_tick(
+  tick_curl_ = subscribe_job("elastic_curl",
       boost::bind(&flexran::app::log::elastic_search::process_curl, this, _1),
-        20, 0);
+      event::footprint().reads("rib").writes("elastic"),
+      event_sub_.ms_to_ticks(20), 0);
 
   return true;
 }
@@ -367,7 +395,12 @@ bool flexran::app::log::elastic_search::disable_logging()
 {
   if (tick_config_.connected()) tick_config_.disconnect();
   if (tick_stats_.connected()) tick_stats_.disconnect();
-  if (ue_disconnect_.connected()) ue_disconnect_.disconnect();
+  /* might be called in a job (process_curl()), so don't wait: the task
+   * manager disconnects before the next tick */
+  event_sub_.defer([this] {
+      if (ue_disconnect_.connected()) ue_disconnect_.disconnect();
+      if (stats_update_.connected()) stats_update_.disconnect();
+    });
   if (tick_curl_.connected()) tick_curl_.disconnect();
   wait_curl_end();
   return true;
@@ -29,6 +29,7 @@
 #include "rib_common.h"
 
 #include <curl/curl.h>
+#include <map>
 #include <vector>
 #include <chrono>
 
@@ -78,6 +79,9 @@ namespace flexran {
         std::string batch_stats_data_;
         void initialise_batch_config();
         void process_stats(uint64_t tick);
+        void stats_update(const event::stats_update& u);
+        /// RNTIs per BS that sent stats since the last process_stats()
+        std::map<uint64_t, std::vector<rib::rnti_t>> fresh_ues_;
         void ue_disconnect(uint64_t bs_id, flexran::rib::rnti_t rnti);
 
         std::string bulk_create_index(const std::string& index , const std::string& data);
@@ -98,6 +102,7 @@ namespace flexran {
 
         bs2::connection tick_stats_;
         bs2::connection ue_disconnect_;
+        bs2::connection stats_update_;
         bs2::connection tick_config_;
         bs2::connection tick_curl_;
       };
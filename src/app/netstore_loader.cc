@@ -207,8 +207,9 @@ void flexran::app::management::netstore_loader::process_list(
                         id,
                         xid,
                         type),
-            1,
-            0);
+            event_sub_.ms_to_ticks(1),
+            0,
+            "netstore_loader");
       } else {
         LOG4CXX_WARN(flog::app, "no such object \"" << id << "\" found on NetStore, aborting");
       }
@@ -229,7 +230,8 @@ void flexran::app::management::netstore_loader::trigger_app_request(
                   0,
                   protocol::FLCDT_AGENT_CONTROL_APP),
       10,
-      0);
+      0,
+      "netstore_loader");
 }
 
 void flexran::app::management::netstore_loader::trigger_app_stop(
@@ -334,6 +336,7 @@ void flexran::app::management::netstore_loader::process_control_del_req(
                   id,
                   xid,
                   type),
-      10,
-      0);
+      event_sub_.ms_to_ticks(10),
+      0,
+      "netstore_loader");
 }
@@ -26,10 +26,9 @@
 #include <thread>
 #include <iomanip>
 
-#include <google/protobuf/util/json_util.h>
-
 #include "recorder.h"
 #include "enb_rib_info.h"
+#include "flexran_json.h"
 #include "flexran_log.h"
 
 bool flexran::app::log::bs_dump::operator==(const bs_dump& other) const
@@ -63,10 +62,6 @@ bool flexran::app::log::bs_dump::operator==(const bs_dump& other) const
 bool flexran::app::log::recorder::start_meas(uint64_t duration,
     const std::string& type, std::string& id)
 {
-  /* in case we are currently in a measurement, do not handle */
-  if (current_job_)
-    LOG4CXX_DEBUG(flog::app, "recorder: job already running, starting next immediately after");
-
   job_type jt;
   if      (type == "all")   jt = job_type::all;
   else if (type == "enb")   jt = job_type::enb;
@@ -82,15 +77,28 @@ bool flexran::app::log::recorder::start_meas(uint64_t duration,
     return false;
   }
 
+  /* the job (and the RIB) are only touched by the task manager between ticks
+   * and, since we wait, can be captured by reference */
+  return event_sub_.defer([&] { return create_job(duration, jt, type, id); }).get();
+}
+
+bool flexran::app::log::recorder::create_job(uint64_t duration, job_type jt,
+    const std::string& type, std::string& id)
+{
+  /* in case we are currently in a measurement, do not handle */
+  if (current_job_)
+    LOG4CXX_DEBUG(flog::app, "recorder: job already running, starting next immediately after");
+
   /* write dummy data to hopefully fill caches (twice, intentionally) */
-  for (uint64_t bs_id: rib_.get_available_base_stations()) {
+  for (uint64_t bs_id: rib_.get_bs_ids()) {
     record_chunk(std::chrono::system_clock::now(), bs_id);
     record_chunk(std::chrono::system_clock::now(), bs_id);
   }
 
   /* ID corresponds to record start date, but first check if we can have the
    * corresponding file */
-  const uint64_t start = current_job_ ? current_job_->ms_end : event_sub_.last_tick() + 2;
+  const uint64_t start = current_job_ ? current_job_->ms_end
+                                      : event_sub_.ticks_to_ms(event_sub_.last_tick()) + 2;
   id = std::to_string(start);
   std::string filename = "/tmp/record." + id + ".json";
   if (jt == job_type::bin)
@@ -117,8 +125,12 @@ bool flexran::app::log::recorder::start_meas(uint64_t duration,
       << min.count() << "min@" << std::put_time(std::localtime(&now), "%T")
       << ", file " << filename << ", type " << type << ")");
 
-  event_sub_.subscribe_task_tick_extended(
-      boost::bind(&flexran::app::log::recorder::tick, this, _1, _2), 1, start);
+  /* the job disconnects itself when the recording ends */
+  auto conn = std::make_shared<bs2::connection>();
+  *conn = subscribe_job("recorder",
+      [this, conn] (uint64_t t) { tick(*conn, event_sub_.ticks_to_ms(t)); },
+      event::footprint().reads("rib").writes("recorder"),
+      event_sub_.ms_to_ticks(1), event_sub_.ms_to_ticks(start));
 
   return true;
 }
@@ -145,7 +157,7 @@ void flexran::app::log::recorder::tick(const bs2::connection& conn, uint64_t ms)
   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
   std::map<uint64_t, flexran::app::log::bs_dump> m;
   const auto now = std::chrono::system_clock::now();
-  for (uint64_t bs_id: rib_.get_available_base_stations()) {
+  for (uint64_t bs_id: rib_.get_bs_ids()) {
     m.insert(std::make_pair(bs_id, record_chunk(now, bs_id)));
   }
   dump_->push_back(m);
@@ -153,7 +165,8 @@ void flexran::app::log::recorder::tick(const bs2::connection& conn, uint64_t ms)
   LOG4CXX_TRACE(flog::app, "write_json_chunk() at " << ms
       << "ms, duration " << dur.count() << "us");
 
-  if (ms == current_job_->ms_end - 1) {
+  /* the last ms might have been missed */
+  if (ms + 1 >= current_job_->ms_end) {
     std::thread writer(&flexran::app::log::recorder::writer_method, this,
         std::move(current_job_), std::move(dump_));
     writer.detach();
@@ -166,24 +179,25 @@ flexran::app::log::bs_dump flexran::app::log::recorder::record_chunk(
     const std::chrono::time_point<std::chrono::system_clock> t,
     uint64_t bs_id)
 {
+  const rib::enb_rib_info& bs = *rib_.find_bs(bs_id);
   std::vector<mac_harq_info_t> ue_mac_harq_infos;
-  const protocol::flex_ue_config_reply& ue_configs = rib_.get_bs(bs_id)->get_ue_configs();
-  for (int UE_id = 0; UE_id < ue_configs.ue_config_size(); UE_id++) {
-    flexran::rib::rnti_t rnti = ue_configs.ue_config(UE_id).rnti();
-    std::shared_ptr<rib::ue_mac_rib_info> ue_mac_info = rib_.get_bs(bs_id)->get_ue_mac_info(rnti);
-    std::array<bool, 8> harq_infos;
-    auto& harq_array = ue_mac_info->get_all_harq_stats();
-    for (int i = 0; i < 8; i++) {
-      harq_infos[i] = harq_array[0][i][0] == protocol::FLHS_ACK;
-    }
-    ue_mac_harq_infos.push_back(std::make_pair(ue_mac_info->get_mac_stats_report(), harq_infos));
-  }
+  ue_mac_harq_infos.reserve(bs.get_ue_configs().ue_config_size());
+  bs.for_each_ue(
+      [&ue_mac_harq_infos] (const protocol::flex_ue_config&, const rib::ue_mac_rib_info& ue_mac_info) {
+        std::array<bool, 8> harq_infos;
+        auto& harq_array = ue_mac_info.get_all_harq_stats();
+        for (int i = 0; i < 8; i++) {
+          harq_infos[i] = harq_array[0][i][0] == protocol::FLHS_ACK;
+        }
+        ue_mac_harq_infos.push_back(std::make_pair(ue_mac_info.get_mac_stats_report(), harq_infos));
+      }
+  );
 
   return flexran::app::log::bs_dump {
     t,
-    rib_.get_bs(bs_id)->get_enb_config(),
-    rib_.get_bs(bs_id)->get_ue_configs(),
-    rib_.get_bs(bs_id)->get_lc_configs(),
+    bs.get_enb_config(),
+    bs.get_ue_configs(),
+    bs.get_lc_configs(),
     ue_mac_harq_infos
   };
 }
@@ -248,12 +262,9 @@ void flexran::app::log::recorder::write_json_chunk(std::ostream& s,
           if (bs_id == 0) bs_id = p.first;
           const bs_dump& bd = p.second;
           std::string enb_config, ue_config, lc_config;
-          google::protobuf::util::MessageToJsonString(bd.enb_config, &enb_config,
-              google::protobuf::util::JsonPrintOptions());
-          google::protobuf::util::MessageToJsonString(bd.ue_config, &ue_config,
-              google::protobuf::util::JsonPrintOptions());
-          google::protobuf::util::MessageToJsonString(bd.lc_config, &lc_config,
-              google::protobuf::util::JsonPrintOptions());
+          protocol::json::write(enb_config, bd.enb_config);
+          protocol::json::write(ue_config, bd.ue_config);
+          protocol::json::write(lc_config, bd.lc_config);
           return flexran::rib::enb_rib_info::format_configs_to_json(
               p.first, "\"null\"", enb_config, ue_config, lc_config);
         }
@@ -292,7 +303,7 @@ std::vector<std::string> flexran::app::log::recorder::get_ue_stats(
       {
         const protocol::flex_ue_stats_report& ue_config = ue_mac_harq_info.first;
         std::string mac_stats;
-        google::protobuf::util::MessageToJsonString(ue_config, &mac_stats, google::protobuf::util::JsonPrintOptions());
+        protocol::json::write(mac_stats, ue_config);
 
         std::array<std::string, 8> harq;
         for (int i = 0; i < 8; i++) {
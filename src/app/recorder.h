@@ -121,6 +121,10 @@ namespace flexran {
         std::unique_ptr<std::vector<std::map<uint64_t, bs_dump>>> dump_;
         std::unique_ptr<job_info> current_job_;
 
+        /* creates a job, run by the task manager between ticks */
+        bool create_job(uint64_t duration, job_type jt, const std::string& type,
+            std::string& id);
+
         bs_dump record_chunk(
             const std::chrono::time_point<std::chrono::system_clock> t,
             uint64_t bs_id);
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    replication_manager.cc
+ *  \brief   app streaming RIB changes to hot-standby controllers
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include "rt_controller_common.h"
+#include "replication_manager.h"
+#include "flexran_log.h"
+
+constexpr const uint64_t flexran::app::management::replication_manager::HEARTBEAT_MS;
+constexpr const uint64_t flexran::app::management::replication_manager::LOG_PERIOD_MS;
+
+flexran::app::management::replication_manager::replication_manager(
+    const flexran::rib::Rib& rib, const flexran::core::requests_manager& rm,
+    flexran::event::subscription& sub,
+    std::unique_ptr<rib::replication_listener> listener,
+    std::shared_ptr<const stats::stats_manager> stats)
+  : component(rib, rm, sub),
+    listener_(std::move(listener)),
+    stats_(stats),
+    last_version_(0),
+    last_requests_version_(0),
+    last_sent_ms_(0),
+    last_log_ms_(0),
+    deltas_(0),
+    bytes_(0)
+{
+  /* replicate once per ms, which tick() works in */
+  event_sub_.subscribe_task_tick(
+      [this] (uint64_t t) { tick(event_sub_.ticks_to_ms(t)); },
+      event_sub_.ms_to_ticks(1), 0, "replication_manager");
+}
+
+void flexran::app::management::replication_manager::tick(uint64_t ms)
+{
+  const uint64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+
+  /* changes since the last tick for the standbys that are in sync. The RIB
+   * does not change while apps run, so no change can be missed */
+  if (!standbys_.empty()) {
+    protocol::flex_rib_delta d;
+    const bool changed = fill_delta(d) || ms - last_sent_ms_ >= HEARTBEAT_MS;
+    for (auto it = standbys_.begin(); it != standbys_.end(); ) {
+      /* without changes, only write out what did not fit into the socket */
+      const bool ok = changed ? send(*it, d, now_us) : it->stream->flush();
+      if (ok) {
+        ++it;
+      } else {
+        LOG4CXX_WARN(flog::app, "replication_manager: dropping standby");
+        it = standbys_.erase(it);
+      }
+    }
+    if (changed)
+      last_sent_ms_ = ms;
+  }
+  last_version_ = rib_.get_version();
+  last_requests_version_ = stats_ ? stats_->get_requests_version() : 0;
+
+  /* new standbys start with the state as of last_version_ */
+  while (std::unique_ptr<rib::replication_stream> s = listener_->accept()) {
+    LOG4CXX_INFO(flog::app, "replication_manager: new standby, sending "
+        << rib_.get_bs_ids().size() << " BS(s)");
+    standby sb{std::move(s), 0};
+    protocol::flex_rib_delta d;
+    fill_full(d);
+    if (send(sb, d, now_us))
+      standbys_.push_back(std::move(sb));
+  }
+
+  if (ms - last_log_ms_ >= LOG_PERIOD_MS) {
+    if (deltas_ > 0)
+      LOG4CXX_INFO(flog::app, "replication_manager: " << standbys_.size()
+          << " standby(s), " << deltas_ << " deltas, "
+          << bytes_ * 1000 / (ms - last_log_ms_) << " B/s");
+    last_log_ms_ = ms;
+    deltas_ = bytes_ = 0;
+  }
+}
+
+void flexran::app::management::replication_manager::fill_full(
+    protocol::flex_rib_delta& d) const
+{
+  d.set_full(true);
+  protocol::flex_rib_checkpoint cp;
+  rib_.fill_checkpoint(cp);
+  if (stats_) stats_->fill_checkpoint(cp);
+  d.mutable_bs()->Swap(cp.mutable_bs());
+}
+
+bool flexran::app::management::replication_manager::fill_delta(
+    protocol::flex_rib_delta& d) const
+{
+  const bool requests_changed = stats_
+      && stats_->get_requests_version() != last_requests_version_;
+  if (rib_.get_version() == last_version_ && !requests_changed)
+    return false;
+
+  const rib::rib_changes c = rib_.get_changes_since(last_version_);
+  if (!c.complete) {
+    fill_full(d);
+    return true;
+  }
+  for (uint64_t bs_id : c.removed_bs)
+    d.add_removed_bs(bs_id);
+  for (const rib::bs_changes& b : c.bs) {
+    if (!b.has_config_changes()) continue;
+    rib_.find_bs(b.bs_id)->fill_delta(b, *d.add_bs());
+  }
+  if (requests_changed) {
+    /* add the stats requests of all BSs */
+    protocol::flex_rib_checkpoint cp;
+    for (uint64_t bs_id : rib_.get_bs_ids())
+      cp.add_bs()->set_bs_id(bs_id);
+    stats_->fill_checkpoint(cp);
+    for (protocol::flex_bs_checkpoint& r : *cp.mutable_bs()) {
+      if (!r.has_stats_requests()) continue;
+      auto it = std::find_if(d.mutable_bs()->begin(), d.mutable_bs()->end(),
+          [&r](const protocol::flex_bs_checkpoint& b) { return b.bs_id() == r.bs_id(); });
+      if (it != d.mutable_bs()->end())
+        it->mutable_stats_requests()->Swap(r.mutable_stats_requests());
+      else
+        d.add_bs()->Swap(&r);
+    }
+  }
+  return d.bs_size() > 0 || d.removed_bs_size() > 0;
+}
+
+bool flexran::app::management::replication_manager::send(standby& s,
+    protocol::flex_rib_delta& d, uint64_t now_us)
+{
+  d.set_seq(++s.seq);
+  d.set_timestamp_us(now_us);
+  if (!s.stream->send(d) || !s.stream->flush())
+    return false;
+  deltas_++;
+  bytes_ += d.GetCachedSize();
+  return true;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    replication_manager.h
+ *  \brief   app streaming RIB changes to hot-standby controllers
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef REPLICATION_MANAGER_H_
+#define REPLICATION_MANAGER_H_
+
+#include <memory>
+#include <vector>
+
+#include "component.h"
+#include "rib_replication.h"
+#include "stats_manager.h"
+
+namespace flexran {
+
+  namespace app {
+
+    namespace management {
+
+      /// Streams all changes of agents, configurations and stats requests to
+      /// standby controllers connected to the listener, see
+      /// rib::run_standby(). A new standby receives the full state first.
+      /// Statistics are not replicated.
+      class replication_manager : public component {
+
+      public:
+
+        replication_manager(const rib::Rib& rib, const core::requests_manager& rm,
+            event::subscription& sub, std::unique_ptr<rib::replication_listener> listener,
+            std::shared_ptr<const stats::stats_manager> stats);
+        void tick(uint64_t ms);
+
+        std::size_t get_num_standbys() const { return standbys_.size(); }
+
+      private:
+        struct standby {
+          std::unique_ptr<rib::replication_stream> stream;
+          uint64_t seq;
+        };
+
+        void fill_full(protocol::flex_rib_delta& d) const;
+        /// returns false if nothing changed
+        bool fill_delta(protocol::flex_rib_delta& d) const;
+        bool send(standby& s, protocol::flex_rib_delta& d, uint64_t now_us);
+
+        std::unique_ptr<rib::replication_listener> listener_;
+        std::shared_ptr<const stats::stats_manager> stats_;
+        std::vector<standby> standbys_;
+        uint64_t last_version_;
+        uint64_t last_requests_version_;
+        uint64_t last_sent_ms_;
+
+        uint64_t last_log_ms_;
+        uint64_t deltas_;
+        uint64_t bytes_;
+
+        static constexpr const uint64_t HEARTBEAT_MS = 1000;
+        static constexpr const uint64_t LOG_PERIOD_MS = 10000;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* REPLICATION_MANAGER_H_ */
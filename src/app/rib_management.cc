@@ -32,14 +32,15 @@ flexran::app::management::rib_management::rib_management(const flexran::rib::Rib
   : component(rib, rm, sub)
 {
   event_sub_.subscribe_task_tick(
-      boost::bind(&flexran::app::management::rib_management::tick, this, _1), 1000);
+      boost::bind(&flexran::app::management::rib_management::tick, this, _1),
+      event_sub_.ms_to_ticks(1000), 0, "rib_management");
 }
 
 void flexran::app::management::rib_management::tick(uint64_t ms)
 {
   _unused(ms);
   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
-  for (uint64_t bs_id: rib_.get_available_base_stations()) {   
+  for (uint64_t bs_id: rib_.get_bs_ids()) {   
     send_enb_config_request(bs_id);
     send_ue_config_request(bs_id);
     send_lc_config_request(bs_id);
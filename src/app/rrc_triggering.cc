@@ -49,7 +49,7 @@ void flexran::app::rrc::rrc_triggering::bs_added(uint64_t bs_id)
   if (!tick_check_phyCellId.connected())
     tick_check_phyCellId = event_sub_.subscribe_task_tick(
         boost::bind(&flexran::app::rrc::rrc_triggering::check_phyCellId, this, _1),
-            10, event_sub_.last_tick());
+            event_sub_.ms_to_ticks(10), event_sub_.last_tick(), "rrc_triggering");
 }
 
 void flexran::app::rrc::rrc_triggering::check_phyCellId(uint64_t tick)
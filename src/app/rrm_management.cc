@@ -40,9 +40,12 @@ flexran::app::management::rrm_management::rrm_management(rib::Rib& rib,
     const core::requests_manager& rm, event::subscription& sub)
   : component(rib, rm, sub)
 {
-  event_sub_.subscribe_ue_update(
-      boost::bind(&flexran::app::management::rrm_management::ue_add_update_slice_assoc,
-                  this, _1, _2));
+  /* matching IMSIs against the association regexes is too slow to be done
+   * while the RIB updater handles the UE's message, so do it in a job */
+  ue_updates_ = subscribe_events("rrm_slice_assoc",
+      event::event_filter().on(event::event_kind::ue_update),
+      [this] (const event::bs_ue_event& e) { ue_add_update_slice_assoc(e.bs_id, e.rnti); },
+      event::footprint().reads("rib").writes("rrm"));
 }
 
 std::string flexran::app::management::rrm_management::begin_end_space(
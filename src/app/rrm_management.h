@@ -94,6 +94,8 @@ namespace flexran {
         std::vector<std::pair<std::regex, uint32_t>> dl_ue_slice_;
         /// association IMSI -> UL slice_id
         std::vector<std::pair<std::regex, uint32_t>> ul_ue_slice_;
+        /// UE updates handled by ue_add_update_slice_assoc()
+        std::shared_ptr<event::event_inbox> ue_updates_;
       };
     }
   }
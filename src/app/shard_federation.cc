@@ -0,0 +1,331 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    shard_federation.cc
+ *  \brief   federated northbound view over the shards of a sharded deployment
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <future>
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "shard_federation.h"
+#include "rib.h"
+
+namespace {
+
+  std::size_t skip_ws(const std::string& s, std::size_t i)
+  {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r'))
+      ++i;
+    return i;
+  }
+
+  /* returns the position after the string starting at i, or npos */
+  std::size_t skip_string(const std::string& s, std::size_t i)
+  {
+    for (++i; i < s.size(); ++i) {
+      if (s[i] == '\\') ++i;
+      else if (s[i] == '"') return i + 1;
+    }
+    return std::string::npos;
+  }
+
+  /* returns the position after the value starting at i, or npos */
+  std::size_t skip_value(const std::string& s, std::size_t i)
+  {
+    if (i >= s.size()) return std::string::npos;
+    if (s[i] == '"') return skip_string(s, i);
+    if (s[i] != '{' && s[i] != '[') {
+      while (i < s.size() && std::strchr(",}] \t\n\r", s[i]) == nullptr) ++i;
+      return i;
+    }
+    std::string closing;
+    while (i < s.size()) {
+      if (s[i] == '"') {
+        i = skip_string(s, i);
+        if (i == std::string::npos) return i;
+        continue;
+      }
+      if (s[i] == '{') closing.push_back('}');
+      else if (s[i] == '[') closing.push_back(']');
+      else if (s[i] == '}' || s[i] == ']') {
+        if (s[i] != closing.back()) return std::string::npos;
+        closing.pop_back();
+      }
+      ++i;
+      if (closing.empty()) return i;
+    }
+    return std::string::npos;
+  }
+
+  bool wait_for(int fd, short events, int timeout_ms)
+  {
+    pollfd pfd = { fd, events, 0 };
+    int rc;
+    do {
+      rc = poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    return rc > 0;
+  }
+
+  /* decodes a body with chunked transfer encoding */
+  bool dechunk(const std::string& in, std::string& out)
+  {
+    out.clear();
+    std::size_t i = 0;
+    for (;;) {
+      const std::size_t eol = in.find("\r\n", i);
+      if (eol == std::string::npos) return false;
+      const std::size_t len = std::strtoul(in.c_str() + i, nullptr, 16);
+      if (len == 0) return true;
+      if (eol + 2 + len > in.size()) return false;
+      out.append(in, eol + 2, len);
+      i = eol + 2 + len + 2;
+    }
+  }
+
+}
+
+void flexran::app::stats::shard_federation::scatter(const std::string& path,
+    std::vector<std::string>& bodies, std::vector<std::string>& errors) const
+{
+  bodies.assign(shards_.size(), "");
+  errors.assign(shards_.size(), "");
+  std::vector<std::future<void>> fs;
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    fs.push_back(std::async(std::launch::async, [&, i] {
+      if (!http_get(shards_[i], path, timeout_ms_, bodies[i], errors[i]))
+        bodies[i].clear();
+    }));
+  }
+  for (auto& f : fs)
+    f.wait();
+}
+
+std::string flexran::app::stats::shard_federation::stats_to_json_string(
+    const std::string& type) const
+{
+  std::vector<std::string> bodies;
+  std::vector<std::string> errors;
+  scatter("/stats/" + type, bodies, errors);
+
+  std::vector<std::string> answers;
+  std::string failed;
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    std::string enb, mac, error;
+    if (errors[i].empty() && !merge_stats({bodies[i]}, enb, mac, error))
+      errors[i] = error;
+    if (errors[i].empty()) {
+      answers.push_back(std::move(bodies[i]));
+      continue;
+    }
+    if (!failed.empty()) failed += ",";
+    failed += "{\"shard\":\"" + shards_[i].host + ":" + std::to_string(shards_[i].port)
+        + "\",\"error\":\"" + errors[i] + "\"}";
+  }
+
+  std::string enb, mac, error;
+  merge_stats(answers, enb, mac, error);
+  if (type != "mac_stats" && enb.empty()) enb = "[]";
+  if (type != "enb_config" && mac.empty()) mac = "[]";
+  std::string json = flexran::rib::Rib::format_statistics_to_json(
+      std::chrono::system_clock::now(), enb, mac);
+  if (!failed.empty()) {
+    json.pop_back();
+    json += ",\"failed_shards\":[" + failed + "]}";
+  }
+  return json;
+}
+
+bool flexran::app::stats::shard_federation::merge_stats(
+    const std::vector<std::string>& jsons, std::string& enb_configs,
+    std::string& mac_stats, std::string& error)
+{
+  std::string enb, mac;
+  bool has_enb = false, has_mac = false;
+  for (const std::string& j : jsons) {
+    std::string e;
+    bool found;
+    if (!find_array(j, "eNB_config", e, found)) {
+      error = "malformed eNB_config";
+      return false;
+    }
+    has_enb |= found;
+    if (!e.empty()) enb += (enb.empty() ? "" : ",") + e;
+    if (!find_array(j, "mac_stats", e, found)) {
+      error = "malformed mac_stats";
+      return false;
+    }
+    has_mac |= found;
+    if (!e.empty()) mac += (mac.empty() ? "" : ",") + e;
+  }
+  enb_configs = has_enb ? "[" + enb + "]" : "";
+  mac_stats = has_mac ? "[" + mac + "]" : "";
+  return true;
+}
+
+bool flexran::app::stats::shard_federation::find_array(const std::string& json,
+    const std::string& key, std::string& elements, bool& found)
+{
+  found = false;
+  elements.clear();
+  std::size_t i = skip_ws(json, 0);
+  if (i >= json.size() || json[i] != '{') return false;
+  i = skip_ws(json, i + 1);
+  if (i < json.size() && json[i] == '}') return true;
+  while (i < json.size()) {
+    if (json[i] != '"') return false;
+    const std::size_t kend = skip_string(json, i);
+    if (kend == std::string::npos) return false;
+    const std::string k = json.substr(i + 1, kend - i - 2);
+    i = skip_ws(json, kend);
+    if (i >= json.size() || json[i] != ':') return false;
+    const std::size_t v = skip_ws(json, i + 1);
+    const std::size_t vend = skip_value(json, v);
+    if (vend == std::string::npos) return false;
+    if (k == key) {
+      if (json[v] != '[') return false;
+      const std::size_t b = skip_ws(json, v + 1);
+      std::size_t e = vend - 1;
+      while (e > b && std::strchr(" \t\n\r", json[e - 1]) != nullptr) --e;
+      elements = json.substr(b, e - b);
+      found = true;
+      return true;
+    }
+    i = skip_ws(json, vend);
+    if (i < json.size() && json[i] == '}') return true;
+    if (i >= json.size() || json[i] != ',') return false;
+    i = skip_ws(json, i + 1);
+  }
+  return false;
+}
+
+bool flexran::app::stats::shard_federation::http_get(const shard& s,
+    const std::string& path, int timeout_ms, std::string& body, std::string& error)
+{
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *res;
+  const int gai = getaddrinfo(s.host.c_str(), std::to_string(s.port).c_str(), &hints, &res);
+  if (gai != 0) {
+    error = gai_strerror(gai);
+    return false;
+  }
+  const int fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    freeaddrinfo(res);
+    error = strerror(errno);
+    return false;
+  }
+  const int rc = connect(fd, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  int so_error = 0;
+  socklen_t len = sizeof(so_error);
+  if ((rc < 0 && errno != EINPROGRESS)
+      || !wait_for(fd, POLLOUT, timeout_ms)
+      || getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len) < 0 || so_error != 0) {
+    error = so_error != 0 ? strerror(so_error) : "cannot connect";
+    close(fd);
+    return false;
+  }
+
+  const std::string req = "GET " + path + " HTTP/1.1\r\nHost: " + s.host
+      + "\r\nConnection: close\r\n\r\n";
+  std::size_t sent = 0;
+  while (sent < req.size()) {
+    if (!wait_for(fd, POLLOUT, timeout_ms)) {
+      error = "timeout";
+      close(fd);
+      return false;
+    }
+    const ssize_t n = send(fd, req.data() + sent, req.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno != EAGAIN && errno != EINTR) {
+      error = strerror(errno);
+      close(fd);
+      return false;
+    }
+    if (n > 0) sent += n;
+  }
+
+  /* read until the peer closes or the announced length is complete */
+  std::string resp;
+  std::size_t header_end = std::string::npos;
+  std::size_t content_length = std::string::npos;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  char buf[16384];
+  for (;;) {
+    if (header_end != std::string::npos && content_length != std::string::npos
+        && resp.size() >= header_end + content_length)
+      break;
+    const int left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+    if (left <= 0 || !wait_for(fd, POLLIN, left)) {
+      error = "timeout";
+      close(fd);
+      return false;
+    }
+    const ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+    if (n <= 0) break;
+    resp.append(buf, n);
+    if (header_end == std::string::npos) {
+      const std::size_t p = resp.find("\r\n\r\n");
+      if (p == std::string::npos) continue;
+      header_end = p + 4;
+      const std::string h = resp.substr(0, header_end);
+      std::size_t cl = h.find("Content-Length:");
+      if (cl == std::string::npos) cl = h.find("content-length:");
+      if (cl != std::string::npos)
+        content_length = std::strtoul(h.c_str() + cl + 15, nullptr, 10);
+    }
+  }
+  close(fd);
+
+  if (header_end == std::string::npos || resp.compare(0, 5, "HTTP/") != 0) {
+    error = "malformed HTTP response";
+    return false;
+  }
+  const std::size_t sp = resp.find(' ');
+  const int status = std::atoi(resp.c_str() + sp + 1);
+  const std::string headers = resp.substr(0, header_end);
+  body = resp.substr(header_end);
+  if (headers.find("chunked") != std::string::npos) {
+    std::string raw;
+    raw.swap(body);
+    if (!dechunk(raw, body)) {
+      error = "malformed chunked body";
+      return false;
+    }
+  }
+  if (status != 200) {
+    error = "HTTP status " + std::to_string(status);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    shard_federation.h
+ *  \brief   federated northbound view over the shards of a sharded deployment
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef SHARD_FEDERATION_H_
+#define SHARD_FEDERATION_H_
+
+#include <string>
+#include <vector>
+
+namespace flexran {
+
+  namespace app {
+
+    namespace stats {
+
+      /// Scatters northbound queries to the controllers of a sharded
+      /// deployment (see network::shard_proxy) and merges their answers.
+      class shard_federation {
+
+      public:
+        struct shard {
+          std::string host;
+          int port;
+        };
+
+        explicit shard_federation(const std::vector<shard>& shards, int timeout_ms = 1000)
+          : shards_(shards), timeout_ms_(timeout_ms) {}
+
+        const std::vector<shard>& get_shards() const { return shards_; }
+
+        /// GETs path from all shards in parallel. If shard i fails, bodies[i]
+        /// is empty and errors[i] gives the reason.
+        void scatter(const std::string& path, std::vector<std::string>& bodies,
+                     std::vector<std::string>& errors) const;
+
+        /// statistics of all shards in the format of /stats/:type (see
+        /// stats_manager::all_stats_to_json_string()). Shards that did not
+        /// answer are listed in "failed_shards".
+        std::string stats_to_json_string(const std::string& type) const;
+
+        /// concatenates the eNB_config and mac_stats arrays of /stats answers.
+        /// An output stays empty if no answer contains it.
+        static bool merge_stats(const std::vector<std::string>& jsons,
+                                std::string& enb_configs, std::string& mac_stats,
+                                std::string& error);
+
+        /// finds the array value of key in the top-level JSON object json and
+        /// returns its elements, without brackets
+        static bool find_array(const std::string& json, const std::string& key,
+                               std::string& elements, bool& found);
+
+        static bool http_get(const shard& s, const std::string& path, int timeout_ms,
+                             std::string& body, std::string& error);
+
+      private:
+        std::vector<shard> shards_;
+        int timeout_ms_;
+      };
+
+    }
+
+  }
+
+}
+
+#endif /* SHARD_FEDERATION_H_ */
@@ -27,6 +27,7 @@
 
 #include "stats_manager.h"
 #include "flexran.pb.h"
+#include "rib_checkpoint.pb.h"
 #include <google/protobuf/util/json_util.h>
 namespace proto_util = google::protobuf::util;
 
@@ -34,7 +35,8 @@ namespace proto_util = google::protobuf::util;
 
 flexran::app::stats::stats_manager::stats_manager(const flexran::rib::Rib& rib,
     const flexran::core::requests_manager& rm, flexran::event::subscription &s)
-  : component(rib, rm, s)
+  : component(rib, rm, s),
+    requests_version_(0)
 {
   event_sub_.subscribe_bs_add(
       boost::bind(&flexran::app::stats::stats_manager::bs_add, this, _1));
@@ -68,13 +70,25 @@ protocol::flex_complete_stats_request_repeated flexran::app::stats::stats_manage
 
 void flexran::app::stats::stats_manager::bs_add(uint64_t bs_id)
 {
-  const uint32_t xid = 0;
-  protocol::flex_complete_stats_request_repeated reqs = default_stats_request();
-  for (const auto& r : reqs.reports())
+  protocol::flex_complete_stats_request_repeated reqs;
+  auto pit = preloaded_.find(bs_id);
+  if (pit != preloaded_.end() && pit->second.reports_size() > 0) {
+    reqs = pit->second;
+    LOG4CXX_INFO(flog::app, "Using stats requests of checkpoint for BS " << bs_id);
+  } else {
+    reqs = default_stats_request();
+  }
+  if (pit != preloaded_.end())
+    preloaded_.erase(pit);
+  uint32_t xid = 0;
+  for (const auto& r : reqs.reports()) {
     push_complete_stats_request(bs_id, xid, r);
-  LOG4CXX_INFO(flog::app, "Sent periodical stats request to BS " << bs_id
-      << " (xid " << xid << ")");
+    LOG4CXX_INFO(flog::app, "Sent periodical stats request to BS " << bs_id
+        << " (xid " << xid << ")");
+    xid++;
+  }
   bs_list_.insert({bs_id, reqs});
+  requests_version_++;
 }
 
 void flexran::app::stats::stats_manager::push_complete_stats_request(
@@ -137,6 +151,24 @@ void flexran::app::stats::stats_manager::bs_remove(uint64_t bs_id)
   if (it == bs_list_.end()) return; /* not found */
 
   bs_list_.erase(it);
+  requests_version_++;
+}
+
+void flexran::app::stats::stats_manager::fill_checkpoint(protocol::flex_rib_checkpoint& cp) const
+{
+  for (protocol::flex_bs_checkpoint& bs : *cp.mutable_bs()) {
+    auto it = bs_list_.find(bs.bs_id());
+    if (it != bs_list_.end())
+      bs.mutable_stats_requests()->CopyFrom(it->second);
+  }
+}
+
+void flexran::app::stats::stats_manager::preload(const protocol::flex_rib_checkpoint& cp)
+{
+  for (const protocol::flex_bs_checkpoint& bs : cp.bs()) {
+    if (bs.has_stats_requests())
+      preloaded_[bs.bs_id()] = bs.stats_requests();
+  }
 }
 
 std::string flexran::app::stats::stats_manager::all_stats_to_string() const
@@ -144,26 +176,43 @@ std::string flexran::app::stats::stats_manager::all_stats_to_string() const
   return all_enb_configs_to_string() + "\n\n\n" + all_mac_configs_to_string() + "\n";
 }
 
+namespace {
+  /// every (REST) thread reuses the memory of its previous dumps. The
+  /// statistics are written as {"date_time":..,"eNB_config":..,"mac_stats":..}
+  /// like Rib::format_statistics_to_json(), but in a single pass
+  flexran::rib::json_writer& begin_statistics()
+  {
+    thread_local flexran::rib::json_writer w;
+    w.clear();
+    w.begin_object();
+    w.key("date_time").value(
+        flexran::rib::Rib::format_date_time(std::chrono::system_clock::now()));
+    return w;
+  }
+}
+
 std::string flexran::app::stats::stats_manager::all_stats_to_json_string() const
 {
-  return flexran::rib::Rib::format_statistics_to_json(
-      std::chrono::system_clock::now(),
-      rib_.dump_all_enb_configurations_to_json_string(),
-      rib_.dump_all_mac_stats_to_json_string()
-  );
+  flexran::rib::json_writer& w = begin_statistics();
+  w.key("eNB_config");
+  rib_.dump_all_enb_configurations_to_json(w);
+  w.key("mac_stats");
+  rib_.dump_all_mac_stats_to_json(w);
+  w.end_object();
+  return w.str();
 }
 
 bool flexran::app::stats::stats_manager::stats_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const
 {
-  std::string json1, json2;
   out = "{}";
-  bool found = rib_.dump_enb_configurations_by_bs_id_to_json_string(bs_id, json1);
-  if (!found) return false;
-  found = rib_.dump_mac_stats_by_bs_id_to_json_string(bs_id, json2);
-  if (!found) return false;
-  out = flexran::rib::Rib::format_statistics_to_json(
-      std::chrono::system_clock::now(), json1, json2
-  );
+  if (!rib_.has_eNB_config_entry(bs_id)) return false;
+  flexran::rib::json_writer& w = begin_statistics();
+  w.key("eNB_config");
+  rib_.dump_enb_configurations_by_bs_id_to_json(bs_id, w);
+  w.key("mac_stats");
+  rib_.dump_mac_stats_by_bs_id_to_json(bs_id, w);
+  w.end_object();
+  out = w.str();
   return true;
 }
 
@@ -180,18 +229,23 @@ std::string flexran::app::stats::stats_manager::all_enb_configs_to_string() cons
 
 std::string flexran::app::stats::stats_manager::all_enb_configs_to_json_string() const
 {
-  return flexran::rib::Rib::format_statistics_to_json(
-      std::chrono::system_clock::now(),
-      rib_.dump_all_enb_configurations_to_json_string(), ""
-  );
+  flexran::rib::json_writer& w = begin_statistics();
+  w.key("eNB_config");
+  rib_.dump_all_enb_configurations_to_json(w);
+  w.end_object();
+  return w.str();
 }
 
 bool flexran::app::stats::stats_manager::enb_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const
 {
-  std::string json;
-  bool found = rib_.dump_enb_configurations_by_bs_id_to_json_string(bs_id, json);
-  out = flexran::rib::Rib::format_statistics_to_json(
-      std::chrono::system_clock::now(), json, "");
+  flexran::rib::json_writer& w = begin_statistics();
+  const bool found = rib_.has_eNB_config_entry(bs_id);
+  if (found) {
+    w.key("eNB_config");
+    rib_.dump_enb_configurations_by_bs_id_to_json(bs_id, w);
+  }
+  w.end_object();
+  out = w.str();
   return found;
 }
 
@@ -208,24 +262,67 @@ std::string flexran::app::stats::stats_manager::all_mac_configs_to_string() cons
 
 std::string flexran::app::stats::stats_manager::all_mac_configs_to_json_string() const
 {
-  return flexran::rib::Rib::format_statistics_to_json(std::chrono::system_clock::now(),
-      "", rib_.dump_all_mac_stats_to_json_string()
-  );
+  flexran::rib::json_writer& w = begin_statistics();
+  w.key("mac_stats");
+  rib_.dump_all_mac_stats_to_json(w);
+  w.end_object();
+  return w.str();
 }
 
 bool flexran::app::stats::stats_manager::mac_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const
 {
-  std::string json;
-  bool found = rib_.dump_mac_stats_by_bs_id_to_json_string(bs_id, json);
-  out = flexran::rib::Rib::format_statistics_to_json(std::chrono::system_clock::now(), "", json);
+  flexran::rib::json_writer& w = begin_statistics();
+  const bool found = rib_.has_eNB_config_entry(bs_id);
+  if (found) {
+    w.key("mac_stats");
+    rib_.dump_mac_stats_by_bs_id_to_json(bs_id, w);
+  }
+  w.end_object();
+  out = w.str();
   return found;
 }
 
+void flexran::app::stats::stats_manager::stats_to_json_stream(bool configs,
+    bool stats, std::size_t chunk_size,
+    const std::function<void(const std::string&)>& sink) const
+{
+  flexran::rib::json_writer& w = begin_statistics();
+  /* a BS might end beyond chunk_size, so the rest waits for the next part */
+  std::string pending, part;
+  auto send_full_parts = [&pending, &sink, chunk_size] {
+    std::size_t pos = 0;
+    for (; pending.size() - pos >= chunk_size; pos += chunk_size)
+      sink(pending.substr(pos, chunk_size));
+    pending.erase(0, pos);
+  };
+  rib_.dump_json_by_bs(w, configs, stats,
+      [&pending, &part, &send_full_parts, chunk_size] (flexran::rib::json_writer& writer) {
+        if (pending.size() + writer.size() < chunk_size) return;
+        writer.flush(part);
+        pending += part;
+        send_full_parts();
+      }
+  );
+  w.end_object();
+  w.flush(part);
+  pending += part;
+  send_full_parts();
+  if (!pending.empty())
+    sink(pending);
+}
+
 bool flexran::app::stats::stats_manager::ue_stats_by_rnti_by_bs_id_to_json_string(flexran::rib::rnti_t rnti, std::string& out, uint64_t bs_id) const
 {
   return rib_.dump_ue_by_rnti_by_bs_id_to_json_string(rnti, out, bs_id);
 }
 
+bool flexran::app::stats::stats_manager::ue_history_by_rnti_by_bs_id_to_json_string(
+    flexran::rib::rnti_t rnti, std::string& out, uint64_t bs_id,
+    std::size_t max_samples) const
+{
+  return rib_.dump_ue_history_by_rnti_by_bs_id_to_json_string(rnti, out, bs_id, max_samples);
+}
+
 uint64_t flexran::app::stats::stats_manager::parse_bs_agent_id(const std::string& bs_agent_id_s) const
 {
   return rib_.parse_enb_agent_id(bs_agent_id_s);
@@ -305,5 +402,6 @@ bool flexran::app::stats::stats_manager::set_stats_requests(
     it->second.mutable_reports()->Add()->CopyFrom(r);
     xid++;
   }
+  requests_version_++;
   return true;
 }
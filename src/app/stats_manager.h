@@ -26,6 +26,8 @@
 #ifndef STATS_MANAGER_H_
 #define STATS_MANAGER_H_
 
+#include <atomic>
+#include <functional>
 #include <set>
 
 #include "component.h"
@@ -34,6 +36,7 @@
 
 namespace protocol {
   class flex_complete_stats_request;
+  class flex_rib_checkpoint;
 }
 
 namespace flexran {
@@ -64,8 +67,19 @@ namespace flexran {
       std::string all_mac_configs_to_json_string() const;
       bool mac_configs_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const;
 
+      /// writes the JSON of all_stats_to_json_string() (configs and stats),
+      /// all_enb_configs_to_json_string() (configs only) or
+      /// all_mac_configs_to_json_string() (stats only) BS by BS and hands it
+      /// to sink in parts of exactly chunk_size bytes, except for the last
+      /// one. Memory use depends on chunk_size and the largest BS instead
+      /// of the number of BSs
+      void stats_to_json_stream(bool configs, bool stats, std::size_t chunk_size,
+          const std::function<void(const std::string&)>& sink) const;
+
       bool ue_stats_by_rnti_by_bs_id_to_json_string(flexran::rib::rnti_t rnti, std::string& out,
           uint64_t bs_id) const;
+      bool ue_history_by_rnti_by_bs_id_to_json_string(flexran::rib::rnti_t rnti, std::string& out,
+          uint64_t bs_id, std::size_t max_samples) const;
 
       // returns the bs_id of matching agent/enb ID string or zero if not
       // found
@@ -78,10 +92,20 @@ namespace flexran {
       bool parse_rnti_imsi_find_bs(const std::string& rnti_imsi_s, flexran::rib::rnti_t& rnti,
           uint64_t& bs_id) const;
 
+      /// the stats requests are read by the checkpoint and replication jobs,
+      /// so they must only be accessed in the task manager (see command_bus)
       bool get_stats_requests(const std::string& bs, std::string& resp) const;
       bool set_stats_requests(const std::string& bs, const std::string& policy,
           std::string& error_reason);
 
+      /// adds the stats requests to all BSs in cp (filled by the RIB)
+      void fill_checkpoint(protocol::flex_rib_checkpoint& cp) const;
+      /// sends the stats requests of cp instead of the default ones to BSs
+      /// added later
+      void preload(const protocol::flex_rib_checkpoint& cp);
+      /// incremented on every change of the stats requests of any BS
+      uint64_t get_requests_version() const { return requests_version_; }
+
       private:
         void push_complete_stats_request(uint64_t bs_id, uint32_t xid,
             const protocol::flex_complete_stats_request& req);
@@ -89,6 +113,8 @@ namespace flexran {
         protocol::flex_complete_stats_request_repeated default_stats_request();
 
         std::map<uint64_t, protocol::flex_complete_stats_request_repeated> bs_list_;
+        std::map<uint64_t, protocol::flex_complete_stats_request_repeated> preloaded_;
+        std::atomic<uint64_t> requests_version_;
 
       };
 
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    app_executor.cc
+ *  \brief   runs the jobs of apps in a tick on a work-stealing thread pool
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <pthread.h>
+
+#include "app_executor.h"
+#include "thread_placement.h"
+#include "flexran_log.h"
+
+flexran::core::app_executor::app_executor(std::size_t num_workers,
+    const std::vector<int>& cpus, std::chrono::microseconds budget)
+  : num_workers_(num_workers),
+    cpus_(cpus),
+    default_cpus_(get_thread_cpus(0)),
+    budget_(budget),
+    accounting_(nullptr),
+    jobs_(nullptr),
+    tick_(0),
+    deps_size_(0),
+    remaining_(0),
+    generation_(0),
+    stop_(false),
+    ready_(0),
+    jobs_run_(0),
+    jobs_skipped_(0),
+    jobs_overrun_(0)
+{
+  queues_.resize(num_workers_ + 1);
+}
+
+flexran::core::app_executor::~app_executor()
+{
+  stop();
+}
+
+void flexran::core::app_executor::start()
+{
+  /* the queue of the calling thread is allocated here, those of the workers
+   * by the workers after pinning, so they are local to their NUMA node */
+  queues_[num_workers_].reset(new queue);
+  ready_ = 0;
+  for (std::size_t i = 0; i < num_workers_; ++i)
+    threads_.emplace_back(&flexran::core::app_executor::worker, this, i);
+  {
+    std::unique_lock<std::mutex> l(wake_m_);
+    wake_cv_.wait(l, [this] { return ready_ == num_workers_; });
+  }
+  if (num_workers_ > 0)
+    LOG4CXX_INFO(flog::core, "app_executor: started " << num_workers_
+        << " worker(s), tick budget " << budget_.count() << "us");
+}
+
+void flexran::core::app_executor::stop()
+{
+  {
+    std::lock_guard<std::mutex> l(wake_m_);
+    stop_ = true;
+  }
+  wake_cv_.notify_all();
+  for (auto& t : threads_)
+    if (t.joinable()) t.join();
+  threads_.clear();
+}
+
+void flexran::core::app_executor::dispatch(uint64_t tick, const job_list& jobs,
+    std::chrono::steady_clock::time_point tick_start)
+{
+  const std::size_t n = jobs.size();
+  if (n == 0)
+    return;
+
+  jobs_ = &jobs;
+  tick_ = tick;
+  tick_start_ = tick_start;
+  if (n > deps_size_) {
+    deps_.reset(new std::atomic<int>[n]);
+    deps_size_ = n;
+  }
+  if (next_.size() < n)
+    next_.resize(n);
+
+  /* a job depends on every earlier job it conflicts with. The number of jobs
+   * per tick is small, so check all pairs */
+  for (std::size_t j = 0; j < n; ++j) {
+    next_[j].clear();
+    int deps = 0;
+    for (std::size_t i = 0; i < j; ++i) {
+      if (jobs[i]->owner == jobs[j]->owner || jobs[i]->fp.conflicts(jobs[j]->fp)) {
+        next_[i].push_back(j);
+        deps++;
+      }
+    }
+    deps_[j].store(deps, std::memory_order_relaxed);
+  }
+  remaining_.store(n);
+
+  std::size_t q = 0;
+  for (std::size_t j = 0; j < n; ++j) {
+    if (deps_[j].load(std::memory_order_relaxed) > 0)
+      continue;
+    push(q, j);
+    q = (q + 1) % queues_.size();
+  }
+
+  if (num_workers_ > 0) {
+    {
+      std::lock_guard<std::mutex> l(wake_m_);
+      generation_++;
+    }
+    wake_cv_.notify_all();
+  }
+}
+
+void flexran::core::app_executor::join()
+{
+  std::size_t job;
+  while (remaining_.load() > 0) {
+    if (pop(num_workers_, job))
+      run_job(num_workers_, job);
+    else
+      std::this_thread::yield();
+  }
+}
+
+void flexran::core::app_executor::worker(std::size_t i)
+{
+  uint64_t gen = 0;
+  std::size_t job;
+  name_thread("rtc-worker" + std::to_string(i));
+  /* without CPUs of their own, workers must not inherit the (usually
+   * single) CPU of the task manager */
+  const std::vector<int> cpus = cpus_.empty()
+      ? default_cpus_ : std::vector<int>{cpus_[i % cpus_.size()]};
+  std::string error;
+  if (!cpus.empty() && !pin_thread(pthread_self(), cpus, error))
+    LOG4CXX_ERROR(flog::core, "app_executor: worker " << i << ": " << error);
+  {
+    std::lock_guard<std::mutex> l(wake_m_);
+    queues_[i].reset(new queue);
+    ready_++;
+  }
+  wake_cv_.notify_all();
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> l(wake_m_);
+      wake_cv_.wait(l, [this, gen] { return stop_ || generation_ != gen; });
+      if (stop_)
+        return;
+      gen = generation_;
+    }
+    /* stay awake while the tick lasts, jobs might become ready any time */
+    while (remaining_.load() > 0) {
+      if (pop(i, job))
+        run_job(i, job);
+      else
+        std::this_thread::yield();
+    }
+  }
+}
+
+void flexran::core::app_executor::push(std::size_t q, std::size_t job)
+{
+  std::lock_guard<std::mutex> l(queues_[q]->m);
+  queues_[q]->jobs.push_back(job);
+}
+
+bool flexran::core::app_executor::pop(std::size_t q, std::size_t& job)
+{
+  /* own queue from the front, so that jobs start in the order of
+   * subscription as far as possible, steal from the back of the others */
+  {
+    std::lock_guard<std::mutex> l(queues_[q]->m);
+    if (!queues_[q]->jobs.empty()) {
+      job = queues_[q]->jobs.front();
+      queues_[q]->jobs.pop_front();
+      return true;
+    }
+  }
+  for (std::size_t k = 1; k < queues_.size(); ++k) {
+    queue& v = *queues_[(q + k) % queues_.size()];
+    std::lock_guard<std::mutex> l(v.m);
+    if (!v.jobs.empty()) {
+      job = v.jobs.back();
+      v.jobs.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void flexran::core::app_executor::run_job(std::size_t q, std::size_t j)
+{
+  const event::task_job& job = *(*jobs_)[j];
+  const std::chrono::steady_clock::time_point deadline = tick_start_
+      + (job.deadline_us > 0 ? std::chrono::microseconds(job.deadline_us) : budget_);
+
+  if (std::chrono::steady_clock::now() >= deadline) {
+    jobs_skipped_++;
+    LOG4CXX_WARN(flog::app, "app_executor: skipped job " << job.name
+        << " in tick " << tick_ << ", deadline passed");
+  } else {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    try {
+      job.fn(tick_);
+    } catch (const std::exception& e) {
+      LOG4CXX_ERROR(flog::app, "app_executor: job " << job.name
+          << " failed: " << e.what());
+    }
+    jobs_run_++;
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    if (accounting_)
+      accounting_->record(job.app ? job.app : accounting_->get_app(job.name),
+          end - start);
+    if (end > deadline) {
+      jobs_overrun_++;
+      LOG4CXX_DEBUG(flog::app, "app_executor: job " << job.name
+          << " in tick " << tick_ << " finished after its deadline");
+    }
+  }
+
+  for (std::size_t n : next_[j])
+    if (deps_[n].fetch_sub(1) == 1)
+      push(q, n);
+  remaining_.fetch_sub(1);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    app_executor.h
+ *  \brief   runs the jobs of apps in a tick on a work-stealing thread pool
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef APP_EXECUTOR_H_
+#define APP_EXECUTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "task_accounting.h"
+#include "task_job.h"
+
+namespace flexran {
+
+  namespace core {
+
+    /// Runs the jobs of a tick (see event::task_job) on a number of worker
+    /// threads and the calling (task manager) thread. A job waits for all
+    /// earlier jobs of the same tick it conflicts with (same owner or
+    /// conflicting footprint). Every thread has its own queue of ready jobs,
+    /// idle threads steal from the others. Jobs that did not start before
+    /// their deadline are skipped; jobs can not be preempted, so join()
+    /// returns only after all started jobs finished, as apps must not read
+    /// the RIB while the RIB updater runs.
+    class app_executor {
+    public:
+      typedef std::vector<std::shared_ptr<const event::task_job>> job_list;
+
+      /// cpus: if not empty, worker i is pinned to cpus[i % cpus.size()].
+      /// Otherwise, workers run on the CPUs of the thread constructing the
+      /// executor. Every worker allocates its queue after pinning itself
+      app_executor(std::size_t num_workers, const std::vector<int>& cpus,
+          std::chrono::microseconds budget);
+      ~app_executor();
+
+      /// starts the workers. Threads inherit the signal mask and scheduling
+      /// policy of the calling thread, so this should be called from the task
+      /// manager thread
+      void start();
+      void stop();
+      /// if set, the run times of jobs are accounted to their names
+      void set_accounting(event::task_accounting *accounting) { accounting_ = accounting; }
+
+      /// makes the jobs available to the workers. jobs must not change until
+      /// join() returned
+      void dispatch(uint64_t tick, const job_list& jobs,
+          std::chrono::steady_clock::time_point tick_start);
+      /// runs jobs in the calling thread until all jobs of this tick
+      /// finished or have been skipped
+      void join();
+
+      std::size_t get_num_workers() const { return num_workers_; }
+      std::chrono::microseconds get_budget() const { return budget_; }
+      uint64_t get_jobs_run() const { return jobs_run_; }
+      uint64_t get_jobs_skipped() const { return jobs_skipped_; }
+      /// number of jobs that finished after their deadline
+      uint64_t get_jobs_overrun() const { return jobs_overrun_; }
+
+    private:
+      struct queue {
+        std::mutex m;
+        std::deque<std::size_t> jobs;
+      };
+
+      void worker(std::size_t i);
+      void push(std::size_t q, std::size_t job);
+      bool pop(std::size_t q, std::size_t& job);
+      void run_job(std::size_t q, std::size_t job);
+
+      const std::size_t num_workers_;
+      const std::vector<int> cpus_;
+      const std::vector<int> default_cpus_;
+      const std::chrono::microseconds budget_;
+      event::task_accounting *accounting_;
+
+      std::vector<std::thread> threads_;
+      /// one queue per worker, the last one for the task manager thread,
+      /// allocated in start()
+      std::vector<std::unique_ptr<queue>> queues_;
+
+      /* state of the current tick, only modified in dispatch() */
+      const job_list *jobs_;
+      uint64_t tick_;
+      std::chrono::steady_clock::time_point tick_start_;
+      std::vector<std::vector<std::size_t>> next_;
+      std::unique_ptr<std::atomic<int>[]> deps_;
+      std::size_t deps_size_;
+      std::atomic<std::size_t> remaining_;
+
+      std::mutex wake_m_;
+      std::condition_variable wake_cv_;
+      uint64_t generation_;
+      bool stop_;
+      std::size_t ready_; // workers that allocated their queue
+
+      std::atomic<uint64_t> jobs_run_;
+      std::atomic<uint64_t> jobs_skipped_;
+      std::atomic<uint64_t> jobs_overrun_;
+    };
+
+  }
+
+}
+
+#endif /* APP_EXECUTOR_H_ */
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    command_bus.cc
+ *  \brief   executes northbound commands in the task manager between ticks
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <sstream>
+
+#include "command_bus.h"
+
+flexran::core::command_bus::command_bus(std::size_t capacity,
+    std::chrono::microseconds budget)
+  : capacity_(capacity),
+    budget_(budget),
+    executor_(std::thread::id()),
+    queue_(capacity),
+    depth_(0),
+    max_depth_(0),
+    submitted_(0),
+    executed_(0),
+    rejected_(0)
+{
+}
+
+flexran::core::command_bus::~command_bus()
+{
+  /* the futures of commands never run report a broken promise */
+  queue_.consume_all([] (command *c) { delete c; });
+}
+
+std::size_t flexran::core::command_bus::run(
+    std::chrono::steady_clock::time_point deadline)
+{
+  std::size_t n = 0;
+  command *c;
+  while ((n == 0 || std::chrono::steady_clock::now() < deadline) && queue_.pop(c)) {
+    depth_--;
+    const auto start = std::chrono::steady_clock::now();
+    wait_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          start - c->submitted).count());
+    c->fn();
+    runtime_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count());
+    delete c;
+    executed_++;
+    n++;
+  }
+  return n;
+}
+
+std::string flexran::core::command_bus::to_json_string() const
+{
+  std::ostringstream o;
+  o << "{\"capacity\":" << capacity_
+    << ",\"budget_us\":" << budget_.count()
+    << ",\"depth\":" << depth_
+    << ",\"max_depth\":" << max_depth_
+    << ",\"submitted\":" << submitted_
+    << ",\"executed\":" << executed_
+    << ",\"rejected\":" << rejected_
+    << ",\"wait_us\":" << wait_.to_json_string(1000.0)
+    << ",\"run_us\":" << runtime_.to_json_string(1000.0)
+    << "}";
+  return o.str();
+}
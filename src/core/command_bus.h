@@ -0,0 +1,138 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    command_bus.h
+ *  \brief   executes northbound commands in the task manager between ticks
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef COMMAND_BUS_H_
+#define COMMAND_BUS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <boost/lockfree/queue.hpp>
+
+#include "hdr_histogram.h"
+
+namespace flexran {
+
+  namespace core {
+
+    /// Bounded multi-producer queue of commands for the task manager. Apps
+    /// may only read the RIB and send to agents while the RIB updater does
+    /// not run, so other threads (mostly the REST API) submit closures that
+    /// the task manager runs after the RIB updater and before the app jobs
+    /// of a tick, within a time budget. The result (or exception) is given
+    /// through a future. Submitting never blocks, but fails if the queue is
+    /// full. Closures run immediately if submitted from the executing thread
+    /// or if no thread executes commands (e.g., the task manager did not
+    /// start yet).
+    class command_bus {
+    public:
+      explicit command_bus(std::size_t capacity = 256,
+          std::chrono::microseconds budget = std::chrono::microseconds(100));
+      ~command_bus();
+
+      /// queues fn and gives its future in result, or returns false if the
+      /// queue is full
+      template <typename F>
+      bool submit(F fn, std::future<decltype(fn())>& result)
+      {
+        typedef decltype(fn()) R;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::move(fn));
+        result = task->get_future();
+        const std::thread::id exec = executor_.load();
+        if (exec == std::thread::id() || exec == std::this_thread::get_id()) {
+          (*task)();
+          executed_++;
+          return true;
+        }
+        command *c = new command{[task] { (*task)(); },
+                                 std::chrono::steady_clock::now()};
+        if (depth_.fetch_add(1) >= capacity_ || !queue_.bounded_push(c)) {
+          depth_--;
+          rejected_++;
+          delete c;
+          return false;
+        }
+        submitted_++;
+        update_max_depth();
+        /* the executing thread might have stopped in the meantime */
+        if (executor_.load() == std::thread::id())
+          run(std::chrono::steady_clock::time_point::max());
+        return true;
+      }
+
+      /// sets the thread executing commands (none: run them on submission)
+      void set_executor(std::thread::id id) { executor_ = id; }
+      /// runs queued commands until none is left or deadline has passed, but
+      /// at least one. Returns the number of commands run
+      std::size_t run(std::chrono::steady_clock::time_point deadline);
+      std::chrono::microseconds get_budget() const { return budget_; }
+
+      std::size_t get_capacity() const { return capacity_; }
+      std::size_t get_depth() const { return depth_; }
+      std::size_t get_max_depth() const { return max_depth_; }
+      uint64_t get_submitted() const { return submitted_; }
+      uint64_t get_executed() const { return executed_; }
+      uint64_t get_rejected() const { return rejected_; }
+      /// time commands waited in the queue and ran, in ns
+      const hdr_histogram& get_wait() const { return wait_; }
+      const hdr_histogram& get_runtime() const { return runtime_; }
+      std::string to_json_string() const;
+
+    private:
+      struct command {
+        std::function<void()> fn;
+        std::chrono::steady_clock::time_point submitted;
+      };
+
+      void update_max_depth()
+      {
+        std::size_t d = depth_.load();
+        std::size_t m = max_depth_.load();
+        while (d > m && !max_depth_.compare_exchange_weak(m, d)) ;
+      }
+
+      const std::size_t capacity_;
+      const std::chrono::microseconds budget_;
+      std::atomic<std::thread::id> executor_;
+      boost::lockfree::queue<command *, boost::lockfree::fixed_sized<true>> queue_;
+      std::atomic<std::size_t> depth_;
+      std::atomic<std::size_t> max_depth_;
+      std::atomic<uint64_t> submitted_;
+      std::atomic<uint64_t> executed_;
+      std::atomic<uint64_t> rejected_;
+      hdr_histogram wait_;
+      hdr_histogram runtime_;
+    };
+
+  }
+
+}
+
+#endif /* COMMAND_BUS_H_ */
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    hdr_histogram.cc
+ *  \brief   Single-writer histogram with logarithmic buckets of bounded relative error
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <limits>
+#include <sstream>
+
+#include "hdr_histogram.h"
+
+const int flexran::core::hdr_histogram::SUB_BITS;
+const uint64_t flexran::core::hdr_histogram::SUB_COUNT;
+const uint64_t flexran::core::hdr_histogram::HALF;
+const std::size_t flexran::core::hdr_histogram::NUM_BUCKETS;
+
+flexran::core::hdr_histogram::hdr_histogram()
+{
+  for (auto& c : counts_)
+    c.store(0, std::memory_order_relaxed);
+  count_.store(0);
+  sum_.store(0);
+  min_.store(std::numeric_limits<uint64_t>::max());
+  max_.store(0);
+}
+
+void flexran::core::hdr_histogram::reset()
+{
+  for (auto& c : counts_)
+    c.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+void flexran::core::hdr_histogram::take_snapshot(snapshot& s) const
+{
+  s.count = 0;
+  for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+    s.counts[i] = counts_[i].load(std::memory_order_relaxed);
+    s.count += s.counts[i];
+  }
+  s.sum = sum_.load(std::memory_order_relaxed);
+  s.min = s.count > 0 ? min_.load(std::memory_order_relaxed) : 0;
+  s.max = max_.load(std::memory_order_relaxed);
+}
+
+uint64_t flexran::core::hdr_histogram::highest_value(std::size_t idx)
+{
+  if (idx < SUB_COUNT)
+    return idx;
+  const std::size_t shift = (idx - SUB_COUNT) / HALF + 1;
+  const uint64_t sub = (idx - SUB_COUNT) % HALF + HALF;
+  return ((sub + 1) << shift) - 1;
+}
+
+uint64_t flexran::core::hdr_histogram::snapshot::percentile(double q) const
+{
+  if (count == 0)
+    return 0;
+  const uint64_t rank = q <= 0 ? 1 : static_cast<uint64_t>(q * count + 0.5);
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+    seen += counts[i];
+    if (seen >= rank && seen > 0) {
+      /* the bucket bound might exceed the largest value seen */
+      const uint64_t v = highest_value(i);
+      return v < max ? v : max;
+    }
+  }
+  return max;
+}
+
+std::string flexran::core::hdr_histogram::to_json_string(double scale) const
+{
+  snapshot s;
+  take_snapshot(s);
+  std::ostringstream o;
+  o << "{\"count\":" << s.count
+    << ",\"min\":" << s.min / scale
+    << ",\"mean\":" << s.mean() / scale
+    << ",\"p50\":" << s.percentile(0.5) / scale
+    << ",\"p90\":" << s.percentile(0.9) / scale
+    << ",\"p99\":" << s.percentile(0.99) / scale
+    << ",\"p999\":" << s.percentile(0.999) / scale
+    << ",\"max\":" << s.max / scale << "}";
+  return o.str();
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    hdr_histogram.h
+ *  \brief   Single-writer histogram with logarithmic buckets of bounded relative error
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef HDR_HISTOGRAM_H_
+#define HDR_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace flexran {
+
+  namespace core {
+
+    /// Histogram in the style of HdrHistogram: values are counted in buckets
+    /// with 64 sub-buckets per power of two, i.e., with a relative error
+    /// below 1.6% over the whole uint64_t range. Only one thread may
+    /// record(), but any thread can take a snapshot() at any time without
+    /// locking; such a snapshot is consistent per bucket only.
+    class hdr_histogram {
+    public:
+      static const int SUB_BITS = 7;
+      static const uint64_t SUB_COUNT = uint64_t(1) << SUB_BITS;
+      static const uint64_t HALF = SUB_COUNT / 2;
+      static const std::size_t NUM_BUCKETS = SUB_COUNT + (64 - SUB_BITS) * HALF;
+
+      /// plain copy of a histogram, for evaluation
+      struct snapshot {
+        snapshot() : count(0), sum(0), min(0), max(0), counts(NUM_BUCKETS, 0) {}
+        uint64_t count;
+        uint64_t sum;
+        uint64_t min;
+        uint64_t max;
+        std::vector<uint64_t> counts;
+
+        double mean() const { return count > 0 ? double(sum) / count : 0; }
+        /// value below which a fraction q of all values lie (up to the
+        /// bucket precision), 0 <= q <= 1
+        uint64_t percentile(double q) const;
+      };
+
+      hdr_histogram();
+
+      void record(uint64_t v)
+      {
+        inc(counts_[index(v)]);
+        inc(count_);
+        add(sum_, v);
+        if (v < min_.load(std::memory_order_relaxed))
+          min_.store(v, std::memory_order_relaxed);
+        if (v > max_.load(std::memory_order_relaxed))
+          max_.store(v, std::memory_order_relaxed);
+      }
+      /// only to be called by the recording thread
+      void reset();
+      void take_snapshot(snapshot& s) const;
+      /// count, min, mean, some percentiles and max of a snapshot as JSON
+      /// object, all values divided by scale
+      std::string to_json_string(double scale = 1) const;
+
+      static std::size_t index(uint64_t v)
+      {
+        if (v < SUB_COUNT)
+          return v;
+        const int msb = 63 - __builtin_clzll(v);
+        const int shift = msb - (SUB_BITS - 1);
+        return SUB_COUNT + (shift - 1) * HALF + ((v >> shift) - HALF);
+      }
+      /// the highest value counted in bucket idx
+      static uint64_t highest_value(std::size_t idx);
+
+    private:
+      static void inc(std::atomic<uint64_t>& c) { add(c, 1); }
+      static void add(std::atomic<uint64_t>& c, uint64_t v)
+      {
+        /* single writer: no need for an atomic read-modify-write */
+        c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+      }
+
+      std::array<std::atomic<uint64_t>, NUM_BUCKETS> counts_;
+      std::atomic<uint64_t> count_;
+      std::atomic<uint64_t> sum_;
+      std::atomic<uint64_t> min_;
+      std::atomic<uint64_t> max_;
+    };
+
+  }
+
+}
+
+#endif /* HDR_HISTOGRAM_H_ */
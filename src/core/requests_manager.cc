@@ -31,12 +31,12 @@
 void flexran::core::requests_manager::send_message(uint64_t bs_id,
     const protocol::flexran_message& msg) const
 {
-  auto bs = rib_.get_bs(bs_id);
+  const rib::enb_rib_info *bs = rib_.find_bs(bs_id);
   if (!bs) {
     LOG4CXX_ERROR(flog::core, "RequestsManager: unknown BS ID " << bs_id);
     return;
   }
   /* TODO verify which agent really needs to receive this */
-  for (auto a : bs->get_agents())
+  for (const auto& a : bs->get_agents())
     net_xface_.send_msg(msg, a->agent_id);
 }
@@ -26,6 +26,7 @@
 
 #include <thread>
 #include <iostream>
+#include <algorithm>
 
 #include <pthread.h>
 #include <sched.h>
@@ -40,6 +41,7 @@
 #include "rib_updater.h"
 #include "rib.h"
 #include "task_manager.h"
+#include "thread_placement.h"
 #include "subscription.h"
 #include "stats_manager.h"
 #include "plmn_management.h"
@@ -54,6 +56,10 @@
 #include "rib_management.h"
 #include "netstore_loader.h"
 #include "recorder.h"
+#include "checkpoint_manager.h"
+#include "replication_manager.h"
+#include "rib_checkpoint.h"
+#include "rib_replication.h"
 
 //#ifdef NEO4J_SUPPORT
 //#include "neo4j_client.h"
@@ -73,6 +79,7 @@
 #include "stats_manager_calls.h"
 #include "recorder_calls.h"
 #include "netstore_loader_calls.h"
+#include "task_manager_calls.h"
 #ifdef ELASTIC_SEARCH_SUPPORT
 #include "elastic_calls.h"
 #endif
@@ -91,11 +98,6 @@
 
 std::atomic_bool g_exit_controller{false};
 
-#ifdef PROFILE
-std::atomic_bool g_doprof{false};
-std::chrono::time_point<std::chrono::steady_clock> start;
-#endif
-
 namespace po = boost::program_options;
 
 int main(int argc, char* argv[]) {
@@ -111,6 +113,32 @@ int main(int argc, char* argv[]) {
 
   bool expl_log_config = false;
 
+  flexran::rib::ue_kpi_history::config history_config;
+
+  std::string checkpoint_path;
+  uint64_t checkpoint_period = 1000;
+
+  std::string replication_path;
+  std::string standby_path;
+
+  std::size_t app_workers = 0;
+  uint64_t app_budget = 900;
+
+  uint64_t task_budget = 200;
+  std::vector<std::pair<std::string, uint64_t>> task_budgets;
+  flexran::event::overrun_policy overrun_policy = flexran::event::overrun_policy::none;
+  uint32_t overrun_tolerance = 3;
+
+  uint64_t tick_period = 1000;
+  flexran::core::tick_wait tick_wait = flexran::core::tick_wait::timerfd;
+  uint64_t tick_spin = 50;
+  bool tick_poll = true;
+
+  std::size_t command_queue = 256;
+  uint64_t command_budget = 100;
+
+  flexran::core::thread_placement placement;
+
   sigset_t sigmask;
   int rc, sig;
 
@@ -137,10 +165,70 @@ int main(int argc, char* argv[]) {
       ("port,p", po::value<int>()->default_value(2210),
        "Port for incoming agent connections")
       ("address,a", po::value<std::string>()->default_value("0.0.0.0"),
-       "Address to bind for incoming agent connections");
+       "Address to bind for incoming agent connections")
+      ("ue-history", po::value<std::size_t>()->default_value(history_config.capacity),
+       "Number of KPI samples kept per UE (0 disables the history)")
+      ("ue-history-windows",
+       po::value<std::vector<uint32_t>>()->multitoken()
+           ->default_value(history_config.windows, "10 100"),
+       "Window lengths (in samples) of the rolling KPI aggregates per UE")
+      ("checkpoint", po::value<std::string>(),
+       "File to periodically checkpoint the RIB to and to reload it from at "
+       "startup (warm restart)")
+      ("checkpoint-period", po::value<uint64_t>()->default_value(checkpoint_period),
+       "Minimum interval between two checkpoints in ms")
+      ("replication", po::value<std::string>(),
+       "Unix socket on which to stream RIB changes to standby controllers")
+      ("standby", po::value<std::string>(),
+       "Start as hot standby of the controller replicating on this unix "
+       "socket, and take over once it is gone")
+      ("app-workers", po::value<std::size_t>()->default_value(app_workers),
+       "Number of threads running app jobs in parallel to the task manager")
+      ("app-budget", po::value<uint64_t>()->default_value(app_budget),
+       "Time in us after the start of a tick after which app jobs are skipped")
+      ("task-budget", po::value<uint64_t>()->default_value(task_budget),
+       "Default time in us an app may run per tick")
+      ("task-budget-app", po::value<std::vector<std::string>>()->composing(),
+       "Time in us a specific app may run per tick, as app=us")
+      ("overrun-policy", po::value<std::string>()->default_value("none"),
+       "What to do with apps exceeding their budget repeatedly: none, defer, "
+       "decimate, offload")
+      ("overrun-tolerance", po::value<uint32_t>()->default_value(overrun_tolerance),
+       "Number of consecutive overruns before the overrun policy applies")
+      ("tick-period", po::value<uint64_t>()->default_value(tick_period),
+       "Duration of a task manager tick in us, must divide 1000 (e.g., 500, "
+       "250, 125 for NR slots). App periods are given in ticks")
+      ("tick-wait", po::value<std::string>(),
+       "How to wait for a tick: timerfd, hybrid to sleep and spin for the "
+       "last us, or busy to spin all the time (default: timerfd for 1 ms "
+       "ticks, hybrid otherwise)")
+      ("tick-spin", po::value<uint64_t>()->default_value(tick_spin),
+       "Time in us before a tick from which the hybrid wait spins")
+      ("tick-poll", po::value<bool>()->default_value(tick_poll),
+       "Process agent messages while spinning for a tick")
+      ("command-queue", po::value<std::size_t>()->default_value(command_queue),
+       "Number of northbound control calls that may wait for the task "
+       "manager; more are refused")
+      ("command-budget", po::value<uint64_t>()->default_value(command_budget),
+       "Time in us per tick the task manager runs northbound control calls")
+      ("placement", po::value<std::string>(),
+       "File with a [cpus] section giving the cpus.* options below as "
+       "task-manager=2 etc. The command line takes precedence")
+      ("cpus.task-manager", po::value<std::string>(),
+       "CPUs to pin the task manager to (e.g., 2 or 2-3,6), recommended "
+       "when spinning")
+      ("cpus.network", po::value<std::string>(),
+       "CPUs to pin the network thread to")
+      ("cpus.workers", po::value<std::string>(),
+       "CPUs to pin the app workers to, one per worker in turn")
+      ("cpus.rest", po::value<std::string>(),
+       "CPUs to pin the northbound REST threads to");
     
     po::variables_map opts;
     po::store(po::parse_command_line(argc, argv, desc), opts);
+    if (opts.count("placement"))
+      po::store(po::parse_config_file<char>(
+            opts["placement"].as<std::string>().c_str(), desc), opts);
 
     if ( opts.count("help")  ) { 
       std::cout << "FlexRAN real-time controller" << std::endl 
@@ -167,6 +255,77 @@ int main(int argc, char* argv[]) {
     
     cport = opts["port"].as<int>();
     caddr = opts["address"].as<std::string>();
+    history_config.capacity = opts["ue-history"].as<std::size_t>();
+    history_config.windows = opts["ue-history-windows"].as<std::vector<uint32_t>>();
+    if (opts.count("checkpoint"))
+      checkpoint_path = opts["checkpoint"].as<std::string>();
+    checkpoint_period = opts["checkpoint-period"].as<uint64_t>();
+    if (opts.count("replication"))
+      replication_path = opts["replication"].as<std::string>();
+    if (opts.count("standby"))
+      standby_path = opts["standby"].as<std::string>();
+    app_workers = opts["app-workers"].as<std::size_t>();
+    app_budget = opts["app-budget"].as<uint64_t>();
+    task_budget = opts["task-budget"].as<uint64_t>();
+    if (opts.count("task-budget-app")) {
+      for (const std::string& b : opts["task-budget-app"].as<std::vector<std::string>>()) {
+        const std::size_t eq = b.find('=');
+        if (eq == std::string::npos || eq == 0) {
+          std::cerr << "Error: invalid app budget " << b << ", need app=us\n";
+          return 1;
+        }
+        task_budgets.emplace_back(b.substr(0, eq), std::stoull(b.substr(eq + 1)));
+      }
+    }
+    if (!flexran::event::parse_overrun_policy(opts["overrun-policy"].as<std::string>(),
+          overrun_policy)) {
+      std::cerr << "Error: invalid overrun policy "
+                << opts["overrun-policy"].as<std::string>() << "\n";
+      return 1;
+    }
+    overrun_tolerance = opts["overrun-tolerance"].as<uint32_t>();
+    tick_period = opts["tick-period"].as<uint64_t>();
+    if (tick_period == 0 || tick_period > 1000 || 1000 % tick_period != 0) {
+      std::cerr << "Error: tick period " << tick_period << " does not divide 1000 us\n";
+      return 1;
+    }
+    if (opts.count("tick-wait")) {
+      if (!flexran::core::parse_tick_wait(opts["tick-wait"].as<std::string>(), tick_wait)) {
+        std::cerr << "Error: invalid tick wait "
+                  << opts["tick-wait"].as<std::string>() << "\n";
+        return 1;
+      }
+    } else if (tick_period < 1000) {
+      tick_wait = flexran::core::tick_wait::hybrid;
+    }
+    tick_spin = opts["tick-spin"].as<uint64_t>();
+    tick_poll = opts["tick-poll"].as<bool>();
+    command_queue = opts["command-queue"].as<std::size_t>();
+    if (command_queue == 0 || command_queue > 65534) {
+      std::cerr << "Error: command queue size needs to be within 1-65534\n";
+      return 1;
+    }
+    command_budget = opts["command-budget"].as<uint64_t>();
+    const std::vector<std::pair<std::string, flexran::core::thread_class>> cpu_opts = {
+      {"cpus.task-manager", flexran::core::thread_class::task_manager},
+      {"cpus.network", flexran::core::thread_class::network},
+      {"cpus.workers", flexran::core::thread_class::workers},
+      {"cpus.rest", flexran::core::thread_class::rest}
+    };
+    for (const auto& o : cpu_opts) {
+      if (!opts.count(o.first))
+        continue;
+      std::vector<int> cpus;
+      if (!flexran::core::parse_cpu_list(opts[o.first].as<std::string>(), cpus)) {
+        std::cerr << "Error: invalid CPU list " << opts[o.first].as<std::string>()
+                  << " for " << o.first << "\n";
+        return 1;
+      }
+      placement.set_cpus(o.second, cpus);
+    }
+    /* by default, jobs may start during 90% of a tick */
+    if (opts["app-budget"].defaulted())
+      app_budget = tick_period * 9 / 10;
 #ifdef REST_NORTHBOUND
     north_port = opts["nport"].as<int>();
     north_addr = opts["naddress"].as<std::string>();
@@ -187,28 +346,89 @@ int main(int argc, char* argv[]) {
     flexran_log::PropertyConfigurator::configure(path + "/log_config/debug_log");
   }
 
-#ifdef PROFILE
-  LOG4CXX_WARN(flog::core, "Compiled with profiling support (send USR2 to controller)");
-#endif
     
+  // As standby, keep a replica of the RIB until the active controller is gone
+  protocol::flex_rib_checkpoint replicated;
+  bool have_replica = false;
+  if (!standby_path.empty()) {
+    LOG4CXX_INFO(flog::core, "Running as standby of the controller at " << standby_path);
+    // keep the replica in its own thread and handle the end signals here as
+    // in the main loop below, so that a standby can be stopped cleanly
+    sigemptyset(&sigmask);
+    sigaddset(&sigmask, SIGINT);
+    sigaddset(&sigmask, SIGUSR1);
+    sigaddset(&sigmask, SIGUSR2);
+    sigaddset(&sigmask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+    flexran::rib::rib_replica replica;
+    std::atomic_bool standby_done{false};
+    std::thread standby([&] {
+      have_replica = flexran::rib::run_standby(standby_path, replica, g_exit_controller);
+      standby_done = true;
+    });
+    const timespec wait = {0, 100 * 1000 * 1000};
+    while (!standby_done && !g_exit_controller) {
+      sig = sigtimedwait(&sigmask, NULL, &wait);
+      if (sig == SIGINT || sig == SIGUSR1 || sig == SIGTERM)
+        g_exit_controller = true;
+      else if (sig == SIGUSR2)
+        LOG4CXX_WARN(flog::core, "No profiling as standby");
+    }
+    standby.join();
+    if (g_exit_controller)
+      return 0;
+    if (have_replica)
+      replica.fill_checkpoint(replicated);
+    else if (checkpoint_path.empty())
+      LOG4CXX_WARN(flog::core, "Replica is out of sync, starting cold");
+    else
+      LOG4CXX_WARN(flog::core, "Replica is out of sync, falling back to the checkpoint");
+  }
+
   LOG4CXX_INFO(flog::core, "Listening on " << caddr << ":" << cport
       << " for incoming agent connections");
   flexran::network::async_xface net_xface(caddr, cport);
   
+  if (history_config.capacity > 0)
+    LOG4CXX_INFO(flog::core, "Keeping " << history_config.capacity
+        << " KPI samples per UE (" << flexran::rib::ue_kpi_history::memory_footprint(history_config)
+        << " bytes per UE)");
+
   // Create the rib
-  flexran::rib::Rib rib;
+  flexran::rib::Rib rib(history_config);
 
   // Create the requests manager
   flexran::core::requests_manager rm(rib, net_xface);
 
   // Create the event subsystem
   flexran::event::subscription ev;
+  ev.set_ticks_per_ms(1000 / tick_period);
+  ev.get_accounting().set_default_budget(std::chrono::microseconds(task_budget));
+  for (const auto& b : task_budgets)
+    ev.get_accounting().set_budget(b.first, std::chrono::microseconds(b.second));
+  ev.get_accounting().set_policy(overrun_policy);
+  ev.get_accounting().set_tolerance(overrun_tolerance);
 
-  // Create the rib update manager
-  flexran::rib::rib_updater r_updater(rib, net_xface, rm, ev);
+  // Create the rib update manager, which handles at most 350 messages per ms
+  const int messages_per_tick = std::max<int>(1, 350 * tick_period / 1000);
+  flexran::rib::rib_updater r_updater(rib, net_xface, rm, ev, messages_per_tick);
 
   // Create the task manager
-  flexran::core::task_manager tm(r_updater, ev);
+  LOG4CXX_INFO(flog::core, "Task manager tick of " << tick_period << " us, waiting with "
+      << flexran::core::to_string(tick_wait));
+  LOG4CXX_INFO(flog::core, "Thread placement: " << placement.to_string());
+  flexran::core::task_manager tm(r_updater, ev, app_workers,
+      placement.get_cpus(flexran::core::thread_class::workers),
+      std::chrono::microseconds(app_budget), std::chrono::microseconds(tick_period),
+      tick_wait, std::chrono::microseconds(tick_spin));
+  tm.set_cpus(placement.get_cpus(flexran::core::thread_class::task_manager));
+  tm.set_poll_while_waiting(tick_poll);
+  flexran::core::command_bus commands(command_queue,
+      std::chrono::microseconds(command_budget));
+  tm.set_command_bus(&commands);
+  if (tick_wait != flexran::core::tick_wait::timerfd && tm.get_cpus().empty())
+    LOG4CXX_WARN(flog::core, "Task manager spins without being pinned to a CPU "
+        "(see --cpus.task-manager)");
 
   // Register any applications that we might want to execute in the controller
   auto stats_app = std::make_shared<flexran::app::stats::stats_manager>(rib, rm, ev);
@@ -219,6 +439,52 @@ int main(int argc, char* argv[]) {
   auto netstore = std::make_shared<flexran::app::management::netstore_loader>(rib, rm, ev);
   auto recorder = std::make_shared<flexran::app::log::recorder>(rib, rm, ev);
 
+  std::shared_ptr<flexran::app::management::checkpoint_manager> checkpointer;
+  if (!checkpoint_path.empty()) {
+    auto file = std::make_shared<flexran::rib::checkpoint_file>();
+    std::string error;
+    if (!file->open(checkpoint_path, error)) {
+      LOG4CXX_FATAL(flog::core, "Can not open checkpoint: " << error);
+      exit(1);
+    }
+    protocol::flex_rib_checkpoint cp;
+    if (have_replica) {
+      LOG4CXX_INFO(flog::core, "Not loading checkpoint, replica is more recent");
+    } else if (file->load(cp)) {
+      rib.preload(cp);
+      stats_app->preload(cp);
+      LOG4CXX_INFO(flog::core, "Loaded checkpoint " << file->get_sequence()
+          << " from " << checkpoint_path << " with " << cp.bs_size()
+          << " BS(s), waiting for them to reconnect");
+    } else {
+      LOG4CXX_INFO(flog::core, "No valid checkpoint in " << checkpoint_path
+          << ", starting cold");
+    }
+    checkpointer = std::make_shared<flexran::app::management::checkpoint_manager>(
+        rib, rm, ev, file, stats_app, checkpoint_period);
+  }
+
+  if (have_replica) {
+    rib.preload(replicated);
+    stats_app->preload(replicated);
+    LOG4CXX_INFO(flog::core, "Took over " << replicated.bs_size()
+        << " BS(s) from the replica, waiting for them to reconnect");
+  }
+
+  std::shared_ptr<flexran::app::management::replication_manager> replicator;
+  if (!replication_path.empty()) {
+    std::unique_ptr<flexran::rib::replication_listener> listener(
+        new flexran::rib::replication_listener);
+    std::string error;
+    if (!listener->listen(replication_path, error)) {
+      LOG4CXX_FATAL(flog::core, "Can not replicate: " << error);
+      exit(1);
+    }
+    LOG4CXX_INFO(flog::core, "Replicating the RIB to standbys on " << replication_path);
+    replicator = std::make_shared<flexran::app::management::replication_manager>(
+        rib, rm, ev, std::move(listener), stats_app);
+  }
+
   /* More examples of developed applications are available in the commented section.
      WARNING: Some of them might still contain bugs or might be from previous versions of the controller. */
   //auto remote_sched = std::make_shared<flexran::app::scheduler::remote_scheduler>(rib, rm, ev);
@@ -246,7 +512,22 @@ int main(int argc, char* argv[]) {
   std::thread task_manager_thread(&flexran::core::task_manager::execute_task, &tm);
 
   // Start the network thread
-  std::thread networkThread(&flexran::network::async_xface::execute_task, &net_xface);
+  std::thread networkThread([&net_xface, &placement] {
+    flexran::core::name_thread("rtc-net");
+    const std::vector<int>& cpus = placement.get_cpus(flexran::core::thread_class::network);
+    std::string error;
+    if (!cpus.empty() && !flexran::core::pin_thread(pthread_self(), cpus, error))
+      LOG4CXX_ERROR(flog::core, "network: " << error);
+    net_xface.execute_task();
+  });
+
+  // Threads created from now on (REST) inherit the CPUs of the main thread
+  {
+    const std::vector<int>& cpus = placement.get_cpus(flexran::core::thread_class::rest);
+    std::string error;
+    if (!cpus.empty() && !flexran::core::pin_thread(pthread_self(), cpus, error))
+      LOG4CXX_ERROR(flog::core, "rest: " << error);
+  }
 
 #ifdef REST_NORTHBOUND
   LOG4CXX_INFO(flog::core, "Listening on " << north_addr << ":" << north_port
@@ -255,18 +536,21 @@ int main(int argc, char* argv[]) {
   Pistache::Address addr(north_addr, north_port);
   flexran::north_api::manager::call_manager north_api(addr);
 
-  flexran::north_api::plmn_calls plmn_calls(plmn_management);
+  flexran::north_api::plmn_calls plmn_calls(plmn_management, commands);
   north_api.register_calls(plmn_calls);
-  flexran::north_api::rrm_calls rrm_calls(rrm_management);
+  flexran::north_api::rrm_calls rrm_calls(rrm_management, commands);
   north_api.register_calls(rrm_calls);
-  flexran::north_api::stats_manager_calls stats_calls(stats_app);
+  flexran::north_api::stats_manager_calls stats_calls(stats_app, commands);
   north_api.register_calls(stats_calls);
   flexran::north_api::recorder_calls recorder_calls(recorder);
   north_api.register_calls(recorder_calls);
-  flexran::north_api::rrc_triggering_calls rrc_calls(rrc_trigger);
+  flexran::north_api::rrc_triggering_calls rrc_calls(rrc_trigger, commands);
   north_api.register_calls(rrc_calls);
   flexran::north_api::netstore_loader_calls netstore_calls(netstore);
   north_api.register_calls(netstore_calls);
+  flexran::north_api::task_manager_calls task_manager_calls(ev.get_accounting(), tm,
+      placement);
+  north_api.register_calls(task_manager_calls);
 #ifdef ELASTIC_SEARCH_SUPPORT
   flexran::north_api::elastic_calls elastic_calls(elastic);
   north_api.register_calls(elastic_calls);
@@ -278,13 +562,14 @@ int main(int argc, char* argv[]) {
   north_api.start();
 #endif
 
-  // handle SIGINT and SIGUSR1 as end signals
+  // the threads pin themselves first thing, so this shows their effective CPUs
+  LOG4CXX_INFO(flog::core, "Effective thread placement: " << placement.to_json_string());
+
+  // handle SIGINT and SIGUSR1 as end signals, SIGUSR2 toggles the profiler
   sigemptyset(&sigmask);
   sigaddset(&sigmask, SIGINT);
   sigaddset(&sigmask, SIGUSR1);
-#ifdef PROFILE
   sigaddset(&sigmask, SIGUSR2);
-#endif
   sigaddset(&sigmask, SIGTERM);
   pthread_sigmask(SIG_SETMASK, &sigmask, NULL);
   while (!g_exit_controller) {
@@ -296,16 +581,16 @@ int main(int argc, char* argv[]) {
     if (sig == SIGINT || sig == SIGUSR1 || sig == SIGTERM) {
       g_exit_controller = true;
     }
-#ifdef PROFILE
     if (sig == SIGUSR2) {
-      if (!g_doprof) {
+      flexran::core::runtime_profiler& prof = tm.get_profiler();
+      if (!prof.is_running()) {
         LOG4CXX_INFO(flog::core, "start profiling");
-        g_doprof = true;
-        start = std::chrono::steady_clock::now();
-      } else
-        LOG4CXX_ERROR(flog::core, "profiler already running");
+        prof.start();
+      } else {
+        prof.stop();
+        LOG4CXX_INFO(flog::core, "profiling results: " << prof.to_json_string());
+      }
     }
-#endif
   }
 
   if (task_manager_thread.joinable())
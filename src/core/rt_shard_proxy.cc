@@ -0,0 +1,183 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    rt_shard_proxy.cc
+ *  \brief   front-end of a sharded deployment of controllers
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include "rt_controller_common.h"
+#include "shard_proxy.h"
+#include "shard_federation.h"
+
+#ifdef REST_NORTHBOUND
+#include <pistache/endpoint.h>
+#include "call_manager.h"
+#include "federation_calls.h"
+#endif
+
+#include "flexran_log.h"
+
+namespace po = boost::program_options;
+
+/* parses "host:agent_port:north_port" */
+static bool parse_shard(const std::string& s, std::string& host, int& agent_port,
+    int& north_port)
+{
+  const std::size_t p2 = s.rfind(':');
+  if (p2 == std::string::npos || p2 == 0) return false;
+  const std::size_t p1 = s.rfind(':', p2 - 1);
+  if (p1 == std::string::npos || p1 == 0) return false;
+  host = s.substr(0, p1);
+  try {
+    agent_port = std::stoi(s.substr(p1 + 1, p2 - p1 - 1));
+    north_port = std::stoi(s.substr(p2 + 1));
+  } catch (std::exception& e) {
+    return false;
+  }
+  return agent_port > 0 && agent_port < 65536 && north_port > 0 && north_port < 65536;
+}
+
+int main(int argc, char* argv[]) {
+
+  int cport;
+  std::string caddr;
+  int north_port;
+  std::string north_addr;
+  unsigned vnodes;
+  int timeout_ms;
+  std::vector<std::string> shard_specs;
+  std::string path = "../";
+  if (const char* env_p = std::getenv("FLEXRAN_RTC_HOME"))
+    path = env_p;
+  bool expl_log_config = false;
+  bool debug = false;
+
+  try {
+    po::options_description desc("Help");
+    desc.add_options()
+      ("config,c", po::value<std::string>(), "Path to logger configuration file. "
+       "Without it, FLEXRAN_RTC_HOME or ../ is tried")
+      ("debug,d", "Enables debugging messages to be displayed and logged")
+      ("help,h", "Prints this help message")
+      ("shard", po::value<std::vector<std::string>>(&shard_specs)->required(),
+       "Controller shard as host:agent_port:north_port, repeat for every shard. "
+       "All proxies need the same shards to agree on the BS assignment")
+      ("vnodes", po::value<unsigned>(&vnodes)->default_value(64),
+       "Points per shard on the consistent hash ring")
+      ("timeout", po::value<int>(&timeout_ms)->default_value(1000),
+       "Timeout in ms for northbound queries to the shards")
+      ("nport,n", po::value<int>(&north_port)->default_value(9999),
+       "Port for federated northbound API calls")
+      ("naddress,s", po::value<std::string>(&north_addr)->default_value("0.0.0.0"),
+       "Address to bind for federated northbound API calls")
+      ("port,p", po::value<int>(&cport)->default_value(2210),
+       "Port for incoming agent connections")
+      ("address,a", po::value<std::string>(&caddr)->default_value("0.0.0.0"),
+       "Address to bind for incoming agent connections");
+
+    po::variables_map opts;
+    po::store(po::parse_command_line(argc, argv, desc), opts);
+
+    if (opts.count("help")) {
+      std::cout << "FlexRAN shard proxy" << std::endl << desc << std::endl;
+      return 0;
+    }
+    if (opts.count("debug"))
+      debug = true;
+    if (opts.count("config")) {
+      expl_log_config = true;
+      path = opts["config"].as<std::string>();
+    }
+    po::notify(opts);
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (expl_log_config)
+    flexran_log::PropertyConfigurator::configure(path);
+  else if (!debug)
+    flexran_log::PropertyConfigurator::configure(path + "/log_config/basic_log");
+  else
+    flexran_log::PropertyConfigurator::configure(path + "/log_config/debug_log");
+
+  boost::asio::io_service io_service;
+  std::vector<boost::asio::ip::tcp::endpoint> shards;
+  std::vector<flexran::app::stats::shard_federation::shard> north_shards;
+  for (const std::string& s : shard_specs) {
+    std::string host;
+    int agent_port, np;
+    if (!parse_shard(s, host, agent_port, np)) {
+      std::cerr << "Error: invalid shard " << s << ", expected host:agent_port:north_port\n";
+      return 1;
+    }
+    boost::system::error_code ec;
+    boost::asio::ip::tcp::resolver resolver(io_service);
+    auto it = resolver.resolve(boost::asio::ip::tcp::resolver::query(host, std::to_string(agent_port)), ec);
+    if (ec) {
+      std::cerr << "Error: cannot resolve " << host << ": " << ec.message() << "\n";
+      return 1;
+    }
+    shards.push_back(*it);
+    north_shards.push_back({host, np});
+  }
+
+  LOG4CXX_INFO(flog::core, "Listening on " << caddr << ":" << cport
+      << " for incoming agent connections, forwarding to " << shards.size()
+      << " shard(s)");
+  flexran::network::shard_proxy proxy(io_service,
+      boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(caddr), cport),
+      shards, vnodes);
+
+  auto federation = std::make_shared<const flexran::app::stats::shard_federation>(
+      north_shards, timeout_ms);
+#ifdef REST_NORTHBOUND
+  LOG4CXX_INFO(flog::core, "Listening on " << north_addr << ":" << north_port
+      << " for incoming REST connections");
+  Pistache::Address addr(north_addr, north_port);
+  flexran::north_api::manager::call_manager north_api(addr);
+  flexran::north_api::federation_calls federation_calls(federation);
+  north_api.register_calls(federation_calls);
+  north_api.init(1);
+  north_api.start();
+#else
+  _unused(federation);
+#endif
+
+  boost::asio::signal_set signals(io_service, SIGINT, SIGTERM, SIGUSR1);
+  signals.async_wait([&io_service](const boost::system::error_code&, int) {
+      io_service.stop();
+    });
+  io_service.run();
+
+#ifdef REST_NORTHBOUND
+  north_api.shutdown();
+#endif
+  LOG4CXX_INFO(flog::core, "Exiting FlexRAN shard proxy, bye.");
+  return 0;
+}
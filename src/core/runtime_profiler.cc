@@ -0,0 +1,104 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    runtime_profiler.cc
+ *  \brief   Runtime profiler of the task manager loop
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <sstream>
+
+#include "runtime_profiler.h"
+
+namespace {
+  int64_t now_ns()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+
+flexran::core::runtime_profiler::runtime_profiler()
+  : running_(false),
+    epoch_(0),
+    applied_epoch_(0),
+    start_ns_(0),
+    stop_ns_(0)
+{
+}
+
+void flexran::core::runtime_profiler::start()
+{
+  /* the histograms are reset by the task manager thread, which is the only
+   * one writing them */
+  start_ns_ = now_ns();
+  epoch_++;
+  running_ = true;
+}
+
+void flexran::core::runtime_profiler::stop()
+{
+  if (!running_)
+    return;
+  running_ = false;
+  stop_ns_ = now_ns();
+}
+
+void flexran::core::runtime_profiler::reset()
+{
+  inter_loop_.reset();
+  rib_.reset();
+  apps_.reset();
+  loop_.reset();
+  processed_.reset();
+  applied_epoch_ = epoch_.load(std::memory_order_acquire);
+}
+
+void flexran::core::runtime_profiler::set_rx_counters(const std::vector<rib::rx_counter>& rx)
+{
+  std::lock_guard<std::mutex> l(rx_mutex_);
+  rx_ = rx;
+}
+
+std::string flexran::core::runtime_profiler::to_json_string() const
+{
+  const bool running = is_running();
+  const int64_t end = running ? now_ns() : stop_ns_.load();
+  const double dur_s = start_ns_ > 0 ? (end - start_ns_) / 1e9 : 0;
+
+  std::ostringstream o;
+  o << "{\"running\":" << (running ? "true" : "false")
+    << ",\"duration_s\":" << dur_s << ",";
+  o << "\"inter_loop_us\":" << inter_loop_.to_json_string(1000.0)
+    << ",\"rib_us\":" << rib_.to_json_string(1000.0)
+    << ",\"apps_us\":" << apps_.to_json_string(1000.0)
+    << ",\"loop_us\":" << loop_.to_json_string(1000.0)
+    << ",\"processed\":" << processed_.to_json_string()
+    << ",\"agents\":[";
+  std::lock_guard<std::mutex> l(rx_mutex_);
+  for (std::size_t i = 0; i < rx_.size(); ++i) {
+    const rib::rx_counter& a = rx_[i];
+    o << (i > 0 ? "," : "") << "{\"agent_id\":" << a.agent_id
+      << ",\"bs_id\":" << a.bs_id << ",\"rx_packets\":" << a.packets
+      << ",\"rx_bytes\":" << a.bytes
+      << ",\"mbps\":" << (dur_s > 0 ? a.bytes * 8 / dur_s / 1e6 : 0) << "}";
+  }
+  o << "]}";
+  return o.str();
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    runtime_profiler.h
+ *  \brief   Runtime profiler of the task manager loop
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef RUNTIME_PROFILER_H_
+#define RUNTIME_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "hdr_histogram.h"
+#include "rib_updater.h"
+
+namespace flexran {
+
+  namespace core {
+
+    /// Profiles the task manager loop: the time between loop starts (i.e.,
+    /// the jitter of the timer), the time of the RIB updater, of the apps and
+    /// of the whole loop, and the number of messages processed per loop.
+    /// Profiling can be started and stopped at any time from any thread;
+    /// when stopped, a loop only checks a flag. The histograms are only
+    /// written by the task manager thread and can be read at any time.
+    class runtime_profiler {
+    public:
+      typedef std::chrono::duration<uint64_t, std::nano> ns;
+
+      runtime_profiler();
+
+      /// (re)starts profiling, discarding previous results
+      void start();
+      void stop();
+      bool is_running() const { return running_.load(std::memory_order_relaxed); }
+
+      /// called by the task manager thread at the start of every loop.
+      /// Returns whether to profile this loop, and sets restarted if
+      /// profiling has been (re)started since the last loop
+      bool poll(bool& restarted)
+      {
+        restarted = false;
+        if (!is_running())
+          return false;
+        if (applied_epoch_ != epoch_.load(std::memory_order_acquire)) {
+          reset();
+          restarted = true;
+        }
+        return true;
+      }
+      /// called by the task manager thread for every loop poll() allowed
+      void record_loop(ns inter_loop, ns rib, ns apps, ns loop, uint64_t processed)
+      {
+        inter_loop_.record(inter_loop.count());
+        rib_.record(rib.count());
+        apps_.record(apps.count());
+        loop_.record(loop.count());
+        processed_.record(processed);
+      }
+      /// called by the task manager thread to update the receive counters
+      void set_rx_counters(const std::vector<rib::rx_counter>& rx);
+
+      std::string to_json_string() const;
+
+    private:
+      void reset();
+
+      std::atomic<bool> running_;
+      std::atomic<uint64_t> epoch_;
+      uint64_t applied_epoch_;
+      std::atomic<int64_t> start_ns_;
+      std::atomic<int64_t> stop_ns_;
+
+      hdr_histogram inter_loop_;
+      hdr_histogram rib_;
+      hdr_histogram apps_;
+      hdr_histogram loop_;
+      hdr_histogram processed_;
+
+      mutable std::mutex rx_mutex_;
+      std::vector<rib::rx_counter> rx_;
+    };
+
+  }
+
+}
+
+#endif /* RUNTIME_PROFILER_H_ */
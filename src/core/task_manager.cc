@@ -26,156 +26,133 @@
 #include <thread>
 #include <unistd.h>
 #include <iostream>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
 
 #include "task_manager.h"
+#include "thread_placement.h"
 #include "flexran_log.h"
 
 extern std::atomic_bool g_exit_controller;
 
-#ifdef PROFILE
-#include <chrono>
-#include <fstream>
-#include <sstream>
-#include <iomanip>
-#ifdef LOWLATENCY
-#include <linux/types.h>
-#include <sched.h>
-#include <cerrno>
-#include <cstring>
-#endif
-
-extern std::atomic_bool g_doprof;
-extern std::chrono::time_point<std::chrono::steady_clock> start;
-#endif
-
 flexran::core::task_manager::task_manager(flexran::rib::rib_updater& r_updater,
-    flexran::event::subscription& ev)
-  : rt_task(Policy::FIFO, 80), r_updater_(r_updater), event_sub_(ev) {
-  struct itimerspec its;
-  
-  sfd = timerfd_create(CLOCK_MONOTONIC, 0);
-  
-  /* Start the timer */
-  its.it_value.tv_sec = 0;
-  its.it_value.tv_nsec = 1000 * 1000;
-  its.it_interval.tv_sec = its.it_value.tv_sec;
-  its.it_interval.tv_nsec = its.it_value.tv_nsec;
-  
-  if (timerfd_settime(sfd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
-    LOG4CXX_ERROR(flog::core, "Failed to set timer for task manager");
-  }
+    flexran::event::subscription& ev, std::size_t app_workers,
+    const std::vector<int>& app_cpus, std::chrono::microseconds app_budget,
+    std::chrono::nanoseconds tick_period, tick_wait wait, std::chrono::nanoseconds spin)
+  : rt_task(Policy::FIFO, 80), r_updater_(r_updater), event_sub_(ev),
+    executor_(app_workers, app_cpus, app_budget), timer_(tick_period, wait, spin),
+    tick_(0), missed_ticks_(0), late_loops_(0),
+    poll_while_waiting_(false), polled_messages_(0), commands_(nullptr) {
+  executor_.set_accounting(&event_sub_.get_accounting());
 }
 
 void flexran::core::task_manager::run() {
+  name_thread("rtc-tm");
+  if (!cpus_.empty()) {
+    std::string error;
+    if (!pin_thread(pthread_self(), cpus_, error))
+      LOG4CXX_ERROR(flog::core, "task_manager: " << error);
+    else
+      LOG4CXX_INFO(flog::core, "task_manager: pinned to CPU(s) "
+          << cpu_list_to_string(cpus_));
+  }
+  executor_.start();
+  timer_.start();
+  event_sub_.set_applier(std::this_thread::get_id());
+  if (commands_)
+    commands_->set_executor(std::this_thread::get_id());
   manage_rt_tasks();
+  event_sub_.set_applier(std::thread::id());
+  event_sub_.apply_deferred();
+  if (commands_) {
+    commands_->set_executor(std::thread::id());
+    commands_->run(std::chrono::steady_clock::time_point::max());
+  }
+  executor_.stop();
 }
 
 void flexran::core::task_manager::manage_rt_tasks()
 {
   uint64_t t = 0;
-  std::chrono::steady_clock::time_point loop_start;
+  std::chrono::steady_clock::time_point loop_start = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point last_loop_start, app_start;
   std::chrono::duration<float, std::micro> loop_dur;
-#ifdef PROFILE
-  std::chrono::steady_clock::time_point app_start;
-  std::chrono::duration<float, std::micro> rib_dur, app_dur, inter_dur;
-
-  std::unique_ptr<std::stringstream> ss(nullptr);
-  int rounds = 10000;
+  // warn about loops close to the tick period
+  const std::chrono::duration<float, std::micro> max_loop_dur =
+      timer_.get_period() * 99 / 100;
   unsigned int processed;
-#endif
+  bool restarted;
+  bool was_profiling = false;
+  std::vector<flexran::rib::rx_counter> rx;
+  // apps are finished while waiting, so the RIB may be updated; take one
+  // message at a time to not overshoot the tick
+  std::function<void()> poll;
+  if (poll_while_waiting_)
+    poll = [this] { polled_messages_ += r_updater_.poll(1); };
 
   while (!g_exit_controller) {
-#ifdef PROFILE
-    inter_dur = std::chrono::steady_clock::now() - loop_start;
-#endif
+    last_loop_start = loop_start;
     loop_start = std::chrono::steady_clock::now();
+    const bool profiling = profiler_.poll(restarted);
+    if (restarted)
+      r_updater_.reset_rx_counters();
+    r_updater_.set_count_rx(profiling);
 
-    // First run the RIB updater
-#ifdef PROFILE
-    processed =
-#endif
-    r_updater_.run();
+    // subscription changes of other threads are applied between ticks
+    event_sub_.apply_deferred();
 
-#ifdef PROFILE
+    // First run the RIB updater
+    processed = r_updater_.run(t);
     app_start = std::chrono::steady_clock::now();
-    rib_dur = app_start - loop_start;
-#endif
 
-    event_sub_.task_tick_(t);
+    // Commands of other threads (e.g., REST) see the same RIB as the apps
+    if (commands_)
+      commands_->run(app_start + commands_->get_budget());
+
+    // Then the apps: jobs go to the executor's workers while the plain tick
+    // subscribers run here, after which this thread helps with the jobs. All
+    // of them need to be finished before the RIB updater runs again
+    jobs_.clear();
+    event_sub_.advance_task_tick(t, jobs_);
+    executor_.dispatch(t, jobs_, loop_start);
+    event_sub_.run_task_tick(t, loop_start + executor_.get_budget());
+    executor_.join();
     event_sub_.last_tick_ = t;
 
-    loop_dur = std::chrono::steady_clock::now() - loop_start;
-    if (loop_dur.count() > 990)
-      LOG4CXX_WARN(flog::app, "task_manager: loop duration was "
-          << loop_dur.count() << " us");
-#ifdef PROFILE
-    app_dur = std::chrono::steady_clock::now() - app_start;
-    loop_dur = std::chrono::steady_clock::now() - loop_start;
-    if (g_doprof) {
-      if (!ss) {
-        LOG4CXX_WARN(flog::core, "start profiling task_manager");
-        ss.reset(new std::stringstream);
-      }
-      *ss << inter_dur.count() << "\t" << loop_dur.count() << "\t"
-          << rib_dur.count() << "\t" << processed << "\t" << app_dur.count() << "\n";
-      rounds--;
-      if (rounds == 0) {
-        g_doprof = false;
-        rounds = 10000;
-        std::thread t(flexran::core::task_manager::profiler_wb_thread, std::move(ss), event_sub_.task_tick_.num_slots());
-        t.detach();
-        LOG4CXX_WARN(flog::core, "profiling done");
-        r_updater_.print_prof_results(std::chrono::steady_clock::now() - start);
-      }
+    const std::chrono::steady_clock::time_point loop_end = std::chrono::steady_clock::now();
+    loop_dur = loop_end - loop_start;
+    if (loop_dur > max_loop_dur) {
+      std::string app;
+      float app_us;
+      if (event_sub_.get_accounting().get_slowest(app, app_us))
+        LOG4CXX_WARN(flog::app, "task_manager: loop duration was "
+            << loop_dur.count() << " us, slowest app " << app << " ("
+            << app_us << " us)");
+      else
+        LOG4CXX_WARN(flog::app, "task_manager: loop duration was "
+            << loop_dur.count() << " us");
     }
-#endif
-    t++;
-    wait_for_cycle();
-  }
-}
-
-
-#ifdef PROFILE
-void flexran::core::task_manager::profiler_wb_thread(
-    std::unique_ptr<std::stringstream> ss, size_t num_apps)
-{
-#ifdef LOWLATENCY
-  /* set back priority to standard */
-  struct sched_param sp;
-  sp.sched_priority = 0;
-  int ret = sched_setscheduler(0, SCHED_OTHER, &sp);
-  if (ret != 0) {
-    LOG4CXX_ERROR(flog::core, "error for sched_setscheduler(): "
-        << std::strerror(errno));
-  }
-#endif
-
-  auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-  std::stringstream h;
-  h << std::put_time(std::localtime(&now), "%H.%M.%S");
-  std::string fn = "tm.profile." + std::to_string(num_apps) + "." + h.str() + ".dat";
-  std::ofstream fstat;
-  LOG4CXX_WARN(flog::core, "writing to file " << fn);
-  fstat.open(fn);
-  if (!fstat.is_open()) {
-    LOG4CXX_ERROR(flog::core, "can not open file for writing profiling info");
-    return;
-  }
-  fstat << "inter loop\tinner loop dur\trib dur\tprocessed\tapp dur\n";
-  fstat << ss->rdbuf();
-  fstat.close();
-}
-#endif
-
-void flexran::core::task_manager::wait_for_cycle() {
-  uint64_t exp;
-  ssize_t res;
-
-  if (sfd > 0) {
-    res = read(sfd, &exp, sizeof(exp));
-
-    if ((res < 0) || (res != sizeof(exp))) {
-      LOG4CXX_ERROR(flog::core, "Failed in task manager timer wait");
+    if (profiling)
+      profiler_.record_loop(loop_start - last_loop_start, app_start - loop_start,
+          loop_end - app_start, loop_end - loop_start, processed);
+    // the agent list may only be read here, so copy the counters now and then
+    if ((profiling && (restarted || t % 100 == 0)) || (!profiling && was_profiling)) {
+      r_updater_.get_rx_counters(rx);
+      profiler_.set_rx_counters(rx);
+    }
+    was_profiling = profiling;
+
+    // The timer might have expired several times during this loop, in which
+    // case apps see the ticks they missed (see missed_tick_policy)
+    const uint64_t ticks = timer_.wait(poll);
+    if (ticks > 1) {
+      missed_ticks_ += ticks - 1;
+      late_loops_++;
+      LOG4CXX_DEBUG(flog::core, "task_manager: missed " << ticks - 1
+          << " ticks after tick " << t);
     }
+    t += ticks;
+    tick_ = t;
   }
 }
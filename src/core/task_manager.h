@@ -30,13 +30,15 @@
 #include "rt_wrapper.h"
 #include "component.h"
 #include "subscription.h"
+#include "app_executor.h"
+#include "runtime_profiler.h"
+#include "tick_timer.h"
+#include "command_bus.h"
 
 #include <linux/types.h>
 #include <vector>
 #include <memory>
 
-#include <sys/timerfd.h>
-
 namespace flexran {
 
   namespace core {
@@ -44,7 +46,43 @@ namespace flexran {
     class task_manager : public rt::rt_task {
     public:
 
-      task_manager(flexran::rib::rib_updater& r_updater, flexran::event::subscription& ev);
+      /// app_workers: number of threads running app jobs in parallel to
+      /// the task manager thread (0: all jobs run in the task manager
+      /// thread), app_cpus: CPUs to pin them to, app_budget: time after the
+      /// tick start after which app jobs are not started anymore,
+      /// tick_period: duration of a tick, which should match the
+      /// subscription's ticks per ms, tick_wait and spin: see tick_timer
+      task_manager(flexran::rib::rib_updater& r_updater, flexran::event::subscription& ev,
+          std::size_t app_workers = 0, const std::vector<int>& app_cpus = {},
+          std::chrono::microseconds app_budget = std::chrono::microseconds(900),
+          std::chrono::nanoseconds tick_period = std::chrono::milliseconds(1),
+          tick_wait wait = tick_wait::timerfd,
+          std::chrono::nanoseconds spin = std::chrono::microseconds(50));
+
+      const app_executor& get_app_executor() const { return executor_; }
+      runtime_profiler& get_profiler() { return profiler_; }
+      const flexran::event::subscription& get_subscription() const { return event_sub_; }
+      flexran::event::subscription& get_subscription() { return event_sub_; }
+      const tick_timer& get_tick_timer() const { return timer_; }
+      tick_timer& get_tick_timer() { return timer_; }
+      /// pins the task manager thread to cpus when it starts (empty: no
+      /// pinning). The app workers' own CPUs are given in the constructor
+      void set_cpus(const std::vector<int>& cpus) { cpus_ = cpus; }
+      const std::vector<int>& get_cpus() const { return cpus_; }
+      /// commands of other threads to run after the RIB updater in every
+      /// tick (none if nullptr)
+      void set_command_bus(command_bus *bus) { commands_ = bus; }
+      const command_bus *get_command_bus() const { return commands_; }
+      /// if set, agent messages are processed while spinning for a tick
+      void set_poll_while_waiting(bool poll) { poll_while_waiting_ = poll; }
+      /// number of agent messages processed while waiting for a tick
+      uint64_t get_polled_messages() const { return polled_messages_; }
+      /// the current tick, i.e., the number of tick periods since the start
+      uint64_t get_tick() const { return tick_; }
+      /// number of ticks passed while the previous loop was still running
+      uint64_t get_missed_ticks() const { return missed_ticks_; }
+      /// number of loops after which ticks were missed
+      uint64_t get_late_loops() const { return late_loops_; }
 
       void manage_rt_tasks();
 
@@ -52,16 +90,20 @@ namespace flexran {
       
       void run();
   
-      void wait_for_cycle();
 
-#ifdef PROFILE
-      static void profiler_wb_thread(std::unique_ptr<std::stringstream> ss, size_t num_app);
-#endif
-      
       flexran::rib::rib_updater& r_updater_;
       flexran::event::subscription& event_sub_;
-
-      int sfd;
+      app_executor executor_;
+      app_executor::job_list jobs_;
+      runtime_profiler profiler_;
+      tick_timer timer_;
+      std::atomic<uint64_t> tick_;
+      std::atomic<uint64_t> missed_ticks_;
+      std::atomic<uint64_t> late_loops_;
+      std::vector<int> cpus_;
+      bool poll_while_waiting_;
+      std::atomic<uint64_t> polled_messages_;
+      command_bus *commands_;
 
     };
   }
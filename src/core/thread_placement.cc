@@ -0,0 +1,223 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    thread_placement.cc
+ *  \brief   CPU placement of the controller's threads
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <dirent.h>
+#include <sched.h>
+
+#include "thread_placement.h"
+
+namespace {
+  std::string nodes_to_json(const std::vector<int>& nodes)
+  {
+    std::string s = "[";
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+      s += (i > 0 ? "," : "") + std::to_string(nodes[i]);
+    return s + "]";
+  }
+
+  std::string read_comm(pid_t tid)
+  {
+    std::ifstream f("/proc/self/task/" + std::to_string(tid) + "/comm");
+    std::string name;
+    std::getline(f, name);
+    /* comm can be set by anyone, keep it valid JSON */
+    name.erase(std::remove_if(name.begin(), name.end(),
+          [](char c) { return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20; }),
+        name.end());
+    return name;
+  }
+}
+
+std::string flexran::core::to_string(thread_class c)
+{
+  switch (c) {
+    case thread_class::task_manager: return "task_manager";
+    case thread_class::network:      return "network";
+    case thread_class::workers:      return "workers";
+    case thread_class::rest:         return "rest";
+  }
+  return "unknown";
+}
+
+bool flexran::core::parse_cpu_list(const std::string& s, std::vector<int>& cpus)
+{
+  std::vector<int> parsed;
+  std::size_t pos = 0;
+  while (pos < s.size()) {
+    std::size_t end = s.find(',', pos);
+    if (end == std::string::npos)
+      end = s.size();
+    const std::string range = s.substr(pos, end - pos);
+    const std::size_t dash = range.find('-');
+    const std::string first = range.substr(0, dash);
+    const std::string last = dash == std::string::npos ? first : range.substr(dash + 1);
+    if (first.empty() || last.empty()
+        || first.find_first_not_of("0123456789") != std::string::npos
+        || last.find_first_not_of("0123456789") != std::string::npos)
+      return false;
+    const int lo = std::atoi(first.c_str());
+    const int hi = std::atoi(last.c_str());
+    if (lo > hi || hi >= CPU_SETSIZE)
+      return false;
+    for (int c = lo; c <= hi; ++c)
+      parsed.push_back(c);
+    pos = end + 1;
+  }
+  if (parsed.empty())
+    return false;
+  std::sort(parsed.begin(), parsed.end());
+  parsed.erase(std::unique(parsed.begin(), parsed.end()), parsed.end());
+  cpus = std::move(parsed);
+  return true;
+}
+
+std::string flexran::core::cpu_list_to_string(const std::vector<int>& cpus)
+{
+  std::string s;
+  for (std::size_t i = 0; i < cpus.size(); ) {
+    std::size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+      ++j;
+    if (!s.empty())
+      s += ",";
+    s += std::to_string(cpus[i]);
+    if (j > i)
+      s += "-" + std::to_string(cpus[j]);
+    i = j + 1;
+  }
+  return s;
+}
+
+int flexran::core::numa_node_of_cpu(int cpu)
+{
+  /* the CPU's directory has a link nodeN to its node */
+  const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+  DIR *d = opendir(path.c_str());
+  if (!d)
+    return -1;
+  int node = -1;
+  while (struct dirent *e = readdir(d)) {
+    if (std::strncmp(e->d_name, "node", 4) == 0
+        && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+      node = std::atoi(e->d_name + 4);
+      break;
+    }
+  }
+  closedir(d);
+  return node;
+}
+
+std::vector<int> flexran::core::numa_nodes_of_cpus(const std::vector<int>& cpus)
+{
+  std::vector<int> nodes;
+  for (int c : cpus) {
+    const int n = numa_node_of_cpu(c);
+    if (n >= 0 && std::find(nodes.begin(), nodes.end(), n) == nodes.end())
+      nodes.push_back(n);
+  }
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+bool flexran::core::pin_thread(pthread_t thread, const std::vector<int>& cpus,
+    std::string& error)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c : cpus)
+    CPU_SET(c, &set);
+  const int rc = pthread_setaffinity_np(thread, sizeof(set), &set);
+  if (rc != 0) {
+    error = "can not pin to CPU(s) " + cpu_list_to_string(cpus) + ": " + std::strerror(rc);
+    return false;
+  }
+  return true;
+}
+
+std::vector<int> flexran::core::get_thread_cpus(pid_t tid)
+{
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(tid, sizeof(set), &set) != 0)
+    return cpus;
+  for (int c = 0; c < CPU_SETSIZE; ++c)
+    if (CPU_ISSET(c, &set))
+      cpus.push_back(c);
+  return cpus;
+}
+
+void flexran::core::name_thread(const std::string& name)
+{
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
+
+std::string flexran::core::thread_placement::to_string() const
+{
+  std::string s;
+  for (std::size_t i = 0; i < NUM_CLASSES; ++i) {
+    if (i > 0)
+      s += ", ";
+    s += flexran::core::to_string(static_cast<thread_class>(i)) + ": "
+        + (cpus_[i].empty() ? "any" : cpu_list_to_string(cpus_[i]));
+  }
+  return s;
+}
+
+std::string flexran::core::thread_placement::to_json_string() const
+{
+  std::string s = "{\"classes\":{";
+  for (std::size_t i = 0; i < NUM_CLASSES; ++i) {
+    if (i > 0)
+      s += ",";
+    s += "\"" + flexran::core::to_string(static_cast<thread_class>(i)) + "\":{"
+        + "\"cpus\":\"" + cpu_list_to_string(cpus_[i]) + "\","
+        + "\"nodes\":" + nodes_to_json(numa_nodes_of_cpus(cpus_[i])) + "}";
+  }
+  s += "},\"threads\":[";
+
+  std::vector<pid_t> tids;
+  if (DIR *d = opendir("/proc/self/task")) {
+    while (struct dirent *e = readdir(d))
+      if (e->d_name[0] >= '0' && e->d_name[0] <= '9')
+        tids.push_back(std::atoi(e->d_name));
+    closedir(d);
+  }
+  std::sort(tids.begin(), tids.end());
+  for (std::size_t i = 0; i < tids.size(); ++i) {
+    const std::vector<int> cpus = get_thread_cpus(tids[i]);
+    if (i > 0)
+      s += ",";
+    s += "{\"tid\":" + std::to_string(tids[i])
+        + ",\"name\":\"" + read_comm(tids[i]) + "\""
+        + ",\"cpus\":\"" + cpu_list_to_string(cpus) + "\""
+        + ",\"nodes\":" + nodes_to_json(numa_nodes_of_cpus(cpus)) + "}";
+  }
+  return s + "]}";
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    thread_placement.h
+ *  \brief   CPU placement of the controller's threads
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef THREAD_PLACEMENT_H_
+#define THREAD_PLACEMENT_H_
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/types.h>
+
+namespace flexran {
+
+  namespace core {
+
+    /// The classes of threads the controller runs, which can be placed
+    /// independently
+    enum class thread_class {
+      task_manager, // the RIB updater and app ticks
+      network,      // the agent connections' reactor
+      workers,      // the app executor's worker pool
+      rest          // the northbound HTTP server
+    };
+    std::string to_string(thread_class c);
+
+    /// parses a CPU list as in cpuset(7), e.g., "0-3,8,10-11", into a sorted
+    /// list without duplicates
+    bool parse_cpu_list(const std::string& s, std::vector<int>& cpus);
+    std::string cpu_list_to_string(const std::vector<int>& cpus);
+    /// the NUMA node of cpu as exposed in sysfs, or -1 if unknown
+    int numa_node_of_cpu(int cpu);
+    /// the distinct NUMA nodes of cpus
+    std::vector<int> numa_nodes_of_cpus(const std::vector<int>& cpus);
+
+    /// restricts thread to cpus. Threads created afterwards by thread
+    /// inherit the set. Returns false and sets error if the set could not be
+    /// applied
+    bool pin_thread(pthread_t thread, const std::vector<int>& cpus, std::string& error);
+    /// the CPUs thread tid (of this process) may run on
+    std::vector<int> get_thread_cpus(pid_t tid);
+    /// names the calling thread (truncated to 15 characters) so it can be
+    /// told apart in the placement report, top, perf etc.
+    void name_thread(const std::string& name);
+
+    /// The CPU sets each thread class should run on. Pinning is done by the
+    /// threads themselves (or the thread creating them, from which they
+    /// inherit the set) before they allocate their memory, so that it is
+    /// placed on the local NUMA node with the kernel's default first-touch
+    /// policy. The report lists the configured sets and the effective
+    /// affinity of every thread of the process, including those started by
+    /// libraries.
+    class thread_placement {
+    public:
+      /// an empty set leaves the threads of class c unpinned
+      void set_cpus(thread_class c, const std::vector<int>& cpus)
+      { cpus_[static_cast<std::size_t>(c)] = cpus; }
+      const std::vector<int>& get_cpus(thread_class c) const
+      { return cpus_[static_cast<std::size_t>(c)]; }
+
+      /// the configured CPU sets, in one line
+      std::string to_string() const;
+      /// the configured CPU sets with their NUMA nodes and the effective
+      /// CPUs of all threads of this process
+      std::string to_json_string() const;
+
+    private:
+      static const std::size_t NUM_CLASSES = 4;
+      std::array<std::vector<int>, NUM_CLASSES> cpus_;
+    };
+
+  }
+
+}
+
+#endif /* THREAD_PLACEMENT_H_ */
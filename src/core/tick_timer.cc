@@ -0,0 +1,174 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    tick_timer.cc
+ *  \brief   periodic timer driving the task manager ticks
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tick_timer.h"
+#include "flexran_log.h"
+
+namespace {
+  timespec to_timespec(uint64_t ns)
+  {
+    timespec ts;
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+  }
+
+  inline void cpu_relax()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+}
+
+bool flexran::core::parse_tick_wait(const std::string& s, tick_wait& w)
+{
+  if (s == "timerfd")     w = tick_wait::timerfd;
+  else if (s == "hybrid") w = tick_wait::hybrid;
+  else if (s == "busy")   w = tick_wait::busy;
+  else                    return false;
+  return true;
+}
+
+std::string flexran::core::to_string(tick_wait w)
+{
+  switch (w) {
+    case tick_wait::timerfd: return "timerfd";
+    case tick_wait::hybrid:  return "hybrid";
+    case tick_wait::busy:    return "busy";
+  }
+  return "unknown";
+}
+
+flexran::core::tick_timer::tick_timer(std::chrono::nanoseconds period,
+    tick_wait mode, std::chrono::nanoseconds spin)
+  : period_(period),
+    mode_(mode),
+    applied_mode_(mode),
+    spin_(spin),
+    fd_(timerfd_create(CLOCK_MONOTONIC, 0)),
+    epoch_ns_(0),
+    ticks_(0)
+{
+}
+
+flexran::core::tick_timer::~tick_timer()
+{
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+uint64_t flexran::core::tick_timer::now_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+bool flexran::core::tick_timer::start()
+{
+  for (auto& h : wakeup_)
+    h.reset();
+  ticks_ = 0;
+  epoch_ns_ = now_ns();
+  applied_mode_ = mode_;
+  if (applied_mode_ != tick_wait::timerfd)
+    return true;
+  if (fd_ < 0 || arm(true) == 0) {
+    LOG4CXX_ERROR(flog::core, "Failed to set timer for task manager");
+    return false;
+  }
+  return true;
+}
+
+uint64_t flexran::core::tick_timer::arm(bool enable)
+{
+  struct itimerspec its = {};
+  uint64_t first = 0;
+  if (enable) {
+    first = (now_ns() - epoch_ns_) / period_.count() + 1;
+    its.it_value = to_timespec(epoch_ns_ + first * period_.count());
+    its.it_interval = to_timespec(period_.count());
+  }
+  if (timerfd_settime(fd_, TFD_TIMER_ABSTIME, &its, NULL) == -1)
+    return 0;
+  return first;
+}
+
+uint64_t flexran::core::tick_timer::wait(const std::function<void()>& poll)
+{
+  const uint64_t period = period_.count();
+  const tick_wait mode = mode_;
+  uint64_t now;
+  uint64_t n = 1;
+  /* ticks that passed while switching to the timerfd */
+  uint64_t skipped = 0;
+
+  if (mode != applied_mode_) {
+    if (mode == tick_wait::timerfd) {
+      const uint64_t first = arm(true);
+      if (first > ticks_ + 1)
+        skipped = first - 1 - ticks_;
+    } else if (applied_mode_ == tick_wait::timerfd) {
+      arm(false);
+    }
+    applied_mode_ = mode;
+  }
+
+  if (mode == tick_wait::timerfd) {
+    uint64_t exp = 0;
+    const ssize_t res = read(fd_, &exp, sizeof(exp));
+    now = now_ns();
+    if (res != sizeof(exp) || exp == 0) {
+      LOG4CXX_ERROR(flog::core, "Failed in task manager timer wait");
+      exp = 1;
+    }
+    n = exp + skipped;
+    ticks_ += n;
+  } else {
+    const uint64_t deadline = epoch_ns_ + (ticks_ + 1) * period;
+    now = now_ns();
+    if (mode == tick_wait::hybrid && now + spin_.count() < deadline) {
+      const timespec ts = to_timespec(deadline - spin_.count());
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    while ((now = now_ns()) < deadline) {
+      if (poll)
+        poll();
+      else
+        cpu_relax();
+    }
+    const uint64_t elapsed = (now - epoch_ns_) / period;
+    n = elapsed - ticks_;
+    ticks_ = elapsed;
+  }
+
+  const uint64_t tick_ns = epoch_ns_ + ticks_ * period;
+  wakeup_[static_cast<std::size_t>(mode)].record(now > tick_ns ? now - tick_ns : 0);
+  return n;
+}
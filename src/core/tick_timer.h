@@ -0,0 +1,102 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    tick_timer.h
+ *  \brief   periodic timer driving the task manager ticks
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef TICK_TIMER_H_
+#define TICK_TIMER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "hdr_histogram.h"
+
+namespace flexran {
+
+  namespace core {
+
+    /// How the task manager waits for the next tick
+    enum class tick_wait {
+      timerfd, // block in a read on a timerfd
+      hybrid,  // sleep until shortly before the tick, then spin on the clock
+      busy     // spin on the clock for the whole tick
+    };
+    bool parse_tick_wait(const std::string& s, tick_wait& w);
+    std::string to_string(tick_wait w);
+
+    /// Periodic timer on CLOCK_MONOTONIC. Blocking on a timerfd costs the
+    /// scheduler's wakeup latency, which is significant for sub-millisecond
+    /// periods, in which case the hybrid and busy modes trade CPU time for
+    /// accuracy; the thread should then be pinned to an isolated CPU. Only
+    /// one thread may wait on a timer, but the mode can be changed and the
+    /// wakeup latency (kept per mode, for comparison) read from any thread.
+    class tick_timer {
+    public:
+      /// spin: time before a tick after which the hybrid mode spins
+      tick_timer(std::chrono::nanoseconds period, tick_wait mode,
+          std::chrono::nanoseconds spin = std::chrono::microseconds(50));
+      ~tick_timer();
+
+      /// (re)starts counting ticks from now. Returns false if the timerfd
+      /// could not be set
+      bool start();
+      /// waits for the next tick and returns the number of ticks since the
+      /// last call, i.e., more than one if ticks were missed. While
+      /// spinning, poll is called repeatedly instead of idling, so it should
+      /// return quickly
+      uint64_t wait(const std::function<void()>& poll = std::function<void()>());
+
+      std::chrono::nanoseconds get_period() const { return period_; }
+      /// takes effect with the next wait()
+      void set_mode(tick_wait mode) { mode_ = mode; }
+      tick_wait get_mode() const { return mode_; }
+      std::chrono::nanoseconds get_spin() const { return spin_; }
+      /// how late the thread woke up after a tick in the given mode, in ns
+      const hdr_histogram& get_wakeup_latency(tick_wait mode) const
+      { return wakeup_[static_cast<std::size_t>(mode)]; }
+
+    private:
+      static const std::size_t NUM_MODES = 3;
+      static uint64_t now_ns();
+      /// arms the timerfd to expire at the next tick after now, or disarms
+      /// it. Returns the tick at which it expires first
+      uint64_t arm(bool enable);
+
+      const std::chrono::nanoseconds period_;
+      std::atomic<tick_wait> mode_;
+      tick_wait applied_mode_;
+      const std::chrono::nanoseconds spin_;
+      int fd_;
+      uint64_t epoch_ns_;
+      uint64_t ticks_; // since epoch_ns_
+      std::array<hdr_histogram, NUM_MODES> wakeup_;
+    };
+
+  }
+
+}
+
+#endif /* TICK_TIMER_H_ */
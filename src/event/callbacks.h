@@ -27,6 +27,8 @@
 
 #include <boost/signals2.hpp>
 namespace bs2 = boost::signals2;
+#include <vector>
+
 #include "rib_common.h"
 #include "flexran.pb.h"
 
@@ -43,12 +45,32 @@ namespace flexran {
         bs2::keywords::mutex_type<bs2::dummy_mutex>>::type ue_cb;
 
     /// Single-thread callback for Task events (tick)
-    /// Argument is current task iteration (on a ms basis, but might be
-    /// inaccurate due to skipped milliseconds)
+    /// Argument is current task iteration (on a ms basis; the task manager
+    /// counts missed milliseconds, see missed_tick_policy)
     typedef bs2::signal_type<void(uint64_t),
         bs2::keywords::mutex_type<bs2::dummy_mutex>>::type task_cb;
 
 
+    /// The RIB data of a BS that has been refreshed since the last tick
+    struct stats_update {
+      uint64_t bs_id;
+      /// the UEs with new MAC stats, sorted
+      std::vector<flexran::rib::rnti_t> rntis;
+      /// union of the flags of the UE and cell reports, see
+      /// protocol::flex_ue_stats_type and protocol::flex_cell_stats_type
+      uint32_t ue_flags;
+      uint32_t cell_flags;
+      /// number of stats replies and subframe triggers received
+      uint32_t stats_replies;
+      uint32_t sf_triggers;
+    };
+
+    /// Single-thread callback for fresh RIB data, called once per tick and
+    /// BS that sent stats or subframe triggers, after the RIB updater
+    /// processed all messages of the tick
+    typedef bs2::signal_type<void(const stats_update&),
+        bs2::keywords::mutex_type<bs2::dummy_mutex>>::type stats_cb;
+
     /// Single-thread callback for arbitrary protobuf message
     /// Argument is BS ID and the actual message
     template <typename ProtobufMsg>
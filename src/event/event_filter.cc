@@ -0,0 +1,91 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    event_filter.cc
+ *  \brief   BS and UE events and filters selecting them
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "event_filter.h"
+
+std::string flexran::event::to_string(event_kind k)
+{
+  switch (k) {
+    case event_kind::bs_add:        return "bs_add";
+    case event_kind::bs_remove:     return "bs_remove";
+    case event_kind::ue_connect:    return "ue_connect";
+    case event_kind::ue_update:     return "ue_update";
+    case event_kind::ue_disconnect: return "ue_disconnect";
+  }
+  return "unknown";
+}
+
+flexran::event::event_filter& flexran::event::event_filter::bs(uint64_t bs_id)
+{
+  if (std::find(bs_ids_.begin(), bs_ids_.end(), bs_id) == bs_ids_.end())
+    bs_ids_.push_back(bs_id);
+  return *this;
+}
+
+bool flexran::event::event_filter::matches_ue(const bs_ue_event& e, uint64_t imsi) const
+{
+  const bool is_ue = e.kind != event_kind::bs_add && e.kind != event_kind::bs_remove;
+  if (rnti_ != 0 && (!is_ue || e.rnti != rnti_))
+    return false;
+  if (!imsi_prefix_.empty()) {
+    if (!is_ue || imsi == 0)
+      return false;
+    char buf[24];
+    const int n = std::snprintf(buf, sizeof(buf), "%lu", static_cast<unsigned long>(imsi));
+    if (n < static_cast<int>(imsi_prefix_.size())
+        || std::strncmp(buf, imsi_prefix_.c_str(), imsi_prefix_.size()) != 0)
+      return false;
+  }
+  return true;
+}
+
+std::string flexran::event::event_filter::to_string() const
+{
+  std::string s = "kinds=";
+  if (kinds_ == 0) {
+    s += "all";
+  } else {
+    bool first = true;
+    for (std::size_t k = 0; k < NUM_EVENT_KINDS; ++k) {
+      if (!(kinds_ & (1 << k)))
+        continue;
+      s += (first ? "" : ",") + flexran::event::to_string(static_cast<event_kind>(k));
+      first = false;
+    }
+  }
+  if (!bs_ids_.empty()) {
+    s += " bs=";
+    for (std::size_t i = 0; i < bs_ids_.size(); ++i)
+      s += (i > 0 ? "," : "") + std::to_string(bs_ids_[i]);
+  }
+  if (rnti_ != 0)
+    s += " rnti=" + std::to_string(rnti_);
+  if (!imsi_prefix_.empty())
+    s += " imsi=" + imsi_prefix_ + "*";
+  return s;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    event_filter.h
+ *  \brief   BS and UE events and filters selecting them
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef EVENT_FILTER_H_
+#define EVENT_FILTER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rib_common.h"
+
+namespace flexran {
+  namespace event {
+
+    /// The BS and UE events of a subscription (see callbacks.h)
+    enum class event_kind : uint8_t {
+      bs_add, bs_remove, ue_connect, ue_update, ue_disconnect
+    };
+    static const std::size_t NUM_EVENT_KINDS = 5;
+    std::string to_string(event_kind k);
+
+    struct bs_ue_event {
+      event_kind kind;
+      uint64_t bs_id;
+      flexran::rib::rnti_t rnti; // 0 for BS events
+    };
+
+    /// Selects the BS and UE events a subscriber is interested in, e.g.,
+    /// event_filter().on(event_kind::ue_connect).bs(3584).imsi_prefix("20895").
+    /// Every criterion left out matches any event; BS events never match a
+    /// filter on RNTI or IMSI. The subscription indexes filters by kind and
+    /// BS, so subscribers are not even called for events of other BSs.
+    class event_filter {
+    public:
+      event_filter() : kinds_(0), rnti_(0) {}
+
+      event_filter& on(event_kind k)
+      { kinds_ |= 1 << static_cast<unsigned>(k); return *this; }
+      event_filter& bs(uint64_t bs_id);
+      event_filter& rnti(flexran::rib::rnti_t rnti) { rnti_ = rnti; return *this; }
+      event_filter& imsi_prefix(const std::string& prefix) { imsi_prefix_ = prefix; return *this; }
+
+      bool has_kind(event_kind k) const
+      { return kinds_ == 0 || (kinds_ & (1 << static_cast<unsigned>(k))) != 0; }
+      const std::vector<uint64_t>& get_bs_ids() const { return bs_ids_; }
+      bool has_imsi_prefix() const { return !imsi_prefix_.empty(); }
+      /// whether e (of a UE with imsi, 0 if unknown) matches apart from the
+      /// kind and BS, which the index checks
+      bool matches_ue(const bs_ue_event& e, uint64_t imsi) const;
+
+      /// the filter key, e.g., "kinds=ue_connect bs=3584 imsi=20895*"
+      std::string to_string() const;
+
+    private:
+      unsigned kinds_; // bit per event_kind, 0 for all
+      std::vector<uint64_t> bs_ids_;
+      flexran::rib::rnti_t rnti_;
+      std::string imsi_prefix_;
+    };
+
+  }
+}
+
+#endif /* EVENT_FILTER_H_ */
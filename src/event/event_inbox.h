@@ -0,0 +1,85 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    event_inbox.h
+ *  \brief   queue of controller events delivered asynchronously to an app
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef EVENT_INBOX_H_
+#define EVENT_INBOX_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include "event_filter.h"
+
+namespace flexran {
+  namespace event {
+
+    /// Events for one subscriber, queued while the RIB updater handles agent
+    /// messages instead of calling back into the subscriber at that time.
+    /// They are kept in a lock-free single-producer single-consumer queue:
+    /// the RIB updater (task manager thread) is the only producer, the
+    /// subscriber drains the inbox later, in a job of its own (see
+    /// component::subscribe_events()). Events keep the order in which they
+    /// happened, which in particular holds per BS. If the subscriber falls
+    /// behind by more than the capacity, newer events are dropped and
+    /// counted.
+    class event_inbox {
+    public:
+      explicit event_inbox(std::size_t capacity = 4096)
+        : queue_(capacity), capacity_(capacity), dropped_(0) {}
+
+      void push(const bs_ue_event& e)
+      {
+        if (!queue_.push(e))
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      /// calls f for every queued event, returns the number of events
+      template <typename F>
+      std::size_t drain(F&& f)
+      {
+        std::size_t n = 0;
+        bs_ue_event e;
+        while (queue_.pop(e)) {
+          f(e);
+          n++;
+        }
+        return n;
+      }
+
+      /// only valid in the consumer
+      std::size_t size() const { return queue_.read_available(); }
+      std::size_t capacity() const { return capacity_; }
+      uint64_t get_dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+      boost::lockfree::spsc_queue<bs_ue_event> queue_;
+      const std::size_t capacity_;
+      std::atomic<uint64_t> dropped_;
+    };
+
+  }
+}
+
+#endif /* EVENT_INBOX_H_ */
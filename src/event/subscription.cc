@@ -25,6 +25,28 @@
 #include "subscription.h"
 #include <algorithm>
 
+flexran::event::subscription::~subscription()
+{
+  /* the futures of functions never applied report a broken promise */
+  commands_.consume_all([] (std::function<void()> *fn) { delete fn; });
+}
+
+void flexran::event::subscription::apply_deferred()
+{
+  std::function<void()> *fn;
+  while (commands_.pop(fn)) {
+    (*fn)();
+    delete fn;
+  }
+}
+
+bool flexran::event::task_timer::reschedule(uint64_t period, uint64_t start) const
+{
+  if (!sub_)
+    return false;
+  return sub_->reschedule(entry_, period, start);
+}
+
 bs2::connection
 flexran::event::subscription::subscribe_bs_add(const bs_cb::slot_type& cb)
 {
@@ -85,26 +107,308 @@ flexran::event::subscription::subscribe_ue_disconnect_extended(const ue_cb::exte
   return ue_disconnect_.connect_extended(cb);
 }
 
+bs2::connection
+flexran::event::subscription::subscribe_stats_update(const stats_cb::slot_type& cb)
+{
+  return stats_update_.connect(cb);
+}
+
+bs2::connection
+flexran::event::subscription::subscribe_events(const event_filter& filter,
+    const std::function<void(const bs_ue_event&)>& cb, const std::string& app)
+{
+  auto f = std::make_shared<filtered_subscription>();
+  f->filter = filter;
+  f->cb = cb;
+  f->app = app;
+  f->conn = timer_connections_.connect([] {});
+  /* the connection is valid right away, but only the task manager thread
+   * touches the index, between two ticks */
+  defer([this, f] { add_filter(f); });
+  return f->conn;
+}
+
+void flexran::event::subscription::add_filter(
+    const std::shared_ptr<filtered_subscription>& f)
+{
+  for (std::size_t k = 0; k < NUM_EVENT_KINDS; ++k) {
+    if (!f->filter.has_kind(static_cast<event_kind>(k)))
+      continue;
+    if (f->filter.get_bs_ids().empty())
+      filters_[k].any_bs.push_back(f);
+    for (uint64_t bs_id : f->filter.get_bs_ids())
+      filters_[k].by_bs[bs_id].push_back(f);
+  }
+  filtered_.push_back(f);
+  prune_filters();
+}
+
+bs2::connection
+flexran::event::subscription::subscribe_inbox(const event_filter& filter,
+    std::shared_ptr<event_inbox> inbox, const std::string& app)
+{
+  return subscribe_events(filter,
+      [inbox] (const bs_ue_event& e) { inbox->push(e); }, app);
+}
+
+void flexran::event::subscription::notify(event_kind kind, uint64_t bs_id,
+    flexran::rib::rnti_t rnti, uint64_t imsi)
+{
+  switch (kind) {
+    case event_kind::bs_add:        bs_add_(bs_id);               break;
+    case event_kind::bs_remove:     bs_remove_(bs_id);            break;
+    case event_kind::ue_connect:    ue_connect_(bs_id, rnti);     break;
+    case event_kind::ue_update:     ue_update_(bs_id, rnti);      break;
+    case event_kind::ue_disconnect: ue_disconnect_(bs_id, rnti);  break;
+  }
+  if (num_filtered_ == 0)
+    return;
+
+  const bs_ue_event e{kind, bs_id, rnti};
+  /* collect the matches first: callbacks may subscribe or disconnect */
+  matched_.clear();
+  const filter_index& idx = filters_[static_cast<std::size_t>(kind)];
+  bool disconnected = false;
+  auto collect = [&] (const filtered_list& list) {
+    for (const auto& f : list) {
+      if (!f->conn.connected())
+        disconnected = true;
+      else if (f->filter.matches_ue(e, imsi))
+        matched_.push_back(f);
+    }
+  };
+  collect(idx.any_bs);
+  const auto it = idx.by_bs.find(bs_id);
+  if (it != idx.by_bs.end())
+    collect(it->second);
+  if (disconnected)
+    prune_filters();
+  for (const auto& f : matched_)
+    f->cb(e);
+}
+
+void flexran::event::subscription::prune_filters()
+{
+  auto gone = [] (const std::shared_ptr<filtered_subscription>& f)
+      { return !f->conn.connected(); };
+  for (filter_index& idx : filters_) {
+    idx.any_bs.erase(std::remove_if(idx.any_bs.begin(), idx.any_bs.end(), gone),
+        idx.any_bs.end());
+    for (auto it = idx.by_bs.begin(); it != idx.by_bs.end(); ) {
+      it->second.erase(std::remove_if(it->second.begin(), it->second.end(), gone),
+          it->second.end());
+      it = it->second.empty() ? idx.by_bs.erase(it) : std::next(it);
+    }
+  }
+  filtered_.erase(std::remove_if(filtered_.begin(), filtered_.end(), gone),
+      filtered_.end());
+  num_filtered_ = filtered_.size();
+  num_imsi_filters_ = std::count_if(filtered_.begin(), filtered_.end(),
+      [] (const std::shared_ptr<filtered_subscription>& f)
+      { return f->filter.has_imsi_prefix(); });
+}
+
+std::string flexran::event::subscription::subscriptions_to_json_string() const
+{
+  std::string s = "{\"signals\":{"
+      "\"bs_add\":" + std::to_string(bs_add_.num_slots())
+      + ",\"bs_remove\":" + std::to_string(bs_remove_.num_slots())
+      + ",\"ue_connect\":" + std::to_string(ue_connect_.num_slots())
+      + ",\"ue_update\":" + std::to_string(ue_update_.num_slots())
+      + ",\"ue_disconnect\":" + std::to_string(ue_disconnect_.num_slots())
+      + ",\"stats_update\":" + std::to_string(stats_update_.num_slots())
+      + "},\"filtered\":[";
+  bool first = true;
+  for (const auto& f : filtered_) {
+    if (!f->conn.connected())
+      continue;
+    s += std::string(first ? "" : ",") + "{\"app\":\"" + f->app
+        + "\",\"filter\":\"" + f->filter.to_string() + "\"}";
+    first = false;
+  }
+  return s + "],\"task_timers\":" + std::to_string(num_task_timers()) + "}";
+}
+
 bs2::connection
 flexran::event::subscription::subscribe_task_tick(const task_cb::slot_type& cb,
-    uint64_t period, uint64_t start)
+    uint64_t period, uint64_t start, const std::string& app, missed_tick_policy missed)
 {
-  auto f = [period,start,cb] (uint64_t t)
-           {
-             if (t >= start && (t - start) % period == 0) cb(t);
-           };
-  return task_tick_.connect(f);
+  auto e = std::make_shared<task_timer_entry>();
+  auto f = cb.slot_function();
+  e->cb = [f] (const bs2::connection&, uint64_t t) { f(t); };
+  return add_task_timer(e, period, start, app, missed).connection();
 }
 
 bs2::connection
 flexran::event::subscription::subscribe_task_tick_extended(const task_cb::extended_slot_type& cb,
+    uint64_t period, uint64_t start, const std::string& app, missed_tick_policy missed)
+{
+  return subscribe_task_timer(cb, period, start, app, missed).connection();
+}
+
+flexran::event::task_timer
+flexran::event::subscription::subscribe_task_timer(const task_cb::extended_slot_type& cb,
+    uint64_t period, uint64_t start, const std::string& app, missed_tick_policy missed)
+{
+  auto e = std::make_shared<task_timer_entry>();
+  e->cb = cb.slot_function();
+  return add_task_timer(e, period, start, app, missed);
+}
+
+bs2::connection
+flexran::event::subscription::subscribe_task_job(std::shared_ptr<const task_job> job,
+    uint64_t period, uint64_t start, missed_tick_policy missed)
+{
+  auto e = std::make_shared<task_timer_entry>();
+  e->job = job;
+  return add_task_timer(e, period, start, job->name, missed).connection();
+}
+
+flexran::event::task_timer
+flexran::event::subscription::add_task_timer(std::shared_ptr<task_timer_entry> e,
+    uint64_t period, uint64_t start, const std::string& app, missed_tick_policy missed)
+{
+  e->app = accounting_.get_app(app.empty() ? "unnamed" : app);
+  e->missed = missed;
+  e->conn = timer_connections_.connect([] {});
+  /* the handle is valid right away, but only the task manager thread
+   * touches the wheel, between two ticks */
+  defer([this, e, period, start] { schedule(e, period, start); });
+  return task_timer(this, e);
+}
+
+bool flexran::event::subscription::reschedule(std::shared_ptr<task_timer_entry> e,
     uint64_t period, uint64_t start)
 {
-  auto f = [period,start,cb] (const bs2::connection& c, uint64_t t)
-           {
-             if (t >= start && (t - start) % period == 0) cb(c, t);
-           };
-  return task_tick_.connect_extended(f);
+  if (!e->conn.connected())
+    return false;
+  defer([this, e, period, start] {
+    if (e->conn.connected())
+      schedule(e, period, start);
+  });
+  return true;
+}
+
+void flexran::event::subscription::schedule(const std::shared_ptr<task_timer_entry>& e,
+    uint64_t period, uint64_t start)
+{
+  /* the wheel drops the reference to an old expiry */
+  e->generation++;
+  e->period = period;
+  e->due = first_due(timers_.now(), period, start);
+  timers_.insert(e);
+  num_timers_ = timers_.size();
+}
+
+uint64_t flexran::event::subscription::first_due(uint64_t now, uint64_t period,
+    uint64_t start)
+{
+  if (start >= now || period == 0)
+    return start;
+  return start + (now - start + period - 1) / period * period;
+}
+
+std::size_t flexran::event::subscription::num_task_timers() const
+{
+  return num_timers_;
+}
+
+void flexran::event::subscription::advance_task_tick(uint64_t t,
+    std::vector<std::shared_ptr<const task_job>>& jobs)
+{
+  accounting_.begin_tick();
+  due_.clear();
+  expired_.clear();
+  timers_.advance(t, expired_);
+  for (auto& w : expired_) {
+    auto e = std::static_pointer_cast<task_timer_entry>(w);
+    if (!e->conn.connected())
+      continue;
+    if (!e->job && e->app->offloaded) {
+      /* all callbacks of an offloaded app share an owner, so they are still
+       * serialized */
+      auto job = std::make_shared<task_job>();
+      job->name = e->app->name;
+      std::weak_ptr<task_timer_entry> we = e;
+      job->fn = [we] (uint64_t t) {
+        if (auto e = we.lock()) e->cb(e->conn, t);
+      };
+      job->owner = e->app;
+      job->app = e->app;
+      e->job = job;
+    }
+    /* if the task manager missed ticks, the timer might have been due
+     * several times since */
+    const uint64_t step = e->period * e->app->decimation;
+    const uint64_t n = step > 0 && e->due < t ? (t - e->due) / step + 1 : 1;
+    if (n > 1)
+      accounting_.record_missed(e->app, n - 1);
+    if (e->missed == missed_tick_policy::catch_up) {
+      for (uint64_t i = 0; i < n; ++i)
+        collect(e, e->due + i * step, t, jobs);
+    } else {
+      collect(e, t, t, jobs);
+    }
+    if (e->period > 0) {
+      e->due += n * step;
+      timers_.insert(e);
+    } else if (e->job) {
+      e->conn.disconnect();
+    }
+  }
+  num_timers_ = timers_.size();
+}
+
+void flexran::event::subscription::collect(const std::shared_ptr<task_timer_entry>& e,
+    uint64_t tick, uint64_t t, std::vector<std::shared_ptr<const task_job>>& jobs)
+{
+  if (!e->job) {
+    due_.emplace_back(e, tick);
+  } else if (tick == t) {
+    jobs.push_back(e->job);
+  } else {
+    /* the executor calls jobs with the current tick, so a job catching up
+     * gets a copy called with the tick it missed */
+    auto job = std::make_shared<task_job>(*e->job);
+    auto fn = e->job->fn;
+    job->fn = [fn, tick] (uint64_t) { fn(tick); };
+    jobs.push_back(job);
+  }
+}
+
+void flexran::event::subscription::run_task_tick(uint64_t t,
+    std::chrono::steady_clock::time_point deadline)
+{
+  /* callbacks deferred in the last tick go first, and are not deferred again */
+  deferring_.clear();
+  deferring_.swap(deferred_);
+  for (auto& e : deferring_)
+    if (e->conn.connected())
+      call(*e, t);
+
+  for (auto& d : due_) {
+    auto& e = d.first;
+    if (!e->conn.connected())
+      continue;
+    if (e->app->offender && std::chrono::steady_clock::now() > deadline) {
+      accounting_.record_deferred(e->app);
+      deferred_.push_back(e);
+      continue;
+    }
+    call(*e, d.second);
+  }
+  due_.clear();
+}
+
+void flexran::event::subscription::call(task_timer_entry& e, uint64_t t)
+{
+  const uint64_t generation = e.generation;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  e.cb(e.conn, t);
+  accounting_.record(e.app, std::chrono::steady_clock::now() - start);
+  /* one-shot timers end, unless rescheduled in the callback */
+  if (e.period == 0 && e.generation == generation)
+    e.conn.disconnect();
 }
 
 bs2::connection
@@ -25,11 +25,24 @@
 #ifndef SUBSCRIPTION_H_RRRR
 #define SUBSCRIPTION_H_RRRR
 
+#include <array>
 #include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/lockfree/queue.hpp>
 #include <boost/signals2.hpp>
 namespace bs2 = boost::signals2;
 
 #include "callbacks.h"
+#include "event_filter.h"
+#include "event_inbox.h"
+#include "task_accounting.h"
+#include "task_job.h"
+#include "timing_wheel.h"
 
 namespace flexran {
   namespace rib {
@@ -42,14 +55,73 @@ namespace flexran {
 
 namespace flexran {
   namespace event {
+    class subscription;
+
+    /// What a periodic timer does if the task manager missed some of its
+    /// ticks, e.g., because a loop took longer than a tick
+    enum class missed_tick_policy {
+      skip,    // run once, with the current tick
+      catch_up // run once per missed tick, with the tick it was due at
+    };
+
+    /// A tick callback or job in the timing wheel of a subscription
+    struct task_timer_entry : public wheel_timer {
+      uint64_t period; // 0 for one-shot timers
+      missed_tick_policy missed;
+      task_accounting::app_stats *app;
+      std::function<void(const bs2::connection&, uint64_t)> cb;
+      std::shared_ptr<const task_job> job;
+      bs2::connection conn;
+    };
+
+    /// Handle of a timer subscribed to the task tick, which can be
+    /// disconnected and rescheduled
+    class task_timer {
+    public:
+      task_timer() : sub_(nullptr) {}
+
+      bool connected() const { return conn_.connected(); }
+      void disconnect() const { conn_.disconnect(); }
+      const bs2::connection& connection() const { return conn_; }
+      /// changes the period (0: one-shot) and the first tick at which the
+      /// timer expires next, in O(1). Outside of the task manager thread,
+      /// the change applies before the next tick. Returns false if
+      /// disconnected
+      bool reschedule(uint64_t period, uint64_t start) const;
+
+    private:
+      friend class subscription;
+      task_timer(subscription *sub, std::shared_ptr<task_timer_entry> entry)
+        : sub_(sub), entry_(entry), conn_(entry->conn) {}
+
+      subscription *sub_;
+      std::shared_ptr<task_timer_entry> entry_;
+      bs2::connection conn_;
+    };
+
     class subscription {
     public:
       // friend classes can access private fields
       friend class flexran::rib::rib_updater;
       friend class flexran::core::task_manager;
 
-      subscription() : last_tick_(0) {}
+      subscription()
+        : num_timers_(0), ticks_per_ms_(1), last_tick_(0), num_filtered_(0),
+          num_imsi_filters_(0),
+          applier_(std::thread::id()), commands_(64) {}
+      ~subscription();
       uint64_t last_tick() const { return last_tick_; }
+      // a tick is 1 ms by default, or a slot of shorter duration (e.g., 4
+      // ticks per ms for 0.25 ms NR slots). Periods of tick subscriptions
+      // are given in ticks, so apps working in ms convert them. Set before
+      // apps subscribe
+      void set_ticks_per_ms(uint32_t n) { ticks_per_ms_ = n > 0 ? n : 1; }
+      uint32_t ticks_per_ms() const { return ticks_per_ms_; }
+      uint64_t ms_to_ticks(uint64_t ms) const { return ms * ticks_per_ms_; }
+      uint64_t ticks_to_ms(uint64_t t) const { return t / ticks_per_ms_; }
+      std::size_t num_task_timers() const;
+      task_accounting& get_accounting() { return accounting_; }
+      const task_accounting& get_accounting() const { return accounting_; }
 
       // in the following, functions without _extended subscribe to "simple"
       // callback (as in callbacks.h), while the _extended versions subscribe
@@ -68,17 +140,129 @@ namespace flexran {
       bs2::connection subscribe_ue_disconnect(const ue_cb::slot_type& cb);
       bs2::connection subscribe_ue_disconnect_extended(const ue_cb::extended_slot_type& cb);
 
+      // called after a tick with the BSs whose stats were refreshed, so that
+      // apps can react to new data instead of polling the RIB every period
+      bs2::connection subscribe_stats_update(const stats_cb::slot_type& cb);
+
+      // calls cb only for the BS/UE events matching filter, which are
+      // looked up in an index by kind and BS instead of calling every
+      // subscriber for every event. app names the subscriber when listing.
+      // Like the signals, the index is only changed in the task manager
+      // thread: other threads add to it through defer(), before the next tick
+      bs2::connection subscribe_events(const event_filter& filter,
+          const std::function<void(const bs_ue_event&)>& cb, const std::string& app = "");
+      // instead of calling back while the RIB updater handles a message,
+      // queues the events matching filter in inbox, from which the
+      // subscriber takes them later (see event_inbox.h)
+      bs2::connection subscribe_inbox(const event_filter& filter,
+          std::shared_ptr<event_inbox> inbox, const std::string& app = "");
+      // lists the number of subscribers per event, the filtered
+      // subscriptions with their filter keys, and the number of task timers.
+      // Reads the signals and the index, so other threads call it through
+      // defer()
+      std::string subscriptions_to_json_string() const;
+
+      // task tick subscriptions are kept in a timing wheel, so that only
+      // due ones are touched in a tick. They first expire at the first tick
+      // t >= start with (t - start) % period == 0. Their run time is
+      // accounted to app (see task_accounting.h). If the task manager
+      // skipped over some of their ticks, missed decides whether they run
+      // once or for every missed tick. Outside of the task manager thread,
+      // timers are added through defer(), before the next tick
       bs2::connection subscribe_task_tick(const task_cb::slot_type& cb,
-          uint64_t period, uint64_t start = 0);
+          uint64_t period, uint64_t start = 0, const std::string& app = "",
+          missed_tick_policy missed = missed_tick_policy::skip);
       bs2::connection subscribe_task_tick_extended(const task_cb::extended_slot_type& cb,
-          uint64_t period, uint64_t start = 0);
+          uint64_t period, uint64_t start = 0, const std::string& app = "",
+          missed_tick_policy missed = missed_tick_policy::skip);
+      // like subscribe_task_tick_extended(), but period 0 gives a one-shot
+      // timer expiring at tick start, and the timer can be rescheduled
+      task_timer subscribe_task_timer(const task_cb::extended_slot_type& cb,
+          uint64_t period, uint64_t start = 0, const std::string& app = "",
+          missed_tick_policy missed = missed_tick_policy::skip);
+      // jobs are run by the task manager's executor, possibly in parallel to
+      // jobs of other apps (see task_job.h)
+      bs2::connection subscribe_task_job(std::shared_ptr<const task_job> job,
+          uint64_t period, uint64_t start = 0,
+          missed_tick_policy missed = missed_tick_policy::skip);
 
       bs2::connection subscribe_control_del_req(
           const msg_cb<protocol::flex_control_delegation_request>::slot_type& cb);
       bs2::connection subscribe_control_del_req_extended(
           const msg_cb<protocol::flex_control_delegation_request>::extended_slot_type& cb);
-      
+
+      // used by the task manager: advance_task_tick() collects the jobs due
+      // in tick t, run_task_tick() calls the due callbacks. t may skip ticks
+      // the task manager missed. Offending apps are deferred to the next
+      // tick if deadline passed (see overrun_policy::defer)
+      void advance_task_tick(uint64_t t, std::vector<std::shared_ptr<const task_job>>& jobs);
+      void run_task_tick(uint64_t t, std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::time_point::max());
+
+      // used by the RIB updater: emits the signal of kind and calls the
+      // matching filtered subscribers. imsi (0: unknown) is only needed if
+      // needs_imsi()
+      void notify(event_kind kind, uint64_t bs_id, flexran::rib::rnti_t rnti = 0,
+          uint64_t imsi = 0);
+      bool needs_imsi() const { return num_imsi_filters_ > 0; }
+
+      // the signals of BS/UE events and stats and the timing wheel are not
+      // thread-safe, so other threads than the task manager (e.g., REST)
+      // must not change them directly. Instead, defer() queues fn without locking, and the
+      // task manager runs it between two ticks. The returned future gives
+      // its result, e.g., the connection. fn runs immediately if called in
+      // the task manager thread or if the task manager is not running.
+      // Waiting for the future in a job would dead-lock
+      template <typename F>
+      auto defer(F fn) -> std::future<decltype(fn())>
+      {
+        typedef decltype(fn()) R;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::move(fn));
+        std::future<R> f = task->get_future();
+        if (applier_.load() == std::thread::id()
+            || applier_.load() == std::this_thread::get_id()) {
+          (*task)();
+          return f;
+        }
+        commands_.push(new std::function<void()>([task] { (*task)(); }));
+        /* the task manager might have stopped in the meantime */
+        if (applier_.load() == std::thread::id())
+          apply_deferred();
+        return f;
+      }
+      // used by the task manager: the thread applying deferred functions
+      // (none if not running), and applies them
+      void set_applier(std::thread::id id) { applier_ = id; }
+      void apply_deferred();
+
     private:
+      friend class task_timer;
+      struct filtered_subscription {
+        event_filter filter;
+        std::function<void(const bs_ue_event&)> cb;
+        std::string app;
+        bs2::connection conn;
+      };
+      typedef std::vector<std::shared_ptr<filtered_subscription>> filtered_list;
+      struct filter_index {
+        std::unordered_map<uint64_t, filtered_list> by_bs;
+        filtered_list any_bs;
+      };
+
+      void add_filter(const std::shared_ptr<filtered_subscription>& f);
+      void prune_filters();
+
+      task_timer add_task_timer(std::shared_ptr<task_timer_entry> e,
+          uint64_t period, uint64_t start, const std::string& app,
+          missed_tick_policy missed);
+      void collect(const std::shared_ptr<task_timer_entry>& e, uint64_t tick,
+          uint64_t t, std::vector<std::shared_ptr<const task_job>>& jobs);
+      void call(task_timer_entry& e, uint64_t t);
+      bool reschedule(std::shared_ptr<task_timer_entry> e, uint64_t period, uint64_t start);
+      void schedule(const std::shared_ptr<task_timer_entry>& e, uint64_t period,
+          uint64_t start);
+      static uint64_t first_due(uint64_t now, uint64_t period, uint64_t start);
+
       bs_cb bs_add_;
       bs_cb bs_remove_;
 
@@ -86,10 +270,34 @@ namespace flexran {
       ue_cb ue_update_;
       ue_cb ue_disconnect_;
 
-      task_cb task_tick_;
+      stats_cb stats_update_;
+
+      // the wheel and the schedule of timer entries are only changed in the
+      // task manager thread; other threads go through defer()
+      timing_wheel timers_;
+      std::atomic<std::size_t> num_timers_;
+      std::vector<std::shared_ptr<wheel_timer>> expired_;
+      std::vector<std::pair<std::shared_ptr<task_timer_entry>, uint64_t>> due_;
+      std::vector<std::shared_ptr<task_timer_entry>> deferred_;
+      std::vector<std::shared_ptr<task_timer_entry>> deferring_;
+      task_accounting accounting_;
+      // only holds the connections of timers, never emitted
+      bs2::signal<void()> timer_connections_;
+      uint32_t ticks_per_ms_;
       std::atomic<uint64_t> last_tick_; // used to calculate offsets
 
       msg_cb<protocol::flex_control_delegation_request> control_del_req_;
+
+      // filtered subscriptions, indexed by kind and BS. Owned by the task
+      // manager thread like the signals, so notify() does not lock
+      std::array<filter_index, NUM_EVENT_KINDS> filters_;
+      filtered_list filtered_; // all of them, in order of subscription
+      std::size_t num_filtered_;
+      std::size_t num_imsi_filters_;
+      filtered_list matched_; // of the current notify()
+
+      std::atomic<std::thread::id> applier_;
+      boost::lockfree::queue<std::function<void()> *> commands_;
     };
   }
 }
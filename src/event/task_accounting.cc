@@ -0,0 +1,322 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    task_accounting.cc
+ *  \brief   Per-app time accounting and overrun policies for the task tick
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#include "task_accounting.h"
+#include "flexran_log.h"
+
+bool flexran::event::parse_overrun_policy(const std::string& s, overrun_policy& p)
+{
+  if (s == "none")          p = overrun_policy::none;
+  else if (s == "defer")    p = overrun_policy::defer;
+  else if (s == "decimate") p = overrun_policy::decimate;
+  else if (s == "offload")  p = overrun_policy::offload;
+  else return false;
+  return true;
+}
+
+std::string flexran::event::to_string(overrun_policy p)
+{
+  switch (p) {
+    case overrun_policy::none:     return "none";
+    case overrun_policy::defer:    return "defer";
+    case overrun_policy::decimate: return "decimate";
+    case overrun_policy::offload:  return "offload";
+  }
+  return "unknown";
+}
+
+namespace {
+  template <typename T>
+  void atomic_add(std::atomic<T>& a, T v)
+  {
+    T cur = a.load();
+    while (!a.compare_exchange_weak(cur, cur + v)) {}
+  }
+
+  template <typename T>
+  void atomic_max(std::atomic<T>& a, T v)
+  {
+    T cur = a.load();
+    while (cur < v && !a.compare_exchange_weak(cur, v)) {}
+  }
+
+  uint64_t pack_tick_us(uint32_t tick, float us)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &us, sizeof(bits));
+    return uint64_t(tick) << 32 | bits;
+  }
+
+  float unpack_us(uint64_t v)
+  {
+    const uint32_t bits = uint32_t(v);
+    float us;
+    std::memcpy(&us, &bits, sizeof(us));
+    return us;
+  }
+
+  /// the longest run of the app in tick, 0 if it did not run in it
+  float tick_us(const flexran::event::task_accounting::app_stats *app, uint32_t tick)
+  {
+    const uint64_t v = app->tick_max;
+    return uint32_t(v >> 32) == tick ? unpack_us(v) : 0;
+  }
+}
+
+flexran::event::task_accounting::app_stats::app_stats(const std::string& name,
+    std::chrono::microseconds budget)
+  : name(name), budget(budget), runs(0), overruns(0), offences(0),
+    deferred(0), missed(0), total_us(0), max_us(0), window_count(0),
+    consecutive_overruns(0), consecutive_ok(0), tick_max(0), offender(false),
+    decimation(1), offloaded(false)
+{
+  for (auto& h : histogram) h = 0;
+  for (auto& w : window) w = 0;
+}
+
+flexran::event::task_accounting::task_accounting()
+  : default_budget_(200),
+    policy_(overrun_policy::none),
+    tolerance_(3),
+    tick_(0),
+    slowest_(nullptr)
+{
+}
+
+void flexran::event::task_accounting::set_default_budget(std::chrono::microseconds budget)
+{
+  std::lock_guard<std::mutex> l(mutex_);
+  default_budget_ = budget;
+}
+
+void flexran::event::task_accounting::set_budget(const std::string& app,
+    std::chrono::microseconds budget)
+{
+  get_app(app)->budget = budget;
+}
+
+bool flexran::event::task_accounting::get_budget(const std::string& app,
+    std::chrono::microseconds& budget) const
+{
+  std::lock_guard<std::mutex> l(mutex_);
+  auto it = apps_.find(app);
+  if (it == apps_.end()) return false;
+  budget = it->second.budget.load();
+  return true;
+}
+
+flexran::event::task_accounting::app_stats *
+flexran::event::task_accounting::get_app(const std::string& app)
+{
+  std::lock_guard<std::mutex> l(mutex_);
+  auto it = apps_.find(app);
+  if (it == apps_.end())
+    it = apps_.emplace(std::piecewise_construct, std::forward_as_tuple(app),
+        std::forward_as_tuple(app, default_budget_)).first;
+  return &it->second;
+}
+
+bool flexran::event::task_accounting::record(app_stats *app,
+    std::chrono::duration<float, std::micro> dur)
+{
+  if (!update(app, dur.count()))
+    return false;
+  switch (policy_.load()) {
+    case overrun_policy::none:
+      break;
+    case overrun_policy::defer:
+      LOG4CXX_WARN(flog::app, "task_accounting: " << app->name << " exceeded its budget of "
+          << app->budget.load().count() << "us " << tolerance_ << " times in a row, "
+          << "deferring it in late ticks");
+      break;
+    case overrun_policy::decimate:
+      LOG4CXX_WARN(flog::app, "task_accounting: " << app->name << " exceeded its budget of "
+          << app->budget.load().count() << "us " << tolerance_ << " times in a row, "
+          << "decimating it by " << app->decimation);
+      break;
+    case overrun_policy::offload:
+      LOG4CXX_WARN(flog::app, "task_accounting: " << app->name << " exceeded its budget of "
+          << app->budget.load().count() << "us " << tolerance_ << " times in a row, "
+          << "moving it to the app executor");
+      break;
+  }
+  return true;
+}
+
+bool flexran::event::task_accounting::update(app_stats *app, float us)
+{
+  app->runs++;
+  atomic_add(app->total_us, double(us));
+  atomic_max(app->max_us, us);
+  std::size_t b = us < 1 ? 0 : std::size_t(std::log2(us)) + 1;
+  app->histogram[std::min(b, NUM_BUCKETS - 1)]++;
+  app->window[app->window_count++ % WINDOW] = us;
+  update_slowest(app, us);
+
+  if (us <= app->budget.load().count()) {
+    app->consecutive_overruns = 0;
+    /* deferring ends once the app behaves again */
+    if (++app->consecutive_ok >= tolerance_)
+      app->offender = false;
+    return false;
+  }
+  app->overruns++;
+  app->consecutive_ok = 0;
+  if (++app->consecutive_overruns < tolerance_)
+    return false;
+
+  app->consecutive_overruns = 0;
+  app->offences++;
+  switch (policy_.load()) {
+    case overrun_policy::none:
+      return false;
+    case overrun_policy::defer:
+      app->offender = true;
+      break;
+    case overrun_policy::decimate: {
+      uint32_t d = app->decimation;
+      do {
+        if (d >= MAX_DECIMATION)
+          return false;
+      } while (!app->decimation.compare_exchange_weak(d, d * 2));
+      break;
+    }
+    case overrun_policy::offload:
+      if (app->offloaded.exchange(true))
+        return false;
+      break;
+  }
+  return true;
+}
+
+void flexran::event::task_accounting::update_slowest(app_stats *app, float us)
+{
+  const uint32_t tick = tick_;
+  uint64_t cur = app->tick_max;
+  const uint64_t next = pack_tick_us(tick, us);
+  while ((uint32_t(cur >> 32) != tick || unpack_us(cur) < us)
+      && !app->tick_max.compare_exchange_weak(cur, next)) {}
+  const app_stats *s = slowest_;
+  while ((!s || tick_us(s, tick) < us) && !slowest_.compare_exchange_weak(s, app)) {}
+}
+
+void flexran::event::task_accounting::record_deferred(app_stats *app)
+{
+  app->deferred++;
+}
+
+void flexran::event::task_accounting::record_missed(app_stats *app, uint64_t ticks)
+{
+  app->missed += ticks;
+}
+
+void flexran::event::task_accounting::begin_tick()
+{
+  /* no app runs between ticks */
+  tick_++;
+  slowest_ = nullptr;
+}
+
+bool flexran::event::task_accounting::get_slowest(std::string& app, float& us) const
+{
+  const app_stats *s = slowest_;
+  if (!s) return false;
+  app = s->name;
+  us = tick_us(s, tick_);
+  return true;
+}
+
+std::string flexran::event::task_accounting::to_json_string() const
+{
+  struct copy {
+    std::string name;
+    uint64_t budget, runs, overruns, offences, deferred, missed;
+    double total_us;
+    float max_us;
+    std::array<uint64_t, NUM_BUCKETS> histogram;
+    std::vector<float> window;
+    bool offender, offloaded;
+    uint32_t decimation;
+  };
+  std::vector<const app_stats *> stats;
+  uint64_t default_budget;
+  {
+    /* apps are never removed, so only the list needs the lock */
+    std::lock_guard<std::mutex> l(mutex_);
+    default_budget = default_budget_.count();
+    for (const auto& a : apps_)
+      stats.push_back(&a.second);
+  }
+  /* the statistics are read while they are updated */
+  std::vector<copy> apps;
+  for (const app_stats *s : stats) {
+    copy c{s->name, uint64_t(s->budget.load().count()), s->runs, s->overruns,
+        s->offences, s->deferred, s->missed, s->total_us, s->max_us, {}, {},
+        s->offender, s->offloaded, s->decimation};
+    for (std::size_t i = 0; i < NUM_BUCKETS; ++i)
+      c.histogram[i] = s->histogram[i];
+    const std::size_t n = std::min<uint64_t>(s->window_count, WINDOW);
+    c.window.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+      c.window.push_back(s->window[i]);
+    apps.push_back(std::move(c));
+  }
+
+  std::ostringstream o;
+  o << "{\"policy\":\"" << to_string(policy_) << "\",\"tolerance\":" << tolerance_
+    << ",\"default_budget_us\":" << default_budget
+    << ",\"histogram_bounds_us\":[";
+  for (std::size_t i = 0; i < NUM_BUCKETS - 1; ++i)
+    o << (i > 0 ? "," : "") << (uint64_t(1) << i);
+  o << "],\"apps\":[";
+  bool first = true;
+  for (copy& a : apps) {
+    std::sort(a.window.begin(), a.window.end());
+    const std::size_t n = a.window.size();
+    auto pct = [&a, n] (float p) { return n == 0 ? 0 : a.window[std::size_t(p * (n - 1))]; };
+    o << (first ? "" : ",") << "{\"name\":\"" << a.name << "\",\"budget_us\":" << a.budget
+      << ",\"runs\":" << a.runs << ",\"overruns\":" << a.overruns
+      << ",\"offences\":" << a.offences << ",\"deferred\":" << a.deferred
+      << ",\"missed\":" << a.missed
+      << ",\"offender\":" << (a.offender ? "true" : "false")
+      << ",\"decimation\":" << a.decimation
+      << ",\"offloaded\":" << (a.offloaded ? "true" : "false")
+      << ",\"mean_us\":" << (a.runs > 0 ? a.total_us / a.runs : 0)
+      << ",\"max_us\":" << a.max_us
+      << ",\"window\":{\"samples\":" << n << ",\"p50_us\":" << pct(0.5)
+      << ",\"p99_us\":" << pct(0.99) << ",\"max_us\":" << (n > 0 ? a.window[n - 1] : 0)
+      << "},\"histogram\":[";
+    for (std::size_t i = 0; i < NUM_BUCKETS; ++i)
+      o << (i > 0 ? "," : "") << a.histogram[i];
+    o << "]}";
+    first = false;
+  }
+  o << "]}";
+  return o.str();
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    task_accounting.h
+ *  \brief   Per-app time accounting and overrun policies for the task tick
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef TASK_ACCOUNTING_H_
+#define TASK_ACCOUNTING_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace flexran {
+  namespace event {
+
+    /// What to do with apps whose tick callbacks repeatedly exceed their
+    /// budget
+    enum class overrun_policy {
+      none,     // only account
+      defer,    // run them in the next tick if the current one is late
+      decimate, // double their periods (up to 64 times)
+      offload   // run their callbacks as jobs on the app executor
+    };
+    bool parse_overrun_policy(const std::string& s, overrun_policy& p);
+    std::string to_string(overrun_policy p);
+
+    /// Measures how long every app runs per tick, against a budget per app.
+    /// An app that exceeds its budget tolerance times in a row becomes an
+    /// offender, and the policy is applied by the subscription. Apps are
+    /// identified by the names given when subscribing. The statistics of an
+    /// app are only updated atomically, as its tick callbacks (task manager
+    /// thread) and jobs (app executor) may run in parallel; the lock is only
+    /// taken to create apps and to list them.
+    class task_accounting {
+    public:
+      /// bucket i counts durations < 2^i us, the last one all others
+      static const std::size_t NUM_BUCKETS = 16;
+      /// number of the most recent durations kept per app
+      static const std::size_t WINDOW = 1000;
+      static const uint32_t MAX_DECIMATION = 64;
+
+      struct app_stats {
+        app_stats(const std::string& name, std::chrono::microseconds budget);
+        const std::string name;
+        std::atomic<std::chrono::microseconds> budget;
+        std::atomic<uint64_t> runs;
+        std::atomic<uint64_t> overruns;
+        std::atomic<uint64_t> offences;
+        std::atomic<uint64_t> deferred;
+        std::atomic<uint64_t> missed; // due ticks the task manager skipped over
+        std::atomic<double> total_us;
+        std::atomic<float> max_us;
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> histogram;
+        /// ring of the last WINDOW durations, window_count counts all of them
+        std::array<std::atomic<float>, WINDOW> window;
+        std::atomic<uint64_t> window_count;
+        std::atomic<uint32_t> consecutive_overruns;
+        std::atomic<uint32_t> consecutive_ok;
+        /// the tick (upper 32 bits) and the bits of the longest run in it
+        std::atomic<uint64_t> tick_max;
+        /* read by the subscription without lock */
+        std::atomic<bool> offender;
+        std::atomic<uint32_t> decimation;
+        std::atomic<bool> offloaded;
+      };
+
+      task_accounting();
+
+      void set_default_budget(std::chrono::microseconds budget);
+      void set_budget(const std::string& app, std::chrono::microseconds budget);
+      bool get_budget(const std::string& app, std::chrono::microseconds& budget) const;
+      void set_policy(overrun_policy p) { policy_ = p; }
+      overrun_policy get_policy() const { return policy_; }
+      void set_tolerance(uint32_t tolerance) { tolerance_ = tolerance; }
+
+      /// returns the (stable) statistics of app, creating them if necessary.
+      /// Callers should keep the result instead of looking it up in every run
+      app_stats *get_app(const std::string& app);
+      /// records that app ran for dur. Returns true if the app just became an
+      /// offender and the policy has been applied to its statistics
+      bool record(app_stats *app, std::chrono::duration<float, std::micro> dur);
+      void record_deferred(app_stats *app);
+      void record_missed(app_stats *app, uint64_t ticks);
+
+      /// resets the slowest app of the tick
+      void begin_tick();
+      /// the app that took longest in the current tick, if any
+      bool get_slowest(std::string& app, float& us) const;
+
+      std::string to_json_string() const;
+
+    private:
+      /// updates the statistics, returns true if a policy has been applied
+      bool update(app_stats *app, float us);
+      void update_slowest(app_stats *app, float us);
+
+      /// protects apps_ (not the statistics in it)
+      mutable std::mutex mutex_;
+      std::map<std::string, app_stats> apps_;
+      std::chrono::microseconds default_budget_;
+      std::atomic<overrun_policy> policy_;
+      std::atomic<uint32_t> tolerance_;
+      std::atomic<uint32_t> tick_;
+      std::atomic<const app_stats *> slowest_;
+    };
+
+  }
+}
+
+#endif /* TASK_ACCOUNTING_H_ */
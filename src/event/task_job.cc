@@ -0,0 +1,52 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    task_job.cc
+ *  \brief   Jobs that apps run per tick, with the resources they access
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <map>
+#include <mutex>
+
+#include "task_job.h"
+
+flexran::event::footprint& flexran::event::footprint::reads(const std::string& resource)
+{
+  reads_ |= resource_bit(resource);
+  return *this;
+}
+
+flexran::event::footprint& flexran::event::footprint::writes(const std::string& resource)
+{
+  writes_ |= resource_bit(resource);
+  return *this;
+}
+
+uint64_t flexran::event::footprint::resource_bit(const std::string& resource)
+{
+  /* footprints are created when subscribing, not per tick, so a lock is ok */
+  static std::mutex m;
+  static std::map<std::string, uint64_t> bits;
+  std::lock_guard<std::mutex> l(m);
+  auto it = bits.find(resource);
+  if (it == bits.end())
+    it = bits.emplace(resource, uint64_t(1) << (bits.size() % 64)).first;
+  return it->second;
+}
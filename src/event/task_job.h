@@ -0,0 +1,83 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    task_job.h
+ *  \brief   Jobs that apps run per tick, with the resources they access
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef TASK_JOB_H_
+#define TASK_JOB_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "task_accounting.h"
+
+namespace flexran {
+  namespace event {
+
+    /// The (named) resources a job reads and writes. Two jobs of the same
+    /// tick can run in parallel unless their footprints conflict, i.e., one
+    /// writes what the other reads or writes. Resource names are mapped to
+    /// one of 64 bits, so in the (unlikely) case of more resources, some
+    /// share a bit and are serialized unnecessarily, but never wrongly.
+    class footprint {
+    public:
+      footprint() : reads_(0), writes_(0) {}
+
+      footprint& reads(const std::string& resource);
+      footprint& writes(const std::string& resource);
+
+      bool conflicts(const footprint& o) const
+      {
+        return (writes_ & (o.reads_ | o.writes_)) != 0
+            || (o.writes_ & reads_) != 0;
+      }
+
+    private:
+      static uint64_t resource_bit(const std::string& resource);
+
+      uint64_t reads_;
+      uint64_t writes_;
+    };
+
+    /// A job that an app wants to run in a tick. Jobs of the same owner are
+    /// never run in parallel and keep their order of subscription, so that
+    /// apps don't need to protect their own state.
+    struct task_job {
+      std::string name;
+      /// Called with the current tick, or the missed one when catching up
+      std::function<void(uint64_t)> fn;
+      /// Usually the app, any pointer identifying the state the job modifies
+      const void *owner;
+      footprint fp;
+      /// Time in us after the tick start at which the job is not started
+      /// anymore; 0 means the task manager's tick budget
+      uint64_t deadline_us;
+      /// The statistics its runs are accounted to; if nullptr, they are
+      /// looked up by name in every run
+      task_accounting::app_stats *app;
+    };
+
+  }
+}
+
+#endif /* TASK_JOB_H_ */
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    timing_wheel.cc
+ *  \brief   Hierarchical timing wheel for timers on a tick basis
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include "timing_wheel.h"
+
+flexran::event::timing_wheel::timing_wheel(uint64_t now)
+  : now_(now),
+    size_(0)
+{
+}
+
+void flexran::event::timing_wheel::insert(std::shared_ptr<wheel_timer> t)
+{
+  if (t->due < now_)
+    t->due = now_;
+  const uint64_t generation = t->generation;
+  place(ref{std::move(t), generation});
+  size_++;
+}
+
+void flexran::event::timing_wheel::place(ref r)
+{
+  /* a timer goes to the lowest level whose range covers its distance. As
+   * slots of upper levels are cascaded when their range starts, a slot
+   * index equal to the current one is only reached after a full turn of
+   * that level, i.e., exactly when it is due */
+  const uint64_t delta = r.timer->due - now_;
+  for (int level = 0; level < LEVELS; ++level) {
+    if (delta < (uint64_t(1) << (BITS * (level + 1)))) {
+      const uint64_t idx = (r.timer->due >> (BITS * level)) & MASK;
+      wheel_[level][idx].push_back(std::move(r));
+      return;
+    }
+  }
+  overflow_.push_back(std::move(r));
+}
+
+void flexran::event::timing_wheel::cascade(int level)
+{
+  /* move all timers of the current slot of level to lower levels */
+  const uint64_t idx = (now_ >> (BITS * level)) & MASK;
+  cascading_.clear();
+  cascading_.swap(wheel_[level][idx]);
+  for (ref& r : cascading_) {
+    if (r.generation != r.timer->generation) {
+      size_--;
+      continue;
+    }
+    place(std::move(r));
+  }
+  cascading_.clear();
+}
+
+void flexran::event::timing_wheel::advance(uint64_t tick,
+    std::vector<std::shared_ptr<wheel_timer>>& expired)
+{
+  for (; now_ <= tick; ++now_) {
+    if (size_ == 0) {
+      /* nothing to cascade or expire, skip the remaining ticks */
+      now_ = tick + 1;
+      return;
+    }
+    if ((now_ & MASK) == 0) {
+      /* start of a new range of level 1, and maybe of the levels above:
+       * cascade the highest level first, as its timers might end up in a
+       * slot of a lower level that is cascaded next */
+      if ((now_ & ((uint64_t(1) << (BITS * LEVELS)) - 1)) == 0 && !overflow_.empty()) {
+        slot o;
+        o.swap(overflow_);
+        for (ref& r : o)
+          place(std::move(r));
+      }
+      for (int level = LEVELS - 1; level >= 1; --level)
+        if ((now_ & ((uint64_t(1) << (BITS * level)) - 1)) == 0)
+          cascade(level);
+    }
+
+    slot& s = wheel_[0][now_ & MASK];
+    for (ref& r : s) {
+      size_--;
+      if (r.generation != r.timer->generation)
+        continue;
+      expired.push_back(std::move(r.timer));
+    }
+    s.clear();
+  }
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    timing_wheel.h
+ *  \brief   Hierarchical timing wheel for timers on a tick basis
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef TIMING_WHEEL_H_
+#define TIMING_WHEEL_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace flexran {
+  namespace event {
+
+    /// A timer that can be inserted into a timing_wheel. To cancel or move a
+    /// timer, increment its generation (and insert it again): references to
+    /// an older generation are dropped once their slot is reached.
+    struct wheel_timer {
+      wheel_timer() : due(0), generation(0) {}
+      virtual ~wheel_timer() {}
+      /// tick at which the timer expires
+      uint64_t due;
+      uint64_t generation;
+    };
+
+    /// Hierarchical timing wheel (four levels of 256 slots): inserting is
+    /// O(1), and advancing by a tick only touches the timers of one slot,
+    /// plus those of an upper level slot every 256^n ticks, independent of
+    /// the total number of timers. Timers more than 2^32 ticks ahead wait in
+    /// an overflow list. Not thread-safe.
+    class timing_wheel {
+    public:
+      /// now: the next tick to be processed
+      explicit timing_wheel(uint64_t now = 0);
+
+      /// inserts t at t->due, or the next tick if t->due is in the past
+      void insert(std::shared_ptr<wheel_timer> t);
+      /// processes all ticks up to and including tick, appending the
+      /// expired timers in order of expiry
+      void advance(uint64_t tick, std::vector<std::shared_ptr<wheel_timer>>& expired);
+
+      /// the next tick to be processed
+      uint64_t now() const { return now_; }
+      /// number of timer references in the wheel, including stale ones
+      std::size_t size() const { return size_; }
+
+    private:
+      static const int LEVELS = 4;
+      static const int BITS = 8;
+      static const uint64_t SLOTS = 1 << BITS;
+      static const uint64_t MASK = SLOTS - 1;
+
+      struct ref {
+        std::shared_ptr<wheel_timer> timer;
+        uint64_t generation;
+      };
+      typedef std::vector<ref> slot;
+
+      void place(ref r);
+      void cascade(int level);
+
+      std::array<std::array<slot, SLOTS>, LEVELS> wheel_;
+      slot overflow_;
+      slot cascading_;
+      uint64_t now_;
+      std::size_t size_;
+    };
+
+  }
+}
+
+#endif /* TIMING_WHEEL_H_ */
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    shard_proxy.cc
+ *  \brief   front-end forwarding agent connections to the shard owning the BS
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include "shard_proxy.h"
+#include "flexran.pb.h"
+#include "flexran_log.h"
+
+flexran::network::shard_proxy_session::shard_proxy_session(
+    boost::asio::io_service& io_service, boost::asio::ip::tcp::socket agent,
+    const shard_ring& ring,
+    const std::vector<boost::asio::ip::tcp::endpoint>& shards, int session_id)
+  : agent_(std::move(agent)),
+    shard_(io_service),
+    ring_(ring),
+    shards_(shards),
+    session_id_(session_id)
+{
+  agent_.set_option(boost::asio::ip::tcp::no_delay(true));
+}
+
+void flexran::network::shard_proxy_session::start()
+{
+  /* the same hello a controller sends, see rib_updater */
+  protocol::flex_header *header(new protocol::flex_header);
+  header->set_type(protocol::FLPT_HELLO);
+  header->set_version(0);
+  header->set_xid(0);
+  protocol::flex_hello *hello_msg(new protocol::flex_hello);
+  hello_msg->set_allocated_header(header);
+  protocol::flexran_message msg;
+  msg.set_msg_dir(protocol::INITIATING_MESSAGE);
+  msg.set_allocated_hello_msg(hello_msg);
+  const std::string s = msg.SerializeAsString();
+  hello_request_.set_message(s.data(), s.size());
+
+  auto self(shared_from_this());
+  boost::asio::async_write(agent_,
+      boost::asio::buffer(hello_request_.data(), hello_request_.length()),
+      [this, self](boost::system::error_code ec, std::size_t) {
+        if (ec) {
+          close();
+          return;
+        }
+        read_agent_hello();
+      });
+}
+
+void flexran::network::shard_proxy_session::read_agent_hello()
+{
+  auto self(shared_from_this());
+  boost::asio::async_read(agent_,
+      boost::asio::buffer(agent_msg_.data(), protocol_message::header_length),
+      [this, self](boost::system::error_code ec, std::size_t) {
+        if (ec || !agent_msg_.decode_header()) {
+          close();
+          return;
+        }
+        boost::asio::async_read(agent_,
+            boost::asio::buffer(agent_msg_.body(), agent_msg_.body_length()),
+            [this, self](boost::system::error_code ec, std::size_t) {
+              if (ec) {
+                close();
+                return;
+              }
+              protocol::flexran_message msg;
+              if (!msg.ParseFromArray(agent_msg_.body(), agent_msg_.body_length())
+                  || !msg.has_hello_msg()) {
+                LOG4CXX_WARN(flog::net, "Proxy session " << session_id_
+                    << ": ignoring message before hello");
+                read_agent_hello();
+                return;
+              }
+              connect_shard(msg.hello_msg().bs_id());
+            });
+      });
+}
+
+void flexran::network::shard_proxy_session::connect_shard(uint64_t bs_id)
+{
+  const std::size_t i = ring_.owner(bs_id);
+  LOG4CXX_INFO(flog::net, "Proxy session " << session_id_ << ": BS " << bs_id
+      << " belongs to shard " << ring_.get_shards()[i]);
+  auto self(shared_from_this());
+  shard_.async_connect(shards_[i],
+      [this, self, i](boost::system::error_code ec) {
+        if (ec) {
+          LOG4CXX_ERROR(flog::net, "Proxy session " << session_id_
+              << ": cannot connect to shard " << ring_.get_shards()[i]
+              << ": " << ec.message());
+          close();
+          return;
+        }
+        shard_.set_option(boost::asio::ip::tcp::no_delay(true));
+        read_shard_hello();
+      });
+}
+
+void flexran::network::shard_proxy_session::read_shard_hello()
+{
+  auto self(shared_from_this());
+  boost::asio::async_read(shard_,
+      boost::asio::buffer(shard_msg_.data(), protocol_message::header_length),
+      [this, self](boost::system::error_code ec, std::size_t) {
+        if (ec || !shard_msg_.decode_header()) {
+          close();
+          return;
+        }
+        boost::asio::async_read(shard_,
+            boost::asio::buffer(shard_msg_.body(), shard_msg_.body_length()),
+            [this, self](boost::system::error_code ec, std::size_t) {
+              if (ec) {
+                close();
+                return;
+              }
+              protocol::flexran_message msg;
+              if (msg.ParseFromArray(shard_msg_.body(), shard_msg_.body_length())
+                  && msg.has_hello_msg()) {
+                answer_shard_hello();
+                return;
+              }
+              /* not the hello: the agent handles it */
+              boost::asio::async_write(agent_,
+                  boost::asio::buffer(shard_msg_.data(), shard_msg_.length()),
+                  [this, self](boost::system::error_code ec, std::size_t) {
+                    if (ec) close();
+                    else read_shard_hello();
+                  });
+            });
+      });
+}
+
+void flexran::network::shard_proxy_session::answer_shard_hello()
+{
+  auto self(shared_from_this());
+  boost::asio::async_write(shard_,
+      boost::asio::buffer(agent_msg_.data(), agent_msg_.length()),
+      [this, self](boost::system::error_code ec, std::size_t) {
+        if (ec) {
+          close();
+          return;
+        }
+        forward(agent_, shard_, agent_to_shard_);
+        forward(shard_, agent_, shard_to_agent_);
+      });
+}
+
+void flexran::network::shard_proxy_session::forward(boost::asio::ip::tcp::socket& from,
+    boost::asio::ip::tcp::socket& to, std::array<char, 16384>& buf)
+{
+  auto self(shared_from_this());
+  from.async_read_some(boost::asio::buffer(buf),
+      [this, self, &from, &to, &buf](boost::system::error_code ec, std::size_t n) {
+        if (ec) {
+          close();
+          return;
+        }
+        boost::asio::async_write(to, boost::asio::buffer(buf.data(), n),
+            [this, self, &from, &to, &buf](boost::system::error_code ec, std::size_t) {
+              if (ec) close();
+              else forward(from, to, buf);
+            });
+      });
+}
+
+void flexran::network::shard_proxy_session::close()
+{
+  /* closing both sockets cancels the pending operations of the other
+   * direction, which then release the session */
+  if (agent_.is_open()) {
+    LOG4CXX_INFO(flog::net, "Proxy session " << session_id_ << " closed");
+    boost::system::error_code ec;
+    agent_.close(ec);
+  }
+  if (shard_.is_open()) {
+    boost::system::error_code ec;
+    shard_.close(ec);
+  }
+}
+
+flexran::network::shard_proxy::shard_proxy(boost::asio::io_service& io_service,
+    const boost::asio::ip::tcp::endpoint& endpoint,
+    const std::vector<boost::asio::ip::tcp::endpoint>& shards, unsigned vnodes)
+  : io_service_(io_service),
+    acceptor_(io_service, endpoint),
+    socket_(io_service),
+    shards_(shards),
+    ring_(vnodes),
+    next_id_(0)
+{
+  for (const auto& s : shards_)
+    ring_.add_shard(shard_name(s));
+  do_accept();
+}
+
+std::string flexran::network::shard_proxy::shard_name(const boost::asio::ip::tcp::endpoint& ep)
+{
+  return ep.address().to_string() + ":" + std::to_string(ep.port());
+}
+
+void flexran::network::shard_proxy::do_accept()
+{
+  acceptor_.async_accept(socket_,
+      [this](boost::system::error_code ec) {
+        if (!ec)
+          std::make_shared<shard_proxy_session>(io_service_, std::move(socket_),
+                                                ring_, shards_, next_id_++)->start();
+        do_accept();
+      });
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    shard_proxy.h
+ *  \brief   front-end forwarding agent connections to the shard owning the BS
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef SHARD_PROXY_H_
+#define SHARD_PROXY_H_
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "protocol_message.h"
+#include "shard_ring.h"
+
+namespace flexran {
+
+  namespace network {
+
+    /// Proxy for one agent connection. It sends the hello to the agent like
+    /// a controller, picks the shard owning the BS ID of the reply, and
+    /// answers the hello of that shard with the reply of the agent. From then
+    /// on, all bytes are forwarded unchanged in both directions.
+    class shard_proxy_session :
+      public std::enable_shared_from_this<shard_proxy_session> {
+
+    public:
+      shard_proxy_session(boost::asio::io_service& io_service,
+                          boost::asio::ip::tcp::socket agent,
+                          const shard_ring& ring,
+                          const std::vector<boost::asio::ip::tcp::endpoint>& shards,
+                          int session_id);
+
+      void start();
+
+    private:
+      void read_agent_hello();
+      void connect_shard(uint64_t bs_id);
+      void read_shard_hello();
+      void answer_shard_hello();
+      void forward(boost::asio::ip::tcp::socket& from, boost::asio::ip::tcp::socket& to,
+                   std::array<char, 16384>& buf);
+      void close();
+
+      boost::asio::ip::tcp::socket agent_;
+      boost::asio::ip::tcp::socket shard_;
+      const shard_ring& ring_;
+      const std::vector<boost::asio::ip::tcp::endpoint>& shards_;
+      const int session_id_;
+
+      protocol_message hello_request_;
+      protocol_message agent_msg_;
+      protocol_message shard_msg_;
+      std::array<char, 16384> agent_to_shard_;
+      std::array<char, 16384> shard_to_agent_;
+    };
+
+    /// Front-end accepting agent connections and handing each to the shard
+    /// owning its BS, see shard_ring.
+    class shard_proxy {
+
+    public:
+      shard_proxy(boost::asio::io_service& io_service,
+                  const boost::asio::ip::tcp::endpoint& endpoint,
+                  const std::vector<boost::asio::ip::tcp::endpoint>& shards,
+                  unsigned vnodes = 64);
+
+      const shard_ring& get_ring() const { return ring_; }
+      unsigned short get_port() const { return acceptor_.local_endpoint().port(); }
+      /// name of a shard on the ring
+      static std::string shard_name(const boost::asio::ip::tcp::endpoint& ep);
+
+    private:
+      void do_accept();
+
+      boost::asio::io_service& io_service_;
+      boost::asio::ip::tcp::acceptor acceptor_;
+      boost::asio::ip::tcp::socket socket_;
+      const std::vector<boost::asio::ip::tcp::endpoint> shards_;
+      shard_ring ring_;
+      int next_id_;
+    };
+
+  }
+
+}
+
+#endif /* SHARD_PROXY_H_ */
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    shard_ring.cc
+ *  \brief   consistent hashing of BS IDs onto controller shards
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+
+#include "shard_ring.h"
+
+bool flexran::network::shard_ring::add_shard(const std::string& name)
+{
+  if (std::find(shards_.begin(), shards_.end(), name) != shards_.end())
+    return false;
+  shards_.push_back(name);
+  rebuild();
+  return true;
+}
+
+bool flexran::network::shard_ring::remove_shard(const std::string& name)
+{
+  auto it = std::find(shards_.begin(), shards_.end(), name);
+  if (it == shards_.end())
+    return false;
+  shards_.erase(it);
+  rebuild();
+  return true;
+}
+
+std::size_t flexran::network::shard_ring::owner(uint64_t bs_id) const
+{
+  auto it = ring_.lower_bound(mix(bs_id));
+  if (it == ring_.end())
+    it = ring_.begin();
+  return it->second;
+}
+
+void flexran::network::shard_ring::rebuild()
+{
+  ring_.clear();
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    const uint64_t h = hash(shards_[i]);
+    for (unsigned v = 0; v < vnodes_; ++v) {
+      /* on the unlikely collision, the smaller name wins to stay independent
+       * of the order in which shards have been added */
+      auto r = ring_.emplace(mix(h + v), i);
+      if (!r.second && shards_[i] < shards_[r.first->second])
+        r.first->second = i;
+    }
+  }
+}
+
+uint64_t flexran::network::shard_ring::hash(const std::string& s)
+{
+  /* FNV-1a */
+  uint64_t h = 14695981039346656037ULL;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+uint64_t flexran::network::shard_ring::mix(uint64_t x)
+{
+  /* splitmix64 finalizer: BS IDs are often consecutive */
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
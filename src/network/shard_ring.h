@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    shard_ring.h
+ *  \brief   consistent hashing of BS IDs onto controller shards
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef SHARD_RING_H_
+#define SHARD_RING_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace flexran {
+
+  namespace network {
+
+    /// Consistent hash ring assigning BS IDs to shards (controller instances).
+    /// Every shard is placed vnodes times on the ring, and a BS belongs to the
+    /// first shard found clockwise from the hash of its ID. Adding or removing
+    /// a shard therefore only moves the BSs of the neighbouring ring segments.
+    /// The assignment only depends on the shard names, so every process
+    /// configured with the same names agrees on it.
+    class shard_ring {
+    public:
+      explicit shard_ring(unsigned vnodes = 64) : vnodes_(vnodes) {}
+
+      /// adds a shard, false if the name is already present
+      bool add_shard(const std::string& name);
+      bool remove_shard(const std::string& name);
+      const std::vector<std::string>& get_shards() const { return shards_; }
+      std::size_t size() const { return shards_.size(); }
+
+      /// index (in get_shards()) of the shard owning bs_id. The ring must not
+      /// be empty.
+      std::size_t owner(uint64_t bs_id) const;
+      const std::string& owner_name(uint64_t bs_id) const { return shards_[owner(bs_id)]; }
+
+    private:
+      static uint64_t hash(const std::string& s);
+      static uint64_t mix(uint64_t x);
+      void rebuild();
+
+      unsigned vnodes_;
+      std::vector<std::string> shards_;
+      /// ring position -> shard index
+      std::map<uint64_t, std::size_t> ring_;
+    };
+
+  }
+
+}
+
+#endif /* SHARD_RING_H_ */
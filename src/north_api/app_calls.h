@@ -25,8 +25,11 @@
 #ifndef APP_CALLS_H_
 #define APP_CALLS_H_
 
+#include <future>
 #include <pistache/router.h>
 
+#include "command_bus.h"
+
 namespace REQ_TYPE {
   constexpr const char *ALL_STATS  = "all";
   constexpr const char *ENB_CONFIG = "enb_config";
@@ -45,6 +48,26 @@ namespace flexran {
       static constexpr const size_t AGENT_ID_LENGTH_LIMIT = 3;
       static constexpr const size_t RNTI_ID_LENGTH_LIMIT  = 6;
 
+    protected:
+
+      /// runs fn in the task manager, where it can safely use the RIB and
+      /// apps, and waits for it; exceptions of fn are rethrown. If too many
+      /// commands are pending, answers with 503 and returns false
+      template <typename F>
+      static bool run_command(flexran::core::command_bus& bus,
+          Pistache::Http::ResponseWriter& response, F fn)
+      {
+        std::future<void> f;
+        if (!bus.submit(std::move(fn), f)) {
+          response.send(Pistache::Http::Code::Service_Unavailable,
+              "{ \"error\": \"too many pending commands\" }\n",
+              MIME(Application, Json));
+          return false;
+        }
+        f.get();
+        return true;
+      }
+
     };
   }
 }
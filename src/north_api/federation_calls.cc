@@ -0,0 +1,120 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    federation_calls.cc
+ *  \brief   calls for the federated northbound view of a sharded deployment
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <pistache/http_header.h>
+
+#include "rt_controller_common.h"
+#include "federation_calls.h"
+
+void flexran::north_api::federation_calls::register_calls(Pistache::Rest::Description& desc)
+{
+  auto federation = desc.path("/federation");
+
+  /**
+   * @api {get} /federation/stats/:type? Get RAN statistics of all shards
+   * @apiName GetFederatedStats
+   * @apiGroup Federation
+   * @apiParam {string=enb_config,mac_stats,all} [type=all] The type of
+   * statistics to be returned, see <a href="#api-Stats-GetStats">Stats:GetStats</a>.
+   *
+   * @apiDescription This API is offered by the shard proxy of a sharded
+   * deployment. It queries `/stats/:type` of all shards in parallel and
+   * merges the `eNB_config` and `mac_stats` arrays, i.e., the output has the
+   * same format as <a href="#api-Stats-GetStats">Stats:GetStats</a> of a
+   * single controller. Shards that do not answer within the timeout are
+   * listed in `failed_shards` together with the reason.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9990/federation/stats/
+   * @apiSuccessExample One shard unreachable
+   *     HTTP/1.1 200 OK
+   *     {
+   *       "date_time": "2020-07-01T13:00:22.218",
+   *       "eNB_config": [ ... ],
+   *       "mac_stats": [ ... ],
+   *       "failed_shards": [
+   *         { "shard": "127.0.0.1:9992", "error": "Connection refused" }
+   *       ]
+   *     }
+   *
+   * @apiError BadRequest The given stats type is invalid.
+   *
+   * @apiErrorExample Error-Response:
+   *    HTTP/1.1 400 BadRequest
+   *    { "error": "invalid statistics type" }
+   */
+  federation.route(desc.get("/stats/:type?"), "Get RAN statistics of all shards")
+      .bind(&flexran::north_api::federation_calls::obtain_json_stats, this);
+
+  /**
+   * @api {get} /federation/shards List the shards
+   * @apiName GetShards
+   * @apiGroup Federation
+   *
+   * @apiDescription This API lists the northbound endpoints of the shards
+   * queried by <a href="#api-Federation-GetFederatedStats">Federation:GetFederatedStats</a>.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9990/federation/shards
+   * @apiSuccessExample Two shards
+   *     HTTP/1.1 200 OK
+   *     ["127.0.0.1:9991","127.0.0.1:9992"]
+   */
+  federation.route(desc.get("/shards"), "List the shards")
+      .bind(&flexran::north_api::federation_calls::obtain_shards, this);
+}
+
+void flexran::north_api::federation_calls::obtain_json_stats(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  const std::string type = request.hasParam(":type") ?
+      request.param(":type").as<std::string>() : REQ_TYPE::ALL_STATS;
+  if (type != REQ_TYPE::ALL_STATS && type != REQ_TYPE::ENB_CONFIG
+      && type != REQ_TYPE::MAC_STATS) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"invalid statistics type\"}", MIME(Application, Json));
+    return;
+  }
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, federation_->stats_to_json_string(type),
+      MIME(Application, Json));
+}
+
+void flexran::north_api::federation_calls::obtain_shards(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  std::string resp = "[";
+  for (const auto& s : federation_->get_shards()) {
+    if (resp.size() > 1) resp += ",";
+    resp += "\"" + s.host + ":" + std::to_string(s.port) + "\"";
+  }
+  resp += "]";
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, resp, MIME(Application, Json));
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    federation_calls.h
+ *  \brief   calls for the federated northbound view of a sharded deployment
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef FEDERATION_CALLS_H_
+#define FEDERATION_CALLS_H_
+
+#include <memory>
+#include <pistache/http.h>
+#include <pistache/description.h>
+
+#include "app_calls.h"
+#include "shard_federation.h"
+
+namespace flexran {
+
+  namespace north_api {
+
+    class federation_calls : public app_calls {
+
+    public:
+
+      federation_calls(std::shared_ptr<const flexran::app::stats::shard_federation> federation)
+        : federation_(federation)
+      {}
+
+      void register_calls(Pistache::Rest::Description& desc);
+
+      void obtain_json_stats(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void obtain_shards(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+    private:
+
+      std::shared_ptr<const flexran::app::stats::shard_federation> federation_;
+
+    };
+
+  }
+
+}
+
+#endif /* FEDERATION_CALLS_H_ */
@@ -204,7 +204,8 @@ void flexran::north_api::plmn_calls::add_mme(
   }
 
   try {
-    plmn_app->add_mme(bs, policy);
+    if (!run_command(commands, response, [&] { plmn_app->add_mme(bs, policy); }))
+      return;
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -230,7 +231,8 @@ void flexran::north_api::plmn_calls::remove_mme(
   }
 
   try {
-    plmn_app->remove_mme(bs, policy);
+    if (!run_command(commands, response, [&] { plmn_app->remove_mme(bs, policy); }))
+      return;
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -256,7 +258,10 @@ void flexran::north_api::plmn_calls::change_plmn(
   }
 
   try {
-    plmn_app->change_plmn(bs, policy);
+    if (!run_command(commands, response, [&] {
+          plmn_app->change_plmn(bs, policy);
+        }))
+      return;
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -39,8 +39,9 @@ namespace flexran {
 
     public:
 
-      plmn_calls(std::shared_ptr<flexran::app::management::plmn_management> plmn)
-        : plmn_app(plmn)
+      plmn_calls(std::shared_ptr<flexran::app::management::plmn_management> plmn,
+          flexran::core::command_bus& bus)
+        : plmn_app(plmn), commands(bus)
       { }
 
       void register_calls(Pistache::Rest::Description& desc);
@@ -57,6 +58,7 @@ namespace flexran {
     private:
 
       std::shared_ptr<flexran::app::management::plmn_management> plmn_app;
+      flexran::core::command_bus& commands;
 
     };
   }
@@ -27,7 +27,6 @@
 #include <string>
 #include <regex>
 #include <fstream>
-#include <sstream>
 
 #include "recorder_calls.h"
 
@@ -390,26 +389,16 @@ void flexran::north_api::recorder_calls::obtain_json_stats(const Pistache::Rest:
     return;
   }
 
-  std::ifstream file;
-
-  if (info.type == flexran::app::log::job_type::bin)
-    file.open(info.filename, std::ios::binary);
-  else
-    file.open(info.filename);
-
+  std::ifstream file(info.filename, std::ios::binary);
   if (!file.is_open()) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{\"error\":\"Corresponding file " + info.filename + " could not be opened\"}");
     return;
   }
-
-  std::stringstream ss;
-  ss << file.rdbuf();
   file.close();
 
+  /* serveFile() sends the file from disk and sets the content length,
+   * recordings are not read into memory */
   auto mime = Pistache::Http::Mime::MediaType::fromString("application/octet-string");
-  response.setMime(mime);
-  response.headers().add<Pistache::Http::Header::ContentLength>(ss.str().length());
-
-  response.send(Pistache::Http::Code::Ok, ss.str());
+  Pistache::Http::serveFile(response, info.filename, mime);
 }
@@ -196,7 +196,11 @@ void flexran::north_api::rrc_triggering_calls::rrc_reconf(
   }
 
   std::string error_reason;
-  if (!rrc_trigger->rrc_reconf(bs, policy, error_reason)) {
+  bool ok = false;
+  if (!run_command(commands, response,
+        [&] { ok = rrc_trigger->rrc_reconf(bs, policy, error_reason); }))
+    return;
+  if (!ok) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
     return;
@@ -213,7 +217,11 @@ void flexran::north_api::rrc_triggering_calls::rrc_ho(
   std::string tenb = request.param(":tid").as<std::string>();
 
   std::string error_reason;
-  if (!rrc_trigger->rrc_ho(senb, ue, tenb, error_reason)) {
+  bool ok = false;
+  if (!run_command(commands, response,
+        [&] { ok = rrc_trigger->rrc_ho(senb, ue, tenb, error_reason); }))
+    return;
+  if (!ok) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
     return;
@@ -228,7 +236,12 @@ void flexran::north_api::rrc_triggering_calls::rrc_x2_ho_net_control(
   bool x2_ho_net_control = request.param(":bool").as<bool>();
   std::string enb = request.param(":id").as<std::string>();
   std::string error_reason;
-  if (!rrc_trigger->rrc_x2_ho_net_control(enb, x2_ho_net_control, error_reason)) {
+  bool ok = false;
+  if (!run_command(commands, response, [&] {
+        ok = rrc_trigger->rrc_x2_ho_net_control(enb, x2_ho_net_control, error_reason);
+      }))
+    return;
+  if (!ok) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
     return;
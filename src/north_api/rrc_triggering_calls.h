@@ -39,8 +39,9 @@ namespace flexran {
 
     public:
 
-      rrc_triggering_calls(std::shared_ptr<flexran::app::rrc::rrc_triggering> flex_trigger)
-	: rrc_trigger(flex_trigger)
+      rrc_triggering_calls(std::shared_ptr<flexran::app::rrc::rrc_triggering> flex_trigger,
+          flexran::core::command_bus& bus)
+	: rrc_trigger(flex_trigger), commands(bus)
       { }
       
       void register_calls(Pistache::Rest::Description& desc);
@@ -55,6 +56,7 @@ namespace flexran {
     private:
 
       std::shared_ptr<flexran::app::rrc::rrc_triggering> rrc_trigger;
+      flexran::core::command_bus& commands;
 
     };
   }
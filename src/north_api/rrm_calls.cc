@@ -671,7 +671,10 @@ void flexran::north_api::rrm_calls::apply_slice_config(
   }
 
   try {
-    rrm_app->apply_slice_config_policy(bs, policy);
+    if (!run_command(commands, response, [&] {
+          rrm_app->apply_slice_config_policy(bs, policy);
+        }))
+      return;
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -697,7 +700,10 @@ void flexran::north_api::rrm_calls::remove_slice_config(
   }
 
   try {
-    rrm_app->remove_slice(bs, policy);
+    if (!run_command(commands, response, [&] {
+          rrm_app->remove_slice(bs, policy);
+        }))
+      return;
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -723,7 +729,10 @@ void flexran::north_api::rrm_calls::change_ue_slice_assoc(
   }
 
   try {
-    rrm_app->change_ue_slice_association(bs, policy);
+    if (!run_command(commands, response, [&] {
+          rrm_app->change_ue_slice_association(bs, policy);
+        }))
+      return;
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -739,21 +748,27 @@ void flexran::north_api::rrm_calls::yaml_compat(
     const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response)
 {
-  uint64_t bs_id = request.hasParam(":id") ?
-      rrm_app->parse_enb_agent_id(request.param(":id").as<std::string>()) :
-      rrm_app->get_last_bs();
-  if (bs_id == 0) {
-    response.send(Pistache::Http::Code::Not_Found, "Policy not set (no such BS)\n");
-    return;
-  }
   if (request.body().length() == 0) {
     response.send(Pistache::Http::Code::Not_Found, "Policy not set (body is empty)\n");
     return;
   }
 
-  LOG4CXX_INFO(flog::app, "sending YAML request to BS " << bs_id
-      << " (compat):\n" << request.body());
-  rrm_app->reconfigure_agent_string(bs_id, request.body());
+  uint64_t bs_id = 0;
+  if (!run_command(commands, response, [&] {
+        bs_id = request.hasParam(":id") ?
+            rrm_app->parse_enb_agent_id(request.param(":id").as<std::string>()) :
+            rrm_app->get_last_bs();
+        if (bs_id == 0)
+          return;
+        LOG4CXX_INFO(flog::app, "sending YAML request to BS " << bs_id
+            << " (compat):\n" << request.body());
+        rrm_app->reconfigure_agent_string(bs_id, request.body());
+      }))
+    return;
+  if (bs_id == 0) {
+    response.send(Pistache::Http::Code::Not_Found, "Policy not set (no such BS)\n");
+    return;
+  }
   response.send(Pistache::Http::Code::Ok,
                 "Set the policy to BS " + std::to_string(bs_id) + "\n");
 }
@@ -790,7 +805,10 @@ void flexran::north_api::rrm_calls::auto_ue_slice_assoc(
   }
 
   try {
-    rrm_app->auto_ue_slice_association(bs, policy, dl_slice_id, ul_slice_id);
+    if (!run_command(commands, response, [&] {
+          rrm_app->auto_ue_slice_association(bs, policy, dl_slice_id, ul_slice_id);
+        }))
+      return;
   } catch (const std::invalid_argument& e) {
     LOG4CXX_ERROR(flog::app, "encountered error while processing " << __func__
           << "(): " << e.what());
@@ -806,15 +824,6 @@ void flexran::north_api::rrm_calls::cell_reconfiguration(
     const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response)
 {
-  uint64_t bs_id = request.hasParam(":id") ?
-      rrm_app->parse_enb_agent_id(request.param(":id").as<std::string>()) :
-      rrm_app->get_last_bs();
-  if (bs_id == 0) {
-    response.send(Pistache::Http::Code::Bad_Request,
-        "{ \"error\": \"can not find BS\" }", MIME(Application, Json));
-    return;
-  }
-
   std::string policy = request.body();
   if (policy.length() == 0) {
     response.send(Pistache::Http::Code::Bad_Request,
@@ -822,8 +831,23 @@ void flexran::north_api::rrm_calls::cell_reconfiguration(
     return;
   }
 
+  uint64_t bs_id = 0;
   std::string error_reason;
-  if (!rrm_app->apply_cell_config_policy(bs_id, policy, error_reason)) {
+  bool ok = false;
+  if (!run_command(commands, response, [&] {
+        bs_id = request.hasParam(":id") ?
+            rrm_app->parse_enb_agent_id(request.param(":id").as<std::string>()) :
+            rrm_app->get_last_bs();
+        if (bs_id != 0)
+          ok = rrm_app->apply_cell_config_policy(bs_id, policy, error_reason);
+      }))
+    return;
+  if (bs_id == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"can not find BS\" }", MIME(Application, Json));
+    return;
+  }
+  if (!ok) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }", MIME(Application, Json));
     return;
@@ -39,8 +39,9 @@ namespace flexran {
 
     public:
 
-      rrm_calls(std::shared_ptr<flexran::app::management::rrm_management> rrm)
-        : rrm_app(rrm)
+      rrm_calls(std::shared_ptr<flexran::app::management::rrm_management> rrm,
+          flexran::core::command_bus& bus)
+        : rrm_app(rrm), commands(bus)
       { }
       
       void register_calls(Pistache::Rest::Description& desc);
@@ -61,6 +62,7 @@ namespace flexran {
     private:
 
       std::shared_ptr<flexran::app::management::rrm_management> rrm_app;
+      flexran::core::command_bus& commands;
 
     };
   }
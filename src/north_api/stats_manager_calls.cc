@@ -22,6 +22,8 @@
  *  \email   x.foukas@sms.ed.ac.uk, robert.schmidt@eurecom.fr
  */
 
+#include <limits>
+
 #include <pistache/http.h>
 #include <pistache/http_header.h>
 
@@ -78,6 +80,7 @@ void flexran::north_api::stats_manager_calls::register_calls(Pistache::Rest::Des
    * TTI for all eNBs connected to this controller. The output is in JSON
    * format. For human-readable output, see <a
    * href="#api-Stats-GetStatsHumanReadable">Stats:GetStatsHumanReadable</a>.
+   * The response is sent using chunked transfer encoding, BS by BS.
    *
    * @apiVersion v0.1.0
    * @apiPermission None
@@ -3297,6 +3300,99 @@ void flexran::north_api::stats_manager_calls::register_calls(Pistache::Rest::Des
               "Get UE statistics for a UE on a BS")
        .bind(&flexran::north_api::stats_manager_calls::obtain_json_stats_ue, this);
 
+  /**
+   * @api {get} /stats/ue/:id_ue/history/:n? Get UE KPI history in JSON
+   * @apiName GetStatsUEHistory
+   * @apiGroup Stats
+   * @apiParam {Number} id_ue The ID of the UE in the form of either an RNTI or
+   * the IMSI. Everything shorter than 6 digits will be treated as the RNTI,
+   * the rest as the IMSI.
+   * @apiParam {Number} [n] The maximum number of samples to return (the most
+   * recent ones). Without it, all samples in the history are returned.
+   *
+   * @apiDescription This API gets the KPI history of one UE registered at any
+   * eNB managed by the controller. For every statistics report of the UE, the
+   * controller stores one sample of scalar KPIs (wideband CQI, sum of BSRs,
+   * PHR, sum of RLC buffer occupancies, cumulative PDCP bytes) together with
+   * the controller tick and the SFN/SF of the eNB. The history has a fixed
+   * capacity (option `--ue-history`). Additionally, the mean, variance,
+   * minimum, maximum, EWMA (alpha = 2/(length+1)) and rate of change per tick
+   * are maintained for every window configured through option
+   * `--ue-history-windows`. If the history is disabled, `history` is `null`.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9999/stats/ue/208940100001131/history/2
+   * @apiSuccessExample Success-Response:
+   *     HTTP/1.1 200 OK
+   *     {
+   *       "rnti": 27033,
+   *       "history": {
+   *         "capacity": 100,
+   *         "num_pushed": 723,
+   *         "samples": [
+   *           { "tick": 72200, "sfn_sf": 31334, "wb_cqi": 15, "bsr": 0,
+   *             "phr": 40, "rlc_buffer": 0, "pdcp_tx_bytes": 32740,
+   *             "pdcp_rx_bytes": 18030 },
+   *           { "tick": 72300, "sfn_sf": 32934, "wb_cqi": 14, "bsr": 0,
+   *             "phr": 40, "rlc_buffer": 120, "pdcp_tx_bytes": 33860,
+   *             "pdcp_rx_bytes": 18322 }
+   *         ],
+   *         "windows": [
+   *           {
+   *             "length": 10,
+   *             "n": 10,
+   *             "wb_cqi": { "mean": 14.600000, "var": 0.240000, "min": 14,
+   *                         "max": 15, "ewma": 14.512287, "rate": -0.001111 },
+   *             ...
+   *           },
+   *           ...
+   *         ]
+   *       }
+   *     }
+   *
+   * @apiError BadRequest The given UE ID or number of samples is invalid.
+   * @apiErrorExample Error-Response:
+   *     HTTP/1.1 400 BadRequest
+   *     { "error": "invalid UE ID" }
+   */
+  stats.route(desc.get("/ue/:id_ue/history/:n?"),
+              "Get KPI history for a given UE")
+       .bind(&flexran::north_api::stats_manager_calls::obtain_json_history_ue, this);
+
+  /**
+   * @api {get} /stats/enb/:id_enb/ue/:id_ue/history/:n? Get UE KPI history in JSON, delimited to a given eNB
+   * @apiName GetStatsUEHistoryLimited
+   * @apiGroup Stats
+   * @apiParam {Number} id_enb The ID of the desired BS. This can be one of the
+   * following: -1 (last added agent), the eNB ID (in hex, preceded by "0x", or
+   * decimal) or the internal agent ID which can be obtained through a `stats`
+   * call.  Numbers smaller than 1000 are parsed as the agent ID.
+   * @apiParam {number} id_ue The ID of the UE in the form of either an RNTI or
+   * the IMSI. Everything shorter than 6 digits will be treated as the RNTI,
+   * the rest as the IMSI.
+   * @apiParam {Number} [n] The maximum number of samples to return.
+   *
+   * @apiDescription This API gets the KPI history of one UE like <a
+   * href="#api-Stats-GetStatsUEHistory">Stats:GetStatsUEHistory</a>, but the
+   * search is restrained to a given eNB.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9999/stats/enb/234881037/ue/27033/history
+   *
+   * @apiError BadRequest The given eNB ID, UE ID, or number of samples is
+   * invalid.
+   * @apiErrorExample Error-Response:
+   *     HTTP/1.1 400 BadRequest
+   *     { "error": "can not find BS" }
+   */
+  stats.route(desc.get("/enb/:id_enb/ue/:id_ue/history/:n?"),
+              "Get KPI history for a UE on a BS")
+       .bind(&flexran::north_api::stats_manager_calls::obtain_json_history_ue, this);
+
   /**
    * @api {get} /stats/conf/enb/:id? Get statistics configuration
    * @apiName GetStatsConf
@@ -3423,20 +3519,32 @@ void flexran::north_api::stats_manager_calls::obtain_json_stats(const Pistache::
 {
   const std::string type = request.hasParam(":type") ?
       request.param(":type").as<std::string>() : REQ_TYPE::ALL_STATS;
-  std::string resp;
-  if (type == REQ_TYPE::ALL_STATS) {
-    resp = stats_app->all_stats_to_json_string();
-  } else if (type == REQ_TYPE::ENB_CONFIG) {
-    resp = stats_app->all_enb_configs_to_json_string();
-  } else if (type == REQ_TYPE::MAC_STATS) {
-    resp = stats_app->all_mac_configs_to_json_string();
-  } else {
+  const bool configs = type == REQ_TYPE::ALL_STATS || type == REQ_TYPE::ENB_CONFIG;
+  const bool stats = type == REQ_TYPE::ALL_STATS || type == REQ_TYPE::MAC_STATS;
+  if (!configs && !stats) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"invalid statistics type\"}", MIME(Application, Json));
     return;
   }
   response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
-  response.send(Pistache::Http::Code::Ok, resp, MIME(Application, Json));
+  response.setMime(MIME(Application, Json));
+
+  /* send the dump in chunks while writing it BS by BS, instead of building
+   * all of it in memory first */
+  const std::size_t chunk_size = 64 * 1024;
+  /* some Pistache versions cap the stream buffer at its initial size and drop
+   * what does not fit, so leave room for the chunk framing. Parts are at
+   * most chunk_size, and each goes out as one chunk */
+  auto stream = response.stream(Pistache::Http::Code::Ok, chunk_size + 64);
+  stats_app->stats_to_json_stream(configs, stats, chunk_size,
+      [&stream] (const std::string& part) {
+        // an empty chunk ends the response, so it is never written
+        if (part.empty()) return;
+        stream << part;
+        stream.flush();
+      }
+  );
+  stream.ends();
 }
 
 void flexran::north_api::stats_manager_calls::obtain_json_stats_enb(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
@@ -3499,6 +3607,46 @@ void flexran::north_api::stats_manager_calls::obtain_json_stats_ue(const Pistach
   response.send(Pistache::Http::Code::Ok, resp, MIME(Application, Json));
 }
 
+void flexran::north_api::stats_manager_calls::obtain_json_history_ue(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  uint64_t bs_id = 0;
+  const bool check_enb = request.hasParam(":id_enb");
+  if (check_enb) {
+    bs_id = stats_app->parse_bs_agent_id(request.param(":id_enb").as<std::string>());
+    if (bs_id == 0) {
+      response.send(Pistache::Http::Code::Bad_Request,
+          "{ \"error\": \"can not find BS\" }", MIME(Application, Json));
+      return;
+    }
+  }
+
+  const std::string ue_id_s = request.param(":id_ue").as<std::string>();
+  flexran::rib::rnti_t rnti;
+  const bool found = check_enb ? stats_app->parse_rnti_imsi(bs_id, ue_id_s, rnti) :
+                                 stats_app->parse_rnti_imsi_find_bs(ue_id_s, rnti, bs_id);
+  if (!found) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"invalid UE ID\" }", MIME(Application, Json));
+    return;
+  }
+
+  std::size_t n = std::numeric_limits<std::size_t>::max();
+  if (request.hasParam(":n")) {
+    try {
+      n = std::stoul(request.param(":n").as<std::string>());
+    } catch (const std::exception& e) {
+      response.send(Pistache::Http::Code::Bad_Request,
+          "{ \"error\": \"invalid number of samples\" }", MIME(Application, Json));
+      return;
+    }
+  }
+
+  std::string resp;
+  stats_app->ue_history_by_rnti_by_bs_id_to_json_string(rnti, resp, bs_id, n);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, resp, MIME(Application, Json));
+}
+
 void flexran::north_api::stats_manager_calls::get_stats_req(
     const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
@@ -3506,7 +3654,11 @@ void flexran::north_api::stats_manager_calls::get_stats_req(
   if (request.hasParam(":id")) bs = request.param(":id").as<std::string>();
 
   std::string resp;
-  if (!stats_app->get_stats_requests(bs, resp)) {
+  bool found = false;
+  if (!run_command(commands, response,
+        [&] { found = stats_app->get_stats_requests(bs, resp); }))
+    return;
+  if (!found) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + resp +"\" }", MIME(Application, Json));
     return;
@@ -3530,7 +3682,11 @@ void flexran::north_api::stats_manager_calls::set_stats_req(
   }
 
   std::string error_reason;
-  if (!stats_app->set_stats_requests(bs, policy, error_reason)) {
+  bool ok = false;
+  if (!run_command(commands, response,
+        [&] { ok = stats_app->set_stats_requests(bs, policy, error_reason); }))
+    return;
+  if (!ok) {
     response.send(Pistache::Http::Code::Bad_Request,
         "{ \"error\": \"" + error_reason + "\" }\n", MIME(Application, Json));
     return;
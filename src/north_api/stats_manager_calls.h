@@ -40,8 +40,9 @@ namespace flexran {
 
     public:
 
-      stats_manager_calls(std::shared_ptr<flexran::app::stats::stats_manager> stats)
-      : stats_app(stats)
+      stats_manager_calls(std::shared_ptr<flexran::app::stats::stats_manager> stats,
+          flexran::core::command_bus& bus)
+      : stats_app(stats), commands(bus)
       { }
 
       void register_calls(Pistache::Rest::Description& desc);
@@ -51,11 +52,14 @@ namespace flexran {
       void obtain_json_stats(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
       void obtain_json_stats_enb(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
       void obtain_json_stats_ue(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+
+      void obtain_json_history_ue(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
       void get_stats_req(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
       void set_stats_req(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
 
     private:
       std::shared_ptr<flexran::app::stats::stats_manager> stats_app;
+      flexran::core::command_bus& commands;
 
     };
   }
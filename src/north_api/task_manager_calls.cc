@@ -0,0 +1,475 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    task_manager_calls.cc
+ *  \brief   calls to inspect and configure the time apps take in the task manager
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <pistache/http_header.h>
+
+#include "rt_controller_common.h"
+#include "task_manager_calls.h"
+
+void flexran::north_api::task_manager_calls::register_calls(Pistache::Rest::Description& desc)
+{
+  auto task_manager = desc.path("/task_manager");
+
+  /**
+   * @api {get} /task_manager/apps Get the run time statistics of apps
+   * @apiName GetTaskManagerApps
+   * @apiGroup TaskManager
+   *
+   * @apiDescription This API returns how long the apps run per tick in the
+   * task manager. `ticks` gives the tick duration, how the task manager
+   * waits for a tick (see
+   * <a href="#api-TaskManager-SetTaskManagerTickWait">TaskManager:SetTaskManagerTickWait</a>),
+   * the CPUs it is pinned to (empty if none), how late it woke up in every wait
+   * mode (`wakeup_us`), the number of agent messages processed while
+   * spinning (`polled`), the current tick, the number of ticks that passed
+   * while a loop was still running (`missed`) and the number of such loops. `executor` describes the threads running app jobs in
+   * parallel. In `accounting`, every app (as named when subscribing) has a
+   * budget in microseconds. An app exceeding it `tolerance` times in a row
+   * is an offence, after which the `policy` is applied: `defer` runs the
+   * app in the next tick if the current one is late, `decimate` doubles
+   * its periods (see `decimation`), `offload` runs it on the executor. For
+   * every app, the mean and maximum time are given since the start, the
+   * median and 99th percentile over the last 1000 runs in `window`.
+   * `missed` counts the ticks at which the app was due but which the task
+   * manager skipped over. Entry
+   * `i` of the `histogram` counts the runs shorter than entry `i` of
+   * `histogram_bounds_us` (and longer than entry `i-1`), the last entry
+   * all longer runs.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9999/task_manager/apps
+   * @apiSuccessExample Example output
+   *     HTTP/1.1 200 OK
+   *     {
+   *       "ticks": { "period_us": 1000, "wait": "hybrid", "spin_us": 50, "cpus": "3",
+   *         "wakeup_us": {
+   *           "timerfd": { "count": 9313, "min": 2.1, "mean": 8.4, "p50": 6.9,
+   *             "p90": 12.8, "p99": 41.5, "p999": 60.1, "max": 85.3 },
+   *           "hybrid": { "count": 10000, "min": 0, "mean": 0.2, "p50": 0.1,
+   *             "p90": 0.2, "p99": 1.3, "p999": 4.1, "max": 9.2 },
+   *           "busy": { "count": 0, "min": 0, "mean": 0, "p50": 0,
+   *             "p90": 0, "p99": 0, "p999": 0, "max": 0 } },
+   *         "polled": 1834, "tick": 19313, "missed": 2, "late_loops": 1 },
+   *       "executor": { "workers": 2, "budget_us": 900, "jobs_run": 19312,
+   *         "jobs_skipped": 0, "jobs_overrun": 0 },
+   *       "accounting": {
+   *         "policy": "defer", "tolerance": 3, "default_budget_us": 200,
+   *         "histogram_bounds_us": [1,2,4,8,16,32,64,128,256,512,1024,2048,4096,8192,16384],
+   *         "apps": [
+   *           { "name": "rib_management", "budget_us": 200, "runs": 18,
+   *             "overruns": 0, "offences": 0, "deferred": 0, "missed": 0,
+   *             "offender": false, "decimation": 1, "offloaded": false,
+   *             "mean_us": 3.1, "max_us": 7.9,
+   *             "window": { "samples": 18, "p50_us": 2.8, "p99_us": 7.9, "max_us": 7.9 },
+   *             "histogram": [0,0,10,7,1,0,0,0,0,0,0,0,0,0,0,0] }
+   *         ]
+   *       }
+   *     }
+   */
+  task_manager.route(desc.get("/apps"), "Get the run time statistics of apps")
+      .bind(&flexran::north_api::task_manager_calls::obtain_apps, this);
+
+  /**
+   * @api {post} /task_manager/budget/:app/:us Set the budget of an app
+   * @apiName SetTaskManagerBudget
+   * @apiGroup TaskManager
+   * @apiParam {String} app The name of the app, as in
+   * <a href="#api-TaskManager-GetTaskManagerApps">TaskManager:GetTaskManagerApps</a>.
+   * @apiParam {Number} us The time in microseconds the app may run per tick.
+   *
+   * @apiDescription This API sets the time an app may run per tick before
+   * it is counted as an overrun.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X POST http://127.0.0.1:9999/task_manager/budget/recorder/500
+   * @apiSuccessExample Success-Response:
+   *     HTTP/1.1 200 OK
+   *
+   * @apiError BadRequest The budget is not a positive number.
+   *
+   * @apiErrorExample Error-Response:
+   *    HTTP/1.1 400 BadRequest
+   *    { "error": "invalid budget" }
+   */
+  task_manager.route(desc.post("/budget/:app/:us"), "Set the budget of an app")
+      .bind(&flexran::north_api::task_manager_calls::set_budget, this);
+
+  /**
+   * @api {post} /task_manager/tick_wait/:mode Set how to wait for a tick
+   * @apiName SetTaskManagerTickWait
+   * @apiGroup TaskManager
+   * @apiParam {String="timerfd","hybrid","busy"} mode The wait mode.
+   *
+   * @apiDescription This API changes how the task manager waits for the
+   * next tick: `timerfd` blocks on a timer and pays the wakeup latency of
+   * the scheduler, `hybrid` sleeps until shortly before the tick and spins
+   * afterwards, `busy` spins all the time. While spinning, agent messages
+   * are processed as they arrive (unless disabled with `--tick-poll`). The
+   * spinning modes should be used with the task manager pinned to an
+   * isolated CPU (`--cpus.task-manager`). The wakeup latency is kept per mode in
+   * <a href="#api-TaskManager-GetTaskManagerApps">TaskManager:GetTaskManagerApps</a>
+   * to compare them.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X POST http://127.0.0.1:9999/task_manager/tick_wait/hybrid
+   * @apiSuccessExample Success-Response:
+   *     HTTP/1.1 200 OK
+   *
+   * @apiError BadRequest The mode is unknown.
+   *
+   * @apiErrorExample Error-Response:
+   *    HTTP/1.1 400 BadRequest
+   *    { "error": "invalid mode" }
+   */
+  task_manager.route(desc.post("/tick_wait/:mode"), "Set how to wait for a tick")
+      .bind(&flexran::north_api::task_manager_calls::set_tick_wait, this);
+
+  /**
+   * @api {get} /task_manager/profiler Get the task manager profile
+   * @apiName GetTaskManagerProfiler
+   * @apiGroup TaskManager
+   *
+   * @apiDescription This API returns the profile of the task manager loop
+   * since the profiler has been started, see
+   * <a href="#api-TaskManager-StartTaskManagerProfiler">TaskManager:StartTaskManagerProfiler</a>.
+   * `inter_loop_us` is the time between the start of two loops (ideally 1000),
+   * `rib_us` the time to process agent messages, `apps_us` the time of the
+   * apps and `loop_us` the time of the whole loop, `processed` the number
+   * of messages per loop. Percentiles are accurate to within 1.6%. `agents`
+   * lists the packets and bytes received from every agent and the
+   * resulting throughput. The profile is kept after stopping the profiler.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9999/task_manager/profiler
+   * @apiSuccessExample Example output
+   *     HTTP/1.1 200 OK
+   *     {
+   *       "running": true, "duration_s": 12.3,
+   *       "inter_loop_us": { "count": 12300, "min": 951.2, "mean": 1000.0,
+   *         "p50": 1000.4, "p90": 1011.7, "p99": 1040.4, "p999": 1089.5, "max": 1103.9 },
+   *       "rib_us": { "count": 12300, "min": 0.4, "mean": 3.1,
+   *         "p50": 2.9, "p90": 4.8, "p99": 9.7, "p999": 18.2, "max": 21.0 },
+   *       "apps_us": { "count": 12300, "min": 0.6, "mean": 5.2,
+   *         "p50": 4.1, "p90": 8.3, "p99": 40.1, "p999": 96.1, "max": 130.3 },
+   *       "loop_us": { "count": 12300, "min": 1.1, "mean": 8.4,
+   *         "p50": 7.1, "p90": 12.9, "p99": 49.7, "p999": 110.5, "max": 141.8 },
+   *       "processed": { "count": 12300, "min": 0, "mean": 1.1,
+   *         "p50": 1, "p90": 2, "p99": 3, "p999": 4, "max": 5 },
+   *       "agents": [
+   *         { "agent_id": 0, "bs_id": 3584, "rx_packets": 13537,
+   *           "rx_bytes": 2392321, "mbps": 1.556 }
+   *       ]
+   *     }
+   */
+  task_manager.route(desc.get("/profiler"), "Get the task manager profile")
+      .bind(&flexran::north_api::task_manager_calls::obtain_profile, this);
+
+  /**
+   * @api {post} /task_manager/profiler/start Start the task manager profiler
+   * @apiName StartTaskManagerProfiler
+   * @apiGroup TaskManager
+   *
+   * @apiDescription This API (re)starts profiling the task manager loop,
+   * discarding a previous profile. The same can be achieved by sending
+   * SIGUSR2 to the controller, which toggles the profiler and logs the
+   * profile when stopping it.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X POST http://127.0.0.1:9999/task_manager/profiler/start
+   * @apiSuccessExample Success-Response:
+   *     HTTP/1.1 200 OK
+   */
+  task_manager.route(desc.post("/profiler/start"), "Start the task manager profiler")
+      .bind(&flexran::north_api::task_manager_calls::start_profiler, this);
+
+  /**
+   * @api {post} /task_manager/profiler/stop Stop the task manager profiler
+   * @apiName StopTaskManagerProfiler
+   * @apiGroup TaskManager
+   *
+   * @apiDescription This API stops the task manager profiler and returns
+   * the profile as in
+   * <a href="#api-TaskManager-GetTaskManagerProfiler">TaskManager:GetTaskManagerProfiler</a>.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X POST http://127.0.0.1:9999/task_manager/profiler/stop
+   * @apiSuccessExample Success-Response:
+   *     HTTP/1.1 200 OK
+   *     { "running": false, "duration_s": 12.3, ... }
+   */
+  task_manager.route(desc.post("/profiler/stop"), "Stop the task manager profiler")
+      .bind(&flexran::north_api::task_manager_calls::stop_profiler, this);
+
+  /**
+   * @api {get} /task_manager/placement Get the CPU placement of all threads
+   * @apiName GetTaskManagerPlacement
+   * @apiGroup TaskManager
+   *
+   * @apiDescription This API returns on which CPUs the threads of the
+   * controller run. `classes` lists the CPUs configured per thread class
+   * (see the `--cpus.*` and `--placement` options; empty if not pinned)
+   * and their NUMA nodes. `threads` lists every thread of the process with
+   * its effective CPUs and NUMA nodes: the task manager is named `rtc-tm`,
+   * the app workers `rtc-workerN`, the network thread `rtc-net`; the others
+   * are the REST threads and the main thread, which share the `rest` CPUs.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9999/task_manager/placement
+   * @apiSuccessExample Example output
+   *     HTTP/1.1 200 OK
+   *     {
+   *       "classes": {
+   *         "task_manager": { "cpus": "3", "nodes": [0] },
+   *         "network": { "cpus": "4", "nodes": [0] },
+   *         "workers": { "cpus": "5-6", "nodes": [0] },
+   *         "rest": { "cpus": "16-19", "nodes": [1] }
+   *       },
+   *       "threads": [
+   *         { "tid": 4711, "name": "rt_controller", "cpus": "16-19", "nodes": [1] },
+   *         { "tid": 4712, "name": "rtc-tm", "cpus": "3", "nodes": [0] },
+   *         { "tid": 4713, "name": "rtc-net", "cpus": "4", "nodes": [0] },
+   *         { "tid": 4714, "name": "rtc-worker0", "cpus": "5", "nodes": [0] },
+   *         { "tid": 4715, "name": "rtc-worker1", "cpus": "6", "nodes": [0] },
+   *         { "tid": 4716, "name": "rt_controller", "cpus": "16-19", "nodes": [1] }
+   *       ]
+   *     }
+   */
+  task_manager.route(desc.get("/placement"), "Get the CPU placement of all threads")
+      .bind(&flexran::north_api::task_manager_calls::obtain_placement, this);
+
+  /**
+   * @api {get} /task_manager/subscriptions Get the event subscriptions
+   * @apiName GetTaskManagerSubscriptions
+   * @apiGroup TaskManager
+   *
+   * @apiDescription This API lists who receives the BS and UE events of the
+   * RIB. `signals` gives the number of subscribers called for every event of
+   * a kind. `filtered` lists the subscriptions that are only called for
+   * matching events, with the subscribing app and the filter key: the event
+   * kinds, BS IDs, RNTI and IMSI prefix (left out if any matches).
+   * `task_timers` is the number of subscriptions to the task tick.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9999/task_manager/subscriptions
+   * @apiSuccessExample Example output
+   *     HTTP/1.1 200 OK
+   *     {
+   *       "signals": { "bs_add": 2, "bs_remove": 2, "ue_connect": 0,
+   *         "ue_update": 0, "ue_disconnect": 0, "stats_update": 1 },
+   *       "filtered": [
+   *         { "app": "rrm_slice_assoc", "filter": "kinds=ue_update" }
+   *       ],
+   *       "task_timers": 9
+   *     }
+   */
+  task_manager.route(desc.get("/subscriptions"), "Get the event subscriptions")
+      .bind(&flexran::north_api::task_manager_calls::obtain_subscriptions, this);
+
+  /**
+   * @api {get} /task_manager/commands Get the northbound command queue
+   * @apiName GetTaskManagerCommands
+   * @apiGroup TaskManager
+   *
+   * @apiDescription This API returns the state of the queue through which
+   * control calls (RRM, PLMN, RRC triggering) are executed by the task
+   * manager after the RIB updater, within `budget_us` per tick (see the
+   * `--command-queue` and `--command-budget` options). `depth` is the
+   * number of currently queued commands and `max_depth` the maximum so far.
+   * `rejected` counts calls answered with 503 since the queue was full.
+   * `wait_us` is the time commands were queued until they ran, and
+   * `run_us` the time they took, both in microseconds.
+   *
+   * @apiVersion v0.1.0
+   * @apiPermission None
+   * @apiExample Example usage:
+   *     curl -X GET http://127.0.0.1:9999/task_manager/commands
+   * @apiSuccessExample Example output
+   *     HTTP/1.1 200 OK
+   *     {
+   *       "capacity": 256, "budget_us": 100, "depth": 0, "max_depth": 2,
+   *       "submitted": 17, "executed": 17, "rejected": 0,
+   *       "wait_us": { "count": 17, "min": 12.3, "mean": 540.1, "p50": 612.4,
+   *         "p90": 901.2, "p99": 960.8, "p999": 960.8, "max": 960.8 },
+   *       "run_us": { "count": 17, "min": 3.1, "mean": 18.7, "p50": 15.2,
+   *         "p90": 40.1, "p99": 52.9, "p999": 52.9, "max": 52.9 }
+   *     }
+   */
+  task_manager.route(desc.get("/commands"), "Get the northbound command queue")
+      .bind(&flexran::north_api::task_manager_calls::obtain_commands, this);
+}
+
+namespace {
+  std::string wakeup_to_json(const flexran::core::tick_timer& timer,
+      flexran::core::tick_wait mode)
+  {
+    return "\"" + flexran::core::to_string(mode) + "\":"
+        + timer.get_wakeup_latency(mode).to_json_string(1000.0);
+  }
+}
+
+void flexran::north_api::task_manager_calls::obtain_apps(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  const flexran::core::tick_timer& timer = tm_.get_tick_timer();
+  const std::string resp = "{\"ticks\":{\"period_us\":"
+      + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(
+            timer.get_period()).count())
+      + ",\"wait\":\"" + flexran::core::to_string(timer.get_mode())
+      + "\",\"spin_us\":" + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(
+            timer.get_spin()).count())
+      + ",\"cpus\":\"" + flexran::core::cpu_list_to_string(tm_.get_cpus()) + "\""
+      + ",\"wakeup_us\":{"
+      + wakeup_to_json(timer, flexran::core::tick_wait::timerfd) + ","
+      + wakeup_to_json(timer, flexran::core::tick_wait::hybrid) + ","
+      + wakeup_to_json(timer, flexran::core::tick_wait::busy)
+      + "},\"polled\":" + std::to_string(tm_.get_polled_messages())
+      + ",\"tick\":" + std::to_string(tm_.get_tick())
+      + ",\"missed\":" + std::to_string(tm_.get_missed_ticks())
+      + ",\"late_loops\":" + std::to_string(tm_.get_late_loops())
+      + "},\"executor\":{\"workers\":"
+      + std::to_string(executor_.get_num_workers())
+      + ",\"budget_us\":" + std::to_string(executor_.get_budget().count())
+      + ",\"jobs_run\":" + std::to_string(executor_.get_jobs_run())
+      + ",\"jobs_skipped\":" + std::to_string(executor_.get_jobs_skipped())
+      + ",\"jobs_overrun\":" + std::to_string(executor_.get_jobs_overrun())
+      + "},\"accounting\":" + accounting_.to_json_string() + "}";
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, resp, MIME(Application, Json));
+}
+
+void flexran::north_api::task_manager_calls::set_budget(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  const std::string app = request.param(":app").as<std::string>();
+  const std::string us_s = request.param(":us").as<std::string>();
+  uint64_t us = 0;
+  try {
+    us = std::stoull(us_s);
+  } catch (const std::exception&) {
+    us = 0;
+  }
+  if (us == 0) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"invalid budget\" }", MIME(Application, Json));
+    return;
+  }
+  accounting_.set_budget(app, std::chrono::microseconds(us));
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, "");
+}
+
+void flexran::north_api::task_manager_calls::set_tick_wait(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  const std::string mode_s = request.param(":mode").as<std::string>();
+  flexran::core::tick_wait mode;
+  if (!flexran::core::parse_tick_wait(mode_s, mode)) {
+    response.send(Pistache::Http::Code::Bad_Request,
+        "{ \"error\": \"invalid mode\" }", MIME(Application, Json));
+    return;
+  }
+  tm_.get_tick_timer().set_mode(mode);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, "");
+}
+
+void flexran::north_api::task_manager_calls::obtain_profile(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, profiler_.to_json_string(),
+      MIME(Application, Json));
+}
+
+void flexran::north_api::task_manager_calls::start_profiler(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  profiler_.start();
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, "");
+}
+
+void flexran::north_api::task_manager_calls::stop_profiler(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  profiler_.stop();
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, profiler_.to_json_string(),
+      MIME(Application, Json));
+}
+
+void flexran::north_api::task_manager_calls::obtain_placement(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  response.send(Pistache::Http::Code::Ok, placement_.to_json_string(),
+      MIME(Application, Json));
+}
+
+void flexran::north_api::task_manager_calls::obtain_subscriptions(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  /* the signals and the filter index belong to the task manager thread */
+  flexran::event::subscription& sub = tm_.get_subscription();
+  const std::string list =
+      sub.defer([&sub] { return sub.subscriptions_to_json_string(); }).get();
+  response.send(Pistache::Http::Code::Ok, list, MIME(Application, Json));
+}
+
+void flexran::north_api::task_manager_calls::obtain_commands(
+    const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+  _unused(request);
+  response.headers().add<Pistache::Http::Header::AccessControlAllowOrigin>("*");
+  const flexran::core::command_bus *bus = tm_.get_command_bus();
+  if (!bus) {
+    response.send(Pistache::Http::Code::Not_Found,
+        "{ \"error\": \"no command queue\" }\n", MIME(Application, Json));
+    return;
+  }
+  response.send(Pistache::Http::Code::Ok, bus->to_json_string(), MIME(Application, Json));
+}
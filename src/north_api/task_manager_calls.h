@@ -0,0 +1,94 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    task_manager_calls.h
+ *  \brief   calls to inspect and configure the time apps take in the task manager
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef TASK_MANAGER_CALLS_H_
+#define TASK_MANAGER_CALLS_H_
+
+#include <pistache/http.h>
+#include <pistache/description.h>
+
+#include "app_calls.h"
+#include "task_accounting.h"
+#include "task_manager.h"
+#include "thread_placement.h"
+
+namespace flexran {
+
+  namespace north_api {
+
+    class task_manager_calls : public app_calls {
+
+    public:
+
+      task_manager_calls(flexran::event::task_accounting& accounting,
+          flexran::core::task_manager& tm,
+          const flexran::core::thread_placement& placement)
+        : accounting_(accounting), tm_(tm), executor_(tm.get_app_executor()),
+          profiler_(tm.get_profiler()), placement_(placement)
+      {}
+
+      void register_calls(Pistache::Rest::Description& desc);
+
+      void obtain_apps(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void set_budget(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void set_tick_wait(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void obtain_profile(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void start_profiler(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void stop_profiler(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void obtain_placement(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void obtain_subscriptions(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+      void obtain_commands(const Pistache::Rest::Request& request,
+          Pistache::Http::ResponseWriter response);
+
+    private:
+
+      flexran::event::task_accounting& accounting_;
+      flexran::core::task_manager& tm_;
+      const flexran::core::app_executor& executor_;
+      flexran::core::runtime_profiler& profiler_;
+      const flexran::core::thread_placement& placement_;
+
+    };
+
+  }
+
+}
+
+#endif /* TASK_MANAGER_CALLS_H_ */
@@ -63,13 +63,19 @@ std::string flexran::rib::agent_capabilities::to_string() const
   return s;
 }
 
-std::string flexran::rib::agent_capabilities::to_json() const
+void flexran::rib::agent_capabilities::to_json(json_writer& w) const
 {
-  std::string s = "[";
+  w.begin_array();
   for (protocol::flex_bs_capability c: caps_)
-    s += "\"" + protocol::flex_bs_capability_Name(c) + "\",";
-  s[s.size() - 1] = ']';
-  return s;
+    w.value(protocol::flex_bs_capability_Name(c));
+  w.end_array();
+}
+
+void flexran::rib::agent_capabilities::to_proto(
+    ::google::protobuf::RepeatedField<int> *proto_caps) const
+{
+  for (protocol::flex_bs_capability c: caps_)
+    proto_caps->Add(c);
 }
 
 uint32_t flexran::rib::agent_capabilities::to_u32(
@@ -123,26 +129,32 @@ std::string flexran::rib::agent_splits::to_string() const
   return s;
 }
 
-std::string flexran::rib::agent_splits::to_json() const
+void flexran::rib::agent_splits::to_json(json_writer& w) const
 {
-  if (splits_.size() < 1) return "[]";
-  std::string s = "[";
+  w.begin_array();
   for (protocol::flex_bs_split sp: splits_)
-    s += "\"" + protocol::flex_bs_split_Name(sp) + "\",";
-  s[s.size() - 1] = ']';
-  return s;
+    w.value(protocol::flex_bs_split_Name(sp));
+  w.end_array();
 }
 
-std::string flexran::rib::agent_info::to_json() const
+void flexran::rib::agent_splits::to_proto(
+    ::google::protobuf::RepeatedField<int> *proto_splits) const
 {
-  std::string s = "{";
-  s += "\"agent_id\":" + std::to_string(agent_id);
-  s += ",\"ip_port\":\"" + port_ip;
-  s += "\",\"bs_id\":" + std::to_string(bs_id);
-  s += ",\"capabilities\":" + capabilities.to_json();
-  s += ",\"splits\":" + splits.to_json();
-  s += "}";
-  return s;
+  for (protocol::flex_bs_split sp: splits_)
+    proto_splits->Add(sp);
+}
+
+void flexran::rib::agent_info::to_json(json_writer& w) const
+{
+  w.begin_object();
+  w.key("agent_id").value(agent_id);
+  w.key("ip_port").value(port_ip);
+  w.key("bs_id").value(bs_id);
+  w.key("capabilities");
+  capabilities.to_json(w);
+  w.key("splits");
+  splits.to_json(w);
+  w.end_object();
 }
 
 std::string flexran::rib::agent_info::to_string() const
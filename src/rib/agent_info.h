@@ -26,6 +26,7 @@
 #define AGENT_INFO_H_
 
 #include "flexran.pb.h"
+#include "json_writer.h"
 #include <vector>
 #include <string>
 #include <atomic>
@@ -43,7 +44,8 @@ namespace flexran {
       void merge_in(const agent_capabilities& other);
       bool is_complete() const;
       std::string to_string() const;
-      std::string to_json() const;
+      void to_json(json_writer& w) const;
+      void to_proto(::google::protobuf::RepeatedField<int> *proto_caps) const;
       std::size_t size() const { return caps_.size(); }
 
     private:
@@ -62,7 +64,8 @@ namespace flexran {
       agent_splits(const google::protobuf::RepeatedField<int>& proto_splits);
 
       std::string to_string() const;
-      std::string to_json() const;
+      void to_json(json_writer& w) const;
+      void to_proto(::google::protobuf::RepeatedField<int> *proto_splits) const;
 
     private:
       std::vector<protocol::flex_bs_split> splits_;
@@ -80,7 +83,7 @@ namespace flexran {
           rx_packets(0),
           rx_bytes(0)
       { }
-      std::string to_json() const;
+      void to_json(json_writer& w) const;
       std::string to_string() const;
 
       const int agent_id;
@@ -25,21 +25,40 @@
 
 #include <iostream>
 #include <algorithm>
+#include <set>
 #include <stdexcept>
 
-#include <google/protobuf/util/json_util.h>
-#include <google/protobuf/reflection.h>
 
 #include "enb_rib_info.h"
+#include "flexran_merge.h"
 #include "flexran_log.h"
 
 
 
 flexran::rib::enb_rib_info::enb_rib_info(uint64_t bs_id,
-    const std::set<std::shared_ptr<agent_info>>& agents)
+    const std::set<std::shared_ptr<agent_info>>& agents,
+    const ue_kpi_history::config& history_config,
+    std::shared_ptr<version_counter> versions)
   : bs_id_(bs_id),
-    agents_(agents)
+    agents_(agents),
+    current_frame_(0),
+    current_subframe_(0),
+    sf_known_(false),
+    sf_tick_(0),
+    history_config_(history_config),
+    ue_reconcile_pending_(false),
+    versions_(versions ? versions : std::make_shared<version_counter>()),
+    version_(versions_->next()),
+    created_version_(version_),
+    enb_config_version_(version_),
+    lc_config_version_(version_),
+    cell_stats_version_(version_),
+    ue_tombstone_horizon_(0),
+    ue_config_version_(version_),
+    ue_set_version_(version_),
+    published_version_(0)
 {
+  cell_config_version_.fill(version_);
   last_checked = st_clock::now();
   for (auto a: agents) {
     if (a->bs_id != bs_id_)
@@ -64,25 +83,28 @@ void flexran::rib::enb_rib_info::update_eNB_config(
       && eNB_config_.cell_config_size() != enb_config_update.cell_config_size())
     LOG4CXX_WARN(flog::rib, __func__ << "(): differing numbers of cell_configs");
 
-  eNB_config_mutex_.lock();
+  const uint64_t v = bump();
+  enb_config_version_ = v;
   if (eNB_config_.cell_config_size() == 0) { // saved config is empty
     eNB_config_.CopyFrom(enb_config_update);
+    for (int i = 0; i < std::min(eNB_config_.cell_config_size(), MAX_NUM_CC); ++i)
+      cell_config_version_[i] = v;
   } else {
     const int n = std::min(eNB_config_.cell_config_size(), enb_config_update.cell_config_size());
     for (int i = 0; i < n; ++i) {
       protocol::flex_cell_config *dst = eNB_config_.mutable_cell_config(i);
       const protocol::flex_cell_config& src = enb_config_update.cell_config(i);
-      clear_repeated_if_present(dst, src);
+      protocol::merge::clear_repeated_if_present(dst, src);
       /* the above should be recursively going down. ATM, delete complete slice
        * config if present */
       if (src.has_slice_config()) dst->clear_slice_config();
       dst->MergeFrom(src);
+      if (i < MAX_NUM_CC) cell_config_version_[i] = v;
     }
     eNB_config_.mutable_s1ap()->CopyFrom(enb_config_update.s1ap());
     eNB_config_.mutable_loadedapps()->CopyFrom(enb_config_update.loadedapps());
     eNB_config_.mutable_loadedmacobjects()->CopyFrom(enb_config_update.loadedmacobjects());
   }
-  eNB_config_mutex_.unlock();
   update_liveness();
 }
 
@@ -104,7 +126,7 @@ void flexran::rib::enb_rib_info::update_UE_config(
         << ue_config_.ue_config_size() << ")");
   }
 
-  ue_config_mutex_.lock();
+  uint64_t v = 0;
   for (const protocol::flex_ue_config& src : ue_config_update.ue_config()) {
     const rnti_t rnti = src.rnti();
     auto it = std::find_if(ue_config_.mutable_ue_config()->begin(),
@@ -113,12 +135,14 @@ void flexran::rib::enb_rib_info::update_UE_config(
     if (it == ue_config_.mutable_ue_config()->end()) // this one does not exist
       continue;
     protocol::flex_ue_config *dst = &(*it);
-    clear_repeated_if_present(dst, src);
+    protocol::merge::clear_repeated_if_present(dst, src);
     if (src.has_info())
-      clear_repeated_if_present(dst->mutable_info(), src.info());
+      protocol::merge::clear_repeated_if_present(dst->mutable_info(), src.info());
     dst->MergeFrom(src);
+    kpi_columns_.update_slices(rnti, dst->dl_slice_id(), dst->ul_slice_id());
+    if (v == 0) v = bump();
+    set_ue_config_version(rnti, v);
   }
-  ue_config_mutex_.unlock();
 
   update_liveness();
 }
@@ -126,9 +150,6 @@ void flexran::rib::enb_rib_info::update_UE_config(
 void flexran::rib::enb_rib_info::update_UE_config(
     const protocol::flex_ue_state_change& ue_state_change)
 {
-  // releases itself when leaving scope
-  std::lock_guard<std::mutex> lg_ue(ue_config_mutex_);
-  std::lock_guard<std::mutex> lg_lc(lc_config_mutex_);
   const rnti_t rnti = ue_state_change.config().rnti();
   google::protobuf::RepeatedPtrField<protocol::flex_ue_config>::iterator it = ue_config_.mutable_ue_config()->begin();
   it = std::find_if(ue_config_.mutable_ue_config()->begin(), ue_config_.mutable_ue_config()->end(),
@@ -140,32 +161,27 @@ void flexran::rib::enb_rib_info::update_UE_config(
     LOG4CXX_INFO(flog::rib, "BS " << bs_id_ << ": UE RNTI " << rnti << " activated");
     /* create new entry if not present, otherwise just update */
     if (it == ue_config_.mutable_ue_config()->end()) {
-      protocol::flex_ue_config *c = ue_config_.add_ue_config();
-      c->CopyFrom(ue_state_change.config());
-      ue_mac_info_.emplace(rnti, std::make_shared<ue_mac_rib_info>(rnti));
+      add_ue(ue_state_change.config());
     } else {
       /* dereference RepeatedPtrIterator, pass raw pointer */
-      clear_repeated_if_present(&(*it), ue_state_change.config());
+      protocol::merge::clear_repeated_if_present(&(*it), ue_state_change.config());
       it->MergeFrom(ue_state_change.config());
+      kpi_columns_.update_slices(rnti, it->dl_slice_id(), it->ul_slice_id());
+      set_ue_config_version(rnti, bump());
     }
     break;
   case protocol::FLUESC_DEACTIVATED:
     LOG4CXX_INFO(flog::rib, "BS " << bs_id_ << ": UE RNTI " << rnti << " deactivated");
-    if (it != ue_config_.mutable_ue_config()->end()) {
-      ue_config_.mutable_ue_config()->erase(it);
-      ue_mac_info_.erase(rnti);
-      auto lcit = std::find_if(lc_config_.lc_ue_config().cbegin(), lc_config_.lc_ue_config().cend(),
-          [rnti] (const protocol::flex_lc_ue_config& c) { return rnti == c.rnti(); }
-      );
-      if (lcit != lc_config_.lc_ue_config().cend())
-        lc_config_.mutable_lc_ue_config()->erase(lcit);
-    }
+    if (it != ue_config_.mutable_ue_config()->end())
+      remove_ue(rnti);
     break;
   case protocol::FLUESC_UPDATED:
     LOG4CXX_INFO(flog::rib, "BS " << bs_id_ << ": UE RNTI " << rnti << " updated");
     if (it != ue_config_.mutable_ue_config()->end()) {
-      clear_repeated_if_present(&(*it), ue_state_change.config());
+      protocol::merge::clear_repeated_if_present(&(*it), ue_state_change.config());
       it->MergeFrom(ue_state_change.config());
+      kpi_columns_.update_slices(rnti, it->dl_slice_id(), it->ul_slice_id());
+      set_ue_config_version(rnti, bump());
     }
     break;
   default:
@@ -174,20 +190,57 @@ void flexran::rib::enb_rib_info::update_UE_config(
   }
 }
 
+void flexran::rib::enb_rib_info::add_ue(const protocol::flex_ue_config& config)
+{
+  const rnti_t rnti = config.rnti();
+  protocol::flex_ue_config *c = ue_config_.add_ue_config();
+  c->CopyFrom(config);
+  ue_mac_info_.emplace(rnti, std::make_shared<ue_mac_rib_info>(rnti, history_config_));
+  ue_set_version_ = bump();
+  set_ue_config_version(rnti, ue_set_version_);
+  if (kpi_columns_.add_ue(rnti) < 0)
+    LOG4CXX_WARN(flog::rib, "BS " << bs_id_ << ": no KPI slot left for UE RNTI " << rnti);
+  kpi_columns_.update_slices(rnti, c->dl_slice_id(), c->ul_slice_id());
+}
+
+void flexran::rib::enb_rib_info::remove_ue(rnti_t rnti)
+{
+  auto it = std::find_if(ue_config_.mutable_ue_config()->begin(), ue_config_.mutable_ue_config()->end(),
+      [rnti] (const protocol::flex_ue_config& c) { return rnti == c.rnti(); }
+  );
+  if (it != ue_config_.mutable_ue_config()->end())
+    ue_config_.mutable_ue_config()->erase(it);
+  ue_mac_info_.erase(rnti);
+  kpi_columns_.remove_ue(rnti);
+  auto lcit = std::find_if(lc_config_.lc_ue_config().cbegin(), lc_config_.lc_ue_config().cend(),
+      [rnti] (const protocol::flex_lc_ue_config& c) { return rnti == c.rnti(); }
+  );
+  const uint64_t v = bump();
+  ue_config_version_ = v;
+  ue_set_version_ = v;
+  add_ue_tombstone(v, rnti);
+  if (lcit != lc_config_.lc_ue_config().cend()) {
+    lc_config_.mutable_lc_ue_config()->erase(lcit);
+    lc_config_version_ = v;
+  }
+}
+
 void flexran::rib::enb_rib_info::update_LC_config(const protocol::flex_lc_config_reply& lc_config_update) {
   update_liveness();
   if (lc_config_update.lc_ue_config_size() == 0)
     return;
-  lc_config_mutex_.lock();
   lc_config_.CopyFrom(lc_config_update);
-  lc_config_mutex_.unlock();
+  lc_config_version_ = bump();
 }
 
-void flexran::rib::enb_rib_info::update_subframe(const protocol::flex_sf_trigger& sf_trigger) {
+void flexran::rib::enb_rib_info::update_subframe(const protocol::flex_sf_trigger& sf_trigger,
+    uint64_t tick) {
   rnti_t rnti;
   uint16_t sfn_sf = sf_trigger.sfn_sf();
   current_frame_ = get_frame(sfn_sf);
   current_subframe_ = get_subframe(sfn_sf);
+  sf_known_ = true;
+  sf_tick_ = tick;
 
   // Update dl_sf_info
   for (int i = 0; i < sf_trigger.dl_info_size(); i++) {
@@ -215,8 +268,22 @@ void flexran::rib::enb_rib_info::update_subframe(const protocol::flex_sf_trigger
   update_liveness();
 }
 
-void flexran::rib::enb_rib_info::update_mac_stats(const protocol::flex_stats_reply& mac_stats) {
+uint16_t flexran::rib::enb_rib_info::get_sfn_sf_at(uint64_t tick) const
+{
+  if (!sf_known_)
+    return get_sfn_sf(current_frame_, current_subframe_);
+  /* the SFN wraps after 1024 frames of 10 subframes */
+  const int64_t num_sf = 10240;
+  const int64_t delta = static_cast<int64_t>(tick - sf_tick_) % num_sf;
+  const int64_t sf = ((current_frame_ % 1024) * 10 + current_subframe_ + delta + num_sf) % num_sf;
+  return get_sfn_sf(sf / 10, sf % 10);
+}
+
+void flexran::rib::enb_rib_info::update_mac_stats(const protocol::flex_stats_reply& mac_stats,
+    uint64_t tick) {
   rnti_t rnti;
+  const uint16_t sfn_sf = get_sfn_sf_at(tick);
+  const uint64_t v = bump();
   // First make the UE updates
   for (int i = 0; i < mac_stats.ue_report_size(); i++) {
     rnti = mac_stats.ue_report(i).rnti();
@@ -228,12 +295,170 @@ void flexran::rib::enb_rib_info::update_mac_stats(const protocol::flex_stats_rep
       //							    std::shared_ptr<ue_mac_rib_info>(new ue_mac_rib_info(rnti))));
     } else {
       it->second->update_mac_stats_report(mac_stats.ue_report(i));
+      kpi_columns_.update_kpis(rnti, it->second->get_kpis());
+      it->second->record_kpis(tick, sfn_sf);
+      it->second->set_stats_version(v);
       LOG4CXX_DEBUG(flog::rib, "Update MAC stats for RNTI " << rnti);
     }
   }
   // Then work on the Cell updates
   for (int i = 0; i < mac_stats.cell_report_size(); i++) {
     cell_mac_info_[i].update_cell_stats_report(mac_stats.cell_report(i));
+    cell_stats_version_ = v;
+  }
+}
+
+void flexran::rib::enb_rib_info::fill_checkpoint(protocol::flex_bs_checkpoint& cp) const
+{
+  cp.set_bs_id(bs_id_);
+  for (const auto& a : agents_) {
+    protocol::flex_agent_checkpoint *ac = cp.add_agents();
+    a->capabilities.to_proto(ac->mutable_capabilities());
+    a->splits.to_proto(ac->mutable_splits());
+  }
+  cp.mutable_enb_config()->CopyFrom(eNB_config_);
+  cp.mutable_ue_config()->CopyFrom(ue_config_);
+  cp.mutable_lc_config()->CopyFrom(lc_config_);
+}
+
+void flexran::rib::enb_rib_info::fill_delta(const bs_changes& c,
+    protocol::flex_bs_checkpoint& d) const
+{
+  if (c.added) {
+    fill_checkpoint(d);
+    return;
+  }
+  d.set_bs_id(bs_id_);
+  /* cell configs are small, send the eNB config as a whole */
+  if (c.enb_config || !c.cell_configs.empty())
+    d.mutable_enb_config()->CopyFrom(eNB_config_);
+  for (rnti_t rnti : c.ue_configs) {
+    for (const protocol::flex_ue_config& uc : ue_config_.ue_config()) {
+      if (uc.rnti() != rnti) continue;
+      d.mutable_ue_config()->add_ue_config()->CopyFrom(uc);
+      break;
+    }
+  }
+  for (rnti_t rnti : c.removed_ues)
+    d.add_removed_ues(rnti);
+  if (c.lc_config)
+    d.mutable_lc_config()->CopyFrom(lc_config_);
+}
+
+bool flexran::rib::enb_rib_info::has_agents_of(const protocol::flex_bs_checkpoint& cp) const
+{
+  std::multiset<std::string> caps;
+  for (const auto& a : agents_)
+    caps.insert(a->capabilities.to_string());
+  std::multiset<std::string> cp_caps;
+  for (const protocol::flex_agent_checkpoint& ac : cp.agents()) {
+    if (ac.capabilities_size() == 0) return false;
+    cp_caps.insert(agent_capabilities(ac.capabilities()).to_string());
+  }
+  return caps == cp_caps;
+}
+
+void flexran::rib::enb_rib_info::restore(const protocol::flex_bs_checkpoint& cp)
+{
+  update_eNB_config(cp.enb_config());
+  for (const protocol::flex_ue_config& c : cp.ue_config().ue_config()) {
+    if (ue_mac_info_.find(c.rnti()) == ue_mac_info_.end())
+      add_ue(c);
+  }
+  update_LC_config(cp.lc_config());
+  ue_reconcile_pending_ = true;
+  LOG4CXX_INFO(flog::rib, "BS " << bs_id_ << ": restored "
+      << eNB_config_.cell_config_size() << " cell(s) and "
+      << ue_config_.ue_config_size() << " UE(s) from checkpoint");
+}
+
+bool flexran::rib::enb_rib_info::reconcile_UE_configs(
+    const protocol::flex_ue_config_reply& ue_config_reply,
+    std::vector<rnti_t>& added, std::vector<std::pair<rnti_t, uint64_t>>& removed)
+{
+  if (!ue_reconcile_pending_)
+    return false;
+  ue_reconcile_pending_ = false;
+
+  std::set<rnti_t> present;
+  for (const protocol::flex_ue_config& c : ue_config_reply.ue_config())
+    present.insert(c.rnti());
+  for (const protocol::flex_ue_config& c : ue_config_.ue_config()) {
+    if (present.find(c.rnti()) == present.end())
+      removed.emplace_back(c.rnti(), c.has_imsi() ? c.imsi() : 0);
+  }
+  for (const auto& r : removed) {
+    LOG4CXX_INFO(flog::rib, "BS " << bs_id_ << ": restored UE RNTI " << r.first << " is gone");
+    remove_ue(r.first);
+  }
+  for (const protocol::flex_ue_config& c : ue_config_reply.ue_config()) {
+    if (ue_mac_info_.find(c.rnti()) != ue_mac_info_.end()) continue;
+    LOG4CXX_INFO(flog::rib, "BS " << bs_id_ << ": UE RNTI " << c.rnti() << " appeared during restart");
+    add_ue(c);
+    added.push_back(c.rnti());
+  }
+  return true;
+}
+
+void flexran::rib::enb_rib_info::publish()
+{
+  const uint64_t pv = published_version_;
+  if (version_ == pv)
+    return;
+  if (enb_config_version_ > pv)
+    eNB_config_snapshot_.publish(eNB_config_);
+  if (ue_config_version_ > pv)
+    ue_config_snapshot_.publish(ue_config_);
+  if (lc_config_version_ > pv)
+    lc_config_snapshot_.publish(lc_config_);
+  for (const auto& ue : ue_mac_info_) {
+    if (ue.second->get_stats_version() > pv)
+      ue.second->publish_mac_stats();
+  }
+  if (ue_set_version_ > pv)
+    ue_mac_info_snapshot_.publish(ue_mac_info_);
+  published_version_ = version_;
+}
+
+bool flexran::rib::enb_rib_info::get_changes_since(uint64_t v, bs_changes& out) const
+{
+  out.bs_id = bs_id_;
+  out.added = created_version_ > v;
+  out.enb_config = enb_config_version_ > v;
+  out.cell_configs.clear();
+  for (int i = 0; i < MAX_NUM_CC; ++i)
+    if (cell_config_version_[i] > v) out.cell_configs.push_back(i);
+  out.lc_config = lc_config_version_ > v;
+  out.cell_stats = cell_stats_version_ > v;
+  out.ue_configs.clear();
+  out.ue_stats.clear();
+  for (const auto& ue : ue_mac_info_) {
+    if (ue.second->get_config_version() > v) out.ue_configs.push_back(ue.first);
+    if (ue.second->get_stats_version() > v) out.ue_stats.push_back(ue.first);
+  }
+  out.removed_ues.clear();
+  for (auto it = ue_tombstones_.rbegin(); it != ue_tombstones_.rend() && it->first > v; ++it) {
+    if (ue_mac_info_.find(it->second) != ue_mac_info_.end()) continue; // re-added
+    if (std::find(out.removed_ues.begin(), out.removed_ues.end(), it->second) == out.removed_ues.end())
+      out.removed_ues.push_back(it->second);
+  }
+  return v >= ue_tombstone_horizon_;
+}
+
+void flexran::rib::enb_rib_info::set_ue_config_version(rnti_t rnti, uint64_t v)
+{
+  ue_config_version_ = v;
+  auto it = ue_mac_info_.find(rnti);
+  if (it != ue_mac_info_.end())
+    it->second->set_config_version(v);
+}
+
+void flexran::rib::enb_rib_info::add_ue_tombstone(uint64_t v, rnti_t rnti)
+{
+  ue_tombstones_.emplace_back(v, rnti);
+  if (ue_tombstones_.size() > MAX_UE_TOMBSTONES) {
+    ue_tombstone_horizon_ = ue_tombstones_.front().first;
+    ue_tombstones_.pop_front();
   }
 }
 
@@ -257,7 +482,7 @@ void flexran::rib::enb_rib_info::update_liveness() {
 
 void flexran::rib::enb_rib_info::dump_mac_stats() const {
   LOG4CXX_INFO(flog::rib, "UE MAC stats for BS " << bs_id_);
-  for (auto ue_stats : ue_mac_info_) {
+  for (auto ue_stats : *ue_mac_info_snapshot_.get()) {
     ue_stats.second->dump_stats();
   }
 }
@@ -268,7 +493,7 @@ std::string flexran::rib::enb_rib_info::dump_mac_stats_to_string() const {
   str += "UE MAC stats for BS ";
   str += bs_id_;
   str += "\n";
-  for (auto ue_stats : ue_mac_info_) {
+  for (auto ue_stats : *ue_mac_info_snapshot_.get()) {
     str += ue_stats.second->dump_stats_to_string();
     str += "\n";
   }
@@ -276,16 +501,23 @@ std::string flexran::rib::enb_rib_info::dump_mac_stats_to_string() const {
   return str;
 }
 
-std::string flexran::rib::enb_rib_info::dump_mac_stats_to_json_string() const
+void flexran::rib::enb_rib_info::dump_mac_stats_to_json(json_writer& w) const
 {
-  std::vector<std::string> ue_mac_stats;
-  ue_mac_stats.reserve(ue_mac_info_.size());
-  std::transform(ue_mac_info_.begin(), ue_mac_info_.end(), std::back_inserter(ue_mac_stats),
-      [] (const std::pair<rnti_t, std::shared_ptr<ue_mac_rib_info>>& ue_stats)
-      { return ue_stats.second->dump_stats_to_json_string(); }
-  );
+  const std::shared_ptr<const ue_mac_info_map> ue_mac_info = ue_mac_info_snapshot_.get();
+  w.begin_object();
+  w.key("bs_id").value(bs_id_);
+  w.key("ue_mac_stats").begin_array();
+  for (const auto& ue_stats : *ue_mac_info)
+    ue_stats.second->dump_stats_to_json(w);
+  w.end_array();
+  w.end_object();
+}
 
-  return format_mac_stats_to_json(bs_id_, ue_mac_stats);
+std::string flexran::rib::enb_rib_info::dump_mac_stats_to_json_string() const
+{
+  json_writer w;
+  dump_mac_stats_to_json(w);
+  return w.str().substr(1, w.size() - 2);
 }
 
 std::string flexran::rib::enb_rib_info::format_mac_stats_to_json(
@@ -308,15 +540,9 @@ void flexran::rib::enb_rib_info::dump_configs() const {
   LOG4CXX_INFO(flog::rib, "dump_configs() for BS " << bs_id_);
   for (auto a : agents_)
     LOG4CXX_INFO(flog::rib, a->to_string());
-  eNB_config_mutex_.lock();
-  LOG4CXX_INFO(flog::rib, eNB_config_.DebugString());
-  eNB_config_mutex_.unlock();
-  ue_config_mutex_.lock();
-  LOG4CXX_INFO(flog::rib, ue_config_.DebugString());
-  ue_config_mutex_.unlock();
-  lc_config_mutex_.lock();
-  LOG4CXX_INFO(flog::rib, lc_config_.DebugString());
-  lc_config_mutex_.unlock();
+  LOG4CXX_INFO(flog::rib, eNB_config_snapshot_.get()->DebugString());
+  LOG4CXX_INFO(flog::rib, ue_config_snapshot_.get()->DebugString());
+  LOG4CXX_INFO(flog::rib, lc_config_snapshot_.get()->DebugString());
 }
 
 std::string flexran::rib::enb_rib_info::dump_configs_to_string() const {
@@ -324,46 +550,35 @@ std::string flexran::rib::enb_rib_info::dump_configs_to_string() const {
   str += "configs for BS " + std::to_string(bs_id_) + "\n";
   for (auto a : agents_)
     str += a->to_string() + "\n";
-  eNB_config_mutex_.lock();
-  str += eNB_config_.DebugString();
-  eNB_config_mutex_.unlock();
+  str += eNB_config_snapshot_.get()->DebugString();
   str += "\n";
-  ue_config_mutex_.lock();
-  str += ue_config_.DebugString();
-  ue_config_mutex_.unlock();
+  str += ue_config_snapshot_.get()->DebugString();
   str += "\n";
-  lc_config_mutex_.lock();
-  str += lc_config_.DebugString();
-  lc_config_mutex_.unlock();
+  str += lc_config_snapshot_.get()->DebugString();
   str += "\n";
 
   return str;
 }
 
-std::string flexran::rib::enb_rib_info::dump_configs_to_json_string() const
+void flexran::rib::enb_rib_info::dump_configs_to_json(json_writer& w) const
 {
-  std::string agent_info, enb_config, ue_config, lc_config;
-
-  agent_info = "[";
-  for (auto it = agents_.begin(); it != agents_.end(); ++it) {
-    if (it != agents_.begin()) agent_info += ",";
-    agent_info += (*it)->to_json();
-  }
-  agent_info += "]";
-
-  eNB_config_mutex_.lock();
-  google::protobuf::util::MessageToJsonString(eNB_config_, &enb_config, google::protobuf::util::JsonPrintOptions());
-  eNB_config_mutex_.unlock();
-
-  ue_config_mutex_.lock();
-  google::protobuf::util::MessageToJsonString(ue_config_, &ue_config, google::protobuf::util::JsonPrintOptions());
-  ue_config_mutex_.unlock();
-
-  lc_config_mutex_.lock();
-  google::protobuf::util::MessageToJsonString(lc_config_, &lc_config, google::protobuf::util::JsonPrintOptions());
-  lc_config_mutex_.unlock();
+  w.begin_object();
+  w.key("bs_id").value(bs_id_);
+  w.key("agent_info").begin_array();
+  for (const auto& a : agents_)
+    a->to_json(w);
+  w.end_array();
+  w.key("eNB").message(*eNB_config_snapshot_.get());
+  w.key("UE").message(*ue_config_snapshot_.get());
+  w.key("LC").message(*lc_config_snapshot_.get());
+  w.end_object();
+}
 
-  return format_configs_to_json(bs_id_, agent_info, enb_config, ue_config, lc_config);
+std::string flexran::rib::enb_rib_info::dump_configs_to_json_string() const
+{
+  json_writer w;
+  dump_configs_to_json(w);
+  return w.str().substr(1, w.size() - 2);
 }
 
 std::string flexran::rib::enb_rib_info::format_configs_to_json(
@@ -389,13 +604,25 @@ std::string flexran::rib::enb_rib_info::format_configs_to_json(
 
 bool flexran::rib::enb_rib_info::dump_ue_spec_stats_by_rnti_to_json_string(rnti_t rnti, std::string& out) const
 {
-  auto it = ue_mac_info_.find(rnti);
-  if (it == ue_mac_info_.end()) return false;
+  const std::shared_ptr<const ue_mac_info_map> ue_mac_info = ue_mac_info_snapshot_.get();
+  auto it = ue_mac_info->find(rnti);
+  if (it == ue_mac_info->end()) return false;
 
   out = it->second->dump_stats_to_json_string();
   return true;
 }
 
+bool flexran::rib::enb_rib_info::dump_ue_history_by_rnti_to_json_string(
+    rnti_t rnti, std::string& out, std::size_t max_samples) const
+{
+  const std::shared_ptr<const ue_mac_info_map> ue_mac_info = ue_mac_info_snapshot_.get();
+  auto it = ue_mac_info->find(rnti);
+  if (it == ue_mac_info->end()) return false;
+
+  out = it->second->dump_history_to_json_string(max_samples);
+  return true;
+}
+
 bool flexran::rib::enb_rib_info::parse_rnti_imsi(const std::string& rnti_imsi_s,
     rnti_t& rnti) const
 {
@@ -415,16 +642,17 @@ bool flexran::rib::enb_rib_info::parse_rnti_imsi(const std::string& rnti_imsi_s,
   } catch (const std::invalid_argument& e) {
     return false;
   }
-  return ue_mac_info_.find(rnti) != ue_mac_info_.end();
+  const std::shared_ptr<const ue_mac_info_map> ue_mac_info = ue_mac_info_snapshot_.get();
+  return ue_mac_info->find(rnti) != ue_mac_info->end();
 }
 
 bool flexran::rib::enb_rib_info::get_rnti(uint64_t imsi, rnti_t& rnti) const
 {
-  std::lock_guard<std::mutex> lg(ue_config_mutex_);
-  for (int i = 0; i < ue_config_.ue_config_size(); i++) {
-    if (ue_config_.ue_config(i).has_imsi()
-        && imsi == ue_config_.ue_config(i).imsi()) {
-      rnti = ue_config_.ue_config(i).rnti();
+  const std::shared_ptr<const protocol::flex_ue_config_reply> ue_config = ue_config_snapshot_.get();
+  for (int i = 0; i < ue_config->ue_config_size(); i++) {
+    if (ue_config->ue_config(i).has_imsi()
+        && imsi == ue_config->ue_config(i).imsi()) {
+      rnti = ue_config->ue_config(i).rnti();
       return true;
     }
   }
@@ -433,10 +661,10 @@ bool flexran::rib::enb_rib_info::get_rnti(uint64_t imsi, rnti_t& rnti) const
 
 bool flexran::rib::enb_rib_info::has_dl_slice(uint32_t slice_id, uint16_t cell_id) const
 {
-  std::lock_guard<std::mutex> lg(eNB_config_mutex_);
-  if (!eNB_config_.cell_config(cell_id).slice_config().has_dl())
+  const std::shared_ptr<const protocol::flex_enb_config_reply> eNB_config = eNB_config_snapshot_.get();
+  if (!eNB_config->cell_config(cell_id).slice_config().has_dl())
     return false;
-  const protocol::flex_slice_dl_ul_config& s = eNB_config_.cell_config(cell_id).slice_config().dl();
+  const protocol::flex_slice_dl_ul_config& s = eNB_config->cell_config(cell_id).slice_config().dl();
   for (int i = 0; i < s.slices_size(); i++) {
     if (s.slices(i).id() == slice_id) {
       return true;
@@ -447,18 +675,18 @@ bool flexran::rib::enb_rib_info::has_dl_slice(uint32_t slice_id, uint16_t cell_i
 
 uint32_t flexran::rib::enb_rib_info::num_dl_slices(uint16_t cell_id) const
 {
-  std::lock_guard<std::mutex> lg(eNB_config_mutex_);
-  if (!eNB_config_.cell_config(cell_id).slice_config().has_dl())
+  const std::shared_ptr<const protocol::flex_enb_config_reply> eNB_config = eNB_config_snapshot_.get();
+  if (!eNB_config->cell_config(cell_id).slice_config().has_dl())
     return 0;
-  return eNB_config_.cell_config(cell_id).slice_config().dl().slices_size();
+  return eNB_config->cell_config(cell_id).slice_config().dl().slices_size();
 }
 
 bool flexran::rib::enb_rib_info::has_ul_slice(uint32_t slice_id, uint16_t cell_id) const
 {
-  std::lock_guard<std::mutex> lg(eNB_config_mutex_);
-  if (!eNB_config_.cell_config(cell_id).slice_config().has_ul())
+  const std::shared_ptr<const protocol::flex_enb_config_reply> eNB_config = eNB_config_snapshot_.get();
+  if (!eNB_config->cell_config(cell_id).slice_config().has_ul())
     return false;
-  const protocol::flex_slice_dl_ul_config& s = eNB_config_.cell_config(cell_id).slice_config().ul();
+  const protocol::flex_slice_dl_ul_config& s = eNB_config->cell_config(cell_id).slice_config().ul();
   for (int i = 0; i < s.slices_size(); i++) {
     if (s.slices(i).id() == slice_id) {
       return true;
@@ -469,31 +697,9 @@ bool flexran::rib::enb_rib_info::has_ul_slice(uint32_t slice_id, uint16_t cell_i
 
 uint32_t flexran::rib::enb_rib_info::num_ul_slices(uint16_t cell_id) const
 {
-  std::lock_guard<std::mutex> lg(eNB_config_mutex_);
-  if (!eNB_config_.cell_config(cell_id).slice_config().has_ul())
+  const std::shared_ptr<const protocol::flex_enb_config_reply> eNB_config = eNB_config_snapshot_.get();
+  if (!eNB_config->cell_config(cell_id).slice_config().has_ul())
     return 0;
-  return eNB_config_.cell_config(cell_id).slice_config().ul().slices_size();
+  return eNB_config->cell_config(cell_id).slice_config().ul().slices_size();
 }
 
-/*
- * Clear all repeated fields in protobuf message dst which are present in src
- */
-void flexran::rib::enb_rib_info::clear_repeated_if_present(
-    google::protobuf::Message *dst, const google::protobuf::Message& src)
-{
-  const google::protobuf::Descriptor *desc_src = src.GetDescriptor();
-  const google::protobuf::Reflection *refl_src = src.GetReflection();
-  const google::protobuf::Descriptor *desc_dst = dst->GetDescriptor();
-  const google::protobuf::Reflection *refl_dst = dst->GetReflection();
-  for (int i = 0; i < desc_src->field_count(); ++i) {
-    const google::protobuf::FieldDescriptor *field_src = desc_src->field(i);
-    if (!field_src) continue;
-    if (!field_src->is_repeated()) continue;
-    if (refl_src->FieldSize(src, field_src) == 0) continue;
-
-    const google::protobuf::FieldDescriptor *field_dst = desc_dst->field(i);
-    if (!field_dst) continue;
-    if (!field_dst->is_repeated()) continue;
-    refl_dst->ClearField(dst, field_dst);
-  }
-}
@@ -26,25 +26,39 @@
 #ifndef ENB_RIB_INFO_H_
 #define ENB_RIB_INFO_H_
 
+#include <array>
+#include <deque>
 #include <map>
 #include <memory>
-#include <mutex>
 #include <chrono>
 using st_clock = std::chrono::steady_clock;
 
 #include "flexran.pb.h"
+#include "rib_checkpoint.pb.h"
 #include "rib_common.h"
 #include "ue_mac_rib_info.h"
 #include "cell_mac_rib_info.h"
+#include "ue_kpi_columns.h"
+#include "rib_version.h"
+#include "snapshot.h"
 #include "agent_info.h"
 
 namespace flexran {
 
   namespace rib {
 
+    /// The state of a BS is updated by the RIB updater only, which never
+    /// blocks on readers: the configurations and UE statistics are read by
+    /// apps through the get_*() accessors. The dump_*(), parse_rnti_imsi(),
+    /// get_rnti() and slice functions instead read the copies made in
+    /// publish() and can be used from any thread, e.g. the northbound API.
     class enb_rib_info {
     public:
-      enb_rib_info(uint64_t bs_id, const std::set<std::shared_ptr<agent_info>>& agents);
+      /// versions is the version counter of the RIB this BS belongs to. If
+      /// none is given, the BS uses its own.
+      enb_rib_info(uint64_t bs_id, const std::set<std::shared_ptr<agent_info>>& agents,
+          const ue_kpi_history::config& history_config = ue_kpi_history::config(),
+          std::shared_ptr<version_counter> versions = nullptr);
       
       void update_eNB_config(const protocol::flex_enb_config_reply& enb_config_update);
       
@@ -56,9 +70,45 @@ namespace flexran {
 
       void update_liveness();
 
-      void update_subframe(const protocol::flex_sf_trigger& sf_trigger);
+      /// tick is the task manager time in ms at reception, to align it and
+      /// SFN/SF (see get_sfn_sf_at())
+      void update_subframe(const protocol::flex_sf_trigger& sf_trigger,
+                           uint64_t tick = 0);
 
-      void update_mac_stats(const protocol::flex_stats_reply& mac_stats);
+      /// tick is the task manager time in ms at reception, used for the KPI
+      /// history
+      void update_mac_stats(const protocol::flex_stats_reply& mac_stats,
+                            uint64_t tick = 0);
+
+      /// copies agents and configurations into cp
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      void fill_checkpoint(protocol::flex_bs_checkpoint& cp) const;
+
+      /// copies the entities listed in c into d, for replication: everything
+      /// if the BS has been added, otherwise only what changed (see
+      /// protocol::flex_rib_delta)
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      void fill_delta(const bs_changes& c, protocol::flex_bs_checkpoint& d) const;
+
+      /// whether the agents of this BS have the same capabilities as the ones
+      /// in cp
+      bool has_agents_of(const protocol::flex_bs_checkpoint& cp) const;
+
+      /// restores the configurations of a checkpoint. The UEs are verified
+      /// with the next UE config reply, see reconcile_UE_configs().
+      void restore(const protocol::flex_bs_checkpoint& cp);
+
+      /// after restore(), adds the UEs of ue_config_reply that are unknown and
+      /// removes the ones missing in it, saving their RNTI and IMSI (0 if
+      /// unknown) in removed. Returns false if nothing had to be done, i.e.
+      /// the BS was not restored or has been reconciled already.
+      bool reconcile_UE_configs(const protocol::flex_ue_config_reply& ue_config_reply,
+                                std::vector<rnti_t>& added,
+                                std::vector<std::pair<rnti_t, uint64_t>>& removed);
+
+      /// publishes everything that changed since the last call for readers
+      /// outside of the RIB updater. Called once per update cycle.
+      void publish();
   
       bool need_to_query();
 
@@ -66,6 +116,9 @@ namespace flexran {
 
       std::string dump_mac_stats_to_string() const;
 
+      /// writes the object {"bs_id":..,"ue_mac_stats":[..]}
+      void dump_mac_stats_to_json(json_writer& w) const;
+      /// like dump_mac_stats_to_json(), but without the enclosing braces
       std::string dump_mac_stats_to_json_string() const;
 
       static std::string format_mac_stats_to_json(uint64_t bs_id,
@@ -75,6 +128,9 @@ namespace flexran {
 
       std::string dump_configs_to_string() const;
 
+      /// writes the object {"bs_id":..,"agent_info":[..],"eNB":..,"UE":..,"LC":..}
+      void dump_configs_to_json(json_writer& w) const;
+      /// like dump_configs_to_json(), but without the enclosing braces
       std::string dump_configs_to_json_string() const;
 
       static std::string format_configs_to_json(uint64_t bs_id,
@@ -85,10 +141,18 @@ namespace flexran {
 
       bool dump_ue_spec_stats_by_rnti_to_json_string(rnti_t rnti, std::string& out) const;
 
+      bool dump_ue_history_by_rnti_to_json_string(rnti_t rnti, std::string& out,
+                                                  std::size_t max_samples) const;
+
       frame_t get_current_frame() const { return current_frame_; }
 
       subframe_t get_current_subframe() const { return current_subframe_; }
 
+      /// estimates the SFN/SF of this BS at a task manager time in ms from
+      /// the last subframe trigger. Without trigger, returns the current
+      /// SFN/SF
+      uint16_t get_sfn_sf_at(uint64_t tick) const;
+
       //! Access is only safe when the RIB is not active, i.e. within apps
       const protocol::flex_enb_config_reply& get_enb_config() const {return eNB_config_;}
 
@@ -102,6 +166,21 @@ namespace flexran {
 
       std::shared_ptr<ue_mac_rib_info> get_ue_mac_info(rnti_t rnti) const;
 
+      //! calls f(const protocol::flex_ue_config&, ue_mac_rib_info&) for every
+      //! UE, in the order of get_ue_configs().
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      template <typename F>
+      void for_each_ue(F f) const {
+        for (const protocol::flex_ue_config& c : ue_config_.ue_config()) {
+          auto it = ue_mac_info_.find(c.rnti());
+          if (it != ue_mac_info_.end())
+            f(c, *it->second);
+        }
+      }
+
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      const ue_kpi_columns& get_kpi_columns() const { return kpi_columns_; }
+
       cell_mac_rib_info& get_cell_mac_rib_info(uint16_t cell_id) {
 	return cell_mac_info_[cell_id];
       }
@@ -113,15 +192,28 @@ namespace flexran {
       bool has_ul_slice(uint32_t slice_id, uint16_t cell_id = 0) const;
       uint32_t num_ul_slices(uint16_t cell_id = 0) const;
 
-      std::set<std::shared_ptr<agent_info>> get_agents() const { return agents_; }
+      const std::set<std::shared_ptr<agent_info>>& get_agents() const { return agents_; }
       uint64_t get_id() const { return bs_id_; }
 
-    private:
+      /// version of the last change to any entity of this BS
+      uint64_t get_version() const { return version_; }
+      uint64_t get_created_version() const { return created_version_; }
+      /// fills out with all entities changed after version v. Returns false if
+      /// UE removals after v might be missing since too many UEs have been
+      /// removed in the meantime.
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      bool get_changes_since(uint64_t v, bs_changes& out) const;
 
-      void clear_repeated_if_present(google::protobuf::Message *dst,
-          const google::protobuf::Message& src);
-      
     private:
+      using ue_mac_info_map = std::map<rnti_t, std::shared_ptr<ue_mac_rib_info>>;
+
+      /// takes a new version for a change of this BS
+      uint64_t bump() { version_ = versions_->next(); return version_; }
+      void add_ue(const protocol::flex_ue_config& config);
+      void remove_ue(rnti_t rnti);
+      void set_ue_config_version(rnti_t rnti, uint64_t v);
+      void add_ue_tombstone(uint64_t v, rnti_t rnti);
+
       uint64_t bs_id_;
       std::set<std::shared_ptr<agent_info>> agents_;
 
@@ -132,21 +224,50 @@ namespace flexran {
 
       frame_t current_frame_;
       subframe_t current_subframe_;
+      bool sf_known_;
+      uint64_t sf_tick_; // tick at which the last subframe trigger was received
       
       // eNB config structure
       protocol::flex_enb_config_reply eNB_config_;
-      mutable std::mutex eNB_config_mutex_;
       // UE config structure
       protocol::flex_ue_config_reply ue_config_;
-      mutable std::mutex ue_config_mutex_;
       // LC config structure
       protocol::flex_lc_config_reply lc_config_;
-      mutable std::mutex lc_config_mutex_;
       
-      std::map<rnti_t, std::shared_ptr<ue_mac_rib_info>> ue_mac_info_;
+      ue_mac_info_map ue_mac_info_;
+      const ue_kpi_history::config history_config_;
+      // hot KPIs of all UEs in ue_mac_info_, updated alongside
+      ue_kpi_columns kpi_columns_;
 
       cell_mac_rib_info cell_mac_info_[MAX_NUM_CC];
       static constexpr const size_t RNTI_ID_LENGTH_LIMIT = 6;
+      // restored from a checkpoint, UEs not verified yet
+      bool ue_reconcile_pending_;
+
+      // versions of the last change per entity, see get_changes_since()
+      std::shared_ptr<version_counter> versions_;
+      uint64_t version_;
+      const uint64_t created_version_;
+      uint64_t enb_config_version_;
+      std::array<uint64_t, MAX_NUM_CC> cell_config_version_;
+      uint64_t lc_config_version_;
+      uint64_t cell_stats_version_;
+      // (version, RNTI) of removed UEs, oldest first. Only the last
+      // MAX_UE_TOMBSTONES are kept; the horizon is the newest one dropped.
+      std::deque<std::pair<uint64_t, rnti_t>> ue_tombstones_;
+      uint64_t ue_tombstone_horizon_;
+      static constexpr const size_t MAX_UE_TOMBSTONES = MAX_NUM_UE;
+      // versions of the last change of any UE config/of the set of UEs
+      uint64_t ue_config_version_;
+      uint64_t ue_set_version_;
+
+      // copies for readers outside of the RIB updater as of version
+      // published_version_, see publish()
+      snapshot<protocol::flex_enb_config_reply> eNB_config_snapshot_;
+      snapshot<protocol::flex_ue_config_reply> ue_config_snapshot_;
+      snapshot<protocol::flex_lc_config_reply> lc_config_snapshot_;
+      snapshot<ue_mac_info_map> ue_mac_info_snapshot_;
+      uint64_t published_version_;
     };
 
   }
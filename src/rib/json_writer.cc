@@ -0,0 +1,110 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    json_writer.cc
+ *  \brief   single-pass JSON writer into a reusable buffer
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <google/protobuf/util/json_util.h>
+
+#include "json_writer.h"
+#include "flexran_json.h"
+
+flexran::rib::json_writer& flexran::rib::json_writer::value(const char *s, std::size_t n)
+{
+  static const char hex[] = "0123456789abcdef";
+  separate();
+  buf_ += '"';
+  const char *begin = s;
+  for (const char *c = s; c != s + n; ++c) {
+    const unsigned char u = *c;
+    if (u >= 0x20 && u != '"' && u != '\\')
+      continue;
+    buf_.append(begin, c - begin);
+    begin = c + 1;
+    switch (u) {
+      case '"':  buf_ += "\\\""; break;
+      case '\\': buf_ += "\\\\"; break;
+      case '\n': buf_ += "\\n"; break;
+      case '\r': buf_ += "\\r"; break;
+      case '\t': buf_ += "\\t"; break;
+      default:
+        buf_ += "\\u00";
+        buf_ += hex[u >> 4];
+        buf_ += hex[u & 0xf];
+        break;
+    }
+  }
+  buf_.append(begin, s + n - begin);
+  buf_ += '"';
+  return *this;
+}
+
+flexran::rib::json_writer& flexran::rib::json_writer::message(
+    const google::protobuf::Message& m)
+{
+  separate();
+  /* the output is not appended to in all protobuf versions */
+  scratch_.clear();
+  google::protobuf::util::MessageToJsonString(m, &scratch_,
+      google::protobuf::util::JsonPrintOptions());
+  buf_ += scratch_;
+  return *this;
+}
+
+flexran::rib::json_writer& flexran::rib::json_writer::message(
+    const protocol::flex_enb_config_reply& m)
+{
+  separate();
+  protocol::json::write(buf_, m);
+  return *this;
+}
+
+flexran::rib::json_writer& flexran::rib::json_writer::message(
+    const protocol::flex_ue_config_reply& m)
+{
+  separate();
+  protocol::json::write(buf_, m);
+  return *this;
+}
+
+flexran::rib::json_writer& flexran::rib::json_writer::message(
+    const protocol::flex_lc_config_reply& m)
+{
+  separate();
+  protocol::json::write(buf_, m);
+  return *this;
+}
+
+flexran::rib::json_writer& flexran::rib::json_writer::message(
+    const protocol::flex_ue_stats_report& m)
+{
+  separate();
+  protocol::json::write(buf_, m);
+  return *this;
+}
+
+flexran::rib::json_writer& flexran::rib::json_writer::message(
+    const protocol::flex_cell_stats_report& m)
+{
+  separate();
+  protocol::json::write(buf_, m);
+  return *this;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    json_writer.h
+ *  \brief   single-pass JSON writer into a reusable buffer
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef JSON_WRITER_H_
+#define JSON_WRITER_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace google {
+  namespace protobuf {
+    class Message;
+  }
+}
+
+namespace protocol {
+  class flex_enb_config_reply;
+  class flex_ue_config_reply;
+  class flex_lc_config_reply;
+  class flex_ue_stats_report;
+  class flex_cell_stats_report;
+}
+
+namespace flexran {
+
+  namespace rib {
+
+    /// Writes JSON into one growable buffer, inserting the commas between
+    /// the members of objects and arrays. Dumps of the RIB are written in a
+    /// single pass into it instead of concatenating temporary strings.
+    /// clear() keeps the memory, so that a writer can be reused for the next
+    /// dump without allocating. Not thread-safe.
+    class json_writer {
+    public:
+      json_writer() : after_key_(false) {}
+
+      void clear() { buf_.clear(); first_.clear(); after_key_ = false; }
+      void reserve(std::size_t n) { buf_.reserve(n); }
+      const std::string& str() const { return buf_; }
+      std::size_t size() const { return buf_.size(); }
+      /// number of currently open objects and arrays
+      std::size_t depth() const { return first_.size(); }
+      /// moves the JSON written so far to out and continues with an empty
+      /// buffer, e.g., to send a dump in parts
+      void flush(std::string& out) { out.clear(); out.swap(buf_); }
+
+      json_writer& begin_object() { open('{'); return *this; }
+      json_writer& end_object() { close('}'); return *this; }
+      json_writer& begin_array() { open('['); return *this; }
+      json_writer& end_array() { close(']'); return *this; }
+
+      /// writes the key of the next object member. k is not escaped. Some
+      /// existing dumps have a space after the colon, which space keeps
+      json_writer& key(const char *k, bool space = false)
+      {
+        separate();
+        buf_ += '"';
+        buf_ += k;
+        buf_ += space ? "\": " : "\":";
+        after_key_ = true;
+        return *this;
+      }
+
+      json_writer& value(uint64_t v) { separate(); append_uint(v); return *this; }
+      json_writer& value(uint32_t v) { return value(static_cast<uint64_t>(v)); }
+      json_writer& value(int64_t v)
+      {
+        separate();
+        if (v < 0) {
+          buf_ += '-';
+          append_uint(~static_cast<uint64_t>(v) + 1);
+        } else {
+          append_uint(v);
+        }
+        return *this;
+      }
+      json_writer& value(int32_t v) { return value(static_cast<int64_t>(v)); }
+      json_writer& value(bool v) { separate(); buf_ += v ? "true" : "false"; return *this; }
+      json_writer& value(const std::string& s) { return value(s.data(), s.size()); }
+      json_writer& value(const char *s) { return value(s, std::strlen(s)); }
+      json_writer& value(const char *s, std::size_t n);
+      json_writer& null() { separate(); buf_ += "null"; return *this; }
+      /// writes s, which needs to be valid JSON, as the next value
+      json_writer& raw(const std::string& s) { separate(); buf_ += s; return *this; }
+      /// writes m like google::protobuf::util::MessageToJsonString()
+      json_writer& message(const google::protobuf::Message& m);
+      /// same output as above for the frequently dumped messages, but
+      /// written by the encoders generated by flpt_json_gen instead of
+      /// through the reflection API
+      json_writer& message(const protocol::flex_enb_config_reply& m);
+      json_writer& message(const protocol::flex_ue_config_reply& m);
+      json_writer& message(const protocol::flex_lc_config_reply& m);
+      json_writer& message(const protocol::flex_ue_stats_report& m);
+      json_writer& message(const protocol::flex_cell_stats_report& m);
+
+    private:
+      void separate()
+      {
+        if (after_key_) {
+          after_key_ = false;
+        } else if (!first_.empty()) {
+          if (!first_.back())
+            buf_ += ',';
+          first_.back() = false;
+        }
+      }
+      void open(char c) { separate(); buf_ += c; first_.push_back(true); }
+      void close(char c) { buf_ += c; first_.pop_back(); }
+      void append_uint(uint64_t v)
+      {
+        char d[20];
+        char *p = d + sizeof(d);
+        do {
+          *--p = '0' + v % 10;
+          v /= 10;
+        } while (v > 0);
+        buf_.append(p, d + sizeof(d) - p);
+      }
+
+      std::string buf_;
+      std::vector<bool> first_; // per open object/array: no member yet
+      bool after_key_;
+      std::string scratch_;
+    };
+
+  }
+
+}
+
+#endif /* JSON_WRITER_H_ */
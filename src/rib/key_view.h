@@ -0,0 +1,77 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    key_view.h
+ *  \brief   range over the keys of a map that does not copy them
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef KEY_VIEW_H_
+#define KEY_VIEW_H_
+
+#include <cstddef>
+#include <iterator>
+
+namespace flexran {
+
+  namespace rib {
+
+    /// Read-only, bidirectional range over the keys of a std::map. It refers
+    /// to the map and is therefore only valid as long as the map is not
+    /// modified.
+    template <typename Map>
+    class key_view {
+    public:
+      class iterator {
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename Map::key_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type&;
+
+        explicit iterator(typename Map::const_iterator it) : it_(it) {}
+        reference operator*() const { return it_->first; }
+        pointer operator->() const { return &it_->first; }
+        iterator& operator++() { ++it_; return *this; }
+        iterator operator++(int) { iterator i(*this); ++it_; return i; }
+        iterator& operator--() { --it_; return *this; }
+        iterator operator--(int) { iterator i(*this); --it_; return i; }
+        bool operator==(const iterator& o) const { return it_ == o.it_; }
+        bool operator!=(const iterator& o) const { return it_ != o.it_; }
+
+      private:
+        typename Map::const_iterator it_;
+      };
+
+      explicit key_view(const Map& m) : m_(m) {}
+      iterator begin() const { return iterator(m_.cbegin()); }
+      iterator end() const { return iterator(m_.cend()); }
+      std::size_t size() const { return m_.size(); }
+      bool empty() const { return m_.empty(); }
+
+    private:
+      const Map& m_;
+    };
+
+  }
+
+}
+
+#endif /* KEY_VIEW_H_ */
@@ -24,6 +24,7 @@
  */
 
 #include "rib.h"
+#include "flexran_log.h"
 #include <algorithm>
 #include <stdexcept>
 #include <iomanip>
@@ -97,10 +98,12 @@ bool flexran::rib::Rib::new_eNB_config_entry(uint64_t bs_id)
      * known agents */
     eNB_configs_.emplace(
         (*agents.begin())->bs_id,
-        std::make_shared<enb_rib_info>((*agents.begin())->bs_id, agents)
+        std::make_shared<enb_rib_info>((*agents.begin())->bs_id, agents,
+                                       history_config_, versions_)
     );
     pending_agents_.erase(*agents.begin());
     agent_configs_.emplace((*agents.begin())->agent_id, *agents.begin());
+    publish_bs_list();
     return true;
   }
 
@@ -115,13 +118,15 @@ bool flexran::rib::Rib::new_eNB_config_entry(uint64_t bs_id)
     if (caps.is_complete()) {
       eNB_configs_.emplace(std::make_pair(
           (*agents.begin())->bs_id,
-          std::make_shared<enb_rib_info>((*agents.begin())->bs_id, agents)
+          std::make_shared<enb_rib_info>((*agents.begin())->bs_id, agents,
+                                         history_config_, versions_)
         )
       );
       for (auto a : agents) {
         pending_agents_.erase(a);
         agent_configs_.emplace(a->agent_id, a);
       }
+      publish_bs_list();
       return true;
     }
   }
@@ -129,6 +134,15 @@ bool flexran::rib::Rib::new_eNB_config_entry(uint64_t bs_id)
   return false;
 }
 
+void flexran::rib::Rib::publish_bs_list()
+{
+  auto bs = std::make_shared<bs_list>();
+  bs->reserve(eNB_configs_.size());
+  for (const auto& e : eNB_configs_)
+    bs->push_back(e.second);
+  bs_snapshot_.publish(std::move(bs));
+}
+
 bool flexran::rib::Rib::has_eNB_config_entry(uint64_t bs_id) const
 {
   return get_bs(bs_id) != nullptr;
@@ -144,6 +158,12 @@ bool flexran::rib::Rib::remove_eNB_config_entry(int agent_id)
    * agent_configs_ and put agents that are still connected into pending */
   std::set<std::shared_ptr<agent_info>> all = eNB_configs_.find(disconnected->bs_id)->second->get_agents();
   eNB_configs_.erase(disconnected->bs_id);
+  publish_bs_list();
+  bs_tombstones_.emplace_back(versions_->next(), disconnected->bs_id);
+  if (bs_tombstones_.size() > MAX_BS_TOMBSTONES) {
+    bs_tombstone_horizon_ = bs_tombstones_.front().first;
+    bs_tombstones_.pop_front();
+  }
   for (auto b: all)
     agent_configs_.erase(b->agent_id);
   all.erase(disconnected);
@@ -152,6 +172,65 @@ bool flexran::rib::Rib::remove_eNB_config_entry(int agent_id)
   return true;
 }
 
+flexran::rib::rib_changes flexran::rib::Rib::get_changes_since(uint64_t v) const
+{
+  rib_changes c;
+  /* take the version first: changes after it might be included as well, but
+   * none before it can be missed */
+  c.version = versions_->current();
+  c.complete = v >= bs_tombstone_horizon_;
+  for (const auto& e : eNB_configs_) {
+    if (e.second->get_version() <= v) continue;
+    bs_changes bc;
+    c.complete &= e.second->get_changes_since(v, bc);
+    c.bs.push_back(std::move(bc));
+  }
+  for (auto it = bs_tombstones_.rbegin(); it != bs_tombstones_.rend() && it->first > v; ++it) {
+    if (eNB_configs_.find(it->second) != eNB_configs_.end()) continue; // re-added
+    if (std::find(c.removed_bs.begin(), c.removed_bs.end(), it->second) == c.removed_bs.end())
+      c.removed_bs.push_back(it->second);
+  }
+  return c;
+}
+
+void flexran::rib::Rib::fill_checkpoint(protocol::flex_rib_checkpoint& cp) const
+{
+  for (const auto& e : eNB_configs_)
+    e.second->fill_checkpoint(*cp.add_bs());
+}
+
+void flexran::rib::Rib::preload(const protocol::flex_rib_checkpoint& cp)
+{
+  for (const protocol::flex_bs_checkpoint& bs : cp.bs())
+    preloaded_bs_[bs.bs_id()] = bs;
+}
+
+bool flexran::rib::Rib::restore_bs(uint64_t bs_id, std::vector<rnti_t>& ues)
+{
+  auto it = preloaded_bs_.find(bs_id);
+  if (it == preloaded_bs_.end()) return false;
+  const protocol::flex_bs_checkpoint cp = std::move(it->second);
+  preloaded_bs_.erase(it);
+
+  std::shared_ptr<enb_rib_info> bs = get_bs(bs_id);
+  if (!bs) return false;
+  if (!bs->has_agents_of(cp)) {
+    LOG4CXX_WARN(flog::rib, "BS " << bs_id << ": agents differ from checkpoint, "
+        << "not restoring");
+    return false;
+  }
+  bs->restore(cp);
+  for (const protocol::flex_ue_config& c : cp.ue_config().ue_config())
+    ues.push_back(c.rnti());
+  return true;
+}
+
+void flexran::rib::Rib::publish()
+{
+  for (auto& e : eNB_configs_)
+    e.second->publish();
+}
+
 std::set<uint64_t> flexran::rib::Rib::get_available_base_stations() const
 {
   std::set<uint64_t> agents;
@@ -170,6 +249,14 @@ flexran::rib::Rib::get_bs(uint64_t bs_id) const
   return it->second;
 }
 
+flexran::rib::enb_rib_info *flexran::rib::Rib::find_bs(uint64_t bs_id) const
+{
+  auto it = eNB_configs_.find(bs_id);
+  if (it == eNB_configs_.end()) return nullptr;
+
+  return it->second.get();
+}
+
 std::shared_ptr<flexran::rib::enb_rib_info>
 flexran::rib::Rib::get_bs_from_agent(int agent_id) const
 {
@@ -205,25 +292,41 @@ std::string flexran::rib::Rib::dump_all_mac_stats_to_string() const {
   return str;
 }
 
-std::string flexran::rib::Rib::dump_all_mac_stats_to_json_string() const
+void flexran::rib::Rib::dump_all_mac_stats_to_json(json_writer& w) const
 {
-  std::vector<std::string> mac_stats;
-  mac_stats.reserve(eNB_configs_.size());
-  std::transform(eNB_configs_.begin(), eNB_configs_.end(), std::back_inserter(mac_stats),
-      [] (const std::pair<int, std::shared_ptr<enb_rib_info>>& enb_config)
-      { return enb_config.second->dump_mac_stats_to_json_string(); }
-  );
-
-  return format_mac_stats_to_json(mac_stats);
+  w.begin_array();
+  for (const auto& enb_config : eNB_configs_)
+    enb_config.second->dump_mac_stats_to_json(w);
+  w.end_array();
 }
 
-bool flexran::rib::Rib::dump_mac_stats_by_bs_id_to_json_string(uint64_t bs_id,
-    std::string& out) const
+bool flexran::rib::Rib::dump_mac_stats_by_bs_id_to_json(uint64_t bs_id,
+    json_writer& w) const
 {
   auto it = eNB_configs_.find(bs_id);
   if (it == eNB_configs_.end()) return false;
 
-  out = format_mac_stats_to_json(std::vector<std::string>{it->second->dump_mac_stats_to_json_string()});
+  w.begin_array();
+  it->second->dump_mac_stats_to_json(w);
+  w.end_array();
+  return true;
+}
+
+std::string flexran::rib::Rib::dump_all_mac_stats_to_json_string() const
+{
+  json_writer w;
+  dump_all_mac_stats_to_json(w);
+  std::string s;
+  w.flush(s);
+  return s;
+}
+
+bool flexran::rib::Rib::dump_mac_stats_by_bs_id_to_json_string(uint64_t bs_id,
+    std::string& out) const
+{
+  json_writer w;
+  if (!dump_mac_stats_by_bs_id_to_json(bs_id, w)) return false;
+  w.flush(out);
   return true;
 }
 
@@ -259,28 +362,68 @@ std::string flexran::rib::Rib::dump_all_enb_configurations_to_string() const {
   return str;
 }
 
-std::string flexran::rib::Rib::dump_all_enb_configurations_to_json_string() const
+void flexran::rib::Rib::dump_all_enb_configurations_to_json(json_writer& w) const
 {
-  std::vector<std::string> enb_configurations;
-  enb_configurations.reserve(eNB_configs_.size());
-  std::transform(eNB_configs_.begin(), eNB_configs_.end(), std::back_inserter(enb_configurations),
-      [] (const std::pair<int, std::shared_ptr<enb_rib_info>>& enb_config)
-      { return enb_config.second->dump_configs_to_json_string(); }
-  );
-
-  return format_enb_configurations_to_json(enb_configurations);
+  w.begin_array();
+  for (const auto& enb_config : eNB_configs_)
+    enb_config.second->dump_configs_to_json(w);
+  w.end_array();
 }
 
-bool flexran::rib::Rib::dump_enb_configurations_by_bs_id_to_json_string(
-    uint64_t bs_id, std::string& out) const
+bool flexran::rib::Rib::dump_enb_configurations_by_bs_id_to_json(uint64_t bs_id,
+    json_writer& w) const
 {
   auto it = eNB_configs_.find(bs_id);
   if (it == eNB_configs_.end()) return false;
 
-  out = format_enb_configurations_to_json(std::vector<std::string>{it->second->dump_configs_to_json_string()});
+  w.begin_array();
+  it->second->dump_configs_to_json(w);
+  w.end_array();
   return true;
 }
 
+std::string flexran::rib::Rib::dump_all_enb_configurations_to_json_string() const
+{
+  json_writer w;
+  dump_all_enb_configurations_to_json(w);
+  std::string s;
+  w.flush(s);
+  return s;
+}
+
+bool flexran::rib::Rib::dump_enb_configurations_by_bs_id_to_json_string(
+    uint64_t bs_id, std::string& out) const
+{
+  json_writer w;
+  if (!dump_enb_configurations_by_bs_id_to_json(bs_id, w)) return false;
+  w.flush(out);
+  return true;
+}
+
+void flexran::rib::Rib::dump_json_by_bs(json_writer& w, bool configs,
+    bool stats, const std::function<void(json_writer&)>& part) const
+{
+  /* the BSs stay valid even if they are removed in the meantime */
+  const auto bs = bs_snapshot_.get();
+
+  if (configs) {
+    w.key("eNB_config").begin_array();
+    for (const auto& b : *bs) {
+      b->dump_configs_to_json(w);
+      part(w);
+    }
+    w.end_array();
+  }
+  if (stats) {
+    w.key("mac_stats").begin_array();
+    for (const auto& b : *bs) {
+      b->dump_mac_stats_to_json(w);
+      part(w);
+    }
+    w.end_array();
+  }
+}
+
 std::string flexran::rib::Rib::format_enb_configurations_to_json(
     const std::vector<std::string>& enb_configurations_json)
 {
@@ -331,6 +474,14 @@ bool flexran::rib::Rib::dump_ue_by_rnti_by_bs_id_to_json_string(
   return it->second->dump_ue_spec_stats_by_rnti_to_json_string(rnti, out);
 }
 
+bool flexran::rib::Rib::dump_ue_history_by_rnti_by_bs_id_to_json_string(
+    rnti_t rnti, std::string& out, uint64_t bs_id, std::size_t max_samples) const
+{
+  auto it = eNB_configs_.find(bs_id);
+  if (it == eNB_configs_.end()) return false;
+  return it->second->dump_ue_history_by_rnti_to_json_string(rnti, out, max_samples);
+}
+
 uint64_t flexran::rib::Rib::get_bs_id(int agent_id) const
 {
   auto it = agent_configs_.find(agent_id);
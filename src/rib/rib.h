@@ -26,11 +26,16 @@
 #ifndef RIB_H_
 #define RIB_H_
 
+#include <deque>
+#include <functional>
 #include <map>
 #include <set>
 
 #include "enb_rib_info.h"
+#include "rib_version.h"
 #include "agent_info.h"
+#include "key_view.h"
+#include "snapshot.h"
 #include <memory>
 #include <set>
 #include <chrono>
@@ -41,6 +46,11 @@ namespace flexran {
 
     class Rib {
     public:
+      /// history_config applies to the KPI history of every UE of every BS
+      explicit Rib(const ue_kpi_history::config& history_config = ue_kpi_history::config())
+        : history_config_(history_config),
+          versions_(std::make_shared<version_counter>()),
+          bs_tombstone_horizon_(0) {}
 
       // Pending agent methods
       bool add_pending_agent(std::shared_ptr<agent_info> ai);
@@ -54,30 +64,101 @@ namespace flexran {
       bool has_eNB_config_entry(uint64_t bs_id) const;
       bool remove_eNB_config_entry(int agent_id);
       
+      /// copy of all BS IDs, see also get_bs_ids()
       std::set<uint64_t> get_available_base_stations() const;
-      std::map<int, std::shared_ptr<agent_info>> get_agents() const { return agent_configs_; }
-      
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      const std::map<int, std::shared_ptr<agent_info>>& get_agents() const { return agent_configs_; }
+
+      //! IDs of all BSs, iterated in place.
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      key_view<std::map<uint64_t, std::shared_ptr<enb_rib_info>>> get_bs_ids() const {
+        return key_view<std::map<uint64_t, std::shared_ptr<enb_rib_info>>>(eNB_configs_);
+      }
+
+      //! calls f(enb_rib_info&) for every BS.
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      template <typename F>
+      void for_each_bs(F f) const {
+        for (const auto& e : eNB_configs_)
+          f(*e.second);
+      }
+
+      //! calls f(agent_info&) for every connected (not pending) agent.
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      template <typename F>
+      void for_each_agent(F f) const {
+        for (const auto& a : agent_configs_)
+          f(*a.second);
+      }
+
       std::shared_ptr<enb_rib_info> get_bs(uint64_t bs_id) const;
+      //! like get_bs(), without taking a reference. Returns nullptr if there
+      //! is no such BS.
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      enb_rib_info *find_bs(uint64_t bs_id) const;
       std::shared_ptr<enb_rib_info> get_bs_from_agent(int agent_id) const;
       std::shared_ptr<agent_info>   get_agent(int agent_id) const;
+
+      /// version of the last change anywhere in the RIB
+      uint64_t get_version() const { return versions_->current(); }
+      /// returns all entities changed after version v, see rib_changes
+      rib_changes get_changes_since(uint64_t v) const;
+
+      /// copies all BSs into cp, see enb_rib_info::fill_checkpoint()
+      //! Access is only safe when the RIB is not active, i.e. within apps
+      void fill_checkpoint(protocol::flex_rib_checkpoint& cp) const;
+      /// keeps the BSs of cp to restore them when they reconnect
+      void preload(const protocol::flex_rib_checkpoint& cp);
+      std::size_t get_num_preloaded() const { return preloaded_bs_.size(); }
+      /// restores the newly created BS bs_id from the preloaded checkpoint, if
+      /// any, and returns its UEs. The checkpoint is dropped in any case, and
+      /// not used if the agents of the BS changed.
+      bool restore_bs(uint64_t bs_id, std::vector<rnti_t>& ues);
+
+      /// publishes the changes of all BS for readers outside of the RIB
+      /// updater, see enb_rib_info::publish()
+      void publish();
       
       void dump_mac_stats() const;
       
       void dump_enb_configurations() const;
 
       std::string dump_all_mac_stats_to_string() const;
+      /// writes the array of the MAC stats of all BSs, see
+      /// enb_rib_info::dump_mac_stats_to_json()
+      void dump_all_mac_stats_to_json(json_writer& w) const;
+      /// like dump_all_mac_stats_to_json() for BS bs_id only, writes nothing
+      /// and returns false if there is no such BS
+      bool dump_mac_stats_by_bs_id_to_json(uint64_t bs_id, json_writer& w) const;
       std::string dump_all_mac_stats_to_json_string() const;
       bool dump_mac_stats_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const;
 
       static std::string format_mac_stats_to_json(const std::vector<std::string>& mac_stats_json);
       
       std::string dump_all_enb_configurations_to_string() const;
+      /// writes the array of the configurations of all BSs, see
+      /// enb_rib_info::dump_configs_to_json()
+      void dump_all_enb_configurations_to_json(json_writer& w) const;
+      bool dump_enb_configurations_by_bs_id_to_json(uint64_t bs_id, json_writer& w) const;
       std::string dump_all_enb_configurations_to_json_string() const;
       bool dump_enb_configurations_by_bs_id_to_json_string(uint64_t bs_id, std::string& out) const;
 
       static std::string format_enb_configurations_to_json(const std::vector<std::string>& enb_configurations_json);
 
+      /// writes the members "eNB_config" (if configs) and "mac_stats" (if
+      /// stats) into the open object of w, like
+      /// dump_all_enb_configurations_to_json() and
+      /// dump_all_mac_stats_to_json(), but from the last published snapshot
+      /// of the BS list, so it may be called outside of the RIB updater, and
+      /// calling part(w) after every BS, e.g., to send out what has been
+      /// written so far using json_writer::flush()
+      void dump_json_by_bs(json_writer& w, bool configs, bool stats,
+          const std::function<void(json_writer&)>& part) const;
+
       bool dump_ue_by_rnti_by_bs_id_to_json_string(rnti_t rnti, std::string& out, uint64_t bs_id) const;
+      bool dump_ue_history_by_rnti_by_bs_id_to_json_string(rnti_t rnti, std::string& out,
+          uint64_t bs_id, std::size_t max_samples) const;
+      const ue_kpi_history::config& get_history_config() const { return history_config_; }
 
       uint64_t get_bs_id(int agent_id) const;
       uint64_t parse_enb_agent_id(const std::string& enb_agent_id_s) const;
@@ -88,9 +169,23 @@ namespace flexran {
       static std::string format_date_time(std::chrono::time_point<std::chrono::system_clock> t);
       
     private:
+      typedef std::vector<std::shared_ptr<enb_rib_info>> bs_list;
+      // publishes the BSs of eNB_configs_ after adding or removing one
+      void publish_bs_list();
+
       std::map<uint64_t, std::shared_ptr<enb_rib_info>> eNB_configs_;
+      snapshot<bs_list> bs_snapshot_;
       std::map<int, std::shared_ptr<agent_info>> agent_configs_;
       std::set<std::shared_ptr<agent_info>> pending_agents_;
+      const ue_kpi_history::config history_config_;
+      std::shared_ptr<version_counter> versions_;
+      // (version, BS ID) of removed BSs, oldest first, see enb_rib_info for
+      // the UE equivalent
+      std::deque<std::pair<uint64_t, uint64_t>> bs_tombstones_;
+      uint64_t bs_tombstone_horizon_;
+      static constexpr const size_t MAX_BS_TOMBSTONES = 256;
+      // BSs of a checkpoint that did not reconnect yet
+      std::map<uint64_t, protocol::flex_bs_checkpoint> preloaded_bs_;
 
       static constexpr const size_t AGENT_ID_LENGTH_LIMIT = 4;
       
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    rib_checkpoint.cc
+ *  \brief   memory-mapped file holding the last RIB checkpoint
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rib_checkpoint.h"
+
+constexpr const char *flexran::rib::checkpoint_file::MAGIC;
+constexpr const uint32_t flexran::rib::checkpoint_file::FORMAT;
+constexpr const std::size_t flexran::rib::checkpoint_file::HEADER_SIZE;
+constexpr const std::size_t flexran::rib::checkpoint_file::INITIAL_SLOT_SIZE;
+
+flexran::rib::checkpoint_file::checkpoint_file()
+  : fd_(-1),
+    base_(nullptr),
+    mapped_(0)
+{
+  static_assert(sizeof(header) <= HEADER_SIZE, "checkpoint header too large");
+}
+
+flexran::rib::checkpoint_file::~checkpoint_file()
+{
+  if (base_) {
+    msync(base_, mapped_, MS_SYNC);
+    munmap(base_, mapped_);
+  }
+  if (fd_ >= 0) close(fd_);
+}
+
+bool flexran::rib::checkpoint_file::open(const std::string& path, std::string& error)
+{
+  if (is_open()) {
+    error = "checkpoint file already open";
+    return false;
+  }
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    error = "cannot open " + path + ": " + strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) < 0) {
+    error = "cannot stat " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  if (st.st_size == 0) { // new file
+    const std::size_t size = HEADER_SIZE + 2 * INITIAL_SLOT_SIZE;
+    if (ftruncate(fd_, size) < 0) {
+      error = "cannot resize " + path + ": " + strerror(errno);
+      return false;
+    }
+    if (!map(size, error)) return false;
+    header *h = hdr();
+    memcpy(h->magic, MAGIC, sizeof(h->magic));
+    h->format = FORMAT;
+    h->active = 0;
+    h->slot_size = INITIAL_SLOT_SIZE;
+    memset(h->slot, 0, sizeof(h->slot));
+    return true;
+  }
+
+  if (static_cast<std::size_t>(st.st_size) < HEADER_SIZE) {
+    error = path + " is not a checkpoint file";
+    return false;
+  }
+  if (!map(st.st_size, error)) return false;
+  const header *h = hdr();
+  if (memcmp(h->magic, MAGIC, sizeof(h->magic)) != 0
+      || h->format != FORMAT
+      || HEADER_SIZE + 2 * h->slot_size > mapped_) {
+    error = path + " is not a checkpoint file of format " + std::to_string(FORMAT);
+    munmap(base_, mapped_);
+    base_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool flexran::rib::checkpoint_file::load(protocol::flex_rib_checkpoint& cp) const
+{
+  if (!is_open()) return false;
+  const int a = hdr()->active & 1;
+  for (int i : {a, 1 - a}) {
+    if (!valid_slot(i)) continue;
+    if (cp.ParseFromArray(slot_data(i), hdr()->slot[i].len))
+      return true;
+  }
+  return false;
+}
+
+bool flexran::rib::checkpoint_file::store(const protocol::flex_rib_checkpoint& cp,
+    std::string& error)
+{
+  if (!is_open()) {
+    error = "checkpoint file not open";
+    return false;
+  }
+  const std::size_t len = cp.ByteSizeLong();
+  if (len > hdr()->slot_size) {
+    std::size_t slot_size = hdr()->slot_size;
+    while (slot_size < 2 * len) slot_size *= 2;
+    if (!grow(slot_size, error)) return false;
+  }
+
+  header *h = hdr();
+  const int target = 1 - (h->active & 1);
+  uint8_t *dst = slot_data(target);
+  cp.SerializeWithCachedSizesToArray(dst);
+  h->slot[target].seq = std::max(h->slot[0].seq, h->slot[1].seq) + 1;
+  h->slot[target].len = len;
+  h->slot[target].hash = hash(dst, len);
+  std::atomic_thread_fence(std::memory_order_release);
+  h->active = target;
+  msync(base_, mapped_, MS_ASYNC);
+  return true;
+}
+
+uint64_t flexran::rib::checkpoint_file::get_sequence() const
+{
+  if (!is_open()) return 0;
+  return std::max(hdr()->slot[0].seq, hdr()->slot[1].seq);
+}
+
+bool flexran::rib::checkpoint_file::valid_slot(int i) const
+{
+  const slot_info& s = hdr()->slot[i];
+  return s.seq > 0 && s.len <= hdr()->slot_size
+      && hash(slot_data(i), s.len) == s.hash;
+}
+
+bool flexran::rib::checkpoint_file::map(std::size_t size, std::string& error)
+{
+  void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (p == MAP_FAILED) {
+    error = std::string("cannot map checkpoint file: ") + strerror(errno);
+    return false;
+  }
+  base_ = static_cast<uint8_t *>(p);
+  mapped_ = size;
+  return true;
+}
+
+bool flexran::rib::checkpoint_file::grow(std::size_t slot_size, std::string& error)
+{
+  const std::size_t old_slot_size = hdr()->slot_size;
+  const std::size_t size = HEADER_SIZE + 2 * slot_size;
+  if (ftruncate(fd_, size) < 0) {
+    error = std::string("cannot resize checkpoint file: ") + strerror(errno);
+    return false;
+  }
+  munmap(base_, mapped_);
+  base_ = nullptr;
+  if (!map(size, error)) return false;
+  /* slot 0 stays in place, slot 1 moves behind the larger slot 0. The old
+   * location is not overwritten before the header points to the new one */
+  memmove(base_ + HEADER_SIZE + slot_size, base_ + HEADER_SIZE + old_slot_size,
+          hdr()->slot[1].len <= old_slot_size ? hdr()->slot[1].len : 0);
+  std::atomic_thread_fence(std::memory_order_release);
+  hdr()->slot_size = slot_size;
+  return true;
+}
+
+uint64_t flexran::rib::checkpoint_file::hash(const uint8_t *data, std::size_t len)
+{
+  /* FNV-1a */
+  uint64_t h = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < len; ++i) {
+    h ^= data[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    rib_checkpoint.h
+ *  \brief   memory-mapped file holding the last RIB checkpoint
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef RIB_CHECKPOINT_H_
+#define RIB_CHECKPOINT_H_
+
+#include <cstdint>
+#include <string>
+
+#include "rib_checkpoint.pb.h"
+
+namespace flexran {
+
+  namespace rib {
+
+    /// Memory-mapped file with two slots for a serialized
+    /// protocol::flex_rib_checkpoint. store() serializes directly into the
+    /// slot not in use and only then switches the active slot in the header,
+    /// so that a controller killed while storing still finds the previous
+    /// checkpoint. Since the file is mapped shared, a checkpoint survives a
+    /// restart of the controller without any write() or fsync(); the kernel
+    /// writes it back in the background. store() still faults in file pages
+    /// and remaps the file when growing it, so it should not be called on
+    /// the RT path (see app::management::checkpoint_manager).
+    class checkpoint_file {
+    public:
+      checkpoint_file();
+      ~checkpoint_file();
+      checkpoint_file(const checkpoint_file&) = delete;
+      checkpoint_file& operator=(const checkpoint_file&) = delete;
+
+      /// opens (and creates if necessary) the file at path
+      bool open(const std::string& path, std::string& error);
+      bool is_open() const { return base_ != nullptr; }
+
+      /// reads the last stored checkpoint, false if there is none or if it
+      /// is corrupted
+      bool load(protocol::flex_rib_checkpoint& cp) const;
+
+      /// stores cp as the new checkpoint, growing the file if necessary
+      bool store(const protocol::flex_rib_checkpoint& cp, std::string& error);
+
+      /// number of checkpoints stored in this file, over all runs
+      uint64_t get_sequence() const;
+
+      std::size_t get_file_size() const { return mapped_; }
+
+    private:
+      struct slot_info {
+        uint64_t seq;
+        uint64_t len;
+        uint64_t hash;
+      };
+      struct header {
+        char magic[8];
+        uint32_t format;
+        uint32_t active;
+        uint64_t slot_size;
+        slot_info slot[2];
+      };
+
+      header *hdr() const { return reinterpret_cast<header *>(base_); }
+      uint8_t *slot_data(int i) const { return base_ + HEADER_SIZE + i * hdr()->slot_size; }
+      bool valid_slot(int i) const;
+      bool map(std::size_t size, std::string& error);
+      bool grow(std::size_t slot_size, std::string& error);
+      static uint64_t hash(const uint8_t *data, std::size_t len);
+
+      int fd_;
+      uint8_t *base_;
+      std::size_t mapped_;
+
+      static constexpr const char *MAGIC = "FLXRCKPT";
+      static constexpr const uint32_t FORMAT = 1;
+      static constexpr const std::size_t HEADER_SIZE = 4096;
+      static constexpr const std::size_t INITIAL_SLOT_SIZE = 1 << 20;
+    };
+
+  }
+
+}
+
+#endif /* RIB_CHECKPOINT_H_ */
@@ -0,0 +1,355 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    rib_replication.cc
+ *  \brief   streaming of RIB changes to a hot-standby controller
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "rib_replication.h"
+#include "flexran_log.h"
+
+constexpr const std::size_t flexran::rib::replication_stream::HEADER_LENGTH;
+constexpr const std::size_t flexran::rib::replication_stream::MAX_PENDING;
+constexpr const std::size_t flexran::rib::replication_stream::MAX_FRAME;
+
+bool flexran::rib::rib_replica::apply(const protocol::flex_rib_delta& d)
+{
+  if (d.full()) {
+    bs_.clear();
+    synced_ = true;
+  } else if (!synced_ || d.seq() != seq_ + 1) {
+    synced_ = false;
+    return false;
+  }
+  seq_ = d.seq();
+
+  for (uint64_t bs_id : d.removed_bs())
+    bs_.erase(bs_id);
+  for (const protocol::flex_bs_checkpoint& b : d.bs()) {
+    if (b.agents_size() > 0) { // new BS
+      bs_[b.bs_id()] = b;
+      continue;
+    }
+    auto it = bs_.find(b.bs_id());
+    if (it == bs_.end()) {
+      synced_ = false;
+      return false;
+    }
+    merge(it->second, b);
+  }
+  return true;
+}
+
+const protocol::flex_bs_checkpoint *flexran::rib::rib_replica::get_bs(uint64_t bs_id) const
+{
+  auto it = bs_.find(bs_id);
+  return it != bs_.end() ? &it->second : nullptr;
+}
+
+void flexran::rib::rib_replica::fill_checkpoint(protocol::flex_rib_checkpoint& cp) const
+{
+  cp.set_timestamp_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+  for (const auto& b : bs_)
+    cp.add_bs()->CopyFrom(b.second);
+}
+
+void flexran::rib::rib_replica::merge(protocol::flex_bs_checkpoint& dst,
+    const protocol::flex_bs_checkpoint& src)
+{
+  if (src.has_enb_config())
+    dst.mutable_enb_config()->CopyFrom(src.enb_config());
+
+  /* removals first: a UE might have been removed and re-added since */
+  auto *ues = dst.mutable_ue_config()->mutable_ue_config();
+  for (uint32_t rnti : src.removed_ues()) {
+    for (int i = 0; i < ues->size(); ++i) {
+      if (ues->Get(i).rnti() != rnti) continue;
+      ues->DeleteSubrange(i, 1);
+      break;
+    }
+  }
+  for (const protocol::flex_ue_config& c : src.ue_config().ue_config()) {
+    auto it = std::find_if(ues->begin(), ues->end(),
+        [&c](const protocol::flex_ue_config& u) { return u.rnti() == c.rnti(); });
+    if (it != ues->end())
+      it->CopyFrom(c);
+    else
+      ues->Add()->CopyFrom(c);
+  }
+
+  if (src.has_lc_config())
+    dst.mutable_lc_config()->CopyFrom(src.lc_config());
+  if (src.has_stats_requests())
+    dst.mutable_stats_requests()->CopyFrom(src.stats_requests());
+}
+
+flexran::rib::replication_stream::replication_stream(int fd)
+  : fd_(fd),
+    out_pos_(0),
+    bytes_received_(0)
+{
+}
+
+flexran::rib::replication_stream::~replication_stream()
+{
+  close(fd_);
+}
+
+std::unique_ptr<flexran::rib::replication_stream>
+flexran::rib::replication_stream::connect(const std::string& path, std::string& error)
+{
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    error = "socket path " + path + " too long";
+    return nullptr;
+  }
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    error = std::string("cannot create socket: ") + strerror(errno);
+    return nullptr;
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+      || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+    error = "cannot connect to " + path + ": " + strerror(errno);
+    close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<replication_stream>(new replication_stream(fd));
+}
+
+bool flexran::rib::replication_stream::send(const protocol::flex_rib_delta& d)
+{
+  const std::size_t len = d.ByteSizeLong();
+  if (get_pending() + HEADER_LENGTH + len > MAX_PENDING)
+    return false;
+  if (out_pos_ == out_.size()) {
+    out_.clear();
+    out_pos_ = 0;
+  }
+  const std::size_t pos = out_.size();
+  out_.resize(pos + HEADER_LENGTH + len);
+  uint8_t *p = reinterpret_cast<uint8_t *>(&out_[pos]);
+  p[0] = (len >> 24) & 0xff;
+  p[1] = (len >> 16) & 0xff;
+  p[2] = (len >> 8) & 0xff;
+  p[3] = len & 0xff;
+  d.SerializeWithCachedSizesToArray(p + HEADER_LENGTH);
+  return true;
+}
+
+bool flexran::rib::replication_stream::flush()
+{
+  while (get_pending() > 0) {
+    const ssize_t n = ::send(fd_, out_.data() + out_pos_, get_pending(), MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    out_pos_ += n;
+  }
+  return true;
+}
+
+flexran::rib::replication_stream::receive_result
+flexran::rib::replication_stream::receive(std::vector<protocol::flex_rib_delta>& ds,
+    int timeout_ms)
+{
+  pollfd pfd = { fd_, POLLIN, 0 };
+  const int rc = poll(&pfd, 1, timeout_ms);
+  if (rc < 0) return errno == EINTR ? receive_result::ok : receive_result::error;
+  if (rc == 0) return receive_result::ok;
+
+  receive_result result = receive_result::ok;
+  char buf[64 * 1024];
+  for (;;) {
+    const ssize_t n = read(fd_, buf, sizeof(buf));
+    if (n > 0) {
+      in_.append(buf, n);
+      bytes_received_ += n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n == 0)
+      result = receive_result::closed;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK)
+      result = receive_result::error;
+    break;
+  }
+
+  std::size_t pos = 0;
+  while (in_.size() - pos >= HEADER_LENGTH) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(in_.data() + pos);
+    const std::size_t len = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    if (len > MAX_FRAME) return receive_result::error;
+    if (in_.size() - pos - HEADER_LENGTH < len) break;
+    ds.emplace_back();
+    if (!ds.back().ParseFromArray(p + HEADER_LENGTH, len)) {
+      ds.pop_back();
+      return receive_result::error;
+    }
+    pos += HEADER_LENGTH + len;
+  }
+  in_.erase(0, pos);
+  /* a delta cut off by the end of the stream is lost */
+  if (result == receive_result::closed && !in_.empty())
+    return receive_result::error;
+  return result;
+}
+
+flexran::rib::replication_listener::~replication_listener()
+{
+  if (fd_ < 0) return;
+  close(fd_);
+  unlink(path_.c_str());
+}
+
+bool flexran::rib::replication_listener::listen(const std::string& path, std::string& error)
+{
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    error = "socket path " + path + " too long";
+    return false;
+  }
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    error = std::string("cannot create socket: ") + strerror(errno);
+    return false;
+  }
+  unlink(path.c_str());
+  if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+      || ::listen(fd_, 4) < 0) {
+    error = "cannot listen on " + path + ": " + strerror(errno);
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  path_ = path;
+  return true;
+}
+
+std::unique_ptr<flexran::rib::replication_stream> flexran::rib::replication_listener::accept()
+{
+  const int fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd < 0) return nullptr;
+  return std::unique_ptr<replication_stream>(new replication_stream(fd));
+}
+
+bool flexran::rib::run_standby(const std::string& path, rib_replica& replica,
+    const std::atomic_bool& exit, uint64_t log_period_ms)
+{
+  using clock = std::chrono::steady_clock;
+  bool waiting_logged = false;
+  while (!exit) {
+    std::string error;
+    std::unique_ptr<replication_stream> s = replication_stream::connect(path, error);
+    if (!s) {
+      if (replica.get_seq() > 0) {
+        /* it went away before resending its full state, so the replica
+         * misses changes or is partially merged */
+        LOG4CXX_WARN(flog::rib, "Active controller at " << path << " is gone "
+            << "while replica " << replica.get_seq() << " is out of sync, "
+            << "not taking it over");
+        return false;
+      }
+      if (!waiting_logged)
+        LOG4CXX_INFO(flog::rib, "Waiting for the active controller: " << error);
+      waiting_logged = true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      continue;
+    }
+    LOG4CXX_INFO(flog::rib, "Replicating the RIB of the active controller at " << path);
+
+    std::vector<protocol::flex_rib_delta> ds;
+    clock::time_point last_log = clock::now();
+    uint64_t last_bytes = 0;
+    uint64_t n = 0;
+    uint64_t lag_sum = 0;
+    uint64_t lag_max = 0;
+    bool in_sync = true;
+    replication_stream::receive_result r = replication_stream::receive_result::ok;
+    while (in_sync && r == replication_stream::receive_result::ok && !exit) {
+      /* the last deltas might come with the end of the stream */
+      r = s->receive(ds, 100);
+      const uint64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count();
+      for (const protocol::flex_rib_delta& d : ds) {
+        const uint64_t lag = now_us > d.timestamp_us() ? now_us - d.timestamp_us() : 0;
+        lag_sum += lag;
+        lag_max = std::max(lag_max, lag);
+        n++;
+        if (!replica.apply(d)) {
+          LOG4CXX_WARN(flog::rib, "Replication delta " << d.seq() << " does not "
+              << "follow " << replica.get_seq() << ", resynchronizing");
+          in_sync = false;
+          break;
+        }
+      }
+      ds.clear();
+
+      const clock::time_point now = clock::now();
+      const uint64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_log).count();
+      if (ms >= log_period_ms && n > 0) {
+        LOG4CXX_INFO(flog::rib, "Replication: " << n << " deltas, "
+            << (s->get_bytes_received() - last_bytes) * 1000 / ms << " B/s, lag avg "
+            << lag_sum / n << "us max " << lag_max << "us, replica "
+            << replica.get_seq() << " with " << replica.get_num_bs() << " BS(s)");
+        last_log = now;
+        last_bytes = s->get_bytes_received();
+        n = lag_sum = lag_max = 0;
+      }
+    }
+    if (exit)
+      break;
+    if (r == replication_stream::receive_result::error) {
+      /* the active controller might still be there, so reconnect for its
+       * full state. If it is gone, the replica misses deltas */
+      LOG4CXX_WARN(flog::rib, "Replication stream from " << path << " broke at "
+          << replica.get_seq() << ", resynchronizing");
+      replica.desync();
+      continue;
+    }
+    if (r == replication_stream::receive_result::closed && replica.is_synced()) {
+      LOG4CXX_WARN(flog::rib, "Active controller at " << path << " is gone, taking over");
+      return true;
+    }
+  }
+  return false;
+}
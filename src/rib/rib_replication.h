@@ -0,0 +1,148 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    rib_replication.h
+ *  \brief   streaming of RIB changes to a hot-standby controller
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef RIB_REPLICATION_H_
+#define RIB_REPLICATION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rib_checkpoint.pb.h"
+
+namespace flexran {
+
+  namespace rib {
+
+    /// State of the RIB of the active controller as seen by a standby,
+    /// built from the stream of protocol::flex_rib_delta. It is kept in
+    /// checkpoint format so that it can be preloaded into the RIB when
+    /// taking over, see Rib::preload().
+    class rib_replica {
+    public:
+      rib_replica() : synced_(false), seq_(0) {}
+
+      /// applies d. Returns false if d does not follow the last delta
+      /// applied, in which case the replica is out of sync until the next
+      /// full delta.
+      bool apply(const protocol::flex_rib_delta& d);
+      bool is_synced() const { return synced_; }
+      /// marks the replica out of sync until the next full delta, e.g.,
+      /// after deltas have been lost
+      void desync() { synced_ = false; }
+      uint64_t get_seq() const { return seq_; }
+      std::size_t get_num_bs() const { return bs_.size(); }
+      const protocol::flex_bs_checkpoint *get_bs(uint64_t bs_id) const;
+
+      void fill_checkpoint(protocol::flex_rib_checkpoint& cp) const;
+
+    private:
+      static void merge(protocol::flex_bs_checkpoint& dst,
+                        const protocol::flex_bs_checkpoint& src);
+
+      bool synced_;
+      uint64_t seq_;
+      std::map<uint64_t, protocol::flex_bs_checkpoint> bs_;
+    };
+
+    /// Non-blocking stream of length-prefixed protocol::flex_rib_delta over
+    /// a unix domain socket. The length prefix is the same as for agent
+    /// messages (4 bytes, big endian).
+    class replication_stream {
+    public:
+      enum class receive_result {
+        ok,     // possibly without new deltas
+        closed, // the peer closed the stream
+        error   // the stream broke or carried garbage, deltas might be lost
+      };
+
+      /// takes ownership of fd, which has to be non-blocking
+      explicit replication_stream(int fd);
+      ~replication_stream();
+      replication_stream(const replication_stream&) = delete;
+      replication_stream& operator=(const replication_stream&) = delete;
+
+      /// connects to the active controller listening at path
+      static std::unique_ptr<replication_stream> connect(const std::string& path,
+                                                         std::string& error);
+
+      /// queues d for sending. Returns false if the peer does not keep up,
+      /// i.e., more than MAX_PENDING bytes would be queued.
+      bool send(const protocol::flex_rib_delta& d);
+      /// writes as much queued data as possible, false if the peer is gone
+      bool flush();
+      std::size_t get_pending() const { return out_.size() - out_pos_; }
+
+      /// waits up to timeout_ms for data and appends all complete deltas to
+      /// ds, also those before the end of the stream or an error
+      receive_result receive(std::vector<protocol::flex_rib_delta>& ds, int timeout_ms);
+      /// bytes received so far
+      uint64_t get_bytes_received() const { return bytes_received_; }
+
+    private:
+      int fd_;
+      std::string out_;
+      std::size_t out_pos_;
+      std::string in_;
+      uint64_t bytes_received_;
+
+      static constexpr const std::size_t HEADER_LENGTH = 4;
+      static constexpr const std::size_t MAX_PENDING = 64 << 20;
+      static constexpr const std::size_t MAX_FRAME = 256 << 20;
+    };
+
+    /// Listening unix domain socket of the active controller
+    class replication_listener {
+    public:
+      replication_listener() : fd_(-1) {}
+      ~replication_listener();
+      replication_listener(const replication_listener&) = delete;
+      replication_listener& operator=(const replication_listener&) = delete;
+
+      /// listens at path, replacing a stale socket of a previous controller
+      bool listen(const std::string& path, std::string& error);
+      /// returns a newly connected standby, or nullptr if there is none
+      std::unique_ptr<replication_stream> accept();
+
+    private:
+      int fd_;
+      std::string path_;
+    };
+
+    /// Runs a standby controller: keeps replica in sync with the active
+    /// controller listening at path until the latter is gone (or exit is
+    /// set). Returns true if replica is synced and can be taken over, false
+    /// if the active controller went away while replica was out of sync.
+    /// Logs the replication lag and throughput every log_period_ms.
+    bool run_standby(const std::string& path, rib_replica& replica,
+                     const std::atomic_bool& exit, uint64_t log_period_ms = 5000);
+
+  }
+
+}
+
+#endif /* RIB_REPLICATION_H_ */
@@ -22,6 +22,7 @@
  *  \email   x.foukas@sms.ed.ac.uk
  */
 
+#include <algorithm>
 #include <iostream>
 
 #include "rib_updater.h"
@@ -33,50 +34,100 @@
 
 #include "flexran_log.h"
 
-#ifdef PROFILE
-#include <iostream>
-extern std::atomic_bool g_doprof;
-#endif
+namespace {
+  uint64_t imsi_of(const protocol::flex_ue_config_reply& c, flexran::rib::rnti_t rnti)
+  {
+    for (const protocol::flex_ue_config& ue : c.ue_config())
+      if (ue.rnti() == rnti)
+        return ue.has_imsi() ? ue.imsi() : 0;
+    return 0;
+  }
+}
+
+unsigned int flexran::rib::rib_updater::run(uint64_t tick)
+{
+  tick_ = tick;
+  const unsigned int processed = update_rib();
+  rib_.publish();
+  notify_fresh();
+  return processed;
+}
+
+flexran::event::stats_update& flexran::rib::rib_updater::fresh(uint64_t bs_id)
+{
+  for (std::size_t i = 0; i < num_fresh_; ++i)
+    if (fresh_[i].bs_id == bs_id)
+      return fresh_[i];
+  if (num_fresh_ == fresh_.size())
+    fresh_.emplace_back();
+  event::stats_update& u = fresh_[num_fresh_++];
+  u.bs_id = bs_id;
+  u.rntis.clear();
+  u.ue_flags = 0;
+  u.cell_flags = 0;
+  u.stats_replies = 0;
+  u.sf_triggers = 0;
+  return u;
+}
+
+void flexran::rib::rib_updater::notify_fresh()
+{
+  for (std::size_t i = 0; i < num_fresh_; ++i) {
+    std::vector<rnti_t>& r = fresh_[i].rntis;
+    std::sort(r.begin(), r.end());
+    r.erase(std::unique(r.begin(), r.end()), r.end());
+    event_sub_.stats_update_(fresh_[i]);
+  }
+  num_fresh_ = 0;
+}
+
+unsigned int flexran::rib::rib_updater::poll(unsigned int max_msgs)
+{
+  const unsigned int processed = update_rib(max_msgs);
+  if (processed > 0)
+    rib_.publish();
+  return processed;
+}
 
-unsigned int flexran::rib::rib_updater::run()
+void flexran::rib::rib_updater::get_rx_counters(std::vector<rx_counter>& rx) const
 {
-  return update_rib();
+  rx.clear();
+  for (const auto& a : rib_.get_agents())
+    rx.push_back(rx_counter{a.second->agent_id, a.second->bs_id,
+        a.second->rx_packets, a.second->rx_bytes});
 }
 
-#ifdef PROFILE
-void flexran::rib::rib_updater::print_prof_results(std::chrono::duration<double> d)
+void flexran::rib::rib_updater::reset_rx_counters()
 {
-  double us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
-  std::cout << "*** Agent throughput profiling results during "
-      << us << "us ***\n";
-  for (auto a : rib_.get_agents()) {
-    std::cout << "agent " << a.second->agent_id << " BS " << a.second->bs_id
-        << " rx packets " << a.second->rx_packets
-        << " rx_bytes " << a.second->rx_bytes
-        << " ~Mbps " << static_cast<double>(a.second->rx_bytes) * 8 / us << std::endl;
+  for (const auto& a : rib_.get_agents()) {
     a.second->rx_bytes = 0;
     a.second->rx_packets = 0;
   }
 }
-#endif
 
 unsigned int flexran::rib::rib_updater::update_rib()
+{
+  return update_rib(messages_to_check_);
+}
+
+unsigned int flexran::rib::rib_updater::update_rib(int max_msgs)
 {
   unsigned int processed = 0;
-  int rem_msgs = messages_to_check_;
+  int rem_msgs = max_msgs;
   std::shared_ptr<flexran::network::tagged_message> tm;
 
-  while(net_xface_.get_msg_from_network(tm) && (rem_msgs > 0)) {
+  /* check the budget first, as a message taken from the queue is lost */
+  while (rem_msgs > 0 && net_xface_.get_msg_from_network(tm)) {
     if (tm->getSize() == 0) { // New connection. update the pending eNBs list
       handle_new_connection(tm->getTag());
     } else {
-#ifdef PROFILE
-      if (g_doprof) {
+      if (count_rx_) {
         std::shared_ptr<agent_info> a = rib_.get_agent(tm->getTag());
-        a->rx_packets++;
-        a->rx_bytes += tm->getSize();
+        if (a) {
+          a->rx_packets++;
+          a->rx_bytes += tm->getSize();
+        }
       }
-#endif
       dispatch_message(tm);
     }
     rem_msgs--;
@@ -206,11 +257,24 @@ void flexran::rib::rib_updater::handle_hello(int agent_id,
     return;
   }
   if (rib_.new_eNB_config_entry(agent->bs_id)) {
-    // new BS is complete -> ask for configuration
-    LOG4CXX_INFO(flog::rib, "New BS " << agent->bs_id
-        << ", creating RIB entry");
-    trigger_bs_config(agent->bs_id);
-    event_sub_.bs_add_(agent->bs_id);
+    std::vector<rnti_t> restored_ues;
+    if (rib_.restore_bs(agent->bs_id, restored_ues)) {
+      // known BS from checkpoint -> only verify the UEs, the remaining
+      // configuration is refreshed periodically
+      LOG4CXX_INFO(flog::rib, "BS " << agent->bs_id
+          << " reattached from checkpoint");
+      request_ue_config(agent->bs_id);
+    } else {
+      // new BS is complete -> ask for configuration
+      LOG4CXX_INFO(flog::rib, "New BS " << agent->bs_id
+          << ", creating RIB entry");
+      trigger_bs_config(agent->bs_id);
+    }
+    event_sub_.notify(event::event_kind::bs_add, agent->bs_id);
+    const auto bs = rib_.get_bs(agent->bs_id);
+    for (rnti_t rnti : restored_ues)
+      event_sub_.notify(event::event_kind::ue_connect, agent->bs_id, rnti,
+          event_sub_.needs_imsi() ? imsi_of(bs->get_ue_configs(), rnti) : 0);
   } else {
     LOG4CXX_WARN(flog::rib, "Could not create BS " << agent->bs_id << " (yet)");
   }
@@ -260,7 +324,9 @@ void flexran::rib::rib_updater::handle_sf_trigger(int agent_id,
 
   LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << "/BS "
       << bs->get_id() << " received a subframe trigger msg");
-  bs->update_subframe(sf_trigger_msg);
+  bs->update_subframe(sf_trigger_msg, event_sub_.ticks_to_ms(tick_));
+  if (!event_sub_.stats_update_.empty())
+    fresh(bs->get_id()).sf_triggers++;
 }
 
 void flexran::rib::rib_updater::handle_enb_config_reply(int agent_id,
@@ -286,6 +352,17 @@ void flexran::rib::rib_updater::handle_ue_config_reply(int agent_id,
   }
 
   LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << " received a UE config reply msg");
+  std::vector<rnti_t> added;
+  std::vector<std::pair<rnti_t, uint64_t>> removed;
+  if (bs->reconcile_UE_configs(ue_config_reply_msg, added, removed)) {
+    /* the UEs are gone from the RIB already, so use the IMSIs saved by
+     * reconcile_UE_configs() */
+    for (const auto& r : removed)
+      event_sub_.notify(event::event_kind::ue_disconnect, bs->get_id(), r.first, r.second);
+    for (rnti_t rnti : added)
+      event_sub_.notify(event::event_kind::ue_connect, bs->get_id(), rnti,
+          event_sub_.needs_imsi() ? imsi_of(ue_config_reply_msg, rnti) : 0);
+  }
   bs->update_UE_config(ue_config_reply_msg);
 }
 
@@ -327,7 +404,17 @@ void flexran::rib::rib_updater::handle_stats_reply(int agent_id,
   }
 
   LOG4CXX_DEBUG(flog::rib, "Agent " << agent_id << ": received stats reply msg");
-  bs->update_mac_stats(mac_stats_reply);
+  bs->update_mac_stats(mac_stats_reply, event_sub_.ticks_to_ms(tick_));
+  if (event_sub_.stats_update_.empty())
+    return;
+  event::stats_update& u = fresh(bs->get_id());
+  u.stats_replies++;
+  for (const protocol::flex_ue_stats_report& r : mac_stats_reply.ue_report()) {
+    u.rntis.push_back(r.rnti());
+    u.ue_flags |= r.flags();
+  }
+  for (const protocol::flex_cell_stats_report& r : mac_stats_reply.cell_report())
+    u.cell_flags |= r.flags();
 }
 
 void flexran::rib::rib_updater::handle_ue_state_change(int agent_id,
@@ -339,17 +426,27 @@ void flexran::rib::rib_updater::handle_ue_state_change(int agent_id,
     return;
   }
 
+  /* updates and deactivations usually carry only the RNTI, so take the IMSI
+   * from the RIB before applying the change, and from the message for new
+   * UEs */
+  const protocol::flex_ue_config& c = ue_state_change_msg.config();
+  uint64_t imsi = 0;
+  if (event_sub_.needs_imsi()) {
+    imsi = imsi_of(bs->get_ue_configs(), c.rnti());
+    if (imsi == 0 && c.has_imsi())
+      imsi = c.imsi();
+  }
   bs->update_UE_config(ue_state_change_msg);
   switch (ue_state_change_msg.type()) {
   case protocol::FLUESC_ACTIVATED:
-    event_sub_.ue_connect_(bs->get_id(), ue_state_change_msg.config().rnti());
+    event_sub_.notify(event::event_kind::ue_connect, bs->get_id(), c.rnti(), imsi);
     trigger_bs_config(bs->get_id());
     break;
   case protocol::FLUESC_UPDATED:
-    event_sub_.ue_update_(bs->get_id(), ue_state_change_msg.config().rnti());
+    event_sub_.notify(event::event_kind::ue_update, bs->get_id(), c.rnti(), imsi);
     break;
   case protocol::FLUESC_DEACTIVATED:
-    event_sub_.ue_disconnect_(bs->get_id(), ue_state_change_msg.config().rnti());
+    event_sub_.notify(event::event_kind::ue_disconnect, bs->get_id(), c.rnti(), imsi);
     break;
   default:
     break;
@@ -365,7 +462,7 @@ void flexran::rib::rib_updater::handle_disconnect(int agent_id,
     LOG4CXX_INFO(flog::rib, "Agent " << agent_id << " of BS " << bs_id << " disconnected");
     if (rib_.remove_eNB_config_entry(agent_id)) {
       LOG4CXX_INFO(flog::rib, "BS " << bs_id << " is offline");
-      event_sub_.bs_remove_(bs_id);
+      event_sub_.notify(event::event_kind::bs_remove, bs_id);
     }
   } else if (rib_.agent_is_pending(agent_id)) { // pending base station
     LOG4CXX_INFO(flog::rib, "Pending agent " << agent_id << " disconnected");
@@ -391,7 +488,13 @@ void flexran::rib::rib_updater::handle_control_delegation_request(int agent_id,
 void flexran::rib::rib_updater::trigger_bs_config(uint64_t bs_id)
 {
   // BS is alive. Request info about its configuration (from all agents)
-  // eNB config first
+  request_enb_config(bs_id);
+  request_ue_config(bs_id);
+  request_lc_config(bs_id);
+}
+
+void flexran::rib::rib_updater::request_enb_config(uint64_t bs_id)
+{
   protocol::flex_header *header1(new protocol::flex_header);
   header1->set_type(protocol::FLPT_GET_ENB_CONFIG_REQUEST);
   header1->set_version(0);
@@ -402,8 +505,10 @@ void flexran::rib::rib_updater::trigger_bs_config(uint64_t bs_id)
   out_message1.set_msg_dir(protocol::INITIATING_MESSAGE);
   out_message1.set_allocated_enb_config_request_msg(enb_config_request_msg);
   req_manager_.send_message(bs_id, out_message1);
+}
 
-  // UE config second
+void flexran::rib::rib_updater::request_ue_config(uint64_t bs_id)
+{
   protocol::flex_header *header2(new protocol::flex_header);
   header2->set_type(protocol::FLPT_GET_UE_CONFIG_REQUEST);
   header2->set_version(0);
@@ -414,11 +519,13 @@ void flexran::rib::rib_updater::trigger_bs_config(uint64_t bs_id)
   out_message2.set_msg_dir(protocol::INITIATING_MESSAGE);
   out_message2.set_allocated_ue_config_request_msg(ue_config_request_msg);
   req_manager_.send_message(bs_id, out_message2);
+}
 
-  // LC config third
+void flexran::rib::rib_updater::request_lc_config(uint64_t bs_id)
+{
   protocol::flex_header *header3(new protocol::flex_header);
   header3->set_type(protocol::FLPT_GET_LC_CONFIG_REQUEST);
-  header2->set_version(0);
+  header3->set_version(0);
   header3->set_xid(2);
   protocol::flex_lc_config_request *lc_config_request_msg(new protocol::flex_lc_config_request);
   lc_config_request_msg->set_allocated_header(header3);
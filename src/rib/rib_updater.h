@@ -32,11 +32,20 @@
 #include "rt_task.h"
 #include "subscription.h"
 #include <chrono>
+#include <vector>
 
 namespace flexran {
 
   namespace rib {
 
+    /// messages received from an agent, see rib_updater::get_rx_counters()
+    struct rx_counter {
+      int agent_id;
+      uint64_t bs_id;
+      uint64_t packets;
+      uint64_t bytes;
+    };
+
     class rib_updater {
 
     public:
@@ -44,15 +53,25 @@ namespace flexran {
         flexran::core::requests_manager& netman,
         flexran::event::subscription& ev, int n_msg_check = 350)
       : rib_(storage), net_xface_(xface), req_manager_(netman),
-        event_sub_(ev), messages_to_check_(n_msg_check) {}
-      
-      unsigned int run();
-      
+        event_sub_(ev), messages_to_check_(n_msg_check), count_rx_(false),
+        tick_(0), num_fresh_(0) {}
+
+      /// processes the messages received until tick (of the task manager),
+      /// but at most n_msg_check. Afterwards, notifies the subscribers of
+      /// stats updates once per BS that sent stats since the last run(),
+      /// including those processed by poll()
+      unsigned int run(uint64_t tick);
+      /// processes at most max_msgs messages, e.g., while waiting for the
+      /// next tick, and publishes the changes
+      unsigned int poll(unsigned int max_msgs);
+
       unsigned int update_rib();
+      unsigned int update_rib(int max_msgs);
 
-#ifdef PROFILE
-      void print_prof_results(std::chrono::duration<double> d);
-#endif
+      /// count received packets and bytes per agent, for profiling
+      void set_count_rx(bool count) { count_rx_ = count; }
+      void get_rx_counters(std::vector<rx_counter>& rx) const;
+      void reset_rx_counters();
 
     private:
       
@@ -95,8 +114,15 @@ namespace flexran {
           const protocol::flex_control_delegation_request& control_del_req_msg);
 
       void trigger_bs_config(uint64_t bs_id);
+      void request_enb_config(uint64_t bs_id);
+      void request_ue_config(uint64_t bs_id);
+      void request_lc_config(uint64_t bs_id);
 
       void warn_unknown_agent_bs(const std::string& function, int agent_id);
+
+      /// the pending stats update of bs_id, added if there is none yet
+      flexran::event::stats_update& fresh(uint64_t bs_id);
+      void notify_fresh();
       
       Rib& rib_;
       // RX, can TX to individual agents
@@ -108,6 +134,12 @@ namespace flexran {
       
       // Max number of messages to check during a single update period
       std::atomic<int> messages_to_check_;
+      bool count_rx_;
+      uint64_t tick_;
+      // stats updates of the current tick, only the first num_fresh_ are
+      // valid. The others are kept to reuse their memory
+      std::vector<flexran::event::stats_update> fresh_;
+      std::size_t num_fresh_;
       static constexpr const uint64_t BS_ID_OFFSET = 10000;
       
     };
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    rib_version.h
+ *  \brief   change versions of RIB entities
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef RIB_VERSION_H_
+#define RIB_VERSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "rib_common.h"
+
+namespace flexran {
+
+  namespace rib {
+
+    /// Monotonic version counter shared by all entities of a RIB. Every change
+    /// applied by the RIB updater takes a new version, and every entity
+    /// remembers the version of its last change, so that consumers can ask
+    /// for everything changed since a version they have seen before. Version
+    /// 0 is never handed out, i.e., "changes since 0" means everything.
+    class version_counter {
+    public:
+      version_counter() : v_(0) {}
+      /// returns a new version, only to be called by the RIB updater
+      uint64_t next() { return v_.fetch_add(1, std::memory_order_release) + 1; }
+      /// returns the last version handed out
+      uint64_t current() const { return v_.load(std::memory_order_acquire); }
+    private:
+      std::atomic<uint64_t> v_;
+    };
+
+    /// entities of one BS changed since a given version
+    struct bs_changes {
+      uint64_t bs_id = 0;
+      /// the BS itself is newer than the version, i.e., everything is new
+      bool added = false;
+      /// top-level fields of the eNB config other than the cell configs
+      bool enb_config = false;
+      std::vector<uint16_t> cell_configs;
+      bool lc_config = false;
+      bool cell_stats = false;
+      std::vector<rnti_t> ue_configs;
+      std::vector<rnti_t> ue_stats;
+      /// UEs which have been removed and are not present anymore
+      std::vector<rnti_t> removed_ues;
+
+      /// whether anything but statistics changed
+      bool has_config_changes() const
+      {
+        return added || enb_config || !cell_configs.empty() || lc_config
+            || !ue_configs.empty() || !removed_ues.empty();
+      }
+    };
+
+    /// all changes of a RIB since a given version
+    struct rib_changes {
+      /// version up to which changes are included, to be used in the next
+      /// query
+      uint64_t version = 0;
+      /// false if removals older than the queried version have been
+      /// forgotten: the consumer needs to do a full read
+      bool complete = true;
+      std::vector<bs_changes> bs;
+      std::vector<uint64_t> removed_bs;
+    };
+
+  }
+
+}
+
+#endif /* RIB_VERSION_H_ */
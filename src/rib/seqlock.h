@@ -0,0 +1,95 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    seqlock.h
+ *  \brief   sequence lock for one writer and non-blocking readers
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace flexran {
+
+  namespace rib {
+
+    /// Sequence lock between one writer (the RIB updater) and any number of
+    /// readers. The writer never waits: it brackets every modification with
+    /// write_begin()/write_end(). Readers copy the protected data inside
+    /// read() and transparently retry if the writer interfered. Since a reader
+    /// may observe torn data before retrying, the read function must only
+    /// copy plain data and must not follow pointers into the protected data.
+    class seqlock {
+    public:
+      seqlock() : seq_(0) {}
+
+      void write_begin()
+      {
+        seq_.store(seq_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+      }
+
+      void write_end()
+      {
+        seq_.store(seq_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+      }
+
+      template <typename F>
+      void read(F f) const
+      {
+        uint64_t s;
+        do {
+          s = read_begin();
+          f();
+        } while (read_retry(s));
+      }
+
+      /// number of completed writes
+      uint64_t version() const
+      { return seq_.load(std::memory_order_acquire) / 2; }
+
+    private:
+      uint64_t read_begin() const
+      {
+        uint64_t s;
+        while ((s = seq_.load(std::memory_order_acquire)) & 1)
+          std::this_thread::yield();
+        return s;
+      }
+
+      bool read_retry(uint64_t s) const
+      {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return seq_.load(std::memory_order_relaxed) != s;
+      }
+
+      std::atomic<uint64_t> seq_;
+    };
+
+  }
+
+}
+
+#endif /* SEQLOCK_H_ */
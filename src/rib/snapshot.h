@@ -0,0 +1,61 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    snapshot.h
+ *  \brief   immutable copy of RIB data published by the RIB updater
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <atomic>
+#include <memory>
+
+namespace flexran {
+
+  namespace rib {
+
+    /// Double-buffered copy of data owned by the RIB updater. The writer
+    /// modifies its own copy and publishes an immutable copy of it from time
+    /// to time; readers in other threads (e.g. the northbound API) get a
+    /// reference-counted pointer to the latest published copy and may keep it
+    /// as long as they like. Neither side ever waits on the other for longer
+    /// than the exchange of the pointer.
+    template <typename T>
+    class snapshot {
+    public:
+      snapshot() : p_(std::make_shared<const T>()) {}
+
+      /// publishes a copy of t, to be called by the writer only
+      void publish(const T& t) { publish(std::make_shared<const T>(t)); }
+      void publish(std::shared_ptr<const T> p) { std::atomic_store(&p_, std::move(p)); }
+
+      /// the last published copy, never nullptr
+      std::shared_ptr<const T> get() const { return std::atomic_load(&p_); }
+
+    private:
+      std::shared_ptr<const T> p_;
+    };
+
+  }
+
+}
+
+#endif /* SNAPSHOT_H_ */
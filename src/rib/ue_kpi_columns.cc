@@ -0,0 +1,212 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    ue_kpi_columns.cc
+ *  \brief   struct-of-arrays columns of hot per-UE KPIs of one BS
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+
+#include "ue_kpi_columns.h"
+
+uint32_t flexran::rib::ue_kpis::wb_cqi_of(const protocol::flex_dl_cqi_report& r)
+{
+  /* take the report of the PCell (serving cell index 0), or the first P10
+   * report in case there is none for the PCell */
+  uint32_t cqi = 0;
+  bool found = false;
+  for (const auto& csi : r.csi_report()) {
+    if (!csi.has_p10csi()) continue;
+    if (csi.serv_cell_index() == 0) return csi.p10csi().wb_cqi();
+    if (!found) {
+      cqi = csi.p10csi().wb_cqi();
+      found = true;
+    }
+  }
+  return cqi;
+}
+
+uint32_t flexran::rib::ue_kpis::bsr_of(const protocol::flex_ue_stats_report& r)
+{
+  uint32_t sum = 0;
+  for (uint32_t b : r.bsr())
+    sum += b;
+  return sum;
+}
+
+uint32_t flexran::rib::ue_kpis::rlc_buffer_of(const protocol::flex_ue_stats_report& r)
+{
+  uint32_t sum = 0;
+  for (const auto& rlc : r.rlc_report())
+    sum += rlc.tx_queue_size();
+  return sum;
+}
+
+uint32_t flexran::rib::ue_kpis::value(int id) const
+{
+  switch (id) {
+    case WB_CQI:        return wb_cqi;
+    case BSR:           return bsr;
+    case PHR:           return phr;
+    case RLC_BUFFER:    return rlc_buffer;
+    case PDCP_TX_BYTES: return pdcp_tx_bytes;
+    case PDCP_RX_BYTES: return pdcp_rx_bytes;
+    default:            return 0;
+  }
+}
+
+const char *flexran::rib::ue_kpis::name(int id)
+{
+  switch (id) {
+    case WB_CQI:        return "wb_cqi";
+    case BSR:           return "bsr";
+    case PHR:           return "phr";
+    case RLC_BUFFER:    return "rlc_buffer";
+    case PDCP_TX_BYTES: return "pdcp_tx_bytes";
+    case PDCP_RX_BYTES: return "pdcp_rx_bytes";
+    default:            return "unknown";
+  }
+}
+
+flexran::rib::ue_kpi_columns::ue_kpi_columns()
+  : end_(0)
+{
+  free_slots_.reserve(MAX_NUM_UE);
+  /* reverse order, so that the lowest slot is handed out first */
+  for (int s = MAX_NUM_UE - 1; s >= 0; --s) {
+    free_slots_.push_back(s);
+    clear_slot(s);
+  }
+}
+
+int flexran::rib::ue_kpi_columns::add_ue(rnti_t rnti)
+{
+  auto it = slot_.find(rnti);
+  if (it != slot_.end()) return it->second;
+  if (free_slots_.empty()) return -1;
+
+  const int s = free_slots_.back();
+  free_slots_.pop_back();
+  slot_.emplace(rnti, s);
+  active_[s] = 1;
+  rnti_[s] = rnti;
+  end_ = std::max(end_, s + 1);
+  return s;
+}
+
+void flexran::rib::ue_kpi_columns::remove_ue(rnti_t rnti)
+{
+  auto it = slot_.find(rnti);
+  if (it == slot_.end()) return;
+
+  const int s = it->second;
+  slot_.erase(it);
+  clear_slot(s);
+  free_slots_.push_back(s);
+  while (end_ > 0 && !active_[end_ - 1])
+    --end_;
+}
+
+int flexran::rib::ue_kpi_columns::get_slot(rnti_t rnti) const
+{
+  auto it = slot_.find(rnti);
+  return it != slot_.end() ? it->second : -1;
+}
+
+void flexran::rib::ue_kpi_columns::update_kpis(rnti_t rnti, const ue_kpis& k)
+{
+  const int s = get_slot(rnti);
+  if (s < 0) return;
+  wb_cqi_[s]        = k.wb_cqi;
+  bsr_[s]           = k.bsr;
+  phr_[s]           = k.phr;
+  rlc_buffer_[s]    = k.rlc_buffer;
+  pdcp_tx_bytes_[s] = k.pdcp_tx_bytes;
+  pdcp_rx_bytes_[s] = k.pdcp_rx_bytes;
+}
+
+void flexran::rib::ue_kpi_columns::update_slices(rnti_t rnti,
+    uint32_t dl_slice_id, uint32_t ul_slice_id)
+{
+  const int s = get_slot(rnti);
+  if (s < 0) return;
+  dl_slice_id_[s] = dl_slice_id;
+  ul_slice_id_[s] = ul_slice_id;
+}
+
+std::vector<flexran::rib::rnti_t>
+flexran::rib::ue_kpi_columns::top_k_by_cqi(std::size_t k) const
+{
+  std::vector<int> slots;
+  slots.reserve(slot_.size());
+  for (int s = 0; s < end_; ++s)
+    if (active_[s]) slots.push_back(s);
+
+  k = std::min(k, slots.size());
+  std::partial_sort(slots.begin(), slots.begin() + k, slots.end(),
+      [this] (int a, int b)
+      { return wb_cqi_[a] != wb_cqi_[b] ? wb_cqi_[a] > wb_cqi_[b] : a < b; }
+  );
+
+  std::vector<rnti_t> rntis;
+  rntis.reserve(k);
+  for (std::size_t i = 0; i < k; ++i)
+    rntis.push_back(rnti_[slots[i]]);
+  return rntis;
+}
+
+uint64_t flexran::rib::ue_kpi_columns::sum_rlc_buffer() const
+{
+  /* unused slots are zero, no need to check active_ */
+  uint64_t sum = 0;
+  for (int s = 0; s < end_; ++s)
+    sum += rlc_buffer_[s];
+  return sum;
+}
+
+uint64_t flexran::rib::ue_kpi_columns::sum_rlc_buffer_dl_slice(uint32_t dl_slice_id) const
+{
+  uint64_t sum = 0;
+  for (int s = 0; s < end_; ++s)
+    sum += dl_slice_id_[s] == dl_slice_id ? rlc_buffer_[s] : 0;
+  return sum;
+}
+
+uint64_t flexran::rib::ue_kpi_columns::sum_bsr_ul_slice(uint32_t ul_slice_id) const
+{
+  uint64_t sum = 0;
+  for (int s = 0; s < end_; ++s)
+    sum += ul_slice_id_[s] == ul_slice_id ? bsr_[s] : 0;
+  return sum;
+}
+
+void flexran::rib::ue_kpi_columns::clear_slot(int s)
+{
+  active_[s]        = 0;
+  rnti_[s]          = 0;
+  wb_cqi_[s]        = 0;
+  bsr_[s]           = 0;
+  phr_[s]           = 0;
+  rlc_buffer_[s]    = 0;
+  pdcp_tx_bytes_[s] = 0;
+  pdcp_rx_bytes_[s] = 0;
+  dl_slice_id_[s]   = 0;
+  ul_slice_id_[s]   = 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    ue_kpi_columns.h
+ *  \brief   struct-of-arrays columns of hot per-UE KPIs of one BS
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef UE_KPI_COLUMNS_H_
+#define UE_KPI_COLUMNS_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "rib_common.h"
+#include "flexran.pb.h"
+
+namespace flexran {
+
+  namespace rib {
+
+    /// compact scalar KPIs of a UE, derived from a (merged)
+    /// flex_ue_stats_report so that consumers do not have to dig into the
+    /// protobuf message
+    struct ue_kpis {
+      uint32_t wb_cqi = 0;        ///< DL wideband CQI (P10 CSI) of the PCell
+      uint32_t bsr = 0;           ///< sum of all reported buffer status reports
+      uint32_t phr = 0;           ///< power headroom report
+      uint32_t rlc_buffer = 0;    ///< sum of RLC TX queue sizes of all LCs
+      uint32_t pdcp_tx_bytes = 0; ///< cumulative PDCP TX bytes
+      uint32_t pdcp_rx_bytes = 0; ///< cumulative PDCP RX bytes
+
+      /// index of a KPI for generic access through value()
+      enum kpi_id { WB_CQI, BSR, PHR, RLC_BUFFER, PDCP_TX_BYTES, PDCP_RX_BYTES,
+                    NUM_KPIS };
+      uint32_t value(int id) const;
+      /// name of a KPI as used in JSON output
+      static const char *name(int id);
+
+      static uint32_t wb_cqi_of(const protocol::flex_dl_cqi_report& r);
+      static uint32_t bsr_of(const protocol::flex_ue_stats_report& r);
+      static uint32_t rlc_buffer_of(const protocol::flex_ue_stats_report& r);
+    };
+
+    /// Struct-of-arrays view on the KPIs of all UEs of a BS. Every UE
+    /// occupies one slot for the time it is connected; all columns are
+    /// indexed by this slot. Columns are kept zeroed for unused slots, so
+    /// scans can run over [0, size()) without branching on the occupancy.
+    class ue_kpi_columns {
+    public:
+      ue_kpi_columns();
+
+      /// assigns a slot to the UE, returns it or -1 if no slot is left
+      int add_ue(rnti_t rnti);
+      void remove_ue(rnti_t rnti);
+      /// returns the slot of the UE or -1 if unknown
+      int get_slot(rnti_t rnti) const;
+
+      void update_kpis(rnti_t rnti, const ue_kpis& k);
+      void update_slices(rnti_t rnti, uint32_t dl_slice_id, uint32_t ul_slice_id);
+
+      /// number of slots to scan, i.e., one past the highest occupied slot
+      int size() const { return end_; }
+      int num_ues() const { return static_cast<int>(slot_.size()); }
+
+      // raw columns for custom scans over [0, size())
+      const uint8_t  *active()        const { return active_.data(); }
+      const rnti_t   *rnti()          const { return rnti_.data(); }
+      const uint32_t *wb_cqi()        const { return wb_cqi_.data(); }
+      const uint32_t *bsr()           const { return bsr_.data(); }
+      const uint32_t *phr()           const { return phr_.data(); }
+      const uint32_t *rlc_buffer()    const { return rlc_buffer_.data(); }
+      const uint32_t *pdcp_tx_bytes() const { return pdcp_tx_bytes_.data(); }
+      const uint32_t *pdcp_rx_bytes() const { return pdcp_rx_bytes_.data(); }
+      const uint32_t *dl_slice_id()   const { return dl_slice_id_.data(); }
+      const uint32_t *ul_slice_id()   const { return ul_slice_id_.data(); }
+
+      /// RNTIs of the (at most) k UEs with the highest wideband CQI, highest
+      /// first
+      std::vector<rnti_t> top_k_by_cqi(std::size_t k) const;
+      uint64_t sum_rlc_buffer() const;
+      uint64_t sum_rlc_buffer_dl_slice(uint32_t dl_slice_id) const;
+      uint64_t sum_bsr_ul_slice(uint32_t ul_slice_id) const;
+
+    private:
+      void clear_slot(int s);
+
+      std::map<rnti_t, int> slot_;
+      std::vector<int> free_slots_;
+      int end_;
+
+      std::array<uint8_t,  MAX_NUM_UE> active_;
+      std::array<rnti_t,   MAX_NUM_UE> rnti_;
+      std::array<uint32_t, MAX_NUM_UE> wb_cqi_;
+      std::array<uint32_t, MAX_NUM_UE> bsr_;
+      std::array<uint32_t, MAX_NUM_UE> phr_;
+      std::array<uint32_t, MAX_NUM_UE> rlc_buffer_;
+      std::array<uint32_t, MAX_NUM_UE> pdcp_tx_bytes_;
+      std::array<uint32_t, MAX_NUM_UE> pdcp_rx_bytes_;
+      std::array<uint32_t, MAX_NUM_UE> dl_slice_id_;
+      std::array<uint32_t, MAX_NUM_UE> ul_slice_id_;
+    };
+
+  }
+
+}
+
+#endif /* UE_KPI_COLUMNS_H_ */
@@ -0,0 +1,297 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    ue_kpi_history.cc
+ *  \brief   bounded per-UE history of KPI samples with rolling aggregates
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#include <algorithm>
+#include <functional>
+
+#include "ue_kpi_history.h"
+
+flexran::rib::ue_kpi_history::ue_kpi_history(const config& c)
+  : capacity_(std::max<std::size_t>(c.capacity, 1)),
+    samples_(capacity_),
+    pushed_(0)
+{
+  for (uint32_t l : sanitize_windows(c)) {
+    window_state ws;
+    ws.length = l;
+    ws.alpha = 2.0 / (l + 1);
+    ws.sum.fill(0);
+    ws.sumsq.fill(0);
+    for (int k = 0; k < ue_kpis::NUM_KPIS; ++k) {
+      ws.min_q[k].pos.resize(l);
+      ws.max_q[k].pos.resize(l);
+    }
+    ws.since_resync = 0;
+    windows_.push_back(std::move(ws));
+
+    ue_kpi_window r;
+    r.length = l;
+    r.n = 0;
+    r.kpi.fill(ue_kpi_aggregate{0, 0, 0, 0, 0, 0});
+    results_.push_back(r);
+  }
+}
+
+std::vector<uint32_t> flexran::rib::ue_kpi_history::sanitize_windows(const config& c)
+{
+  const uint32_t cap = std::max<std::size_t>(c.capacity, 1);
+  std::vector<uint32_t> ws;
+  for (uint32_t l : c.windows) {
+    if (l == 0) continue;
+    ws.push_back(std::min(l, cap));
+  }
+  return ws;
+}
+
+std::size_t flexran::rib::ue_kpi_history::memory_footprint(const config& c)
+{
+  if (c.capacity == 0) return 0;
+  std::size_t b = sizeof(ue_kpi_history) + c.capacity * sizeof(ue_kpi_sample);
+  for (uint32_t l : sanitize_windows(c))
+    b += sizeof(window_state) + sizeof(ue_kpi_window)
+        + 2 * ue_kpis::NUM_KPIS * l * sizeof(uint32_t);
+  return b;
+}
+
+uint32_t flexran::rib::ue_kpi_history::age(uint32_t p) const
+{
+  const uint32_t newest = (pushed_ - 1) % capacity_;
+  return (newest + capacity_ - p) % capacity_;
+}
+
+void flexran::rib::ue_kpi_history::push(uint64_t tick, uint16_t sfn_sf,
+    const ue_kpis& k)
+{
+  lock_.write_begin();
+
+  const uint32_t p = pushed_ % capacity_;
+  /* before overwriting the oldest sample, remove every sample that is about
+   * to leave a window: from the sums, and from the front of the min/max
+   * queues (the next push ages every queued sample by one) */
+  for (window_state& ws : windows_) {
+    if (pushed_ >= ws.length) {
+      const ue_kpis& old = samples_[(pushed_ - ws.length) % capacity_].kpis;
+      for (int i = 0; i < ue_kpis::NUM_KPIS; ++i) {
+        const uint32_t v = old.value(i);
+        ws.sum[i] -= v;
+        ws.sumsq[i] -= static_cast<double>(v) * v;
+      }
+    }
+    if (pushed_ == 0) continue;
+    for (int i = 0; i < ue_kpis::NUM_KPIS; ++i) {
+      for (mono_queue *q : {&ws.min_q[i], &ws.max_q[i]}) {
+        while (q->len > 0 && age(q->pos[q->head]) + 1 >= ws.length) {
+          q->head = (q->head + 1) % ws.length;
+          q->len--;
+        }
+      }
+    }
+  }
+
+  samples_[p].tick = tick;
+  samples_[p].sfn_sf = sfn_sf;
+  samples_[p].kpis = k;
+  pushed_++;
+
+  for (std::size_t w = 0; w < windows_.size(); ++w)
+    update_window(w, p);
+
+  lock_.write_end();
+}
+
+template <typename Cmp>
+void flexran::rib::ue_kpi_history::push_mono(mono_queue& q, int kpi,
+    uint32_t newest, uint32_t length, Cmp cmp)
+{
+  /* drop all entries that can never become the extremum again */
+  const uint32_t v = samples_[newest].kpis.value(kpi);
+  while (q.len > 0) {
+    const uint32_t back = (q.head + q.len - 1) % length;
+    if (cmp(v, samples_[q.pos[back]].kpis.value(kpi)))
+      break;
+    q.len--;
+  }
+  q.pos[(q.head + q.len) % length] = newest;
+  q.len++;
+}
+
+void flexran::rib::ue_kpi_history::update_window(std::size_t w, uint32_t newest)
+{
+  window_state& ws = windows_[w];
+  ue_kpi_window& r = results_[w];
+  const ue_kpi_sample& s = samples_[newest];
+  r.n = std::min<uint64_t>(pushed_, ws.length);
+  const ue_kpi_sample& oldest = samples_[(pushed_ - r.n) % capacity_];
+  const double dt = static_cast<double>(s.tick) - oldest.tick;
+
+  for (int i = 0; i < ue_kpis::NUM_KPIS; ++i) {
+    const uint32_t v = s.kpis.value(i);
+    ws.sum[i] += v;
+    ws.sumsq[i] += static_cast<double>(v) * v;
+    push_mono(ws.min_q[i], i, newest, ws.length, std::greater<uint32_t>());
+    push_mono(ws.max_q[i], i, newest, ws.length, std::less<uint32_t>());
+
+    ue_kpi_aggregate& a = r.kpi[i];
+    a.ewma = pushed_ == 1 ? v : a.ewma + ws.alpha * (v - a.ewma);
+    a.min = samples_[ws.min_q[i].pos[ws.min_q[i].head]].kpis.value(i);
+    a.max = samples_[ws.max_q[i].pos[ws.max_q[i].head]].kpis.value(i);
+    a.rate = dt > 0 ? (static_cast<double>(v) - oldest.kpis.value(i)) / dt : 0;
+  }
+
+  /* the sum of squares is kept in floating point and therefore accumulates
+   * rounding errors: recompute it once per window length */
+  if (++ws.since_resync >= ws.length)
+    resync_sumsq(ws);
+
+  for (int i = 0; i < ue_kpis::NUM_KPIS; ++i) {
+    ue_kpi_aggregate& a = r.kpi[i];
+    a.mean = static_cast<double>(ws.sum[i]) / r.n;
+    a.var = std::max(0.0, ws.sumsq[i] / r.n - a.mean * a.mean);
+  }
+}
+
+void flexran::rib::ue_kpi_history::resync_sumsq(window_state& ws)
+{
+  ws.since_resync = 0;
+  ws.sumsq.fill(0);
+  const uint64_t n = std::min<uint64_t>(pushed_, ws.length);
+  for (uint64_t j = pushed_ - n; j < pushed_; ++j) {
+    const ue_kpis& k = samples_[j % capacity_].kpis;
+    for (int i = 0; i < ue_kpis::NUM_KPIS; ++i)
+      ws.sumsq[i] += static_cast<double>(k.value(i)) * k.value(i);
+  }
+}
+
+uint64_t flexran::rib::ue_kpi_history::num_pushed() const
+{
+  uint64_t n;
+  lock_.read([&] { n = pushed_; });
+  return n;
+}
+
+std::vector<flexran::rib::ue_kpi_sample> flexran::rib::ue_kpi_history::get_samples(
+    std::size_t max) const
+{
+  std::vector<ue_kpi_sample> out;
+  out.reserve(std::min(max, capacity_));
+  lock_.read([&] {
+    out.clear();
+    const uint64_t n = std::min<uint64_t>({pushed_, capacity_, max});
+    for (uint64_t j = pushed_ - n; j < pushed_; ++j)
+      out.push_back(samples_[j % capacity_]);
+  });
+  return out;
+}
+
+bool flexran::rib::ue_kpi_history::get_latest(ue_kpi_sample& s) const
+{
+  bool found;
+  lock_.read([&] {
+    found = pushed_ > 0;
+    if (found) s = samples_[(pushed_ - 1) % capacity_];
+  });
+  return found;
+}
+
+flexran::rib::ue_kpi_window flexran::rib::ue_kpi_history::get_window(std::size_t w) const
+{
+  ue_kpi_window r;
+  lock_.read([&] { r = results_[w]; });
+  return r;
+}
+
+std::vector<flexran::rib::ue_kpi_window> flexran::rib::ue_kpi_history::get_windows() const
+{
+  std::vector<ue_kpi_window> r(results_.size());
+  lock_.read([&] { std::copy(results_.begin(), results_.end(), r.begin()); });
+  return r;
+}
+
+std::string flexran::rib::ue_kpi_history::to_json_string(std::size_t max) const
+{
+  /* take both copies within one read section so that samples and
+   * aggregates are consistent */
+  std::vector<ue_kpi_sample> samples;
+  samples.reserve(std::min(max, capacity_));
+  std::vector<ue_kpi_window> windows(results_.size());
+  uint64_t pushed;
+  lock_.read([&] {
+    pushed = pushed_;
+    samples.clear();
+    const uint64_t n = std::min<uint64_t>({pushed_, capacity_, max});
+    for (uint64_t j = pushed_ - n; j < pushed_; ++j)
+      samples.push_back(samples_[j % capacity_]);
+    std::copy(results_.begin(), results_.end(), windows.begin());
+  });
+
+  std::string str;
+  str += "{\"capacity\":";
+  str += std::to_string(capacity_);
+  str += ",\"num_pushed\":";
+  str += std::to_string(pushed);
+  str += ",\"samples\":[";
+  for (auto it = samples.begin(); it != samples.end(); ++it) {
+    if (it != samples.begin()) str += ",";
+    str += "{\"tick\":";
+    str += std::to_string(it->tick);
+    str += ",\"sfn_sf\":";
+    str += std::to_string(it->sfn_sf);
+    for (int i = 0; i < ue_kpis::NUM_KPIS; ++i) {
+      str += ",\"";
+      str += ue_kpis::name(i);
+      str += "\":";
+      str += std::to_string(it->kpis.value(i));
+    }
+    str += "}";
+  }
+  str += "],\"windows\":[";
+  for (auto it = windows.begin(); it != windows.end(); ++it) {
+    if (it != windows.begin()) str += ",";
+    str += "{\"length\":";
+    str += std::to_string(it->length);
+    str += ",\"n\":";
+    str += std::to_string(it->n);
+    for (int i = 0; i < ue_kpis::NUM_KPIS; ++i) {
+      const ue_kpi_aggregate& a = it->kpi[i];
+      str += ",\"";
+      str += ue_kpis::name(i);
+      str += "\":{\"mean\":";
+      str += std::to_string(a.mean);
+      str += ",\"var\":";
+      str += std::to_string(a.var);
+      str += ",\"min\":";
+      str += std::to_string(a.min);
+      str += ",\"max\":";
+      str += std::to_string(a.max);
+      str += ",\"ewma\":";
+      str += std::to_string(a.ewma);
+      str += ",\"rate\":";
+      str += std::to_string(a.rate);
+      str += "}";
+    }
+    str += "}";
+  }
+  str += "]}";
+  return str;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2016-2018 FlexRAN Authors, Eurecom and The University of Edinburgh
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * For more information about Mosaic5G:  contact@mosaic-5g.io
+ */
+
+/*! \file    ue_kpi_history.h
+ *  \brief   bounded per-UE history of KPI samples with rolling aggregates
+ *  \authors Robert Schmidt
+ *  \company Eurecom
+ *  \email   robert.schmidt@eurecom.fr
+ */
+
+#ifndef UE_KPI_HISTORY_H_
+#define UE_KPI_HISTORY_H_
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "ue_kpi_columns.h"
+#include "seqlock.h"
+
+namespace flexran {
+
+  namespace rib {
+
+    /// one entry of the KPI history of a UE
+    struct ue_kpi_sample {
+      uint64_t tick;    ///< task manager time (ms) at which the sample was taken
+      uint16_t sfn_sf;  ///< SFN/SF of the BS at that time, as estimated by the RIB
+      ue_kpis kpis;
+    };
+
+    /// aggregates of one KPI over one window
+    struct ue_kpi_aggregate {
+      double mean;
+      double var;
+      double ewma;      ///< EWMA with alpha = 2/(window+1)
+      double rate;      ///< change per ms between oldest and newest sample
+      uint32_t min;
+      uint32_t max;
+    };
+
+    /// aggregates of all KPIs over one window
+    struct ue_kpi_window {
+      uint32_t length;  ///< configured window length in samples
+      uint32_t n;       ///< samples currently in the window (<= length)
+      std::array<ue_kpi_aggregate, ue_kpis::NUM_KPIS> kpi;
+    };
+
+    /// Fixed-capacity ring buffer of KPI samples of one UE. The aggregates of
+    /// all configured windows are updated incrementally when a sample is
+    /// pushed: sums for mean/variance, monotonic queues for min/max, and one
+    /// EWMA per window. All memory is allocated at construction.
+    ///
+    /// push() must only be called by the RIB updater. All const methods can
+    /// be called from any thread (e.g., the northbound API) and never block
+    /// the writer, see seqlock.
+    class ue_kpi_history {
+    public:
+      struct config {
+        std::size_t capacity = 100;             ///< samples, 0 disables history
+        std::vector<uint32_t> windows{10, 100}; ///< window lengths in samples
+      };
+
+      /// window lengths of 0 are dropped, lengths larger than the capacity
+      /// are reduced to the capacity
+      explicit ue_kpi_history(const config& c);
+
+      void push(uint64_t tick, uint16_t sfn_sf, const ue_kpis& k);
+
+      std::size_t capacity() const { return capacity_; }
+      std::size_t num_windows() const { return windows_.size(); }
+      /// total number of samples ever pushed
+      uint64_t num_pushed() const;
+
+      /// returns the last (at most max) samples, oldest first
+      std::vector<ue_kpi_sample> get_samples(
+          std::size_t max = std::numeric_limits<std::size_t>::max()) const;
+      /// copies the latest sample into s, returns false if there is none
+      bool get_latest(ue_kpi_sample& s) const;
+      /// returns the aggregates of window w, w < num_windows()
+      ue_kpi_window get_window(std::size_t w) const;
+      std::vector<ue_kpi_window> get_windows() const;
+
+      std::string to_json_string(
+          std::size_t max = std::numeric_limits<std::size_t>::max()) const;
+
+      /// bytes allocated for a history with the given configuration
+      static std::size_t memory_footprint(const config& c);
+
+    private:
+      /// ring of positions into samples_ forming a monotonic queue for the
+      /// min or max of one KPI within one window
+      struct mono_queue {
+        std::vector<uint32_t> pos;
+        uint32_t head = 0;
+        uint32_t len = 0;
+      };
+
+      struct window_state {
+        uint32_t length;
+        double alpha;
+        std::array<uint64_t, ue_kpis::NUM_KPIS> sum;
+        std::array<double, ue_kpis::NUM_KPIS> sumsq;
+        std::array<mono_queue, ue_kpis::NUM_KPIS> min_q;
+        std::array<mono_queue, ue_kpis::NUM_KPIS> max_q;
+        uint32_t since_resync;
+      };
+
+      /// age of the sample at position p relative to the newest one
+      uint32_t age(uint32_t p) const;
+      void update_window(std::size_t w, uint32_t newest);
+      template <typename Cmp>
+      void push_mono(mono_queue& q, int kpi, uint32_t newest, uint32_t length,
+                     Cmp cmp);
+      void resync_sumsq(window_state& ws);
+
+      static std::vector<uint32_t> sanitize_windows(const config& c);
+
+      const std::size_t capacity_;
+      // all of the following is protected by lock_
+      std::vector<ue_kpi_sample> samples_;
+      uint64_t pushed_;
+      std::vector<window_state> windows_;
+      std::vector<ue_kpi_window> results_;
+      seqlock lock_;
+    };
+
+  }
+
+}
+
+#endif /* UE_KPI_HISTORY_H_ */
@@ -27,7 +27,6 @@
 #include <iostream>
 #include <sstream>
 #include <string>
-#include <google/protobuf/util/json_util.h>
 
 #include "ue_mac_rib_info.h"
 #include "flexran_log.h"
@@ -36,6 +35,7 @@ void flexran::rib::ue_mac_rib_info::update_dl_sf_info(const protocol::flex_dl_in
   uint8_t CC_id = dl_info.serv_cell_index();
   uint8_t harq_id = dl_info.harq_process_id();
   
+  harq_lock_.write_begin();
   for (int i = 0; i < dl_info.harq_status_size(); i++) {
     LOG4CXX_DEBUG(flog::rib, "HARQ ID " << static_cast<uint16_t>(harq_id)
         << ", HARQ status " << dl_info.harq_status(i) << ", CC "
@@ -43,6 +43,7 @@ void flexran::rib::ue_mac_rib_info::update_dl_sf_info(const protocol::flex_dl_in
     harq_stats_[CC_id][harq_id][i] = dl_info.harq_status(i);
     active_harq_[CC_id][harq_id][i] = true;
   }
+  harq_lock_.write_end();
 }
 
 void flexran::rib::ue_mac_rib_info::update_ul_sf_info(const protocol::flex_ul_info& ul_info) {
@@ -58,21 +59,21 @@ void flexran::rib::ue_mac_rib_info::update_mac_stats_report(const protocol::flex
   // Check the flags of the incoming report and copy only those elements that have been updated
   uint32_t flags = stats_report.flags();
 
-  // lock the mutex for the duration of this method
-  std::lock_guard<std::mutex> guard(mac_stats_report_mutex_);
-
   mac_stats_report_.set_rnti(stats_report.rnti());
   if (protocol::FLUST_BSR & flags) {
     mac_stats_report_.clear_bsr();
     for (int i = 0; i < stats_report.bsr_size(); i++) {
       mac_stats_report_.add_bsr(stats_report.bsr(i));
     }
+    kpis_.bsr = ue_kpis::bsr_of(stats_report);
   }
   if (protocol::FLUST_PHR & flags) {
     mac_stats_report_.set_phr(stats_report.phr());
+    kpis_.phr = stats_report.phr();
   }
   if (protocol::FLUST_RLC_BS & flags) {
     mac_stats_report_.mutable_rlc_report()->CopyFrom(stats_report.rlc_report());
+    kpis_.rlc_buffer = ue_kpis::rlc_buffer_of(stats_report);
 
     //if (stats_report.rlc_report_size() == mac_stats_report_.rlc_report_size()) {
     //  for (int i = 0; i < mac_stats_report_.rlc_report_size(); i++) {
@@ -91,6 +92,7 @@ void flexran::rib::ue_mac_rib_info::update_mac_stats_report(const protocol::flex
   }
   if (protocol::FLUST_DL_CQI & flags) {
     mac_stats_report_.mutable_dl_cqi_report()->CopyFrom(stats_report.dl_cqi_report());
+    kpis_.wb_cqi = ue_kpis::wb_cqi_of(stats_report.dl_cqi_report());
   }
   if (protocol::FLUST_PBS & flags) {
     mac_stats_report_.mutable_pbr()->CopyFrom(stats_report.pbr());
@@ -101,6 +103,8 @@ void flexran::rib::ue_mac_rib_info::update_mac_stats_report(const protocol::flex
 
   if (protocol::FLUST_PDCP_STATS & flags) {
    mac_stats_report_.mutable_pdcp_stats()->CopyFrom(stats_report.pdcp_stats());
+   kpis_.pdcp_tx_bytes = stats_report.pdcp_stats().pkt_tx_bytes();
+   kpis_.pdcp_rx_bytes = stats_report.pdcp_stats().pkt_rx_bytes();
   }
 
   if (protocol::FLUST_RRC_MEASUREMENTS & flags) {
@@ -118,11 +122,27 @@ void flexran::rib::ue_mac_rib_info::update_mac_stats_report(const protocol::flex
     mac_stats_report_.mutable_s1ap_stats()->CopyFrom(stats_report.s1ap_stats());
 }
 
+void flexran::rib::ue_mac_rib_info::record_kpis(uint64_t tick, uint16_t sfn_sf)
+{
+  if (history_)
+    history_->push(tick, sfn_sf, kpis_);
+}
+
+std::array<uint8_t, flexran::rib::MAX_NUM_HARQ>
+flexran::rib::ue_mac_rib_info::get_harq_snapshot(uint16_t cell_id) const
+{
+  std::array<uint8_t, MAX_NUM_HARQ> harq;
+  harq_lock_.read([&] {
+    for (int i = 0; i < MAX_NUM_HARQ; i++)
+      harq[i] = harq_stats_[cell_id][i][0];
+  });
+  return harq;
+}
+
 void flexran::rib::ue_mac_rib_info::dump_stats() const {
   LOG4CXX_INFO(flog::rib, "Rnti: " << rnti_);
-  mac_stats_report_mutex_.lock();
-  LOG4CXX_INFO(flog::rib, mac_stats_report_.DebugString());
-  mac_stats_report_mutex_.unlock();
+  LOG4CXX_INFO(flog::rib, get_mac_stats_snapshot()->DebugString());
+  const std::array<uint8_t, MAX_NUM_HARQ> harq_stats = get_harq_snapshot(0);
   LOG4CXX_INFO(flog::rib, "Harq status");
   std::ostringstream oss;
   for (int i = 0; i < 8; i++) {
@@ -132,7 +152,7 @@ void flexran::rib::ue_mac_rib_info::dump_stats() const {
   oss.str(" ");
   oss.clear();
   for (int i = 0; i < 8; i++) {
-    if (harq_stats_[0][i][0] == protocol::FLHS_ACK) {
+    if (harq_stats[i] == protocol::FLHS_ACK) {
       oss << " | " << "ACK";
     } else {
       oss << " | " << "NACK";
@@ -148,9 +168,7 @@ std::string flexran::rib::ue_mac_rib_info::dump_stats_to_string() const {
   str += "Rnti: ";
   str += std::to_string(rnti_);
   str += "\n";
-  mac_stats_report_mutex_.lock();
-  str += mac_stats_report_.DebugString();
-  mac_stats_report_mutex_.unlock();
+  str += get_mac_stats_snapshot()->DebugString();
   str += "\n";
   str += "Harq status";
   str += "\n";
@@ -163,8 +181,9 @@ std::string flexran::rib::ue_mac_rib_info::dump_stats_to_string() const {
   str += "   |   ";
   str += "\n";
   str += " ";
+  const std::array<uint8_t, MAX_NUM_HARQ> harq_stats = get_harq_snapshot(0);
   for (int i = 0; i < 8; i++) {
-    if (harq_stats_[0][i][0] == protocol::FLHS_ACK) {
+    if (harq_stats[i] == protocol::FLHS_ACK) {
       str += " | ";
       str += "ACK";
     } else {
@@ -179,19 +198,38 @@ std::string flexran::rib::ue_mac_rib_info::dump_stats_to_string() const {
 
 }
 
-std::string flexran::rib::ue_mac_rib_info::dump_stats_to_json_string() const
+void flexran::rib::ue_mac_rib_info::dump_stats_to_json(json_writer& w) const
 {
-  std::string mac_stats;
-  mac_stats_report_mutex_.lock();
-  google::protobuf::util::MessageToJsonString(mac_stats_report_, &mac_stats, google::protobuf::util::JsonPrintOptions());
-  mac_stats_report_mutex_.unlock();
-  std::array<std::string, 8> harq;
+  const std::array<uint8_t, MAX_NUM_HARQ> harq_stats = get_harq_snapshot(0);
+  w.begin_object();
+  w.key("rnti", true).value(rnti_);
+  w.key("mac_stats").message(*get_mac_stats_snapshot());
+  w.key("harq").begin_array();
+  for (int i = 0; i < 8; i++)
+    w.value(harq_stats[i] == protocol::FLHS_ACK ? "ACK" : "NACK");
+  w.end_array();
+  w.end_object();
+}
 
-  for (int i = 0; i < 8; i++) {
-    harq[i] = harq_stats_[0][i][0] == protocol::FLHS_ACK ? "\"ACK\"" : "\"NACK\"";
-  }
+std::string flexran::rib::ue_mac_rib_info::dump_stats_to_json_string() const
+{
+  json_writer w;
+  dump_stats_to_json(w);
+  std::string s;
+  w.flush(s);
+  return s;
+}
 
-  return format_stats_to_json(rnti_, mac_stats, harq);
+std::string flexran::rib::ue_mac_rib_info::dump_history_to_json_string(
+    std::size_t max_samples) const
+{
+  std::string str;
+  str += "{\"rnti\": ";
+  str += std::to_string(rnti_);
+  str += ",\"history\":";
+  str += history_ ? history_->to_json_string(max_samples) : "null";
+  str += "}";
+  return str;
 }
 
 std::string flexran::rib::ue_mac_rib_info::format_stats_to_json(
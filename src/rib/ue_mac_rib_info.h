@@ -28,9 +28,15 @@
 #define UE_MAC_RIB_INFO_H_
 
 #include <cstdint>
-#include <mutex>
+#include <array>
+#include <memory>
 
 #include "rib_common.h"
+#include "ue_kpi_columns.h"
+#include "ue_kpi_history.h"
+#include "seqlock.h"
+#include "snapshot.h"
+#include "json_writer.h"
 #include "flexran.pb.h"
 
 template <class T, size_t rows, size_t cols>
@@ -47,8 +53,12 @@ namespace flexran {
       
     public:
       
-    ue_mac_rib_info(rnti_t rnti)
-      : rnti_(rnti), harq_stats_{{{protocol::FLHS_ACK}}},
+    ue_mac_rib_info(rnti_t rnti,
+        const ue_kpi_history::config& history_config = ue_kpi_history::config())
+      : rnti_(rnti),
+        history_(history_config.capacity > 0 ? new ue_kpi_history(history_config) : nullptr),
+        config_version_(0), stats_version_(0),
+        harq_stats_{{{protocol::FLHS_ACK}}},
 	uplink_reception_stats_{0}, ul_reception_data_{{0}} {
 
 	  for (int i = 0; i < MAX_NUM_CC; i++) {
@@ -65,23 +75,55 @@ namespace flexran {
      void update_ul_sf_info(const protocol::flex_ul_info& ul_info);
 
      void update_mac_stats_report(const protocol::flex_ue_stats_report& stats_report);
+
+     /// appends the current KPIs to the history (if enabled)
+     void record_kpis(uint64_t tick, uint16_t sfn_sf);
      
      void dump_stats() const;
 
      std::string dump_stats_to_string() const;
 
+     /// writes the stats as object {"rnti": ..,"mac_stats":..,"harq":[..]}
+     void dump_stats_to_json(json_writer& w) const;
      std::string dump_stats_to_json_string() const;
 
+     std::string dump_history_to_json_string(std::size_t max_samples) const;
+
      static std::string format_stats_to_json(rnti_t rnti,
                                              const std::string& mac_stats,
                                              const std::array<std::string, 8>& harq);
 
      //! Access is only safe when the RIB is not active, i.e. within apps
      const protocol::flex_ue_stats_report& get_mac_stats_report() const { return mac_stats_report_; }
+
+     //! publishes the current MAC stats report for readers outside of the RIB
+     //! updater, see get_mac_stats_snapshot()
+     void publish_mac_stats() { mac_stats_snapshot_.publish(mac_stats_report_); }
+
+     //! MAC stats report as of the last publish_mac_stats(). Can be read at
+     //! any time.
+     std::shared_ptr<const protocol::flex_ue_stats_report> get_mac_stats_snapshot() const {
+       return mac_stats_snapshot_.get();
+     }
+
+     //! scalar KPIs of the merged MAC stats report
+     const ue_kpis& get_kpis() const { return kpis_; }
+
+     //! versions of the last change of the UE config and the UE stats
+     uint64_t get_config_version() const { return config_version_; }
+     uint64_t get_stats_version() const { return stats_version_; }
+     void set_config_version(uint64_t v) { config_version_ = v; }
+     void set_stats_version(uint64_t v) { stats_version_ = v; }
+
+     //! KPI history, nullptr if disabled. Can be read at any time.
+     const ue_kpi_history *get_kpi_history() const { return history_.get(); }
      
      uint8_t get_harq_stats(uint16_t cell_id, int harq_pid) const {
        return harq_stats_[cell_id][harq_pid][0];
      }
+
+     //! HARQ status of the first TB of all processes. Can be read at any time.
+     std::array<uint8_t, MAX_NUM_HARQ> get_harq_snapshot(uint16_t cell_id) const;
      
      //! Access is only safe when the RIB is not active, i.e. within apps
      const array3d<uint8_t, MAX_NUM_CC, MAX_NUM_HARQ, MAX_NUM_TB>& get_all_harq_stats() const {
@@ -116,10 +158,14 @@ namespace flexran {
      rnti_t rnti_;
      
      protocol::flex_ue_stats_report mac_stats_report_;
-     mutable std::mutex mac_stats_report_mutex_;
-
-     // TODO this could/should be protected with mutexes, too
-     // SF info
+     snapshot<protocol::flex_ue_stats_report> mac_stats_snapshot_;
+     ue_kpis kpis_;
+     std::unique_ptr<ue_kpi_history> history_;
+     uint64_t config_version_;
+     uint64_t stats_version_;
+
+     // SF info, harq_stats_ is written under harq_lock_
+     seqlock harq_lock_;
      array3d<uint8_t, MAX_NUM_CC, MAX_NUM_HARQ, MAX_NUM_TB> harq_stats_;
      array3d<bool, MAX_NUM_CC, MAX_NUM_HARQ, MAX_NUM_TB> active_harq_;
      std::array<uint8_t, MAX_NUM_CC> uplink_reception_stats_;
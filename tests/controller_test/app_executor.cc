@@ -0,0 +1,159 @@
+#include "catch.hpp"
+#include "app_executor.h"
+#include <mutex>
+#include <set>
+#include <thread>
+
+using flexran::core::app_executor;
+using flexran::event::footprint;
+using flexran::event::task_job;
+
+namespace {
+  std::shared_ptr<const task_job> make_job(const std::string& name,
+      const void *owner, const footprint& fp, std::function<void(uint64_t)> fn,
+      uint64_t deadline_us = 0)
+  {
+    auto job = std::make_shared<task_job>();
+    job->name = name;
+    job->fn = std::move(fn);
+    job->owner = owner;
+    job->fp = fp;
+    job->deadline_us = deadline_us;
+    return job;
+  }
+
+  void run_tick(app_executor& ex, uint64_t tick, const app_executor::job_list& jobs)
+  {
+    ex.dispatch(tick, jobs, std::chrono::steady_clock::now());
+    ex.join();
+  }
+}
+
+TEST_CASE("footprints conflict on writes", "[app_executor]")
+{
+  const footprint r = footprint().reads("rib");
+  const footprint w = footprint().reads("rib").writes("state-a");
+  const footprint w2 = footprint().reads("rib").writes("state-b");
+  const footprint rw = footprint().reads("state-a");
+  REQUIRE (!r.conflicts(r));
+  REQUIRE (!w.conflicts(w2));
+  REQUIRE (w.conflicts(w));
+  REQUIRE (w.conflicts(rw));
+  REQUIRE (rw.conflicts(w));
+  REQUIRE (!rw.conflicts(w2));
+}
+
+TEST_CASE("executor without workers runs jobs in order", "[app_executor]")
+{
+  app_executor ex(0, {}, std::chrono::seconds(1));
+  ex.start();
+  int a, b;
+  std::vector<std::string> order;
+  app_executor::job_list jobs {
+    make_job("a1", &a, footprint(), [&order] (uint64_t) { order.push_back("a1"); }),
+    make_job("b1", &b, footprint(), [&order] (uint64_t) { order.push_back("b1"); }),
+    make_job("a2", &a, footprint(), [&order] (uint64_t t) { order.push_back("a2." + std::to_string(t)); })
+  };
+  run_tick(ex, 7, jobs);
+  REQUIRE (order == std::vector<std::string>({"a1", "b1", "a2.7"}));
+  REQUIRE (ex.get_jobs_run() == 3);
+
+  /* empty ticks are fine */
+  run_tick(ex, 8, {});
+  REQUIRE (ex.get_jobs_run() == 3);
+}
+
+TEST_CASE("executor runs independent jobs in parallel", "[app_executor]")
+{
+  app_executor ex(3, {}, std::chrono::seconds(1));
+  ex.start();
+  int owners[4];
+  std::mutex m;
+  std::set<std::thread::id> threads;
+  app_executor::job_list jobs;
+  for (int i = 0; i < 4; ++i)
+    jobs.push_back(make_job("sleep", &owners[i], footprint().reads("rib"),
+        [&m, &threads] (uint64_t) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+          std::lock_guard<std::mutex> l(m);
+          threads.insert(std::this_thread::get_id());
+        }));
+
+  for (uint64_t t = 0; t < 3; ++t) {
+    threads.clear();
+    const auto start = std::chrono::steady_clock::now();
+    run_tick(ex, t, jobs);
+    const auto dur = std::chrono::steady_clock::now() - start;
+    REQUIRE (threads.size() == 4);
+    REQUIRE (dur < std::chrono::milliseconds(150));
+  }
+  REQUIRE (ex.get_jobs_run() == 12);
+  ex.stop();
+}
+
+TEST_CASE("executor never overlaps conflicting jobs", "[app_executor]")
+{
+  app_executor ex(4, {}, std::chrono::seconds(1));
+  ex.start();
+  int owners[16];
+  std::atomic<int> active_a(0), active_same(0);
+  std::atomic<bool> overlap(false);
+  std::mutex m;
+  std::vector<int> order;
+  app_executor::job_list jobs;
+  for (int i = 0; i < 16; ++i) {
+    /* even jobs write "a", odd jobs share an owner, all read the RIB */
+    const bool even = i % 2 == 0;
+    footprint fp = footprint().reads("rib");
+    if (even) fp.writes("a");
+    std::atomic<int>& active = even ? active_a : active_same;
+    jobs.push_back(make_job("job" + std::to_string(i), even ? &owners[i] : &owners[1], fp,
+        [i, &active, &overlap, &m, &order] (uint64_t) {
+          if (active++ != 0) overlap = true;
+          std::this_thread::sleep_for(std::chrono::microseconds(300));
+          {
+            std::lock_guard<std::mutex> l(m);
+            order.push_back(i);
+          }
+          active--;
+        }));
+  }
+
+  for (uint64_t t = 0; t < 5; ++t) {
+    order.clear();
+    run_tick(ex, t, jobs);
+    REQUIRE (!overlap);
+    REQUIRE (order.size() == 16);
+    /* conflicting jobs keep their order of subscription */
+    int last_even = -1, last_odd = -1;
+    for (int i : order) {
+      int& last = i % 2 == 0 ? last_even : last_odd;
+      REQUIRE (i > last);
+      last = i;
+    }
+  }
+}
+
+TEST_CASE("executor skips jobs after their deadline", "[app_executor]")
+{
+  app_executor ex(1, {}, std::chrono::milliseconds(10));
+  ex.start();
+  int a, b;
+  std::atomic<int> run(0);
+  app_executor::job_list jobs {
+    make_job("slow", &a, footprint(), [&run] (uint64_t) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      run++;
+    }),
+    /* waits for slow, so misses the tick budget */
+    make_job("late", &a, footprint(), [&run] (uint64_t) { run++; }),
+    /* has its own deadline beyond the slow one */
+    make_job("own-deadline", &a, footprint(), [&run] (uint64_t) { run++; }, 100000),
+    make_job("throws", &b, footprint(), [] (uint64_t) { throw std::runtime_error("bad"); })
+  };
+  run_tick(ex, 0, jobs);
+  REQUIRE (run == 2);
+  REQUIRE (ex.get_jobs_run() == 3);
+  REQUIRE (ex.get_jobs_skipped() == 1);
+  REQUIRE (ex.get_jobs_overrun() == 1);
+}
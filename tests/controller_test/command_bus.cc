@@ -0,0 +1,71 @@
+#include "catch.hpp"
+#include "command_bus.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+using flexran::core::command_bus;
+
+TEST_CASE("commands run on submission without an executor", "[command_bus]")
+{
+  command_bus bus(4);
+  std::future<int> f;
+  REQUIRE (bus.submit([] { return 42; }, f));
+  REQUIRE (f.get() == 42);
+  REQUIRE (bus.get_executed() == 1);
+  REQUIRE (bus.get_depth() == 0);
+}
+
+TEST_CASE("commands are queued for the executor up to the capacity", "[command_bus]")
+{
+  command_bus bus(2);
+  bus.set_executor(std::this_thread::get_id());
+  std::vector<int> order;
+  std::future<void> f1, f2, f3;
+  std::thread producer([&] {
+    REQUIRE (bus.submit([&order] { order.push_back(1); }, f1));
+    REQUIRE (bus.submit([&order] { order.push_back(2); throw std::invalid_argument("no"); }, f2));
+    REQUIRE_FALSE (bus.submit([&order] { order.push_back(3); }, f3));
+  });
+  producer.join();
+  REQUIRE (bus.get_depth() == 2);
+  REQUIRE (bus.get_max_depth() == 2);
+  REQUIRE (bus.get_rejected() == 1);
+  REQUIRE (order.empty());
+
+  /* at least one command runs even if the deadline passed */
+  REQUIRE (bus.run(std::chrono::steady_clock::now()) == 1);
+  REQUIRE (bus.run(std::chrono::steady_clock::now() + std::chrono::seconds(1)) == 1);
+  REQUIRE (bus.run(std::chrono::steady_clock::now() + std::chrono::seconds(1)) == 0);
+  REQUIRE (order == (std::vector<int>{1, 2}));
+  f1.get();
+  REQUIRE_THROWS_AS (f2.get(), std::invalid_argument);
+  REQUIRE (bus.get_submitted() == 2);
+  REQUIRE (bus.get_executed() == 2);
+  REQUIRE (bus.get_depth() == 0);
+  REQUIRE (bus.get_wait().to_json_string().find("\"count\":2") != std::string::npos);
+}
+
+TEST_CASE("a waiting caller gets the result once the executor ran", "[command_bus]")
+{
+  command_bus bus;
+  std::atomic<bool> stop(false);
+  std::atomic<bool> running(false);
+  std::thread executor([&] {
+    bus.set_executor(std::this_thread::get_id());
+    running = true;
+    while (!stop)
+      bus.run(std::chrono::steady_clock::now() + std::chrono::microseconds(100));
+    bus.set_executor(std::thread::id());
+    bus.run(std::chrono::steady_clock::time_point::max());
+  });
+  while (!running)
+    std::this_thread::yield();
+
+  std::future<std::thread::id> f;
+  REQUIRE (bus.submit([] { return std::this_thread::get_id(); }, f));
+  REQUIRE (f.get() == executor.get_id());
+
+  stop = true;
+  executor.join();
+}
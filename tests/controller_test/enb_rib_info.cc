@@ -1,7 +1,17 @@
 #include "catch.hpp"
 #include "flexran.pb.h"
 #include "enb_rib_info.h"
+#include "flexran_merge.h"
 #include <iostream>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <google/protobuf/util/message_differencer.h>
+
+void fill_message(google::protobuf::Message &m, std::mt19937_64& mt);
 
 TEST_CASE("test update_eNB_config", "[enb_rib_info]")
 {
@@ -298,3 +308,381 @@ TEST_CASE("test update_LC_config correct merging", "[enb_rib_info]")
   REQUIRE (rib_info.get_lc_configs().lc_ue_config(0).lc_config_size() == 1);
   REQUIRE (rib_info.get_lc_configs().lc_ue_config(0).lc_config(0).lcid() == lcid2);
 }
+
+TEST_CASE("test KPI columns follow UE state changes and MAC stats", "[enb_rib_info]")
+{
+  const int rnti1 = 0x1111, rnti2 = 0x2222, rnti3 = 0x3333;
+  const int dl_sid = 5;
+
+  flexran::rib::enb_rib_info rib_info(1, {});
+
+  auto activate = [&rib_info] (int rnti, int dl_slice) {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->set_rnti(rnti);
+    sc.mutable_config()->set_dl_slice_id(dl_slice);
+    rib_info.update_UE_config(sc);
+  };
+  activate(rnti1, dl_sid);
+  activate(rnti2, 0);
+  activate(rnti3, dl_sid);
+
+  const flexran::rib::ue_kpi_columns& cols = rib_info.get_kpi_columns();
+  REQUIRE (cols.num_ues() == 3);
+  REQUIRE (cols.size() == 3);
+
+  protocol::flex_stats_reply sr;
+  auto add_report = [&sr] (int rnti, int cqi, int rlc) {
+    protocol::flex_ue_stats_report *r = sr.add_ue_report();
+    r->set_rnti(rnti);
+    r->set_flags(protocol::FLUST_DL_CQI | protocol::FLUST_RLC_BS | protocol::FLUST_BSR);
+    protocol::flex_dl_csi *csi = r->mutable_dl_cqi_report()->add_csi_report();
+    csi->set_serv_cell_index(0);
+    csi->mutable_p10csi()->set_wb_cqi(cqi);
+    r->add_rlc_report()->set_tx_queue_size(rlc);
+    r->add_rlc_report()->set_tx_queue_size(rlc);
+    r->add_bsr(rlc);
+  };
+  add_report(rnti1, 7, 100);
+  add_report(rnti2, 15, 10);
+  add_report(rnti3, 11, 1);
+  rib_info.update_mac_stats(sr);
+
+  REQUIRE (cols.wb_cqi()[cols.get_slot(rnti2)] == 15);
+  REQUIRE (cols.rlc_buffer()[cols.get_slot(rnti1)] == 200);
+  REQUIRE (rib_info.get_ue_mac_info(rnti1)->get_kpis().bsr == 100);
+  REQUIRE (cols.top_k_by_cqi(2) == std::vector<flexran::rib::rnti_t>{rnti2, rnti3});
+  REQUIRE (cols.sum_rlc_buffer() == 222);
+  REQUIRE (cols.sum_rlc_buffer_dl_slice(dl_sid) == 202);
+
+  SECTION("a report without CQI flag keeps the previous CQI") {
+    protocol::flex_stats_reply sr2;
+    protocol::flex_ue_stats_report *r = sr2.add_ue_report();
+    r->set_rnti(rnti1);
+    r->set_flags(protocol::FLUST_PHR);
+    r->set_phr(40);
+    rib_info.update_mac_stats(sr2);
+    REQUIRE (cols.wb_cqi()[cols.get_slot(rnti1)] == 7);
+    REQUIRE (cols.phr()[cols.get_slot(rnti1)] == 40);
+  }
+
+  SECTION("slice reassociation moves the buffer occupancy") {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_UPDATED);
+    sc.mutable_config()->set_rnti(rnti3);
+    sc.mutable_config()->set_dl_slice_id(0);
+    rib_info.update_UE_config(sc);
+    REQUIRE (cols.sum_rlc_buffer_dl_slice(dl_sid) == 200);
+  }
+
+  SECTION("deactivation frees and clears the slot") {
+    const int slot = cols.get_slot(rnti3);
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_DEACTIVATED);
+    sc.mutable_config()->set_rnti(rnti3);
+    rib_info.update_UE_config(sc);
+    REQUIRE (cols.num_ues() == 2);
+    REQUIRE (cols.get_slot(rnti3) == -1);
+    REQUIRE (cols.size() == 2);
+    REQUIRE (cols.active()[slot] == 0);
+    REQUIRE (cols.rlc_buffer()[slot] == 0);
+    REQUIRE (cols.sum_rlc_buffer() == 220);
+    activate(rnti3, 0);
+    REQUIRE (cols.get_slot(rnti3) == slot);
+  }
+}
+
+/* fills m randomly, but leaves every repeated field of m empty with
+ * probability 1/2 */
+static void fill_sparse_message(google::protobuf::Message& m, std::mt19937_64& mt)
+{
+  fill_message(m, mt);
+  const google::protobuf::Descriptor *d = m.GetDescriptor();
+  for (int i = 0; i < d->field_count(); ++i) {
+    if (d->field(i)->is_repeated() && mt() % 2)
+      m.GetReflection()->ClearField(&m, d->field(i));
+  }
+}
+
+/* reference implementation of the generated merge helpers through the
+ * reflection API, for any message */
+static void clear_repeated_if_present_reflection(google::protobuf::Message *dst,
+    const google::protobuf::Message& src)
+{
+  const google::protobuf::Descriptor *desc_src = src.GetDescriptor();
+  const google::protobuf::Reflection *refl_src = src.GetReflection();
+  const google::protobuf::Descriptor *desc_dst = dst->GetDescriptor();
+  const google::protobuf::Reflection *refl_dst = dst->GetReflection();
+  for (int i = 0; i < desc_src->field_count(); ++i) {
+    const google::protobuf::FieldDescriptor *field_src = desc_src->field(i);
+    if (!field_src) continue;
+    if (!field_src->is_repeated()) continue;
+    if (refl_src->FieldSize(src, field_src) == 0) continue;
+
+    const google::protobuf::FieldDescriptor *field_dst = desc_dst->field(i);
+    if (!field_dst) continue;
+    if (!field_dst->is_repeated()) continue;
+    refl_dst->ClearField(dst, field_dst);
+  }
+}
+
+template <typename T>
+static void compare_generated_reflection_merge(std::mt19937_64& mt)
+{
+  for (int i = 0; i < 50; ++i) {
+    T dst, src;
+    fill_sparse_message(dst, mt);
+    fill_sparse_message(src, mt);
+    T gen = dst;
+    T refl = dst;
+    protocol::merge::clear_repeated_if_present(&gen, src);
+    clear_repeated_if_present_reflection(&refl, src);
+    REQUIRE (google::protobuf::util::MessageDifferencer::Equals(gen, refl));
+    gen.MergeFrom(src);
+    refl.MergeFrom(src);
+    REQUIRE (google::protobuf::util::MessageDifferencer::Equals(gen, refl));
+  }
+}
+
+TEST_CASE("test generated merge helpers match the reflection version", "[enb_rib_info]")
+{
+  std::random_device rd;
+  const unsigned int seed = rd();
+  std::cout << "test enb_rib_info.cc: seed is " << seed << ", please note if test fails\n";
+  std::mt19937_64 mt(seed);
+
+  compare_generated_reflection_merge<protocol::flex_enb_config_reply>(mt);
+  compare_generated_reflection_merge<protocol::flex_cell_config>(mt);
+  compare_generated_reflection_merge<protocol::flex_ue_config>(mt);
+  compare_generated_reflection_merge<protocol::flex_measurement_info>(mt);
+
+  /* replacing semantics: present repeated fields replace, absent ones are
+   * kept */
+  protocol::flex_cell_config dst, src;
+  dst.add_mbsfn_subframe_config_rfperiod(1);
+  dst.add_mbsfn_subframe_config_rfoffset(2);
+  src.add_mbsfn_subframe_config_rfperiod(3);
+  protocol::merge::clear_repeated_if_present(&dst, src);
+  dst.MergeFrom(src);
+  REQUIRE (dst.mbsfn_subframe_config_rfperiod_size() == 1);
+  REQUIRE (dst.mbsfn_subframe_config_rfperiod(0) == 3);
+  REQUIRE (dst.mbsfn_subframe_config_rfoffset_size() == 1);
+}
+
+TEST_CASE("test change versions of BS entities", "[enb_rib_info]")
+{
+  const int rnti1 = 0x1111, rnti2 = 0x2222;
+  flexran::rib::enb_rib_info rib_info(1, {});
+
+  auto activate = [&rib_info] (int rnti) {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->set_rnti(rnti);
+    rib_info.update_UE_config(sc);
+  };
+  activate(rnti1);
+  activate(rnti2);
+
+  flexran::rib::bs_changes c;
+  REQUIRE (rib_info.get_changes_since(0, c) == true);
+  REQUIRE (c.added == true);
+  REQUIRE (c.ue_configs.size() == 2);
+  REQUIRE (c.ue_stats.empty());
+
+  uint64_t v = rib_info.get_version();
+  REQUIRE (rib_info.get_changes_since(v, c) == true);
+  REQUIRE (c.added == false);
+  REQUIRE (c.ue_configs.empty());
+
+  SECTION("stats of one UE") {
+    protocol::flex_stats_reply sr;
+    sr.add_ue_report()->set_rnti(rnti2);
+    rib_info.update_mac_stats(sr);
+    REQUIRE (rib_info.get_version() > v);
+    rib_info.get_changes_since(v, c);
+    REQUIRE (c.ue_stats == std::vector<flexran::rib::rnti_t>{rnti2});
+    REQUIRE (c.ue_configs.empty());
+    REQUIRE (c.cell_stats == false);
+  }
+
+  SECTION("UE config update and UE removal") {
+    protocol::flex_ue_config_reply ur;
+    ur.add_ue_config()->set_rnti(rnti1);
+    rib_info.update_UE_config(ur);
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_DEACTIVATED);
+    sc.mutable_config()->set_rnti(rnti2);
+    rib_info.update_UE_config(sc);
+    rib_info.get_changes_since(v, c);
+    REQUIRE (c.ue_configs == std::vector<flexran::rib::rnti_t>{rnti1});
+    REQUIRE (c.removed_ues == std::vector<flexran::rib::rnti_t>{rnti2});
+
+    /* a re-added UE is reported as changed, not removed */
+    activate(rnti2);
+    rib_info.get_changes_since(v, c);
+    REQUIRE (c.ue_configs.size() == 2);
+    REQUIRE (c.removed_ues.empty());
+  }
+
+  SECTION("old removals are forgotten") {
+    for (int i = 0; i < 1100; ++i) {
+      activate(0x3000 + i);
+      protocol::flex_ue_state_change sc;
+      sc.set_type(protocol::FLUESC_DEACTIVATED);
+      sc.mutable_config()->set_rnti(0x3000 + i);
+      rib_info.update_UE_config(sc);
+    }
+    REQUIRE (rib_info.get_changes_since(v, c) == false);
+    REQUIRE (rib_info.get_changes_since(rib_info.get_version(), c) == true);
+  }
+}
+
+TEST_CASE("test readers see the state of the last publish", "[enb_rib_info]")
+{
+  const int rnti = 0x1234;
+  const uint64_t imsi = 208950000000001;
+  flexran::rib::enb_rib_info rib_info(1, {});
+  protocol::flex_enb_config_reply ec;
+  ec.add_cell_config()->mutable_slice_config()->mutable_dl()->add_slices()->set_id(3);
+  rib_info.update_eNB_config(ec);
+  protocol::flex_ue_state_change sc;
+  sc.set_type(protocol::FLUESC_ACTIVATED);
+  sc.mutable_config()->set_rnti(rnti);
+  sc.mutable_config()->set_imsi(imsi);
+  rib_info.update_UE_config(sc);
+  protocol::flex_stats_reply sr;
+  protocol::flex_ue_stats_report *r = sr.add_ue_report();
+  r->set_rnti(rnti);
+  r->set_flags(protocol::FLUST_PHR);
+  r->set_phr(17);
+  rib_info.update_mac_stats(sr);
+
+  /* apps see the update immediately, other readers only after publish() */
+  flexran::rib::rnti_t found;
+  std::string json;
+  REQUIRE (rib_info.get_ue_mac_info(rnti)->get_mac_stats_report().phr() == 17);
+  REQUIRE (rib_info.get_rnti(imsi, found) == false);
+  REQUIRE (rib_info.dump_ue_spec_stats_by_rnti_to_json_string(rnti, json) == false);
+  REQUIRE (rib_info.dump_configs_to_json_string().find("\"sliceConfig\"") == std::string::npos);
+
+  rib_info.publish();
+  REQUIRE (rib_info.get_rnti(imsi, found) == true);
+  REQUIRE (found == rnti);
+  REQUIRE (rib_info.has_dl_slice(3) == true);
+  REQUIRE (rib_info.num_dl_slices() == 1);
+  REQUIRE (rib_info.dump_ue_spec_stats_by_rnti_to_json_string(rnti, json) == true);
+  REQUIRE (json.find("\"phr\":17") != std::string::npos);
+  REQUIRE (rib_info.dump_configs_to_json_string().find("\"sliceConfig\"") != std::string::npos);
+
+  /* a held copy does not change */
+  std::shared_ptr<const protocol::flex_ue_stats_report> held =
+      rib_info.get_ue_mac_info(rnti)->get_mac_stats_snapshot();
+  r->set_phr(18);
+  rib_info.update_mac_stats(sr);
+  rib_info.publish();
+  REQUIRE (held->phr() == 17);
+  REQUIRE (rib_info.get_ue_mac_info(rnti)->get_mac_stats_snapshot()->phr() == 18);
+
+  sc.set_type(protocol::FLUESC_DEACTIVATED);
+  rib_info.update_UE_config(sc);
+  REQUIRE (rib_info.dump_ue_spec_stats_by_rnti_to_json_string(rnti, json) == true);
+  rib_info.publish();
+  REQUIRE (rib_info.dump_ue_spec_stats_by_rnti_to_json_string(rnti, json) == false);
+  REQUIRE (rib_info.get_rnti(imsi, found) == false);
+}
+
+/* Emulates the RT loop (stats of all UEs and a UE reconfiguration every
+ * 1ms) while other threads continuously dump the BS to JSON like the
+ * northbound API does, and reports the duration of the RT updates. Not run
+ * by default, use "[.stress]" to run. */
+TEST_CASE("RIB writer latency under concurrent JSON dumps", "[.stress]")
+{
+  const int num_ues = 64;
+  const int num_rounds = 3000;
+  const int num_readers = 4;
+  flexran::rib::enb_rib_info rib_info(1, {});
+
+  protocol::flex_enb_config_reply ec;
+  for (int c = 0; c < 2; ++c) {
+    protocol::flex_cell_config *cc = ec.add_cell_config();
+    cc->set_phy_cell_id(c);
+    for (int s = 0; s < 8; ++s)
+      cc->mutable_slice_config()->mutable_dl()->add_slices()->set_id(s);
+  }
+  rib_info.update_eNB_config(ec);
+
+  protocol::flex_stats_reply sr;
+  for (int i = 0; i < num_ues; ++i) {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->set_rnti(100 + i);
+    sc.mutable_config()->set_imsi(208950000000000 + i);
+    rib_info.update_UE_config(sc);
+    protocol::flex_ue_stats_report *r = sr.add_ue_report();
+    r->set_rnti(100 + i);
+    r->set_flags(protocol::FLUST_DL_CQI | protocol::FLUST_RLC_BS
+        | protocol::FLUST_MAC_STATS | protocol::FLUST_PDCP_STATS);
+    r->mutable_dl_cqi_report()->add_csi_report()->mutable_p10csi()->set_wb_cqi(10);
+    for (int l = 0; l < 3; ++l)
+      r->add_rlc_report()->set_tx_queue_size(l);
+    r->mutable_mac_stats()->set_total_bytes_sdus_dl(1000);
+    r->mutable_pdcp_stats()->set_pkt_tx_bytes(1000);
+  }
+
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> dumps{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < num_readers; ++t) {
+    readers.emplace_back([&] {
+      while (!stop) {
+        std::string s = rib_info.dump_configs_to_json_string();
+        s += rib_info.dump_mac_stats_to_json_string();
+        dumps++;
+      }
+    });
+  }
+
+  std::vector<double> lat;
+  lat.reserve(num_rounds);
+  for (int n = 0; n < num_rounds; ++n) {
+    const auto start = std::chrono::steady_clock::now();
+    rib_info.update_mac_stats(sr, n);
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_UPDATED);
+    sc.mutable_config()->set_rnti(100 + n % num_ues);
+    sc.mutable_config()->set_dl_slice_id(n % 8);
+    rib_info.update_UE_config(sc);
+    rib_info.publish();
+    lat.push_back(std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - start).count());
+    std::this_thread::sleep_until(start + std::chrono::milliseconds(1));
+  }
+  stop = true;
+  for (auto& t : readers) t.join();
+
+  std::sort(lat.begin(), lat.end());
+  std::cout << "RT update latency [us] over " << num_rounds << " rounds, "
+            << num_ues << " UEs, " << num_readers << " readers ("
+            << dumps << " dumps): median " << lat[lat.size() / 2]
+            << " p99 " << lat[lat.size() * 99 / 100]
+            << " p99.9 " << lat[lat.size() * 999 / 1000]
+            << " max " << lat.back() << "\n";
+  REQUIRE (dumps > 0);
+}
+
+TEST_CASE("test SFN/SF is extrapolated from the last subframe trigger", "[enb_rib_info]")
+{
+  flexran::rib::enb_rib_info rib_info(1, {});
+  REQUIRE (rib_info.get_sfn_sf_at(100) == 0);
+
+  protocol::flex_sf_trigger sf;
+  sf.set_sfn_sf(flexran::rib::get_sfn_sf(1023, 7));
+  rib_info.update_subframe(sf, 100);
+  REQUIRE (rib_info.get_sfn_sf_at(100) == flexran::rib::get_sfn_sf(1023, 7));
+  REQUIRE (rib_info.get_sfn_sf_at(102) == flexran::rib::get_sfn_sf(1023, 9));
+  /* the SFN wraps around */
+  REQUIRE (rib_info.get_sfn_sf_at(103) == flexran::rib::get_sfn_sf(0, 0));
+  REQUIRE (rib_info.get_sfn_sf_at(100 + 10240) == flexran::rib::get_sfn_sf(1023, 7));
+  /* a tick before the trigger */
+  REQUIRE (rib_info.get_sfn_sf_at(90) == flexran::rib::get_sfn_sf(1022, 7));
+}
@@ -0,0 +1,171 @@
+#include "catch.hpp"
+#include "subscription.h"
+#include "rib_updater.h"
+#include "requests_manager.h"
+#include "async_xface.h"
+#include "rib_test_agents.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using flexran::event::bs_ue_event;
+using flexran::event::event_filter;
+using flexran::event::event_kind;
+using flexran::event::subscription;
+
+TEST_CASE("filtered subscriptions only get matching events", "[event_filter]")
+{
+  subscription sub;
+  std::vector<std::string> calls;
+  auto record = [&calls] (const std::string& who) {
+    return [&calls, who] (const bs_ue_event& e) {
+      calls.push_back(who + ":" + flexran::event::to_string(e.kind) + ":"
+          + std::to_string(e.bs_id) + ":" + std::to_string(e.rnti));
+    };
+  };
+  int unfiltered = 0;
+  sub.subscribe_ue_connect([&unfiltered] (uint64_t, flexran::rib::rnti_t) { unfiltered++; });
+
+  sub.subscribe_events(event_filter(), record("all"), "all");
+  sub.subscribe_events(event_filter().on(event_kind::ue_connect).bs(1).bs(3),
+      record("bs13"), "bs13");
+  sub.subscribe_events(event_filter().on(event_kind::ue_update).rnti(17),
+      record("rnti17"), "rnti17");
+  auto imsi = sub.subscribe_events(event_filter().on(event_kind::ue_connect)
+      .imsi_prefix("20895"), record("imsi"), "imsi");
+  REQUIRE (sub.needs_imsi());
+
+  sub.notify(event_kind::bs_add, 2);
+  sub.notify(event_kind::ue_connect, 2, 5, 208950000000001);
+  sub.notify(event_kind::ue_connect, 3, 6, 208940000000001);
+  sub.notify(event_kind::ue_update, 3, 17);
+  sub.notify(event_kind::ue_update, 3, 18);
+  REQUIRE (calls == (std::vector<std::string>{
+      "all:bs_add:2:0",
+      "all:ue_connect:2:5", "imsi:ue_connect:2:5",
+      "all:ue_connect:3:6", "bs13:ue_connect:3:6",
+      "all:ue_update:3:17", "rnti17:ue_update:3:17",
+      "all:ue_update:3:18"}));
+  REQUIRE (unfiltered == 2);
+
+  const std::string list = sub.subscriptions_to_json_string();
+  REQUIRE (list.find("\"ue_connect\":1") != std::string::npos);
+  REQUIRE (list.find("{\"app\":\"bs13\",\"filter\":\"kinds=ue_connect bs=1,3\"}")
+      != std::string::npos);
+  REQUIRE (list.find("{\"app\":\"imsi\",\"filter\":\"kinds=ue_connect imsi=20895*\"}")
+      != std::string::npos);
+  REQUIRE (list.find("{\"app\":\"all\",\"filter\":\"kinds=all\"}") != std::string::npos);
+
+  /* disconnected subscriptions are not called and removed from the index */
+  imsi.disconnect();
+  calls.clear();
+  sub.notify(event_kind::ue_connect, 1, 7, 208950000000002);
+  REQUIRE (calls == (std::vector<std::string>{"all:ue_connect:1:7", "bs13:ue_connect:1:7"}));
+  REQUIRE_FALSE (sub.needs_imsi());
+  REQUIRE (sub.subscriptions_to_json_string().find("imsi=") == std::string::npos);
+}
+
+TEST_CASE("filtered subscriptions of other threads apply in the task manager",
+    "[event_filter]")
+{
+  subscription sub;
+  sub.set_applier(std::this_thread::get_id());
+  int called = 0;
+  std::thread rest([&] {
+    sub.subscribe_events(event_filter().on(event_kind::bs_add),
+        [&called] (const bs_ue_event&) { called++; }, "rest");
+  });
+  rest.join();
+  /* not in the index before the task manager applies it */
+  sub.notify(event_kind::bs_add, 1);
+  REQUIRE (called == 0);
+  sub.apply_deferred();
+  sub.notify(event_kind::bs_add, 1);
+  REQUIRE (called == 1);
+
+  std::string list;
+  std::atomic_bool listed{false};
+  std::thread lister([&] {
+    list = sub.defer([&sub] { return sub.subscriptions_to_json_string(); }).get();
+    listed = true;
+  });
+  while (!listed) {
+    sub.apply_deferred();
+    std::this_thread::yield();
+  }
+  lister.join();
+  REQUIRE (list.find("{\"app\":\"rest\",\"filter\":\"kinds=bs_add\"}")
+      != std::string::npos);
+  sub.set_applier(std::thread::id());
+}
+
+TEST_CASE("filtered inboxes keep the order of events", "[event_filter]")
+{
+  subscription sub;
+  auto inbox = std::make_shared<flexran::event::event_inbox>();
+  sub.subscribe_inbox(event_filter().on(event_kind::ue_connect)
+      .on(event_kind::ue_disconnect).bs(1), inbox);
+  sub.notify(event_kind::ue_connect, 1, 10);
+  sub.notify(event_kind::ue_connect, 2, 11);
+  sub.notify(event_kind::ue_update, 1, 10);
+  sub.notify(event_kind::ue_disconnect, 1, 10);
+
+  std::vector<event_kind> kinds;
+  inbox->drain([&kinds] (const bs_ue_event& e) { kinds.push_back(e.kind); });
+  REQUIRE (kinds == (std::vector<event_kind>{event_kind::ue_connect,
+        event_kind::ue_disconnect}));
+}
+
+namespace {
+  void send_ue_state_change(flexran::network::async_xface& xface, int agent_id,
+      protocol::flex_ue_state_change_type type, int rnti, uint64_t imsi = 0)
+  {
+    protocol::flexran_message m;
+    m.set_msg_dir(protocol::INITIATING_MESSAGE);
+    protocol::flex_ue_state_change *sc = m.mutable_ue_state_change_msg();
+    sc->set_type(type);
+    sc->mutable_config()->set_rnti(rnti);
+    if (imsi > 0)
+      sc->mutable_config()->set_imsi(imsi);
+    const std::string s = m.SerializeAsString();
+    xface.forward_message(new flexran::network::tagged_message(s.data(), s.size(), agent_id));
+  }
+}
+
+TEST_CASE("IMSI filters get UE events of state changes without IMSI", "[event_filter]")
+{
+  flexran::rib::Rib rib;
+  flexran::network::async_xface xface("127.0.0.1", 2210);
+  flexran::core::requests_manager rm(rib, xface);
+  subscription sub;
+  flexran::rib::rib_updater updater(rib, xface, rm, sub);
+  REQUIRE (rib.add_pending_agent(make_bs_agent(0, 1)));
+  REQUIRE (rib.new_eNB_config_entry(1));
+
+  std::vector<std::string> calls;
+  sub.subscribe_events(event_filter().on(event_kind::ue_update)
+      .on(event_kind::ue_disconnect).imsi_prefix("20895"),
+      [&calls] (const bs_ue_event& e) {
+        calls.push_back(flexran::event::to_string(e.kind) + ":" + std::to_string(e.rnti));
+      }, "imsi");
+
+  flexran::rib::enb_rib_info& bs = *rib.get_bs(1);
+  for (int rnti : {10, 11}) {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->set_rnti(rnti);
+    sc.mutable_config()->set_imsi((rnti == 10 ? 208950000000000 : 208940000000000) + rnti);
+    bs.update_UE_config(sc);
+  }
+
+  /* only the RNTI is given, the IMSI is in the RIB */
+  send_ue_state_change(xface, 0, protocol::FLUESC_UPDATED, 10);
+  send_ue_state_change(xface, 0, protocol::FLUESC_UPDATED, 11);
+  send_ue_state_change(xface, 0, protocol::FLUESC_DEACTIVATED, 10);
+  send_ue_state_change(xface, 0, protocol::FLUESC_DEACTIVATED, 11);
+  /* unknown to the RIB, the message has the IMSI */
+  send_ue_state_change(xface, 0, protocol::FLUESC_DEACTIVATED, 12, 208950000000012);
+  REQUIRE (updater.update_rib() == 5);
+  REQUIRE (calls == (std::vector<std::string>{
+      "ue_update:10", "ue_disconnect:10", "ue_disconnect:12"}));
+}
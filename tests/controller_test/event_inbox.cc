@@ -0,0 +1,45 @@
+#include "catch.hpp"
+#include "event_inbox.h"
+#include <thread>
+#include <vector>
+
+using flexran::event::event_inbox;
+using flexran::event::event_kind;
+using flexran::event::bs_ue_event;
+
+TEST_CASE("event inbox delivers in order and counts dropped events", "[event_inbox]")
+{
+  event_inbox inbox(4);
+  REQUIRE (inbox.capacity() == 4);
+  inbox.push({event_kind::bs_add, 1, 0});
+  inbox.push({event_kind::ue_connect, 1, 17});
+  inbox.push({event_kind::ue_update, 1, 17});
+  inbox.push({event_kind::ue_disconnect, 1, 17});
+  inbox.push({event_kind::bs_remove, 1, 0});
+  REQUIRE (inbox.get_dropped() == 1);
+
+  std::vector<event_kind> kinds;
+  REQUIRE (inbox.drain([&kinds] (const bs_ue_event& e) { kinds.push_back(e.kind); }) == 4);
+  REQUIRE (kinds == (std::vector<event_kind>{event_kind::bs_add,
+        event_kind::ue_connect, event_kind::ue_update, event_kind::ue_disconnect}));
+  REQUIRE (inbox.size() == 0);
+}
+
+TEST_CASE("event inbox keeps the order between two threads", "[event_inbox]")
+{
+  const uint64_t n = 100000;
+  event_inbox inbox(n);
+  std::thread producer([&inbox, n] {
+    for (uint64_t i = 0; i < n; ++i)
+      inbox.push({event_kind::ue_update, i, 0});
+  });
+  uint64_t expected = 0;
+  bool ordered = true;
+  while (expected < n) {
+    if (inbox.drain([&] (const bs_ue_event& e) { ordered = ordered && e.bs_id == expected++; }) == 0)
+      std::this_thread::yield();
+  }
+  producer.join();
+  REQUIRE (ordered);
+  REQUIRE (inbox.get_dropped() == 0);
+}
@@ -0,0 +1,120 @@
+#include "catch.hpp"
+#include "flexran_json.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <google/protobuf/util/json_util.h>
+
+void fill_message(google::protobuf::Message &m, std::mt19937_64& mt);
+
+namespace {
+  std::string reflection_json(const google::protobuf::Message& m)
+  {
+    std::string s;
+    google::protobuf::util::MessageToJsonString(m, &s,
+        google::protobuf::util::JsonPrintOptions());
+    return s;
+  }
+
+  template <typename M>
+  std::string generated_json(const M& m)
+  {
+    std::string s;
+    protocol::json::write(s, m);
+    return s;
+  }
+
+  template <typename M>
+  void require_random_matches(std::mt19937_64& mt, int n)
+  {
+    for (int i = 0; i < n; ++i) {
+      M m;
+      fill_message(m, mt);
+      REQUIRE (generated_json(m) == reflection_json(m));
+    }
+  }
+}
+
+TEST_CASE("generated JSON encoders match the reflection output", "[json_gen]")
+{
+  std::random_device rd;
+  const unsigned int seed = rd();
+  std::cout << "test json_gen.cc: seed is " << seed << ", please note if test fails\n";
+  std::mt19937_64 mt(seed);
+
+  require_random_matches<protocol::flex_enb_config_reply>(mt, 50);
+  require_random_matches<protocol::flex_ue_config_reply>(mt, 50);
+  require_random_matches<protocol::flex_lc_config_reply>(mt, 50);
+  require_random_matches<protocol::flex_ue_stats_report>(mt, 50);
+  require_random_matches<protocol::flex_cell_stats_report>(mt, 50);
+
+  /* empty messages and present fields with default values */
+  protocol::flex_ue_stats_report ue;
+  REQUIRE (generated_json(ue) == "{}");
+  ue.set_rnti(0);
+  ue.add_rlc_report();
+  ue.mutable_mac_stats()->set_tbs_dl(0);
+  REQUIRE (generated_json(ue) == reflection_json(ue));
+
+  /* the output is appended */
+  std::string s = "[";
+  protocol::json::write(s, ue);
+  REQUIRE (s == "[" + reflection_json(ue));
+}
+
+TEST_CASE("generated JSON encoders escape strings like the reflection output", "[json_gen]")
+{
+  protocol::flex_enb_config_reply m;
+  m.mutable_s1ap()->set_enb_name("q\"b\\/\b\f\n\r\t\x01\x1f<a>&'\x7f");
+  protocol::flex_slice *s = m.add_cell_config()->mutable_slice_config()
+      ->mutable_dl()->add_slices();
+  /* é, soft hyphen, line separator, BOM, euro, emoji, language tag */
+  s->set_label("\xc3\xa9\xc2\xad\xe2\x80\xa8\xef\xbb\xbf\xe2\x82\xac"
+               "\xf0\x9f\x98\x80\xf3\xa0\x80\x81");
+  s->set_scheduler(std::string("a\0b", 3));
+  s->mutable_static_()->set_poslow(-1u);
+  m.mutable_s1ap()->add_mme()->set_s1_ip("10.0.0.1");
+  REQUIRE (generated_json(m) == reflection_json(m));
+
+  /* invalid UTF-8 is left to the reflection API */
+  for (const std::string bad : {"a\xff" "b", "a\xe2\x82" "b", "a\xc0\xaf" "b",
+                                "a\xed\xa0\x80" "b", "a\xf4\x90\x80\x80" "b", "ab\xe2"}) {
+    s->set_label(bad);
+    REQUIRE (generated_json(m) == reflection_json(m));
+  }
+}
+
+/* Compares the throughput of the generated JSON encoders against the
+ * reflection API. Not run by default, use "[.stress]" to run. */
+TEST_CASE("generated JSON encoder throughput", "[.stress][json_gen]")
+{
+  std::mt19937_64 mt(42);
+  std::vector<protocol::flex_ue_stats_report> reports(256);
+  for (auto& r : reports)
+    fill_message(r, mt);
+  const int num_rounds = 50;
+
+  std::size_t bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < num_rounds; ++n)
+    for (const auto& r : reports)
+      bytes += reflection_json(r).size();
+  const double reflection_s = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  std::string out;
+  start = std::chrono::steady_clock::now();
+  for (int n = 0; n < num_rounds; ++n) {
+    for (const auto& r : reports) {
+      out.clear();
+      protocol::json::write(out, r);
+    }
+  }
+  const double generated_s = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  const double mb = bytes / 1e6;
+  std::cout << "JSON of " << reports.size() << " UE stats reports: reflection "
+            << mb / reflection_s << " MB/s, generated " << mb / generated_s << " MB/s\n";
+  REQUIRE (out.size() > 0);
+}
@@ -0,0 +1,279 @@
+#include "catch.hpp"
+#include "flexran.pb.h"
+#include "rib.h"
+#include "json_writer.h"
+#include "rib_test_agents.h"
+#include "stats_manager.h"
+#include "requests_manager.h"
+#include "async_xface.h"
+#include "subscription.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <google/protobuf/util/json_util.h>
+
+using flexran::rib::json_writer;
+
+TEST_CASE("json writer separates members and escapes strings", "[json_writer]")
+{
+  json_writer w;
+  w.begin_object();
+  w.key("a").value(1);
+  w.key("b", true).value(int64_t(-9223372036854775807 - 1));
+  w.key("c").begin_array();
+  w.value(uint64_t(18446744073709551615u)).value(true).null();
+  w.begin_object().end_object();
+  w.begin_array().value(0).end_array();
+  w.end_array();
+  w.key("d").value("q\"b\\\n\x01");
+  w.key("e").raw("{\"x\":[]}");
+  w.end_object();
+  REQUIRE (w.depth() == 0);
+  REQUIRE (w.str() == "{\"a\":1,\"b\": -9223372036854775808,"
+      "\"c\":[18446744073709551615,true,null,{},[0]],"
+      "\"d\":\"q\\\"b\\\\\\n\\u0001\",\"e\":{\"x\":[]}}");
+
+  /* the buffer is reused */
+  const std::size_t cap = w.str().capacity();
+  w.clear();
+  w.begin_array().end_array();
+  REQUIRE (w.str() == "[]");
+  REQUIRE (w.str().capacity() == cap);
+
+  std::string out;
+  w.flush(out);
+  REQUIRE (out == "[]");
+  REQUIRE (w.size() == 0);
+}
+
+namespace {
+  void fill_bs(flexran::rib::enb_rib_info& info, int num_ues, int num_cells = 2)
+  {
+    protocol::flex_enb_config_reply ec;
+    for (int c = 0; c < num_cells; ++c) {
+      protocol::flex_cell_config *cc = ec.add_cell_config();
+      cc->set_phy_cell_id(c);
+      cc->set_dl_freq(2680);
+      cc->set_duplex_mode(protocol::FLDM_FDD);
+      for (int s = 0; s < 4; ++s)
+        cc->mutable_slice_config()->mutable_dl()->add_slices()->set_id(s);
+    }
+    info.update_eNB_config(ec);
+
+    protocol::flex_stats_reply sr;
+    for (int i = 0; i < num_ues; ++i) {
+      protocol::flex_ue_state_change sc;
+      sc.set_type(protocol::FLUESC_ACTIVATED);
+      sc.mutable_config()->set_rnti(100 + i);
+      sc.mutable_config()->set_imsi(208950000000000 + i);
+      info.update_UE_config(sc);
+      protocol::flex_ue_stats_report *r = sr.add_ue_report();
+      r->set_rnti(100 + i);
+      r->set_phr(20 + i);
+      r->mutable_dl_cqi_report()->add_csi_report()->mutable_p10csi()->set_wb_cqi(10);
+      for (int l = 0; l < 3; ++l)
+        r->add_rlc_report()->set_tx_queue_size(l);
+      r->mutable_mac_stats()->set_total_bytes_sdus_dl(1000 * i);
+      r->mutable_pdcp_stats()->set_pkt_tx_bytes(1000 * i);
+    }
+    info.update_mac_stats(sr, 1);
+    info.publish();
+  }
+
+  std::string message_json(const google::protobuf::Message& m)
+  {
+    std::string s;
+    google::protobuf::util::MessageToJsonString(m, &s,
+        google::protobuf::util::JsonPrintOptions());
+    return s;
+  }
+
+  /* the JSON as built before the json_writer, by concatenation */
+  std::string legacy_mac_stats(const flexran::rib::enb_rib_info& info)
+  {
+    std::vector<std::string> ues;
+    for (const auto& ue : info.get_ue_configs().ue_config()) {
+      auto mac = info.get_ue_mac_info(ue.rnti());
+      const std::array<uint8_t, flexran::rib::MAX_NUM_HARQ> harq_stats = mac->get_harq_snapshot(0);
+      std::array<std::string, 8> harq;
+      for (int i = 0; i < 8; i++)
+        harq[i] = harq_stats[i] == protocol::FLHS_ACK ? "\"ACK\"" : "\"NACK\"";
+      ues.push_back(flexran::rib::ue_mac_rib_info::format_stats_to_json(ue.rnti(),
+            message_json(*mac->get_mac_stats_snapshot()), harq));
+    }
+    return flexran::rib::enb_rib_info::format_mac_stats_to_json(info.get_id(), ues);
+  }
+
+  std::string legacy_configs(const flexran::rib::enb_rib_info& info, const std::string& agents)
+  {
+    return flexran::rib::enb_rib_info::format_configs_to_json(info.get_id(), agents,
+        message_json(info.get_enb_config()), message_json(info.get_ue_configs()),
+        message_json(info.get_lc_configs()));
+  }
+}
+
+TEST_CASE("RIB dumps through the json writer match the concatenated JSON", "[json_writer]")
+{
+  flexran::rib::enb_rib_info info(3584,
+      {make_agent(0, 3584, {protocol::LOPHY, protocol::HIPHY, protocol::LOMAC})});
+  fill_bs(info, 4);
+
+  REQUIRE (info.dump_mac_stats_to_json_string() == legacy_mac_stats(info));
+  REQUIRE (info.dump_configs_to_json_string() == legacy_configs(info,
+        "[{\"agent_id\":0,\"ip_port\":\"127.0.0.1:4325\",\"bs_id\":3584,"
+        "\"capabilities\":[\"LOPHY\",\"HIPHY\",\"LOMAC\"],\"splits\":[]}]"));
+
+  json_writer w;
+  w.begin_array();
+  info.dump_mac_stats_to_json(w);
+  info.dump_mac_stats_to_json(w);
+  w.end_array();
+  REQUIRE (w.str() == flexran::rib::Rib::format_mac_stats_to_json(
+        {legacy_mac_stats(info), legacy_mac_stats(info)}));
+}
+
+TEST_CASE("RIB dumps BS by BS in parts of bounded size", "[json_writer]")
+{
+  flexran::rib::Rib rib;
+  std::size_t largest_bs = 0;
+  for (int i = 1; i <= 8; ++i) {
+    REQUIRE (rib.add_pending_agent(make_bs_agent(i, i)));
+    REQUIRE (rib.new_eNB_config_entry(i));
+    fill_bs(*rib.get_bs(i), 4 * i);
+    json_writer b;
+    rib.get_bs(i)->dump_configs_to_json(b);
+    largest_bs = std::max(largest_bs, b.size());
+    b.clear();
+    rib.get_bs(i)->dump_mac_stats_to_json(b);
+    largest_bs = std::max(largest_bs, b.size());
+  }
+
+  json_writer ref;
+  ref.begin_object();
+  ref.key("eNB_config");
+  rib.dump_all_enb_configurations_to_json(ref);
+  ref.key("mac_stats");
+  rib.dump_all_mac_stats_to_json(ref);
+  ref.end_object();
+
+  const std::size_t chunk_size = 4096;
+  std::string all, part;
+  std::size_t largest_part = 0;
+  int num_parts = 0;
+  json_writer w;
+  w.begin_object();
+  rib.dump_json_by_bs(w, true, true,
+      [&] (json_writer& jw) {
+        if (jw.size() < chunk_size) return;
+        jw.flush(part);
+        all += part;
+        largest_part = std::max(largest_part, part.size());
+        num_parts++;
+      });
+  w.end_object();
+  w.flush(part);
+  all += part;
+  REQUIRE (all == ref.str());
+  REQUIRE (num_parts > 1);
+  /* one BS on top of a part below chunk_size, plus the member key */
+  REQUIRE (largest_part < chunk_size + largest_bs + 32);
+
+  /* configurations only */
+  ref.clear();
+  ref.begin_object();
+  ref.key("eNB_config");
+  rib.dump_all_enb_configurations_to_json(ref);
+  ref.end_object();
+  w.clear();
+  w.begin_object();
+  rib.dump_json_by_bs(w, true, false, [] (json_writer&) {});
+  w.end_object();
+  REQUIRE (w.str() == ref.str());
+
+  /* the BS list is published again after removing a BS */
+  REQUIRE (rib.remove_eNB_config_entry(8));
+  w.clear();
+  w.begin_object();
+  rib.dump_json_by_bs(w, true, false, [] (json_writer&) {});
+  w.end_object();
+  REQUIRE (w.str() != ref.str());
+  ref.clear();
+  ref.begin_object();
+  ref.key("eNB_config");
+  rib.dump_all_enb_configurations_to_json(ref);
+  ref.end_object();
+  REQUIRE (w.str() == ref.str());
+}
+
+TEST_CASE("stats are streamed in parts of chunk size", "[json_writer]")
+{
+  flexran::rib::Rib rib;
+  flexran::network::async_xface xface("127.0.0.1", 2210);
+  flexran::core::requests_manager rm(rib, xface);
+  flexran::event::subscription ev;
+  flexran::app::stats::stats_manager stats(rib, rm, ev);
+  for (int i = 1; i <= 8; ++i) {
+    REQUIRE (rib.add_pending_agent(make_bs_agent(i, i)));
+    REQUIRE (rib.new_eNB_config_entry(i));
+    fill_bs(*rib.get_bs(i), 4 * i);
+  }
+
+  const std::size_t chunk_size = 4096;
+  std::vector<std::string> parts;
+  stats.stats_to_json_stream(true, true, chunk_size,
+      [&parts] (const std::string& part) { parts.push_back(part); });
+  REQUIRE (parts.size() > 2);
+  std::string all;
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    if (i + 1 < parts.size())
+      REQUIRE (parts[i].size() == chunk_size);
+    else
+      REQUIRE (parts[i].size() <= chunk_size);
+    all += parts[i];
+  }
+  /* the same as the dump in one string, except for the time */
+  const std::string ref = stats.all_stats_to_json_string();
+  REQUIRE (all.substr(all.find("\"eNB_config\""))
+      == ref.substr(ref.find("\"eNB_config\"")));
+}
+
+/* Compares the throughput of the JSON dump of a large BS through the
+ * json_writer against the previous concatenation of strings. Not run by
+ * default, use "[.stress]" to run. */
+TEST_CASE("json writer throughput of a RIB dump", "[.stress][json_writer]")
+{
+  const int num_ues = 256;
+  const int num_rounds = 200;
+  flexran::rib::enb_rib_info info(3584,
+      {make_agent(0, 3584, {protocol::LOPHY, protocol::HIPHY, protocol::LOMAC})});
+  fill_bs(info, num_ues, 4);
+  const std::string agents = "[]";
+
+  std::size_t bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < num_rounds; ++n) {
+    std::vector<std::string> bs{legacy_configs(info, agents), legacy_mac_stats(info)};
+    bytes += flexran::rib::Rib::format_mac_stats_to_json(bs).size();
+  }
+  const double legacy_s = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  json_writer w;
+  start = std::chrono::steady_clock::now();
+  for (int n = 0; n < num_rounds; ++n) {
+    w.clear();
+    w.begin_array();
+    info.dump_configs_to_json(w);
+    info.dump_mac_stats_to_json(w);
+    w.end_array();
+  }
+  const double writer_s = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  const double mb = bytes / 1e6;
+  std::cout << "RIB dump of " << num_ues << " UEs (" << bytes / num_rounds
+            << " bytes): concatenated " << mb / legacy_s << " MB/s, json_writer "
+            << mb / writer_s << " MB/s\n";
+  REQUIRE (w.size() > 0);
+}
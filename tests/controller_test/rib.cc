@@ -2,6 +2,7 @@
 #include "flexran.pb.h"
 #include "rib.h"
 #include "agent_info.h"
+#include "rib_test_agents.h"
 #include <vector>
 
 using cap = protocol::flex_bs_capability;
@@ -30,6 +31,12 @@ std::shared_ptr<flexran::rib::agent_info> make_agent(
   return std::make_shared<flexran::rib::agent_info>(agent_id, bs_id, create_caps(cs), create_splits(sp), "127.0.0.1:4325");
 }
 
+std::shared_ptr<flexran::rib::agent_info> make_bs_agent(int agent_id, uint64_t bs_id)
+{
+  return make_agent(agent_id, bs_id, {cap::LOPHY, cap::HIPHY, cap::LOMAC,
+      cap::HIMAC, cap::RLC, cap::PDCP, cap::SDAP, cap::RRC, cap::S1AP});
+}
+
 TEST_CASE("RIB pending agents and add of disaggregated BS", "[rib]")
 {
   flexran::rib::Rib rib;
@@ -225,3 +232,94 @@ TEST_CASE("Refuse BS with the same ID")
   REQUIRE(rib.add_pending_agent(a2) == true);
   REQUIRE(rib.new_eNB_config_entry(bs1) == false);
 }
+
+TEST_CASE("RIB changes since a version", "[rib]")
+{
+  flexran::rib::Rib rib;
+  const std::vector<protocol::flex_bs_capability> all_caps =
+      {cap::LOPHY, cap::HIPHY, cap::LOMAC, cap::HIMAC,
+       cap::RLC, cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP};
+  const uint64_t bs1 = 0xe0000;
+  const uint64_t bs2 = 0xf0000;
+
+  REQUIRE(rib.get_changes_since(0).bs.empty());
+
+  REQUIRE(rib.add_pending_agent(make_agent(0, bs1, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs1) == true);
+  REQUIRE(rib.add_pending_agent(make_agent(1, bs2, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs2) == true);
+
+  auto c = rib.get_changes_since(0);
+  REQUIRE(c.complete == true);
+  REQUIRE(c.bs.size() == 2);
+  REQUIRE(c.bs[0].added == true);
+  REQUIRE(c.version == rib.get_version());
+
+  // only BS2 changes: BS1 is not reported anymore
+  const uint64_t v = c.version;
+  protocol::flex_enb_config_reply ec;
+  ec.add_cell_config()->set_phy_cell_id(1);
+  rib.get_bs(bs2)->update_eNB_config(ec);
+  c = rib.get_changes_since(v);
+  REQUIRE(c.bs.size() == 1);
+  REQUIRE(c.bs[0].bs_id == bs2);
+  REQUIRE(c.bs[0].added == false);
+  REQUIRE(c.bs[0].cell_configs == std::vector<uint16_t>{0});
+  REQUIRE(c.removed_bs.empty());
+  REQUIRE(rib.get_changes_since(c.version).bs.empty());
+
+  // removal of BS1 is reported
+  REQUIRE(rib.remove_eNB_config_entry(0) == true);
+  c = rib.get_changes_since(v);
+  REQUIRE(c.bs.size() == 1);
+  REQUIRE(c.removed_bs == std::vector<uint64_t>{bs1});
+}
+
+TEST_CASE("RIB iteration over BSs, agents and UEs in place", "[rib]")
+{
+  flexran::rib::Rib rib;
+  const std::vector<protocol::flex_bs_capability> all_caps =
+      {cap::LOPHY, cap::HIPHY, cap::LOMAC, cap::HIMAC,
+       cap::RLC, cap::RRC, cap::SDAP, cap::PDCP, cap::S1AP};
+  const uint64_t bs1 = 0xe0000;
+  const uint64_t bs2 = 0xf0000;
+
+  REQUIRE(rib.get_bs_ids().empty());
+  REQUIRE(rib.find_bs(bs1) == nullptr);
+
+  REQUIRE(rib.add_pending_agent(make_agent(0, bs2, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs2) == true);
+  REQUIRE(rib.add_pending_agent(make_agent(1, bs1, all_caps, {})) == true);
+  REQUIRE(rib.new_eNB_config_entry(bs1) == true);
+
+  const auto ids = rib.get_bs_ids();
+  REQUIRE(ids.size() == 2);
+  REQUIRE(std::vector<uint64_t>(ids.begin(), ids.end()) == std::vector<uint64_t>{bs1, bs2});
+  REQUIRE(*std::prev(ids.end()) == bs2);
+  REQUIRE(rib.find_bs(bs2) == rib.get_bs(bs2).get());
+
+  std::vector<uint64_t> visited;
+  rib.for_each_bs([&visited] (const flexran::rib::enb_rib_info& bs)
+      { visited.push_back(bs.get_id()); });
+  REQUIRE(visited == std::vector<uint64_t>{bs1, bs2});
+
+  std::vector<int> agents;
+  rib.for_each_agent([&agents] (const flexran::rib::agent_info& a)
+      { agents.push_back(a.agent_id); });
+  REQUIRE(agents == std::vector<int>{0, 1});
+
+  /* UEs are visited in the order of their configuration */
+  for (int rnti : {0x20, 0x10}) {
+    protocol::flex_ue_state_change sc;
+    sc.set_type(protocol::FLUESC_ACTIVATED);
+    sc.mutable_config()->set_rnti(rnti);
+    rib.find_bs(bs1)->update_UE_config(sc);
+  }
+  std::vector<int> rntis;
+  rib.find_bs(bs1)->for_each_ue(
+      [&rntis] (const protocol::flex_ue_config& c, const flexran::rib::ue_mac_rib_info& ue) {
+        REQUIRE(ue.get_mac_stats_report().rnti() == 0);
+        rntis.push_back(c.rnti());
+      });
+  REQUIRE(rntis == std::vector<int>{0x20, 0x10});
+}
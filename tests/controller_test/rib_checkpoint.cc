@@ -0,0 +1,202 @@
+#include "catch.hpp"
+#include "rib_checkpoint.h"
+#include "checkpoint_manager.h"
+#include "requests_manager.h"
+#include "async_xface.h"
+#include "subscription.h"
+#include "rib.h"
+#include "agent_info.h"
+#include "rib_test_agents.h"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+using cap = protocol::flex_bs_capability;
+using flexran::rib::rnti_t;
+
+static const std::vector<cap> all_caps = {cap::LOPHY, cap::HIPHY, cap::LOMAC,
+    cap::HIMAC, cap::RLC, cap::PDCP, cap::SDAP, cap::RRC, cap::S1AP};
+
+static std::string tmp_checkpoint_path()
+{
+  char path[] = "/tmp/rtc_test_checkpoint_XXXXXX";
+  const int fd = mkstemp(path);
+  REQUIRE (fd >= 0);
+  close(fd);
+  std::remove(path); // checkpoint_file creates it
+  return path;
+}
+
+static protocol::flex_ue_config_reply ue_configs(const std::vector<int>& rntis)
+{
+  protocol::flex_ue_config_reply r;
+  for (int rnti : rntis)
+    r.add_ue_config()->set_rnti(rnti);
+  return r;
+}
+
+TEST_CASE("checkpoint file stores and reloads checkpoints", "[rib_checkpoint]")
+{
+  const std::string path = tmp_checkpoint_path();
+  std::string error;
+  protocol::flex_rib_checkpoint cp;
+
+  {
+    flexran::rib::checkpoint_file f;
+    REQUIRE (f.open(path, error) == true);
+    REQUIRE (f.load(cp) == false);
+    REQUIRE (f.get_sequence() == 0);
+
+    for (int i = 1; i <= 3; ++i) {
+      cp.set_timestamp_ms(i);
+      cp.add_bs()->set_bs_id(i);
+      REQUIRE (f.store(cp, error) == true);
+    }
+    REQUIRE (f.get_sequence() == 3);
+  }
+
+  flexran::rib::checkpoint_file f;
+  REQUIRE (f.open(path, error) == true);
+  protocol::flex_rib_checkpoint l;
+  REQUIRE (f.load(l) == true);
+  REQUIRE (l.timestamp_ms() == 3);
+  REQUIRE (l.bs_size() == 3);
+  REQUIRE (f.get_sequence() == 3);
+
+  SECTION("the file grows for large checkpoints") {
+    const std::size_t size = f.get_file_size();
+    protocol::flex_bs_checkpoint *bs = l.add_bs();
+    for (int i = 0; i < 200000; ++i)
+      bs->mutable_ue_config()->add_ue_config()->set_imsi(1000000000000 + i);
+    REQUIRE (l.ByteSizeLong() > size / 2);
+    REQUIRE (f.store(l, error) == true);
+    REQUIRE (f.get_file_size() > size);
+    protocol::flex_rib_checkpoint g;
+    REQUIRE (f.load(g) == true);
+    REQUIRE (g.bs(3).ue_config().ue_config_size() == 200000);
+    REQUIRE (g.bs(3).ue_config().ue_config(199999).imsi() == 1000000000000 + 199999);
+  }
+
+  SECTION("a corrupted checkpoint falls back to the previous one") {
+    std::fstream raw(path, std::ios::in | std::ios::out | std::ios::binary);
+    uint32_t active;
+    uint64_t slot_size;
+    raw.seekg(12);
+    raw.read(reinterpret_cast<char *>(&active), sizeof(active));
+    raw.read(reinterpret_cast<char *>(&slot_size), sizeof(slot_size));
+    raw.seekp(4096 + active * slot_size);
+    raw.write("garbage", 7);
+    raw.close();
+
+    protocol::flex_rib_checkpoint g;
+    REQUIRE (f.load(g) == true);
+    REQUIRE (g.timestamp_ms() == 2);
+  }
+
+  SECTION("files of other formats are refused") {
+    const std::string other = tmp_checkpoint_path();
+    std::ofstream(other) << std::string(8192, 'x');
+    flexran::rib::checkpoint_file o;
+    REQUIRE (o.open(other, error) == false);
+    std::remove(other.c_str());
+  }
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("checkpoint manager stores checkpoints in the background", "[rib_checkpoint]")
+{
+  const std::string path = tmp_checkpoint_path();
+  const uint64_t bs_id = 0xe0000;
+  flexran::rib::Rib rib;
+  flexran::network::async_xface xface("127.0.0.1", 2210);
+  flexran::core::requests_manager rm(rib, xface);
+  flexran::event::subscription ev;
+  rib.add_pending_agent(make_agent(0, bs_id, all_caps));
+  REQUIRE (rib.new_eNB_config_entry(bs_id) == true);
+
+  auto file = std::make_shared<flexran::rib::checkpoint_file>();
+  std::string error;
+  REQUIRE (file->open(path, error) == true);
+  {
+    flexran::app::management::checkpoint_manager checkpointer(rib, rm, ev, file,
+        nullptr, 1000);
+    REQUIRE (checkpointer.checkpoint() == true);
+    REQUIRE (checkpointer.checkpoint() == false); // nothing changed
+    /* the writer stores the checkpoint on destruction at the latest */
+  }
+  REQUIRE (file->get_sequence() == 1);
+  protocol::flex_rib_checkpoint cp;
+  REQUIRE (file->load(cp) == true);
+  REQUIRE (cp.bs_size() == 1);
+  REQUIRE (cp.bs(0).bs_id() == bs_id);
+  std::remove(path.c_str());
+}
+
+TEST_CASE("RIB restores a reconnecting BS from a checkpoint", "[rib_checkpoint]")
+{
+  const uint64_t bs_id = 0xe0000;
+  protocol::flex_rib_checkpoint cp;
+  {
+    flexran::rib::Rib rib;
+    rib.add_pending_agent(make_agent(0, bs_id, all_caps));
+    REQUIRE (rib.new_eNB_config_entry(bs_id) == true);
+    auto bs = rib.get_bs(bs_id);
+    protocol::flex_enb_config_reply ec;
+    ec.add_cell_config()->set_phy_cell_id(5);
+    bs->update_eNB_config(ec);
+    for (int rnti : {10, 11, 12}) {
+      protocol::flex_ue_state_change sc;
+      sc.set_type(protocol::FLUESC_ACTIVATED);
+      sc.mutable_config()->set_rnti(rnti);
+      sc.mutable_config()->set_imsi(208950000000000 + rnti);
+      bs->update_UE_config(sc);
+    }
+    rib.fill_checkpoint(cp);
+    REQUIRE (cp.bs_size() == 1);
+    REQUIRE (cp.bs(0).agents_size() == 1);
+  }
+
+  flexran::rib::Rib rib;
+  rib.preload(cp);
+  REQUIRE (rib.get_num_preloaded() == 1);
+
+  SECTION("same agents: configuration and UEs are restored") {
+    rib.add_pending_agent(make_agent(3, bs_id, all_caps));
+    REQUIRE (rib.new_eNB_config_entry(bs_id) == true);
+    std::vector<rnti_t> ues;
+    REQUIRE (rib.restore_bs(bs_id, ues) == true);
+    REQUIRE (rib.get_num_preloaded() == 0);
+    REQUIRE (ues == std::vector<rnti_t>({10, 11, 12}));
+    auto bs = rib.get_bs(bs_id);
+    REQUIRE (bs->get_enb_config().cell_config(0).phy_cell_id() == 5);
+    REQUIRE (bs->get_ue_mac_info(11) != nullptr);
+
+    std::vector<rnti_t> added;
+    std::vector<std::pair<rnti_t, uint64_t>> removed;
+    REQUIRE (bs->reconcile_UE_configs(ue_configs({11, 12, 13}), added, removed) == true);
+    REQUIRE (added == std::vector<rnti_t>({13}));
+    REQUIRE (removed == std::vector<std::pair<rnti_t, uint64_t>>({{10, 208950000000010}}));
+    REQUIRE (bs->get_ue_mac_info(10) == nullptr);
+    REQUIRE (bs->get_ue_mac_info(13) != nullptr);
+    REQUIRE (bs->reconcile_UE_configs(ue_configs({}), added, removed) == false);
+  }
+
+  SECTION("different agents: nothing is restored") {
+    rib.add_pending_agent(make_agent(3, bs_id, {cap::LOPHY, cap::HIPHY, cap::LOMAC}));
+    rib.add_pending_agent(make_agent(4, bs_id, {cap::HIMAC, cap::RLC, cap::PDCP,
+                                                      cap::SDAP, cap::RRC, cap::S1AP}));
+    REQUIRE (rib.new_eNB_config_entry(bs_id) == true);
+    std::vector<rnti_t> ues;
+    REQUIRE (rib.restore_bs(bs_id, ues) == false);
+    REQUIRE (rib.get_num_preloaded() == 0);
+    REQUIRE (ues.empty());
+    REQUIRE (rib.get_bs(bs_id)->get_ue_mac_info(10) == nullptr);
+  }
+
+  SECTION("unknown BS") {
+    std::vector<rnti_t> ues;
+    REQUIRE (rib.restore_bs(bs_id + 1, ues) == false);
+    REQUIRE (rib.get_num_preloaded() == 1);
+  }
+}
@@ -0,0 +1,380 @@
+#include "catch.hpp"
+#include "rib_replication.h"
+#include "replication_manager.h"
+#include "requests_manager.h"
+#include "async_xface.h"
+#include "subscription.h"
+#include "rib.h"
+#include "agent_info.h"
+#include "rib_test_agents.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using flexran::rib::rib_replica;
+using flexran::rib::replication_stream;
+
+static std::string tmp_socket_path()
+{
+  return "/tmp/rtc_test_replication_" + std::to_string(getpid());
+}
+
+static void ue_state_change(flexran::rib::enb_rib_info& bs, int rnti,
+    protocol::flex_ue_state_change_type type)
+{
+  protocol::flex_ue_state_change sc;
+  sc.set_type(type);
+  sc.mutable_config()->set_rnti(rnti);
+  bs.update_UE_config(sc);
+}
+
+/* receives until the delta with sequence number seq has been applied */
+static void receive_until(replication_stream& s, rib_replica& replica, uint64_t seq)
+{
+  std::vector<protocol::flex_rib_delta> ds;
+  for (int i = 0; i < 100 && replica.get_seq() < seq; ++i) {
+    REQUIRE (s.receive(ds, 10) == replication_stream::receive_result::ok);
+    for (const auto& d : ds)
+      REQUIRE (replica.apply(d) == true);
+    ds.clear();
+  }
+  REQUIRE (replica.get_seq() == seq);
+}
+
+/* an active controller without replication_stream, to send broken frames */
+static int listen_raw(const std::string& path)
+{
+  unlink(path.c_str());
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int accept_raw(int lfd, int timeout_ms)
+{
+  pollfd pfd = { lfd, POLLIN, 0 };
+  return poll(&pfd, 1, timeout_ms) == 1 ? accept(lfd, nullptr, nullptr) : -1;
+}
+
+static void send_frame(int fd, const std::string& payload, std::size_t len)
+{
+  const uint8_t hdr[4] = { uint8_t(len >> 24), uint8_t(len >> 16), uint8_t(len >> 8), uint8_t(len) };
+  REQUIRE (write(fd, hdr, sizeof(hdr)) == sizeof(hdr));
+  REQUIRE (write(fd, payload.data(), payload.size()) == ssize_t(payload.size()));
+}
+
+static std::string ue_configs_of(const protocol::flex_bs_checkpoint& cp)
+{
+  return cp.ue_config().SerializeAsString();
+}
+
+TEST_CASE("standby replica follows the RIB of the active controller", "[rib_replication]")
+{
+  const std::string path = tmp_socket_path();
+  flexran::rib::Rib rib;
+  flexran::network::async_xface xface("127.0.0.1", 2210);
+  flexran::core::requests_manager rm(rib, xface);
+  flexran::event::subscription ev;
+
+  std::unique_ptr<flexran::rib::replication_listener> listener(
+      new flexran::rib::replication_listener);
+  std::string error;
+  REQUIRE (listener->listen(path, error) == true);
+  flexran::app::management::replication_manager active(rib, rm, ev,
+      std::move(listener), nullptr);
+
+  const uint64_t bs_id = 0xe0000;
+  rib.add_pending_agent(make_bs_agent(0, bs_id));
+  REQUIRE (rib.new_eNB_config_entry(bs_id) == true);
+  auto bs = rib.get_bs(bs_id);
+  for (int rnti : {10, 11, 12})
+    ue_state_change(*bs, rnti, protocol::FLUESC_ACTIVATED);
+
+  std::unique_ptr<replication_stream> s = replication_stream::connect(path, error);
+  REQUIRE (s != nullptr);
+  uint64_t ms = 1;
+  active.tick(ms++);
+  REQUIRE (active.get_num_standbys() == 1);
+
+  rib_replica replica;
+  receive_until(*s, replica, 1);
+  REQUIRE (replica.is_synced());
+  REQUIRE (replica.get_num_bs() == 1);
+  protocol::flex_bs_checkpoint cp;
+  bs->fill_checkpoint(cp);
+  REQUIRE (ue_configs_of(*replica.get_bs(bs_id)) == ue_configs_of(cp));
+
+  SECTION("only changes are sent") {
+    ue_state_change(*bs, 11, protocol::FLUESC_DEACTIVATED);
+    ue_state_change(*bs, 13, protocol::FLUESC_ACTIVATED);
+    protocol::flex_ue_config_reply update;
+    protocol::flex_ue_config *c = update.add_ue_config();
+    c->set_rnti(12);
+    c->set_imsi(208950000000012);
+    bs->update_UE_config(update);
+    active.tick(ms++);
+    const uint64_t before = s->get_bytes_received();
+    receive_until(*s, replica, 2);
+    REQUIRE (s->get_bytes_received() - before < cp.ByteSizeLong() + 64);
+
+    cp.Clear();
+    bs->fill_checkpoint(cp);
+    REQUIRE (ue_configs_of(*replica.get_bs(bs_id)) == ue_configs_of(cp));
+    REQUIRE (replica.get_bs(bs_id)->ue_config().ue_config(1).imsi() == 208950000000012);
+
+    /* statistics are not replicated */
+    active.tick(ms++);
+    std::vector<protocol::flex_rib_delta> ds;
+    REQUIRE (s->receive(ds, 10) == replication_stream::receive_result::ok);
+    REQUIRE (ds.empty());
+  }
+
+  SECTION("removed BS") {
+    REQUIRE (rib.remove_eNB_config_entry(0) == true);
+    active.tick(ms++);
+    receive_until(*s, replica, 2);
+    REQUIRE (replica.get_num_bs() == 0);
+  }
+
+  SECTION("heartbeat without changes") {
+    active.tick(ms + 1000);
+    receive_until(*s, replica, 2);
+    REQUIRE (replica.get_num_bs() == 1);
+  }
+
+  SECTION("the standby notices the end of the active controller") {
+    s.reset();
+    active.tick(ms + 1000);
+    REQUIRE (active.get_num_standbys() == 0);
+  }
+}
+
+TEST_CASE("replica needs consecutive deltas", "[rib_replication]")
+{
+  rib_replica replica;
+  protocol::flex_rib_delta d;
+  d.set_seq(1);
+  REQUIRE (replica.apply(d) == false); // no full state yet
+  d.set_full(true);
+  protocol::flex_bs_checkpoint *bs = d.add_bs();
+  bs->set_bs_id(1);
+  bs->add_agents()->add_capabilities(protocol::LOPHY);
+  bs->mutable_ue_config()->add_ue_config()->set_rnti(10);
+  REQUIRE (replica.apply(d) == true);
+  REQUIRE (replica.get_num_bs() == 1);
+
+  /* UE 10 removed and added again, UE 11 added */
+  protocol::flex_rib_delta e;
+  e.set_seq(2);
+  protocol::flex_bs_checkpoint *b = e.add_bs();
+  b->set_bs_id(1);
+  b->add_removed_ues(10);
+  b->mutable_ue_config()->add_ue_config()->set_rnti(11);
+  b->mutable_ue_config()->add_ue_config()->set_rnti(10);
+  REQUIRE (replica.apply(e) == true);
+  REQUIRE (replica.get_bs(1)->ue_config().ue_config_size() == 2);
+  REQUIRE (replica.get_bs(1)->ue_config().ue_config(0).rnti() == 11);
+  REQUIRE (replica.get_bs(1)->agents_size() == 1);
+
+  SECTION("gap") {
+    e.set_seq(4);
+    REQUIRE (replica.apply(e) == false);
+    REQUIRE (replica.is_synced() == false);
+    e.set_seq(5);
+    REQUIRE (replica.apply(e) == false);
+    REQUIRE (replica.apply(d) == true); // full state again
+  }
+
+  SECTION("unknown BS") {
+    e.set_seq(3);
+    e.mutable_bs(0)->set_bs_id(2);
+    REQUIRE (replica.apply(e) == false);
+  }
+
+  protocol::flex_rib_checkpoint cp;
+  replica.fill_checkpoint(cp);
+  REQUIRE (cp.bs_size() == 1);
+}
+
+TEST_CASE("standby takes over only a synced replica", "[rib_replication]")
+{
+  const std::string path = tmp_socket_path();
+  std::unique_ptr<flexran::rib::replication_listener> listener(
+      new flexran::rib::replication_listener);
+  std::string error;
+  REQUIRE (listener->listen(path, error) == true);
+
+  rib_replica replica;
+  std::atomic_bool exit{false};
+  bool take_over = false;
+  std::thread standby([&] { take_over = flexran::rib::run_standby(path, replica, exit); });
+  std::unique_ptr<replication_stream> s;
+  for (int i = 0; i < 100 && !s; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    s = listener->accept();
+  }
+  if (!s) {
+    exit = true;
+    standby.join();
+    FAIL ("standby did not connect");
+  }
+
+  protocol::flex_rib_delta d;
+  d.set_seq(1);
+  d.set_full(true);
+  protocol::flex_bs_checkpoint *bs = d.add_bs();
+  bs->set_bs_id(1);
+  bs->add_agents()->add_capabilities(protocol::LOPHY);
+  REQUIRE (s->send(d) == true);
+
+  SECTION("synced") {
+    REQUIRE (s->flush() == true);
+    s.reset();
+    standby.join();
+    REQUIRE (take_over);
+    REQUIRE (replica.get_num_bs() == 1);
+  }
+
+  SECTION("out of sync") {
+    /* the active controller goes away before resending its full state */
+    protocol::flex_rib_delta e;
+    e.set_seq(3);
+    REQUIRE (s->send(e) == true);
+    REQUIRE (s->flush() == true);
+    s.reset();
+    listener.reset();
+    standby.join();
+    REQUIRE (!take_over);
+    REQUIRE (!replica.is_synced());
+  }
+}
+
+TEST_CASE("standby resynchronizes after a broken stream", "[rib_replication]")
+{
+  const std::string path = tmp_socket_path();
+  const int lfd = listen_raw(path);
+  REQUIRE (lfd >= 0);
+
+  rib_replica replica;
+  std::atomic_bool exit{false};
+  std::atomic_bool done{false};
+  bool take_over = false;
+  std::thread standby([&] {
+    take_over = flexran::rib::run_standby(path, replica, exit);
+    done = true;
+  });
+
+  protocol::flex_rib_delta d;
+  d.set_seq(1);
+  d.set_full(true);
+  protocol::flex_bs_checkpoint *bs = d.add_bs();
+  bs->set_bs_id(1);
+  bs->add_agents()->add_capabilities(protocol::LOPHY);
+  const std::string full = d.SerializeAsString();
+
+  /* a synced replica followed by a frame that is too large */
+  int fd = accept_raw(lfd, 2000);
+  if (fd >= 0) {
+    send_frame(fd, full, full.size());
+    send_frame(fd, "", 0xffffffff);
+  }
+  const int fd2 = accept_raw(lfd, 2000);
+  const bool reconnected = fd2 >= 0 && !done;
+  if (fd2 >= 0) {
+    send_frame(fd2, full, full.size());
+    close(fd2);
+  } else {
+    exit = true;
+  }
+  standby.join();
+  if (fd >= 0) close(fd);
+  close(lfd);
+  unlink(path.c_str());
+
+  REQUIRE (reconnected);
+  REQUIRE (take_over);
+  REQUIRE (replica.get_num_bs() == 1);
+}
+
+TEST_CASE("replication lag and throughput", "[.stress][rib_replication]")
+{
+  const std::string path = tmp_socket_path();
+  flexran::rib::Rib rib;
+  flexran::network::async_xface xface("127.0.0.1", 2210);
+  flexran::core::requests_manager rm(rib, xface);
+  flexran::event::subscription ev;
+  std::unique_ptr<flexran::rib::replication_listener> listener(
+      new flexran::rib::replication_listener);
+  std::string error;
+  REQUIRE (listener->listen(path, error) == true);
+  flexran::app::management::replication_manager active(rib, rm, ev,
+      std::move(listener), nullptr);
+
+  const int num_ues = 200;
+  const int num_ticks = 5000;
+  rib.add_pending_agent(make_bs_agent(0, 1));
+  rib.new_eNB_config_entry(1);
+  auto bs = rib.get_bs(1);
+  for (int rnti = 0; rnti < num_ues; ++rnti)
+    ue_state_change(*bs, rnti, protocol::FLUESC_ACTIVATED);
+
+  std::atomic_bool stop{false};
+  std::vector<uint64_t> lags;
+  uint64_t bytes = 0;
+  std::thread standby([&] {
+    std::string err;
+    std::unique_ptr<replication_stream> s = replication_stream::connect(path, err);
+    rib_replica replica;
+    std::vector<protocol::flex_rib_delta> ds;
+    while (!stop && s->receive(ds, 10) == replication_stream::receive_result::ok) {
+      const uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count();
+      for (const auto& d : ds) {
+        replica.apply(d);
+        lags.push_back(now - d.timestamp_us());
+      }
+      ds.clear();
+    }
+    bytes = s->get_bytes_received();
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const auto start = std::chrono::steady_clock::now();
+  for (int t = 1; t <= num_ticks; ++t) {
+    /* 10% of the UEs change their configuration every ms */
+    protocol::flex_ue_config_reply update;
+    for (int i = 0; i < num_ues / 10; ++i) {
+      protocol::flex_ue_config *c = update.add_ue_config();
+      c->set_rnti((t * 7 + i * 13) % num_ues);
+      c->set_imsi(t);
+    }
+    bs->update_UE_config(update);
+    active.tick(t);
+    std::this_thread::sleep_for(std::chrono::microseconds(1000));
+  }
+  const std::chrono::duration<double> dur = std::chrono::steady_clock::now() - start;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  stop = true;
+  standby.join();
+
+  REQUIRE (lags.size() > 0);
+  std::sort(lags.begin(), lags.end());
+  std::cout << "replication: " << lags.size() << " deltas, "
+            << bytes / dur.count() / 1000 << " kB/s, lag median "
+            << lags[lags.size() / 2] << "us p99 " << lags[lags.size() * 99 / 100]
+            << "us max " << lags.back() << "us\n";
+}
@@ -0,0 +1,20 @@
+#ifndef RIB_TEST_AGENTS_H_
+#define RIB_TEST_AGENTS_H_
+
+#include <memory>
+#include <vector>
+
+#include "flexran.pb.h"
+#include "agent_info.h"
+
+/* agents for RIB tests, defined in rib.cc */
+
+std::shared_ptr<flexran::rib::agent_info> make_agent(
+    int agent_id, uint64_t bs_id,
+    const std::vector<protocol::flex_bs_capability>& cs,
+    const std::vector<protocol::flex_bs_split>& sp = {});
+
+/* an agent with all capabilities, i.e., a complete BS on its own */
+std::shared_ptr<flexran::rib::agent_info> make_bs_agent(int agent_id, uint64_t bs_id);
+
+#endif /* RIB_TEST_AGENTS_H_ */
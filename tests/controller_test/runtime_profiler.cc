@@ -0,0 +1,134 @@
+#include "catch.hpp"
+#include "hdr_histogram.h"
+#include "runtime_profiler.h"
+#include <iostream>
+#include <random>
+#include <thread>
+
+using flexran::core::hdr_histogram;
+using flexran::core::runtime_profiler;
+
+TEST_CASE("hdr histogram buckets have bounded relative error", "[runtime_profiler]")
+{
+  for (uint64_t v = 0; v < hdr_histogram::SUB_COUNT; ++v) {
+    REQUIRE (hdr_histogram::index(v) == v);
+    REQUIRE (hdr_histogram::highest_value(v) == v);
+  }
+  REQUIRE (hdr_histogram::index(~uint64_t(0)) == hdr_histogram::NUM_BUCKETS - 1);
+  REQUIRE (hdr_histogram::highest_value(hdr_histogram::NUM_BUCKETS - 1) == ~uint64_t(0));
+
+  std::mt19937_64 gen(42);
+  for (int i = 0; i < 100000; ++i) {
+    const uint64_t v = gen() >> (gen() % 64);
+    const std::size_t idx = hdr_histogram::index(v);
+    REQUIRE (idx < hdr_histogram::NUM_BUCKETS);
+    const uint64_t hi = hdr_histogram::highest_value(idx);
+    REQUIRE (v <= hi);
+    if (idx > 0)
+      REQUIRE (v > hdr_histogram::highest_value(idx - 1));
+    REQUIRE (hi - v <= v / 64);
+  }
+}
+
+TEST_CASE("hdr histogram percentiles", "[runtime_profiler]")
+{
+  hdr_histogram h;
+  for (uint64_t v = 1; v <= 100000; ++v)
+    h.record(v);
+  hdr_histogram::snapshot s;
+  h.take_snapshot(s);
+  REQUIRE (s.count == 100000);
+  REQUIRE (s.min == 1);
+  REQUIRE (s.max == 100000);
+  REQUIRE (s.mean() == Approx(50000.5));
+  REQUIRE (s.percentile(0.5) == Approx(50000).epsilon(0.016));
+  REQUIRE (s.percentile(0.99) == Approx(99000).epsilon(0.016));
+  REQUIRE (s.percentile(0.999) == Approx(99900).epsilon(0.016));
+  REQUIRE (s.percentile(1) == 100000);
+  REQUIRE (s.percentile(0) == 1);
+
+  h.reset();
+  h.take_snapshot(s);
+  REQUIRE (s.count == 0);
+  REQUIRE (s.percentile(0.5) == 0);
+}
+
+TEST_CASE("hdr histogram can be read while recording", "[runtime_profiler]")
+{
+  hdr_histogram h;
+  std::atomic<bool> done{false};
+  std::thread writer([&h, &done] () {
+    for (uint64_t i = 0; i < 1000000; ++i)
+      h.record(i % 1000);
+    done = true;
+  });
+  hdr_histogram::snapshot s;
+  uint64_t last = 0;
+  while (!done) {
+    h.take_snapshot(s);
+    REQUIRE (s.count >= last);
+    REQUIRE (s.max < 1000);
+    last = s.count;
+  }
+  writer.join();
+  h.take_snapshot(s);
+  REQUIRE (s.count == 1000000);
+  REQUIRE (s.max == 999);
+}
+
+TEST_CASE("runtime profiler is reset by the recording thread", "[runtime_profiler]")
+{
+  typedef runtime_profiler::ns ns;
+  runtime_profiler p;
+  bool restarted;
+  REQUIRE (!p.poll(restarted));
+  REQUIRE (!restarted);
+
+  p.start();
+  REQUIRE (p.is_running());
+  REQUIRE (p.poll(restarted));
+  REQUIRE (restarted);
+  p.record_loop(ns(1000000), ns(2000), ns(3000), ns(5000), 4);
+  p.set_rx_counters({{1, 3584, 10, 1200}});
+  REQUIRE (p.poll(restarted));
+  REQUIRE (!restarted);
+  p.record_loop(ns(1000000), ns(2000), ns(3000), ns(5000), 4);
+
+  p.stop();
+  REQUIRE (!p.poll(restarted));
+  std::string json = p.to_json_string();
+  REQUIRE (json.find("\"running\":false") != std::string::npos);
+  REQUIRE (json.find("\"inter_loop_us\":{\"count\":2,\"min\":1000,") != std::string::npos);
+  REQUIRE (json.find("\"rib_us\":{\"count\":2,\"min\":2,") != std::string::npos);
+  REQUIRE (json.find("\"processed\":{\"count\":2,\"min\":4,\"mean\":4,") != std::string::npos);
+  REQUIRE (json.find("{\"agent_id\":1,\"bs_id\":3584,\"rx_packets\":10,\"rx_bytes\":1200,")
+      != std::string::npos);
+
+  /* results are only discarded once the task manager polls again */
+  p.start();
+  REQUIRE (p.to_json_string().find("\"loop_us\":{\"count\":2,") != std::string::npos);
+  REQUIRE (p.poll(restarted));
+  REQUIRE (restarted);
+  REQUIRE (p.to_json_string().find("\"loop_us\":{\"count\":0,") != std::string::npos);
+}
+
+TEST_CASE("hdr histogram record cost", "[.stress][runtime_profiler]")
+{
+  hdr_histogram h;
+  const uint64_t n = 10000000;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < n; ++i)
+    h.record(i * 2654435761u % 1000000);
+  const std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - start;
+  std::cout << "hdr_histogram::record(): " << d.count() / n << " ns" << std::endl;
+
+  runtime_profiler p;
+  bool restarted;
+  uint64_t polls = 0;
+  const auto pstart = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < n; ++i)
+    polls += p.poll(restarted);
+  const std::chrono::duration<double, std::nano> pd = std::chrono::steady_clock::now() - pstart;
+  std::cout << "runtime_profiler::poll() when idle: " << pd.count() / n << " ns" << std::endl;
+  REQUIRE (polls == 0);
+}
@@ -0,0 +1,194 @@
+#include "catch.hpp"
+#include "shard_ring.h"
+#include "shard_proxy.h"
+#include "shard_federation.h"
+#include "flexran.pb.h"
+#include <map>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using flexran::network::shard_ring;
+using flexran::app::stats::shard_federation;
+
+TEST_CASE("shard ring distributes BSs and moves few of them", "[shard]")
+{
+  shard_ring ring;
+  REQUIRE (ring.add_shard("a:2210") == true);
+  REQUIRE (ring.add_shard("b:2210") == true);
+  REQUIRE (ring.add_shard("c:2210") == true);
+  REQUIRE (ring.add_shard("c:2210") == false);
+
+  const uint64_t n = 30000;
+  std::map<std::size_t, uint64_t> count;
+  std::vector<std::string> before;
+  for (uint64_t bs_id = 0; bs_id < n; ++bs_id) {
+    count[ring.owner(bs_id)]++;
+    before.push_back(ring.owner_name(bs_id));
+  }
+  REQUIRE (count.size() == 3);
+  for (const auto& c : count) {
+    REQUIRE (c.second > n / 3 * 0.7);
+    REQUIRE (c.second < n / 3 * 1.3);
+  }
+
+  /* the assignment does not depend on the order of the shards */
+  shard_ring other;
+  other.add_shard("c:2210");
+  other.add_shard("a:2210");
+  other.add_shard("b:2210");
+  for (uint64_t bs_id = 0; bs_id < n; ++bs_id)
+    REQUIRE (other.owner_name(bs_id) == before[bs_id]);
+
+  /* a fourth shard takes about a quarter, only from the others */
+  ring.add_shard("d:2210");
+  uint64_t moved = 0;
+  for (uint64_t bs_id = 0; bs_id < n; ++bs_id) {
+    if (ring.owner_name(bs_id) == before[bs_id]) continue;
+    REQUIRE (ring.owner_name(bs_id) == "d:2210");
+    moved++;
+  }
+  REQUIRE (moved > n / 4 * 0.7);
+  REQUIRE (moved < n / 4 * 1.3);
+
+  ring.remove_shard("d:2210");
+  for (uint64_t bs_id = 0; bs_id < n; ++bs_id)
+    REQUIRE (ring.owner_name(bs_id) == before[bs_id]);
+}
+
+TEST_CASE("federated stats merge the arrays of all shards", "[shard]")
+{
+  std::string e;
+  bool found;
+  REQUIRE (shard_federation::find_array("{\"a\":1,\"b\":[ {\"x\":\"]\"}, 2 ] }", "b", e, found));
+  REQUIRE (found);
+  REQUIRE (e == "{\"x\":\"]\"}, 2");
+  REQUIRE (shard_federation::find_array("{\"a\":{\"b\":[1]}}", "b", e, found));
+  REQUIRE (!found);
+  REQUIRE (shard_federation::find_array("{}", "b", e, found));
+  REQUIRE (!found);
+  REQUIRE (!shard_federation::find_array("{\"b\":[1}", "b", e, found));
+  REQUIRE (!shard_federation::find_array("<html>", "b", e, found));
+
+  const std::string s1 = "{\"date_time\":\"x\",\"eNB_config\":[{\"bs_id\":1}],\"mac_stats\":[{\"bs_id\":1,\"ue_mac_stats\":[]}]}";
+  const std::string s2 = "{\"date_time\":\"y\",\"eNB_config\":[],\"mac_stats\":[]}";
+  const std::string s3 = "{\"date_time\":\"z\",\"eNB_config\":[{\"bs_id\":3}],\"mac_stats\":[{\"bs_id\":3}]}";
+  std::string enb, mac, error;
+  REQUIRE (shard_federation::merge_stats({s1, s2, s3}, enb, mac, error));
+  REQUIRE (enb == "[{\"bs_id\":1},{\"bs_id\":3}]");
+  REQUIRE (mac == "[{\"bs_id\":1,\"ue_mac_stats\":[]},{\"bs_id\":3}]");
+
+  REQUIRE (shard_federation::merge_stats({"{\"date_time\":\"x\",\"eNB_config\":[]}"}, enb, mac, error));
+  REQUIRE (enb == "[]");
+  REQUIRE (mac == "");
+
+  SECTION("unreachable shards are reported") {
+    shard_federation f({{"127.0.0.1", 1}}, 200);
+    const std::string json = f.stats_to_json_string("all");
+    REQUIRE (json.find("\"eNB_config\":[]") != std::string::npos);
+    REQUIRE (json.find("\"failed_shards\":[{\"shard\":\"127.0.0.1:1\"") != std::string::npos);
+  }
+}
+
+static int listen_local(int& port)
+{
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in a{};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  a.sin_port = 0;
+  bind(fd, reinterpret_cast<sockaddr *>(&a), sizeof(a));
+  listen(fd, 4);
+  socklen_t len = sizeof(a);
+  getsockname(fd, reinterpret_cast<sockaddr *>(&a), &len);
+  port = ntohs(a.sin_port);
+  return fd;
+}
+
+static void write_frame(int fd, const protocol::flexran_message& m)
+{
+  const std::string s = m.SerializeAsString();
+  const uint32_t len = htonl(s.size());
+  REQUIRE (write(fd, &len, 4) == 4);
+  REQUIRE (write(fd, s.data(), s.size()) == static_cast<ssize_t>(s.size()));
+}
+
+static protocol::flexran_message read_frame(int fd)
+{
+  uint32_t len = 0;
+  REQUIRE (recv(fd, &len, 4, MSG_WAITALL) == 4);
+  std::string s(ntohl(len), '\0');
+  REQUIRE (recv(fd, &s[0], s.size(), MSG_WAITALL) == static_cast<ssize_t>(s.size()));
+  protocol::flexran_message m;
+  REQUIRE (m.ParseFromString(s));
+  return m;
+}
+
+static protocol::flexran_message hello(uint64_t bs_id)
+{
+  protocol::flexran_message m;
+  m.set_msg_dir(protocol::SUCCESSFUL_OUTCOME);
+  m.mutable_hello_msg()->mutable_header()->set_type(protocol::FLPT_HELLO);
+  m.mutable_hello_msg()->set_bs_id(bs_id);
+  return m;
+}
+
+TEST_CASE("shard proxy hands agents to the owning shard", "[shard]")
+{
+  int port[2];
+  const int lfd[2] = { listen_local(port[0]), listen_local(port[1]) };
+  std::vector<boost::asio::ip::tcp::endpoint> shards;
+  for (int p : port)
+    shards.emplace_back(boost::asio::ip::address::from_string("127.0.0.1"), p);
+
+  boost::asio::io_service io_service;
+  flexran::network::shard_proxy proxy(io_service,
+      boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0),
+      shards);
+  /* find a BS for the second shard */
+  uint64_t bs_id = 1;
+  while (proxy.get_ring().owner(bs_id) != 1) bs_id++;
+  std::thread t([&io_service] { io_service.run(); });
+
+  /* the agent gets the hello from the proxy */
+  const int agent = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in a{};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  a.sin_port = htons(proxy.get_port());
+  REQUIRE (connect(agent, reinterpret_cast<sockaddr *>(&a), sizeof(a)) == 0);
+  REQUIRE (read_frame(agent).has_hello_msg());
+  write_frame(agent, hello(bs_id));
+
+  /* the shard gets the hello of the agent as answer to its own */
+  const int shard = accept(lfd[1], nullptr, nullptr);
+  REQUIRE (shard >= 0);
+  write_frame(shard, hello(0));
+  protocol::flexran_message h = read_frame(shard);
+  REQUIRE (h.has_hello_msg());
+  REQUIRE (h.hello_msg().bs_id() == bs_id);
+
+  /* afterwards, everything is forwarded in both directions */
+  protocol::flexran_message echo;
+  echo.mutable_echo_request_msg()->mutable_header()->set_xid(42);
+  write_frame(shard, echo);
+  REQUIRE (read_frame(agent).echo_request_msg().header().xid() == 42);
+  protocol::flexran_message reply;
+  reply.mutable_echo_reply_msg()->mutable_header()->set_xid(42);
+  write_frame(agent, reply);
+  REQUIRE (read_frame(shard).echo_reply_msg().header().xid() == 42);
+
+  /* the shard notices when the agent leaves */
+  close(agent);
+  char c;
+  REQUIRE (recv(shard, &c, 1, 0) == 0);
+
+  close(shard);
+  io_service.stop();
+  t.join();
+  close(lfd[0]);
+  close(lfd[1]);
+}
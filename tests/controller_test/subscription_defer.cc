@@ -0,0 +1,91 @@
+#include "catch.hpp"
+#include "subscription.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using flexran::event::subscription;
+
+TEST_CASE("deferred functions run inline without a task manager", "[subscription]")
+{
+  subscription sub;
+  int n = 0;
+  auto f = sub.defer([&n] { return ++n; });
+  REQUIRE (n == 1);
+  REQUIRE (f.get() == 1);
+}
+
+TEST_CASE("deferred functions run in the applier thread, in order", "[subscription]")
+{
+  subscription sub;
+  std::atomic<bool> stop(false);
+  std::atomic<bool> applying(false);
+  std::thread::id applied_by;
+  std::vector<int> order;
+  int connects = 0;
+  std::thread applier([&] {
+    sub.set_applier(std::this_thread::get_id());
+    applying = true;
+    while (!stop)
+      sub.apply_deferred();
+    sub.set_applier(std::thread::id());
+    sub.apply_deferred();
+  });
+  while (!applying)
+    std::this_thread::yield();
+
+  auto f1 = sub.defer([&order] { order.push_back(1); });
+  auto f2 = sub.defer([&] {
+    order.push_back(2);
+    applied_by = std::this_thread::get_id();
+    return sub.subscribe_ue_connect(
+        [&connects] (uint64_t, flexran::rib::rnti_t) { connects++; });
+  });
+  bs2::connection c = f2.get();
+  f1.get();
+  REQUIRE (c.connected());
+  REQUIRE (applied_by == applier.get_id());
+  REQUIRE (order == (std::vector<int>{1, 2}));
+
+  /* the applier itself does not wait for the next round */
+  auto f3 = sub.defer([&sub] {
+    return sub.defer([] { return std::this_thread::get_id(); }).get();
+  });
+  REQUIRE (f3.get() == applier.get_id());
+
+  stop = true;
+  applier.join();
+}
+
+TEST_CASE("task timers of other threads are scheduled between ticks", "[subscription]")
+{
+  subscription sub;
+  std::atomic<bool> stop(false);
+  std::thread task_manager([&stop] { while (!stop) std::this_thread::yield(); });
+  sub.set_applier(task_manager.get_id());
+
+  int calls = 0;
+  auto timer = sub.subscribe_task_timer(
+      [&calls] (const bs2::connection&, uint64_t) { calls++; }, 0, 2, "timer");
+  REQUIRE (timer.connected());
+  REQUIRE (sub.num_task_timers() == 0);
+  sub.apply_deferred();
+  REQUIRE (sub.num_task_timers() == 1);
+
+  REQUIRE (timer.reschedule(0, 4) == true);
+  sub.apply_deferred();
+  std::vector<std::shared_ptr<const flexran::event::task_job>> jobs;
+  std::vector<int> called_at;
+  for (uint64_t t = 1; t <= 5; ++t) {
+    sub.advance_task_tick(t, jobs);
+    sub.run_task_tick(t);
+    if (calls > static_cast<int>(called_at.size()))
+      called_at.push_back(t);
+  }
+  REQUIRE (called_at == std::vector<int>{4});
+  REQUIRE_FALSE (timer.connected());
+
+  stop = true;
+  task_manager.join();
+  sub.set_applier(std::thread::id());
+}
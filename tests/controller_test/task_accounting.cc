@@ -0,0 +1,197 @@
+#include "catch.hpp"
+#include "subscription.h"
+#include "task_accounting.h"
+#include <atomic>
+#include <thread>
+
+using flexran::event::overrun_policy;
+using flexran::event::subscription;
+using flexran::event::task_accounting;
+
+namespace {
+  typedef std::vector<std::shared_ptr<const flexran::event::task_job>> job_list;
+
+  void slow(std::chrono::microseconds us)
+  {
+    const auto end = std::chrono::steady_clock::now() + us;
+    while (std::chrono::steady_clock::now() < end) {}
+  }
+
+  /* runs the ticks with a deadline that has already passed */
+  void run_late_ticks(subscription& sub, uint64_t from, uint64_t to, job_list& jobs)
+  {
+    for (uint64_t t = from; t <= to; ++t) {
+      sub.advance_task_tick(t, jobs);
+      sub.run_task_tick(t, std::chrono::steady_clock::now());
+    }
+  }
+}
+
+TEST_CASE("task accounting counts overruns and offences", "[task_accounting]")
+{
+  task_accounting acc;
+  acc.set_default_budget(std::chrono::microseconds(100));
+  acc.set_budget("slow", std::chrono::microseconds(1000));
+  acc.set_tolerance(2);
+  task_accounting::app_stats *a = acc.get_app("fast");
+  task_accounting::app_stats *s = acc.get_app("slow");
+  REQUIRE (acc.get_app("fast") == a);
+
+  using us = std::chrono::duration<float, std::micro>;
+  acc.begin_tick();
+  REQUIRE (!acc.record(a, us(0.5)));
+  REQUIRE (!acc.record(a, us(3)));
+  REQUIRE (!acc.record(s, us(500)));
+  std::string app;
+  float t;
+  REQUIRE (acc.get_slowest(app, t));
+  REQUIRE (app == "slow");
+  REQUIRE (t == 500);
+  acc.begin_tick();
+  REQUIRE (!acc.get_slowest(app, t));
+
+  /* without policy, offences are counted only */
+  REQUIRE (!acc.record(a, us(150)));
+  REQUIRE (!acc.record(a, us(150)));
+  REQUIRE (a->overruns == 2);
+  REQUIRE (a->offences == 1);
+  REQUIRE (!a->offender);
+
+  REQUIRE (a->runs == 4);
+  REQUIRE (a->histogram[0] == 1);
+  REQUIRE (a->histogram[2] == 1);
+  REQUIRE (a->histogram[8] == 2);
+  REQUIRE (a->max_us == 150);
+
+  const std::string json = acc.to_json_string();
+  REQUIRE (json.find("\"name\":\"fast\",\"budget_us\":100,\"runs\":4,\"overruns\":2,\"offences\":1")
+      != std::string::npos);
+  REQUIRE (json.find("\"name\":\"slow\",\"budget_us\":1000") != std::string::npos);
+  REQUIRE (json.find("\"policy\":\"none\"") != std::string::npos);
+
+  overrun_policy p;
+  REQUIRE (flexran::event::parse_overrun_policy("decimate", p));
+  REQUIRE (p == overrun_policy::decimate);
+  REQUIRE (!flexran::event::parse_overrun_policy("kill", p));
+}
+
+TEST_CASE("offending apps are deferred in late ticks", "[task_accounting]")
+{
+  subscription sub;
+  task_accounting& acc = sub.get_accounting();
+  acc.set_default_budget(std::chrono::microseconds(50));
+  acc.set_policy(overrun_policy::defer);
+  acc.set_tolerance(2);
+  std::vector<uint64_t> slow_ticks, fast_ticks;
+  sub.subscribe_task_tick([&slow_ticks] (uint64_t t) {
+        slow_ticks.push_back(t);
+        slow(std::chrono::microseconds(200));
+      }, 1, 0, "slow");
+  sub.subscribe_task_tick([&fast_ticks] (uint64_t t) { fast_ticks.push_back(t); }, 1, 0, "fast");
+
+  job_list jobs;
+  run_late_ticks(sub, 0, 1, jobs);
+  REQUIRE (acc.get_app("slow")->offender);
+  REQUIRE (!acc.get_app("fast")->offender);
+  REQUIRE (slow_ticks == std::vector<uint64_t>({0, 1}));
+
+  /* from now on, slow runs at the start of the next tick */
+  run_late_ticks(sub, 2, 4, jobs);
+  REQUIRE (slow_ticks == std::vector<uint64_t>({0, 1, 3, 4}));
+  REQUIRE (fast_ticks == std::vector<uint64_t>({0, 1, 2, 3, 4}));
+  REQUIRE (acc.get_app("slow")->deferred == 3);
+
+  /* in time, it is not deferred */
+  sub.advance_task_tick(5, jobs);
+  sub.run_task_tick(5);
+  REQUIRE (slow_ticks.back() == 5);
+}
+
+TEST_CASE("offending apps are decimated or offloaded", "[task_accounting]")
+{
+  subscription sub;
+  task_accounting& acc = sub.get_accounting();
+  acc.set_default_budget(std::chrono::microseconds(50));
+  acc.set_tolerance(2);
+  job_list jobs;
+
+  SECTION("decimate") {
+    acc.set_policy(overrun_policy::decimate);
+    std::vector<uint64_t> ticks;
+    sub.subscribe_task_tick([&ticks] (uint64_t t) {
+          ticks.push_back(t);
+          slow(std::chrono::microseconds(200));
+        }, 2, 0, "slow");
+    run_late_ticks(sub, 0, 20, jobs);
+    /* period 2, doubled after every two runs, starting with the expiry
+     * after the next one */
+    REQUIRE (ticks == std::vector<uint64_t>({0, 2, 4, 8, 12, 20}));
+    REQUIRE (acc.get_app("slow")->decimation == 8);
+  }
+
+  SECTION("offload") {
+    acc.set_policy(overrun_policy::offload);
+    int calls = 0;
+    sub.subscribe_task_tick([&calls] (uint64_t) {
+          calls++;
+          slow(std::chrono::microseconds(200));
+        }, 1, 0, "slow");
+    run_late_ticks(sub, 0, 1, jobs);
+    REQUIRE (calls == 2);
+    REQUIRE (jobs.empty());
+    REQUIRE (acc.get_app("slow")->offloaded);
+
+    /* now it is a job of the app executor */
+    run_late_ticks(sub, 2, 3, jobs);
+    REQUIRE (calls == 2);
+    REQUIRE (jobs.size() == 2);
+    REQUIRE (jobs[0] == jobs[1]);
+    REQUIRE (jobs[0]->name == "slow");
+    jobs[0]->fn(3);
+    REQUIRE (calls == 3);
+  }
+}
+
+TEST_CASE("task accounting records in parallel to its readers", "[task_accounting]")
+{
+  task_accounting acc;
+  acc.set_default_budget(std::chrono::microseconds(100));
+  acc.set_policy(overrun_policy::decimate);
+  acc.set_tolerance(1);
+  task_accounting::app_stats *a = acc.get_app("app");
+  const std::size_t runs = 20000;
+
+  /* the tick callbacks and jobs of one app may run on several threads, while
+   * REST reads the statistics */
+  using us = std::chrono::duration<float, std::micro>;
+  acc.begin_tick();
+  std::atomic<bool> done(false);
+  std::thread reader([&acc, &done] {
+        while (!done) acc.to_json_string();
+      });
+  std::vector<std::thread> writers;
+  for (int w = 0; w < 4; ++w)
+    writers.emplace_back([&acc, a, w, runs] {
+          for (std::size_t i = 0; i < runs; ++i)
+            acc.record(a, us(w == 3 && i == runs / 2 ? 1000 : 150));
+        });
+  for (auto& w : writers)
+    w.join();
+  done = true;
+  reader.join();
+
+  REQUIRE (a->runs == 4 * runs);
+  REQUIRE (a->overruns == 4 * runs);
+  REQUIRE (a->histogram[8] == 4 * runs - 1);
+  REQUIRE (a->histogram[10] == 1);
+  REQUIRE (a->max_us == 1000);
+  REQUIRE (a->total_us == 150.0 * (4 * runs - 1) + 1000);
+  REQUIRE (a->decimation == 64);
+  std::string app;
+  float t;
+  REQUIRE (acc.get_slowest(app, t));
+  REQUIRE (app == "app");
+  REQUIRE (t == 1000);
+  REQUIRE (acc.to_json_string().find("\"window\":{\"samples\":1000,\"p50_us\":150,")
+      != std::string::npos);
+}
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+#include "thread_placement.h"
+#include <thread>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using flexran::core::cpu_list_to_string;
+using flexran::core::parse_cpu_list;
+
+TEST_CASE("CPU lists are parsed and printed as ranges", "[thread_placement]")
+{
+  std::vector<int> cpus;
+  REQUIRE (parse_cpu_list("3", cpus));
+  REQUIRE (cpus == std::vector<int>{3});
+  REQUIRE (parse_cpu_list("8,0-2,10-11,1", cpus));
+  REQUIRE (cpus == (std::vector<int>{0, 1, 2, 8, 10, 11}));
+  REQUIRE (cpu_list_to_string(cpus) == "0-2,8,10-11");
+  REQUIRE (cpu_list_to_string({}) == "");
+
+  cpus = {5};
+  REQUIRE_FALSE (parse_cpu_list("", cpus));
+  REQUIRE_FALSE (parse_cpu_list("3-1", cpus));
+  REQUIRE_FALSE (parse_cpu_list("1,,2", cpus));
+  REQUIRE_FALSE (parse_cpu_list("a", cpus));
+  REQUIRE_FALSE (parse_cpu_list("-1", cpus));
+  REQUIRE_FALSE (parse_cpu_list("100000", cpus));
+  /* not modified on errors */
+  REQUIRE (cpus == std::vector<int>{5});
+}
+
+TEST_CASE("threads are pinned and reported", "[thread_placement]")
+{
+  const std::vector<int> allowed = flexran::core::get_thread_cpus(0);
+  REQUIRE_FALSE (allowed.empty());
+
+  flexran::core::thread_placement placement;
+  placement.set_cpus(flexran::core::thread_class::workers, {allowed.back()});
+  REQUIRE (placement.get_cpus(flexran::core::thread_class::task_manager).empty());
+  REQUIRE (placement.to_string()
+      == "task_manager: any, network: any, workers: "
+         + std::to_string(allowed.back()) + ", rest: any");
+
+  pid_t tid = 0;
+  bool pinned = false;
+  std::string json;
+  std::thread t([&] {
+    flexran::core::name_thread("rtc-test-pinned-1");
+    std::string error;
+    pinned = flexran::core::pin_thread(pthread_self(), {allowed.back()}, error);
+    tid = syscall(SYS_gettid);
+    json = placement.to_json_string();
+  });
+  t.join();
+
+  REQUIRE (pinned);
+  REQUIRE (json.find("\"workers\":{\"cpus\":\"" + std::to_string(allowed.back()) + "\"")
+      != std::string::npos);
+  REQUIRE (json.find("{\"tid\":" + std::to_string(tid)
+        + ",\"name\":\"rtc-test-pinned\",\"cpus\":\"" + std::to_string(allowed.back()) + "\"")
+      != std::string::npos);
+  /* the calling thread is not affected */
+  REQUIRE (flexran::core::get_thread_cpus(0) == allowed);
+}
@@ -0,0 +1,97 @@
+#include "catch.hpp"
+#include "subscription.h"
+#include "tick_timer.h"
+#include <iostream>
+#include <thread>
+
+using flexran::core::tick_timer;
+using flexran::core::tick_wait;
+
+TEST_CASE("tick timer counts elapsed and missed ticks", "[tick_timer]")
+{
+  const tick_wait mode = GENERATE(tick_wait::timerfd, tick_wait::hybrid, tick_wait::busy);
+  tick_timer timer(std::chrono::microseconds(250), mode);
+  const auto start = std::chrono::steady_clock::now();
+  REQUIRE (timer.start());
+
+  uint64_t ticks = 0;
+  for (int i = 0; i < 40; ++i)
+    ticks += timer.wait();
+  /* a tick passes while not waiting */
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  const uint64_t missed = timer.wait();
+  ticks += missed;
+  const std::chrono::duration<double, std::micro> d = std::chrono::steady_clock::now() - start;
+
+  REQUIRE (missed >= 8);
+  /* the timer keeps its phase: the ticks match the elapsed time */
+  REQUIRE (ticks <= uint64_t(d.count() / 250));
+  REQUIRE (ticks + 2 >= uint64_t(d.count() / 250));
+
+  flexran::core::hdr_histogram::snapshot s;
+  timer.get_wakeup_latency(mode).take_snapshot(s);
+  REQUIRE (s.count == 41);
+}
+
+TEST_CASE("tick timer switches modes and polls while spinning", "[tick_timer]")
+{
+  tick_timer timer(std::chrono::microseconds(250), tick_wait::timerfd);
+  const auto start = std::chrono::steady_clock::now();
+  REQUIRE (timer.start());
+  int polls = 0;
+  auto poll = [&polls] { polls++; };
+  uint64_t ticks = 0;
+  for (tick_wait mode : {tick_wait::timerfd, tick_wait::busy, tick_wait::timerfd,
+                         tick_wait::hybrid}) {
+    timer.set_mode(mode);
+    for (int i = 0; i < 10; ++i)
+      ticks += timer.wait(poll);
+  }
+  const std::chrono::duration<double, std::micro> d = std::chrono::steady_clock::now() - start;
+  /* no tick is lost or counted twice when switching */
+  REQUIRE (ticks <= uint64_t(d.count() / 250));
+  REQUIRE (ticks + 2 >= uint64_t(d.count() / 250));
+  REQUIRE (polls > 0);
+
+  flexran::core::hdr_histogram::snapshot s;
+  timer.get_wakeup_latency(tick_wait::timerfd).take_snapshot(s);
+  REQUIRE (s.count == 20);
+  timer.get_wakeup_latency(tick_wait::busy).take_snapshot(s);
+  REQUIRE (s.count == 10);
+}
+
+TEST_CASE("tick timer wait modes can be parsed", "[tick_timer]")
+{
+  tick_wait w;
+  REQUIRE (flexran::core::parse_tick_wait("hybrid", w));
+  REQUIRE (w == tick_wait::hybrid);
+  REQUIRE (flexran::core::to_string(w) == "hybrid");
+  REQUIRE (flexran::core::parse_tick_wait("busy", w));
+  REQUIRE (w == tick_wait::busy);
+  REQUIRE (!flexran::core::parse_tick_wait("poll", w));
+}
+
+TEST_CASE("subscription converts between ms and ticks", "[tick_timer]")
+{
+  flexran::event::subscription sub;
+  REQUIRE (sub.ms_to_ticks(10) == 10);
+  sub.set_ticks_per_ms(4);
+  REQUIRE (sub.ms_to_ticks(10) == 40);
+  REQUIRE (sub.ticks_to_ms(43) == 10);
+}
+
+/* compares the wakeup latency of the modes for 0.5 ms ticks. Hidden by
+ * default, use "[.stress]" to run. */
+TEST_CASE("tick timer wakeup latency", "[.stress][tick_timer]")
+{
+  for (tick_wait mode : {tick_wait::timerfd, tick_wait::hybrid, tick_wait::busy}) {
+    tick_timer timer(std::chrono::microseconds(500), mode);
+    REQUIRE (timer.start());
+    uint64_t ticks = 0;
+    for (int i = 0; i < 4000; ++i)
+      ticks += timer.wait();
+    std::cout << flexran::core::to_string(mode) << ": " << ticks - 4000
+              << " missed ticks, wakeup latency (us) "
+              << timer.get_wakeup_latency(mode).to_json_string(1000.0) << "\n";
+  }
+}
@@ -0,0 +1,251 @@
+#include "catch.hpp"
+#include "subscription.h"
+#include "timing_wheel.h"
+#include <chrono>
+#include <map>
+#include <iostream>
+#include <random>
+
+using flexran::event::subscription;
+using flexran::event::task_timer;
+using flexran::event::timing_wheel;
+using flexran::event::wheel_timer;
+
+namespace {
+  struct test_timer : public wheel_timer {
+    int id;
+  };
+}
+
+TEST_CASE("timing wheel expires timers exactly at their tick", "[timing_wheel]")
+{
+  /* start shortly before the end of ranges of level 1 and 2 */
+  const uint64_t base = GENERATE(uint64_t(0), uint64_t(65536 - 3), uint64_t((1 << 24) - 300));
+  timing_wheel wheel(base);
+  std::mt19937 gen(base);
+  std::vector<uint64_t> deltas {0, 1, 2, 255, 256, 257, 511, 65535, 65536, 65537, 200000,
+    (1 << 24) + 17};
+  std::uniform_int_distribution<uint64_t> d(0, 300000);
+  for (int i = 0; i < 2000; ++i)
+    deltas.push_back(d(gen));
+
+  std::map<uint64_t, int> expected;
+  for (uint64_t delta : deltas) {
+    auto t = std::make_shared<test_timer>();
+    t->due = base + delta;
+    expected[t->due]++;
+    wheel.insert(t);
+  }
+  REQUIRE (wheel.size() == deltas.size());
+
+  std::vector<std::shared_ptr<wheel_timer>> expired;
+  std::size_t total = 0, wrong = 0;
+  const uint64_t end = base + (1 << 24) + 17;
+  for (uint64_t tick = base; tick <= end; ++tick) {
+    expired.clear();
+    wheel.advance(tick, expired);
+    for (const auto& t : expired)
+      if (t->due != tick) wrong++;
+    const auto it = expected.find(tick);
+    if (expired.size() != std::size_t(it == expected.end() ? 0 : it->second)) wrong++;
+    total += expired.size();
+  }
+  REQUIRE (wrong == 0);
+  REQUIRE (total == deltas.size());
+  REQUIRE (wheel.size() == 0);
+  REQUIRE (wheel.now() == end + 1);
+}
+
+TEST_CASE("timing wheel drops moved timers", "[timing_wheel]")
+{
+  timing_wheel wheel;
+  auto t = std::make_shared<test_timer>();
+  t->due = 1000;
+  wheel.insert(t);
+  /* move it earlier, then cancel another one */
+  t->generation++;
+  t->due = 10;
+  wheel.insert(t);
+  auto c = std::make_shared<test_timer>();
+  c->due = 10;
+  wheel.insert(c);
+  c->generation++;
+
+  std::vector<std::shared_ptr<wheel_timer>> expired;
+  wheel.advance(9, expired);
+  REQUIRE (expired.empty());
+  wheel.advance(10, expired);
+  REQUIRE (expired.size() == 1);
+  REQUIRE (expired[0] == t);
+  expired.clear();
+  wheel.advance(2000, expired);
+  REQUIRE (expired.empty());
+  REQUIRE (wheel.size() == 0);
+
+  /* a timer in the past expires in the next tick */
+  t->due = 5;
+  wheel.insert(t);
+  wheel.advance(2001, expired);
+  REQUIRE (expired.size() == 1);
+}
+
+namespace {
+  void run_ticks(subscription& sub, uint64_t from, uint64_t to,
+      std::vector<std::shared_ptr<const flexran::event::task_job>>& jobs)
+  {
+    for (uint64_t t = from; t <= to; ++t) {
+      sub.advance_task_tick(t, jobs);
+      sub.run_task_tick(t);
+    }
+  }
+}
+
+TEST_CASE("subscription timers keep the task tick semantics", "[timing_wheel]")
+{
+  subscription sub;
+  std::vector<std::shared_ptr<const flexran::event::task_job>> jobs;
+  std::vector<uint64_t> every3, from5;
+  sub.subscribe_task_tick([&every3] (uint64_t t) { every3.push_back(t); }, 3);
+  auto conn = sub.subscribe_task_tick([&from5] (uint64_t t) { from5.push_back(t); }, 4, 5);
+  run_ticks(sub, 0, 12, jobs);
+  REQUIRE (every3 == std::vector<uint64_t>({0, 3, 6, 9, 12}));
+  REQUIRE (from5 == std::vector<uint64_t>({5, 9}));
+
+  /* a start in the past is aligned as before */
+  std::vector<uint64_t> late;
+  sub.subscribe_task_tick([&late] (uint64_t t) { late.push_back(t); }, 10, 2);
+  conn.disconnect();
+  run_ticks(sub, 13, 40, jobs);
+  REQUIRE (late == std::vector<uint64_t>({22, 32}));
+  REQUIRE (from5.size() == 2);
+
+  /* extended subscribers can disconnect themselves */
+  int calls = 0;
+  sub.subscribe_task_tick_extended(
+      [&calls] (const bs2::connection& c, uint64_t) { if (++calls == 2) c.disconnect(); }, 1);
+  run_ticks(sub, 41, 50, jobs);
+  REQUIRE (calls == 2);
+
+  /* jobs are collected instead of called */
+  auto job = std::make_shared<flexran::event::task_job>();
+  sub.subscribe_task_job(job, 5, 50);
+  jobs.clear();
+  run_ticks(sub, 51, 60, jobs);
+  REQUIRE (jobs.size() == 2);
+  REQUIRE (jobs[0] == job);
+}
+
+TEST_CASE("subscription supports one-shot and rescheduled timers", "[timing_wheel]")
+{
+  subscription sub;
+  std::vector<std::shared_ptr<const flexran::event::task_job>> jobs;
+  std::vector<uint64_t> fired;
+  task_timer once = sub.subscribe_task_timer(
+      [&fired] (const bs2::connection&, uint64_t t) { fired.push_back(t); }, 0, 7);
+  REQUIRE (once.connected());
+  run_ticks(sub, 0, 20, jobs);
+  REQUIRE (fired == std::vector<uint64_t>({7}));
+  REQUIRE (!once.connected());
+  REQUIRE (!once.reschedule(0, 30));
+
+  /* a periodic timer changes its period */
+  fired.clear();
+  task_timer periodic = sub.subscribe_task_timer(
+      [&fired] (const bs2::connection&, uint64_t t) { fired.push_back(t); }, 5000, 0);
+  run_ticks(sub, 21, 30, jobs);
+  REQUIRE (fired.empty());
+  REQUIRE (periodic.reschedule(2, 31));
+  run_ticks(sub, 31, 36, jobs);
+  REQUIRE (fired == std::vector<uint64_t>({31, 33, 35}));
+  periodic.disconnect();
+
+  /* a one-shot timer re-arms itself from its callback */
+  fired.clear();
+  task_timer rearm;
+  rearm = sub.subscribe_task_timer(
+      [&fired, &rearm] (const bs2::connection&, uint64_t t) {
+        fired.push_back(t);
+        if (fired.size() < 3) rearm.reschedule(0, t + 10);
+      }, 0, 40);
+  run_ticks(sub, 37, 100, jobs);
+  REQUIRE (fired == std::vector<uint64_t>({40, 50, 60}));
+  REQUIRE (!rearm.connected());
+  /* the old expiry of the rescheduled periodic timer goes at its tick */
+  REQUIRE (sub.num_task_timers() == 1);
+  run_ticks(sub, 101, 5000, jobs);
+  REQUIRE (sub.num_task_timers() == 0);
+}
+
+TEST_CASE("subscription timers skip or catch up missed ticks", "[timing_wheel]")
+{
+  using flexran::event::missed_tick_policy;
+  subscription sub;
+  std::vector<std::shared_ptr<const flexran::event::task_job>> jobs;
+  std::vector<uint64_t> skip, catch_up, job_ticks;
+  sub.subscribe_task_tick([&skip] (uint64_t t) { skip.push_back(t); }, 10, 0, "skip");
+  sub.subscribe_task_tick([&catch_up] (uint64_t t) { catch_up.push_back(t); }, 10, 0,
+      "catch_up", missed_tick_policy::catch_up);
+  auto job = std::make_shared<flexran::event::task_job>();
+  job->fn = [&job_ticks] (uint64_t t) { job_ticks.push_back(t); };
+  job->name = "job";
+  sub.subscribe_task_job(job, 10, 0, missed_tick_policy::catch_up);
+
+  /* the task manager misses ticks 1 to 34 */
+  for (uint64_t t : {uint64_t(0), uint64_t(35), uint64_t(36), uint64_t(40)}) {
+    jobs.clear();
+    sub.advance_task_tick(t, jobs);
+    sub.run_task_tick(t);
+    for (const auto& j : jobs)
+      j->fn(t);
+  }
+  REQUIRE (skip == std::vector<uint64_t>({0, 35, 40}));
+  REQUIRE (catch_up == std::vector<uint64_t>({0, 10, 20, 30, 40}));
+  REQUIRE (job_ticks == std::vector<uint64_t>({0, 10, 20, 30, 40}));
+
+  const std::string json = sub.get_accounting().to_json_string();
+  REQUIRE (json.find("\"name\":\"skip\",\"budget_us\":200,\"runs\":3,\"overruns\":0,"
+        "\"offences\":0,\"deferred\":0,\"missed\":2") != std::string::npos);
+  REQUIRE (json.find("\"name\":\"catch_up\",\"budget_us\":200,\"runs\":5,") != std::string::npos);
+}
+
+/* per-tick cost of many registered timers that are rarely due, compared to
+ * a signal checking the period of each subscriber in every tick as before.
+ * Hidden by default, use "[.stress]" to run. */
+TEST_CASE("timer cost per tick with 10k timers", "[.stress][timing_wheel]")
+{
+  const uint64_t ticks = 20000;
+  for (std::size_t num : {std::size_t(100), std::size_t(10000)}) {
+    std::mt19937 gen(num);
+    /* like elastic_search's config and stats ticks */
+    std::uniform_int_distribution<uint64_t> p(1000, 5000);
+    uint64_t calls = 0;
+
+    subscription sub;
+    flexran::event::task_cb signal;
+    for (std::size_t i = 0; i < num; ++i) {
+      const uint64_t period = p(gen);
+      const uint64_t start = gen() % period;
+      sub.subscribe_task_tick([&calls] (uint64_t) { calls++; }, period, start);
+      signal.connect([&calls,period,start] (uint64_t t) {
+        if (t >= start && (t - start) % period == 0) calls++;
+      });
+    }
+
+    std::vector<std::shared_ptr<const flexran::event::task_job>> jobs;
+    auto s = std::chrono::steady_clock::now();
+    run_ticks(sub, 0, ticks - 1, jobs);
+    const std::chrono::duration<float, std::nano> wheel = std::chrono::steady_clock::now() - s;
+    const uint64_t wheel_calls = calls;
+    calls = 0;
+    s = std::chrono::steady_clock::now();
+    for (uint64_t t = 0; t < ticks; ++t)
+      signal(t);
+    const std::chrono::duration<float, std::nano> modulo = std::chrono::steady_clock::now() - s;
+    REQUIRE (calls == wheel_calls);
+
+    std::cout << num << " timers: wheel " << wheel.count() / ticks
+              << " ns/tick, modulo signal " << modulo.count() / ticks
+              << " ns/tick (" << calls << " calls, i.e., "
+              << float(calls) / ticks << " per tick)\n";
+  }
+}
@@ -0,0 +1,143 @@
+#include "catch.hpp"
+#include "ue_kpi_history.h"
+#include "enb_rib_info.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+
+using flexran::rib::ue_kpis;
+using flexran::rib::ue_kpi_history;
+
+static ue_kpis kpis_with_cqi(uint32_t cqi, uint32_t tx_bytes = 0)
+{
+  ue_kpis k;
+  k.wb_cqi = cqi;
+  k.pdcp_tx_bytes = tx_bytes;
+  return k;
+}
+
+TEST_CASE("KPI history ring buffer keeps the most recent samples", "[ue_kpi_history]")
+{
+  ue_kpi_history::config c;
+  c.capacity = 4;
+  c.windows = {2, 0, 10};
+  ue_kpi_history h(c);
+
+  REQUIRE (h.capacity() == 4);
+  REQUIRE (h.num_windows() == 2); // 0 dropped
+  REQUIRE (h.get_window(1).length == 4); // clamped to capacity
+  REQUIRE (h.get_samples().empty());
+  flexran::rib::ue_kpi_sample s;
+  REQUIRE (h.get_latest(s) == false);
+
+  for (uint32_t i = 0; i < 6; ++i)
+    h.push(i * 10, i, kpis_with_cqi(i));
+
+  REQUIRE (h.num_pushed() == 6);
+  auto samples = h.get_samples();
+  REQUIRE (samples.size() == 4);
+  REQUIRE (samples.front().tick == 20);
+  REQUIRE (samples.back().tick == 50);
+  REQUIRE (samples.back().sfn_sf == 5);
+  REQUIRE (h.get_samples(2).front().kpis.wb_cqi == 4);
+  REQUIRE (h.get_latest(s) == true);
+  REQUIRE (s.kpis.wb_cqi == 5);
+
+  auto w = h.get_window(0);
+  REQUIRE (w.n == 2);
+  REQUIRE (w.kpi[ue_kpis::WB_CQI].mean == Approx(4.5));
+  REQUIRE (w.kpi[ue_kpis::WB_CQI].min == 4);
+  REQUIRE (w.kpi[ue_kpis::WB_CQI].max == 5);
+  REQUIRE (w.kpi[ue_kpis::WB_CQI].rate == Approx(0.1));
+}
+
+TEST_CASE("KPI history aggregates match a recomputation", "[ue_kpi_history]")
+{
+  ue_kpi_history::config c;
+  c.capacity = 50;
+  c.windows = {1, 7, 50};
+  ue_kpi_history h(c);
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<uint32_t> cqi(0, 15);
+  std::deque<uint32_t> all;
+  std::vector<double> ewma(c.windows.size(), 0);
+  uint32_t bytes = 0;
+  for (int i = 0; i < 500; ++i) {
+    const uint32_t v = cqi(gen);
+    bytes += 100;
+    all.push_back(v);
+    h.push(i, 0, kpis_with_cqi(v, bytes));
+
+    for (std::size_t wi = 0; wi < c.windows.size(); ++wi) {
+      const uint32_t l = c.windows[wi];
+      const double alpha = 2.0 / (l + 1);
+      ewma[wi] = i == 0 ? v : ewma[wi] + alpha * (v - ewma[wi]);
+
+      const std::size_t n = std::min<std::size_t>(l, all.size());
+      const auto begin = all.end() - n;
+      double mean = 0, var = 0;
+      for (auto it = begin; it != all.end(); ++it) mean += *it;
+      mean /= n;
+      for (auto it = begin; it != all.end(); ++it) var += (*it - mean) * (*it - mean);
+      var /= n;
+
+      const auto w = h.get_window(wi);
+      const auto& a = w.kpi[ue_kpis::WB_CQI];
+      REQUIRE (w.n == n);
+      REQUIRE (a.mean == Approx(mean));
+      REQUIRE (a.var == Approx(var).margin(1e-9));
+      REQUIRE (a.min == *std::min_element(begin, all.end()));
+      REQUIRE (a.max == *std::max_element(begin, all.end()));
+      REQUIRE (a.ewma == Approx(ewma[wi]));
+      if (n > 1)
+        REQUIRE (w.kpi[ue_kpis::PDCP_TX_BYTES].rate == Approx(100.0));
+    }
+  }
+}
+
+TEST_CASE("KPI history is filled from MAC stats", "[ue_kpi_history]")
+{
+  const int rnti = 0x1234;
+  ue_kpi_history::config c;
+  c.capacity = 8;
+  c.windows = {4};
+  flexran::rib::enb_rib_info rib_info(1, {}, c);
+
+  protocol::flex_ue_state_change sc;
+  sc.set_type(protocol::FLUESC_ACTIVATED);
+  sc.mutable_config()->set_rnti(rnti);
+  rib_info.update_UE_config(sc);
+
+  for (int i = 0; i < 3; ++i) {
+    protocol::flex_stats_reply sr;
+    protocol::flex_ue_stats_report *r = sr.add_ue_report();
+    r->set_rnti(rnti);
+    r->set_flags(protocol::FLUST_PHR);
+    r->set_phr(10 + i);
+    rib_info.update_mac_stats(sr, 100 + i);
+  }
+
+  const ue_kpi_history *h = rib_info.get_ue_mac_info(rnti)->get_kpi_history();
+  REQUIRE (h != nullptr);
+  REQUIRE (h->num_pushed() == 3);
+  REQUIRE (h->get_samples().back().tick == 102);
+  REQUIRE (h->get_window(0).kpi[ue_kpis::PHR].mean == Approx(11));
+
+  std::string json;
+  rib_info.publish();
+  REQUIRE (rib_info.dump_ue_history_by_rnti_to_json_string(rnti, json, 1) == true);
+  REQUIRE (json.find("\"num_pushed\":3") != std::string::npos);
+  REQUIRE (json.find("\"phr\":12") != std::string::npos);
+  REQUIRE (rib_info.dump_ue_history_by_rnti_to_json_string(rnti + 1, json, 1) == false);
+
+  SECTION("capacity 0 disables the history") {
+    flexran::rib::enb_rib_info no_hist(2, {}, ue_kpi_history::config{0, {}});
+    no_hist.update_UE_config(sc);
+    no_hist.publish();
+    REQUIRE (no_hist.get_ue_mac_info(rnti)->get_kpi_history() == nullptr);
+    REQUIRE (no_hist.dump_ue_history_by_rnti_to_json_string(rnti, json, 1) == true);
+    REQUIRE (json.find("\"history\":null") != std::string::npos);
+  }
+}